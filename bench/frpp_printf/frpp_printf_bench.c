@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_printf_bench.c
+ * @author Evan Stoddard
+ * @brief Benchmark of frpp_printf packaging and rendering against eager
+ * snprintf
+ *
+ * Usage: frpp_printf_bench [iterations]
+ *
+ * Prints a single JSON document to stdout with ns/op and bytes/op for each
+ * workload case and mode.  Each measurement is the best of several runs to
+ * filter out scheduling noise.  Build with CMAKE_BUILD_TYPE=Release for
+ * meaningful numbers.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "frpp/sys/frpp_printf.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define FRPP_BENCH_ITERATIONS_DEFAULT (200000UL)
+
+/**
+ * @brief Runs per measurement, the fastest is reported
+ */
+#define FRPP_BENCH_RUNS (7U)
+
+#ifndef FRPP_BENCH_BUILD_TYPE
+#define FRPP_BENCH_BUILD_TYPE ""
+#endif
+
+#define FRPP_BENCH_PKG_MAX (256U)
+#define FRPP_BENCH_OUT_MAX (256U)
+
+/**
+ * @brief Define a workload case.  Arguments are read from prv_args so the
+ * compiler can't fold them into the format string.
+ */
+#define FRPP_BENCH_CASE(name_, fmt_, ...)                                      \
+  static int prv_##name_##_package(void *dst, size_t len, uint32_t flags) {    \
+    return frpp_printf_package(dst, len, flags, fmt_, __VA_ARGS__);            \
+  }                                                                            \
+  static int prv_##name_##_eager(char *out, size_t len) {                      \
+    return snprintf(out, len, fmt_, __VA_ARGS__);                              \
+  }
+
+#define FRPP_BENCH_ENTRY(name_, fmt_)                                          \
+  {#name_, fmt_, prv_##name_##_package, prv_##name_##_eager}
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Workload case
+ */
+struct frpp_bench_case {
+  const char *name;
+  const char *fmt;
+  int (*package)(void *dst, size_t len, uint32_t flags);
+  int (*eager)(char *out, size_t len);
+};
+
+/**
+ * @brief Benchmark mode
+ */
+typedef enum {
+  FRPP_BENCH_PACKAGE_SIZE,
+  FRPP_BENCH_PACKAGE,
+  FRPP_BENCH_PACKAGE_DENSE,
+  FRPP_BENCH_RENDER,
+  FRPP_BENCH_EAGER,
+  FRPP_BENCH_MODE_COUNT,
+} frpp_bench_mode_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static volatile struct {
+  int i;
+  unsigned int u;
+  long l;
+  long long ll;
+  size_t z;
+  double d;
+  char c;
+  const char *s;
+} prv_args = {
+    .i = -1234,
+    .u = 48879U,
+    .l = 1234567L,
+    .ll = -9000000000LL,
+    .z = 4096,
+    .d = 3.14159,
+    .c = 'k',
+    .s = "sensor0",
+};
+
+static const char *const prv_mode_names[FRPP_BENCH_MODE_COUNT] = {
+    "package_size", "package", "package_dense", "render", "eager_snprintf",
+};
+
+/**
+ * @brief Results are accumulated here so no call can be optimized out
+ */
+static volatile size_t prv_sink;
+
+static int prv_literal_package(void *dst, size_t len, uint32_t flags) {
+  return frpp_printf_package(dst, len, flags, "boot complete");
+}
+
+static int prv_literal_eager(char *out, size_t len) {
+  return snprintf(out, len, "boot complete");
+}
+
+FRPP_BENCH_CASE(int, "count=%d", prv_args.i)
+FRPP_BENCH_CASE(mixed, "%s: %d/%u 0x%08x", prv_args.s, prv_args.i, prv_args.u,
+                prv_args.u)
+FRPP_BENCH_CASE(long_long, "t=%lld n=%zu id=%llx", prv_args.ll, prv_args.z,
+                (unsigned long long)prv_args.ll)
+FRPP_BENCH_CASE(float, "v=%.3f avg=%8.2f", prv_args.d, prv_args.d * 2)
+FRPP_BENCH_CASE(string, "name=%s host=%-12s|", prv_args.s, prv_args.s)
+FRPP_BENCH_CASE(many, "%d %d %d %u %ld %lld %s %c %x %f %zu", prv_args.i,
+                prv_args.i + 1, prv_args.i + 2, prv_args.u, prv_args.l,
+                prv_args.ll, prv_args.s, prv_args.c, prv_args.u, prv_args.d,
+                prv_args.z)
+
+static const struct frpp_bench_case prv_cases[] = {
+    FRPP_BENCH_ENTRY(literal, "boot complete"),
+    FRPP_BENCH_ENTRY(int, "count=%d"),
+    FRPP_BENCH_ENTRY(mixed, "%s: %d/%u 0x%08x"),
+    FRPP_BENCH_ENTRY(long_long, "t=%lld n=%zu id=%llx"),
+    FRPP_BENCH_ENTRY(float, "v=%.3f avg=%8.2f"),
+    FRPP_BENCH_ENTRY(string, "name=%s host=%-12s|"),
+    FRPP_BENCH_ENTRY(many, "%d %d %d %u %ld %lld %s %c %x %f %zu"),
+};
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Monotonic time in nanoseconds
+ */
+static uint64_t prv_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Run one mode of a case once
+ *
+ * @param bench Case
+ * @param mode Mode
+ * @param pkg Package of case's arguments (rendered in FRPP_BENCH_RENDER)
+ * @param scratch Scratch buffer
+ * @return Bytes produced (package or output length)
+ */
+static int prv_run_once(const struct frpp_bench_case *bench,
+                        frpp_bench_mode_t mode, const void *pkg,
+                        uint8_t *scratch) {
+  switch (mode) {
+  case FRPP_BENCH_PACKAGE_SIZE:
+    return bench->package(NULL, 0, 0);
+  case FRPP_BENCH_PACKAGE:
+    return bench->package(scratch, FRPP_BENCH_PKG_MAX, 0);
+  case FRPP_BENCH_PACKAGE_DENSE:
+    return bench->package(scratch, FRPP_BENCH_PKG_MAX, FRPP_PRINTF_FLAG_DENSE);
+  case FRPP_BENCH_RENDER:
+    return frpp_snprintf(bench->fmt, pkg, scratch, FRPP_BENCH_OUT_MAX);
+  case FRPP_BENCH_EAGER:
+    return bench->eager((char *)scratch, FRPP_BENCH_OUT_MAX);
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief Measure one mode of a case
+ *
+ * @param bench Case
+ * @param mode Mode
+ * @param iterations Calls per run
+ * @param bytes Bytes produced per call output
+ * @return Best ns per call
+ */
+static double prv_measure(const struct frpp_bench_case *bench,
+                          frpp_bench_mode_t mode, unsigned long iterations,
+                          int *bytes) {
+  _Alignas(max_align_t) uint8_t pkg[FRPP_BENCH_PKG_MAX];
+  _Alignas(max_align_t) uint8_t scratch[FRPP_BENCH_OUT_MAX];
+  uint64_t best = UINT64_MAX;
+
+  bench->package(pkg, sizeof(pkg), 0);
+  *bytes = prv_run_once(bench, mode, pkg, scratch);
+
+  for (unsigned int run = 0; run < FRPP_BENCH_RUNS; run++) {
+    size_t sink = 0;
+    uint64_t start = prv_now_ns();
+
+    for (unsigned long i = 0; i < iterations; i++) {
+      sink += (size_t)prv_run_once(bench, mode, pkg, scratch);
+    }
+
+    uint64_t elapsed = prv_now_ns() - start;
+    prv_sink += sink;
+
+    if (elapsed < best) {
+      best = elapsed;
+    }
+  }
+
+  return (double)best / (double)iterations;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int main(int argc, char **argv) {
+  unsigned long iterations = FRPP_BENCH_ITERATIONS_DEFAULT;
+
+  if (argc > 2) {
+    fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (argc == 2) {
+    iterations = strtoul(argv[1], NULL, 0);
+    if (iterations == 0) {
+      fprintf(stderr, "%s: invalid iteration count\n", argv[1]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  printf("{\n  \"benchmark\": \"frpp_printf\",\n");
+  printf("  \"build_type\": \"%s\",\n", FRPP_BENCH_BUILD_TYPE);
+  printf("  \"iterations\": %lu,\n  \"runs\": %u,\n", iterations,
+         FRPP_BENCH_RUNS);
+  printf("  \"results\": [\n");
+
+  const size_t count = sizeof(prv_cases) / sizeof(prv_cases[0]);
+
+  for (size_t i = 0; i < count; i++) {
+    for (int mode = 0; mode < FRPP_BENCH_MODE_COUNT; mode++) {
+      int bytes = 0;
+      double ns = prv_measure(&prv_cases[i], (frpp_bench_mode_t)mode,
+                              iterations, &bytes);
+      bool last = (i == count - 1) && (mode == FRPP_BENCH_MODE_COUNT - 1);
+
+      printf("    {\"case\": \"%s\", \"mode\": \"%s\", \"ns_per_op\": %.2f, "
+             "\"bytes_per_op\": %d}%s\n",
+             prv_cases[i].name, prv_mode_names[mode], ns, bytes,
+             last ? "" : ",");
+    }
+  }
+
+  printf("  ]\n}\n");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log.h
+ * @author Evan Stoddard
+ * @brief Leveled logging front end for the deferred log queue.
+ *
+ * Statements above FRPP_LOG_LEVEL_COMPILE expand to nothing, so neither
+ * their format string nor their arguments make it into the binary.  The rest
+ * are filtered at runtime by their module's level, which costs one load and
+ * a branch before any argument is evaluated or packaged.
+ *
+ * Usage:
+ *
+ *   FRPP_LOG_MODULE_DEFINE(sensor, FRPP_LOG_LEVEL_INFO);
+ *
+ *   FRPP_LOG_INF(sensor, "sample %d", val);
+ *
+ * Other files log to the module after FRPP_LOG_MODULE_DECLARE(sensor).
+ * Records go to the queue given to frpp_log_init, with the format string
+ * interned and prefixed with the level and module, e.g. "I [sensor] ".
+ *
+ * Each format string may log FRPP_LOG_LIMIT_BURST records per
+ * FRPP_LOG_LIMIT_WINDOW ticks.  Further records are dropped before being
+ * packaged and counted, and the count is logged as a single
+ * "(repeated N times)" record once the window rolls over or
+ * frpp_log_limit_flush is called.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frpp/logging/frpp_log_fmt.h"
+#include "frpp/logging/frpp_log_queue.h"
+
+#ifndef frpp_log_h
+#define frpp_log_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/* Levels, in order of increasing verbosity */
+#define FRPP_LOG_LEVEL_OFF (0)
+#define FRPP_LOG_LEVEL_ERROR (1)
+#define FRPP_LOG_LEVEL_WARN (2)
+#define FRPP_LOG_LEVEL_INFO (3)
+#define FRPP_LOG_LEVEL_DEBUG (4)
+
+/**
+ * @brief Most verbose level compiled in.  May be overridden per translation
+ * unit by defining it before including this header.
+ */
+#ifndef FRPP_LOG_LEVEL_COMPILE
+#define FRPP_LOG_LEVEL_COMPILE FRPP_LOG_LEVEL_INFO
+#endif
+
+/**
+ * @brief Format strings tracked for rate limiting.  Must be a power of two,
+ * and a multiple of FRPP_LOG_LIMIT_WAYS.  Set to 0 to disable rate limiting.
+ */
+#ifndef FRPP_LOG_LIMIT_SLOTS
+#define FRPP_LOG_LIMIT_SLOTS (32U)
+#endif
+
+/**
+ * @brief Slots per set.  A format string's pointer hashes to a set, and the
+ * check only scans that set, so it stays O(1).  Up to this many format
+ * strings sharing a set are tracked together; past that, the least recently
+ * logged is evicted.  Must be a power of two.
+ */
+#ifndef FRPP_LOG_LIMIT_WAYS
+#define FRPP_LOG_LIMIT_WAYS (4U)
+#endif
+
+/**
+ * @brief Records logged per format string per window before suppressing
+ */
+#ifndef FRPP_LOG_LIMIT_BURST
+#define FRPP_LOG_LIMIT_BURST (8U)
+#endif
+
+/**
+ * @brief Length of rate limiting window in ticks of the source given to
+ * frpp_log_limit_set_tick.  Without one, records aren't rate limited.
+ */
+#ifndef FRPP_LOG_LIMIT_WINDOW
+#define FRPP_LOG_LIMIT_WINDOW (1000U)
+#endif
+
+#if (FRPP_LOG_LIMIT_SLOTS & (FRPP_LOG_LIMIT_SLOTS - 1)) != 0
+#error "FRPP_LOG_LIMIT_SLOTS must be a power of two"
+#endif
+
+#if FRPP_LOG_LIMIT_WAYS == 0 ||                                                \
+    (FRPP_LOG_LIMIT_WAYS & (FRPP_LOG_LIMIT_WAYS - 1)) != 0
+#error "FRPP_LOG_LIMIT_WAYS must be a power of two"
+#endif
+
+#if FRPP_LOG_LIMIT_SLOTS && FRPP_LOG_LIMIT_SLOTS < FRPP_LOG_LIMIT_WAYS
+#error "FRPP_LOG_LIMIT_SLOTS must be a multiple of FRPP_LOG_LIMIT_WAYS"
+#endif
+
+/**
+ * @brief Section modules are placed in, so they can be looked up by name
+ */
+#define FRPP_LOG_MODULE_SECTION "frpp_log_mod"
+
+/**
+ * @brief Define a log module
+ *
+ * @param name_ Module name (identifier)
+ * @param level_ Initial runtime level
+ */
+#define FRPP_LOG_MODULE_DEFINE(name_, level_)                                  \
+  struct frpp_log_module frpp_log_module_##name_                               \
+      __attribute__((section(FRPP_LOG_MODULE_SECTION), used)) = {              \
+          .name = #name_,                                                      \
+          .level = (level_),                                                   \
+  }
+
+/**
+ * @brief Declare a log module defined in another file
+ */
+#define FRPP_LOG_MODULE_DECLARE(name_)                                         \
+  extern struct frpp_log_module frpp_log_module_##name_
+
+/**
+ * @brief Pointer to a log module
+ */
+#define FRPP_LOG_MODULE(name_) (&frpp_log_module_##name_)
+
+/**
+ * @brief Log at level if the module's runtime level allows it.  Arguments
+ * are only evaluated if it does.
+ */
+#define FRPP_LOG_(mod_, level_, tag_, fmt_, ...)                               \
+  do {                                                                         \
+    if (__builtin_expect(                                                      \
+            __atomic_load_n(&frpp_log_module_##mod_.level,                     \
+                            __ATOMIC_RELAXED) >= (level_),                     \
+            0)) {                                                              \
+      frpp_log_printf(FRPP_LOG_FMT(tag_ " [" #mod_ "] " fmt_),                 \
+                      ##__VA_ARGS__);                                          \
+    }                                                                          \
+  } while (0)
+
+#if FRPP_LOG_LEVEL_COMPILE >= FRPP_LOG_LEVEL_ERROR
+#define FRPP_LOG_ERR(mod_, fmt_, ...)                                          \
+  FRPP_LOG_(mod_, FRPP_LOG_LEVEL_ERROR, "E", fmt_, ##__VA_ARGS__)
+#else
+#define FRPP_LOG_ERR(mod_, fmt_, ...)                                          \
+  do {                                                                         \
+  } while (0)
+#endif
+
+#if FRPP_LOG_LEVEL_COMPILE >= FRPP_LOG_LEVEL_WARN
+#define FRPP_LOG_WRN(mod_, fmt_, ...)                                          \
+  FRPP_LOG_(mod_, FRPP_LOG_LEVEL_WARN, "W", fmt_, ##__VA_ARGS__)
+#else
+#define FRPP_LOG_WRN(mod_, fmt_, ...)                                          \
+  do {                                                                         \
+  } while (0)
+#endif
+
+#if FRPP_LOG_LEVEL_COMPILE >= FRPP_LOG_LEVEL_INFO
+#define FRPP_LOG_INF(mod_, fmt_, ...)                                          \
+  FRPP_LOG_(mod_, FRPP_LOG_LEVEL_INFO, "I", fmt_, ##__VA_ARGS__)
+#else
+#define FRPP_LOG_INF(mod_, fmt_, ...)                                          \
+  do {                                                                         \
+  } while (0)
+#endif
+
+#if FRPP_LOG_LEVEL_COMPILE >= FRPP_LOG_LEVEL_DEBUG
+#define FRPP_LOG_DBG(mod_, fmt_, ...)                                          \
+  FRPP_LOG_(mod_, FRPP_LOG_LEVEL_DEBUG, "D", fmt_, ##__VA_ARGS__)
+#else
+#define FRPP_LOG_DBG(mod_, fmt_, ...)                                          \
+  do {                                                                         \
+  } while (0)
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Log module.  Define with FRPP_LOG_MODULE_DEFINE.  Aligned so
+ * modules are laid out in their section as an array.
+ */
+struct frpp_log_module {
+  /* Module name */
+  const char *name;
+
+  /* Most verbose level logged at runtime.  Accessed with __atomic builtins
+   * rather than as a C11 atomic so the macros also build as C++. */
+  uint8_t level;
+} __attribute__((aligned(sizeof(void *))));
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Set queue records are logged to
+ *
+ * @param queue Queue instance
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_log_init(struct frpp_log_queue *queue);
+
+/**
+ * @brief Log to queue given to frpp_log_init without any filtering.  Used by
+ * the FRPP_LOG_* macros.
+ *
+ * @param fmt_str Format string.  Must be in RO memory
+ * @retval 0 Success
+ * @retval -ENODEV frpp_log_init hasn't been called
+ * @retval Negative errno from frpp_log_queue_vprintf
+ */
+int frpp_log_printf(const char *fmt_str, ...)
+    __attribute__((format(printf, 1, 2)));
+
+/**
+ * @brief Same as frpp_log_printf, taking a va_list
+ *
+ * @param fmt_str Format string.  Must be in RO memory
+ * @param args va_list instance
+ * @retval 0 Success, including records suppressed by rate limiting
+ * @retval -ENODEV frpp_log_init hasn't been called
+ * @retval Negative errno from frpp_log_queue_vprintf
+ */
+int frpp_log_vprintf(const char *fmt_str, va_list args);
+
+/**
+ * @brief Set tick source windows of rate limiting are measured with
+ *
+ * @param tick Tick source (e.g. a wrapper of xTaskGetTickCount), NULL to
+ * stop rate limiting
+ */
+void frpp_log_limit_set_tick(uint32_t (*tick)(void));
+
+/**
+ * @brief Log a "(repeated N times)" record for every format string with
+ * suppressed records and start a new window for all format strings.  Call
+ * periodically (e.g. from the consumer) so repeats of a format string that
+ * stopped logging are still reported.
+ *
+ * @retval Non-negative Number of records logged
+ * @retval -ENODEV frpp_log_init hasn't been called
+ */
+int frpp_log_limit_flush(void);
+
+/**
+ * @brief Set runtime level of a module
+ *
+ * @param mod Module
+ * @param level FRPP_LOG_LEVEL_*
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_log_module_set_level(struct frpp_log_module *mod, uint8_t level);
+
+/**
+ * @brief Get runtime level of a module
+ *
+ * @param mod Module
+ * @return FRPP_LOG_LEVEL_*
+ */
+uint8_t frpp_log_module_get_level(const struct frpp_log_module *mod);
+
+/**
+ * @brief Look up a module by name
+ *
+ * @param name Module name
+ * @return Module, or NULL if no module has that name
+ */
+struct frpp_log_module *frpp_log_module_find(const char *name);
+
+/**
+ * @brief All modules in the image
+ *
+ * @param count Number of modules output
+ * @return Array of modules
+ */
+struct frpp_log_module *frpp_log_modules(size_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_log_h */
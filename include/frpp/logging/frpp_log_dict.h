@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_dict.h
+ * @author Evan Stoddard
+ * @brief Dictionary ("tokenized") binary log streaming.  Instead of rendering
+ * text on target, the format string's address and its dense
+ * (FRPP_PRINTF_FLAG_DENSE) frpp_printf_package bytes are streamed to a sink
+ * as frames.  A host tool
+ * (tools/frpp_log_decode) resolves the address against the firmware ELF and
+ * renders the record offline.
+ *
+ * Every frame is a 3 byte header followed by its payload:
+ *
+ *   u8 type | u16 payload length (little endian) | payload
+ *
+ * FRPP_LOG_DICT_FRAME_SYNC payload describes the target so the decoder can
+ * translate packages and relocate addresses.  Multi-byte fields other than
+ * the frame length are in target byte order:
+ *
+ *   "FRPD" | u8 version | u8 flags | u8 sizeof(void *) | u8 sizeof(long) |
+ *   u8 FRPP_STACK_MIN_ALIGN | u8 FRPP_LOG_FMT_ALIGN |
+ *   u8 sizeof(long double) | u8 LDBL_MANT_DIG | u8 sizeof(wchar_t) |
+ *   u8 sizeof(wint_t) | address of frpp_log_dict_anchor
+ *
+ * FRPP_LOG_DICT_FRAME_RECORD payload:
+ *
+ *   format string address | package
+ *
+ * FRPP_LOG_DICT_FRAME_RECORD_ID payload, used when the format string was
+ * interned with FRPP_LOG_FMT (see frpp_log_fmt.h):
+ *
+ *   u16 format string ID | package
+ *
+ * Packages of format strings with positional (%n$) arguments use the
+ * regular layout instead, see FRPP_PRINTF_FLAG_DENSE.
+ *
+ * Format strings must be in RO memory so the decoder can find them in the
+ * ELF.  %s and %ls arguments are decoded the same way; strings that aren't in
+ * the ELF are shown by address.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef frpp_log_dict_h
+#define frpp_log_dict_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Largest frame produced, in bytes.  Frames are built on the caller's
+ * stack.
+ */
+#ifndef FRPP_LOG_DICT_FRAME_MAX
+#define FRPP_LOG_DICT_FRAME_MAX (128U)
+#endif
+
+/**
+ * @brief Stream format version carried by sync frames
+ */
+#define FRPP_LOG_DICT_VERSION (4U)
+
+/**
+ * @brief Size of frame header in bytes
+ */
+#define FRPP_LOG_DICT_HDR_SIZE (3U)
+
+/* Frame types */
+#define FRPP_LOG_DICT_FRAME_SYNC (0x00U)
+#define FRPP_LOG_DICT_FRAME_RECORD (0x01U)
+#define FRPP_LOG_DICT_FRAME_RECORD_ID (0x02U)
+
+/* Sync frame flags */
+#define FRPP_LOG_DICT_SYNC_BIG_ENDIAN (1U << 0)
+#define FRPP_LOG_DICT_SYNC_DENSE (1U << 1) /* Packages are dense */
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Sink callback.  Called once per frame with the complete frame.
+ *
+ * @param ctx Sink context
+ * @param data Frame
+ * @param len Length of frame
+ * @return 0 on success, negative error code otherwise
+ */
+typedef int (*frpp_log_dict_write_t)(void *ctx, const void *data, size_t len);
+
+/**
+ * @brief Dictionary stream instance.  Treat members as private.
+ */
+struct frpp_log_dict {
+  /* Sink callback */
+  frpp_log_dict_write_t write;
+
+  /* Sink context */
+  void *ctx;
+};
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Symbol whose address is sent in sync frames.  The decoder compares
+ * it to the symbol's ELF address to find the load bias of position
+ * independent images.
+ */
+extern const char frpp_log_dict_anchor[];
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize dictionary stream
+ *
+ * @param dict Stream instance
+ * @param write Sink callback
+ * @param ctx Sink context
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_log_dict_init(struct frpp_log_dict *dict, frpp_log_dict_write_t write,
+                       void *ctx);
+
+/**
+ * @brief Emit a sync frame.  Must be sent before the first record, and can
+ * be repeated so a decoder can join a stream part way through.
+ *
+ * @param dict Stream instance
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval Negative Error returned by sink
+ */
+int frpp_log_dict_sync(struct frpp_log_dict *dict);
+
+/**
+ * @brief Stream a record without rendering it
+ *
+ * @param dict Stream instance
+ * @param fmt_str Format string.  Must be in RO memory
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Record doesn't fit in FRPP_LOG_DICT_FRAME_MAX
+ * @retval Negative Error returned by sink
+ */
+int frpp_log_dict_printf(struct frpp_log_dict *dict, const char *fmt_str, ...);
+
+/**
+ * @brief Same as frpp_log_dict_printf but takes a va_list
+ *
+ * @param dict Stream instance
+ * @param fmt_str Format string.  Must be in RO memory
+ * @param args va_list instance
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Record doesn't fit in FRPP_LOG_DICT_FRAME_MAX
+ * @retval Negative Error returned by sink
+ */
+int frpp_log_dict_vprintf(struct frpp_log_dict *dict, const char *fmt_str,
+                          va_list args);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_log_dict_h */
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_fmt.h
+ * @author Evan Stoddard
+ * @brief Format string interning.  FRPP_LOG_FMT places a format string in
+ * the frpp_log_fmt linker section, where it can be identified by a 16-bit ID
+ * derived from its offset instead of a full pointer.  Deferred log records
+ * store the ID, and host tools map IDs back to strings by reading the
+ * section out of the ELF.
+ *
+ * GNU ld and lld define __start_frpp_log_fmt/__stop_frpp_log_fmt for the
+ * section automatically.  Custom linker scripts must keep the section and
+ * define both symbols, e.g.:
+ *
+ *   .frpp_log_fmt : {
+ *     __start_frpp_log_fmt = .;
+ *     KEEP(*(frpp_log_fmt))
+ *     __stop_frpp_log_fmt = .;
+ *   } > FLASH
+ */
+
+#include <stdint.h>
+
+#ifndef frpp_log_fmt_h
+#define frpp_log_fmt_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Name of linker section holding interned format strings
+ */
+#define FRPP_LOG_FMT_SECTION "frpp_log_fmt"
+
+/**
+ * @brief Alignment of interned format strings.  IDs count in units of this,
+ * so the section can hold up to 64K * FRPP_LOG_FMT_ALIGN bytes.
+ */
+#ifndef FRPP_LOG_FMT_ALIGN
+#define FRPP_LOG_FMT_ALIGN (4U)
+#endif
+
+/**
+ * @brief ID of format strings that aren't interned
+ */
+#define FRPP_LOG_FMT_ID_NONE (0xFFFFU)
+
+/**
+ * @brief Intern a string literal format string, evaluating to a pointer to
+ * the interned copy
+ */
+#define FRPP_LOG_FMT(str_)                                                     \
+  (__extension__({                                                             \
+    static const char frpp_log_fmt_[]                                          \
+        __attribute__((section(FRPP_LOG_FMT_SECTION),                          \
+                       aligned(FRPP_LOG_FMT_ALIGN), used)) = str_;             \
+    &frpp_log_fmt_[0];                                                         \
+  }))
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Get ID of a format string
+ *
+ * @param fmt_str Format string
+ * @return ID, or FRPP_LOG_FMT_ID_NONE if fmt_str isn't interned
+ */
+uint16_t frpp_log_fmt_id(const char *fmt_str);
+
+/**
+ * @brief Get interned format string from its ID
+ *
+ * @param id ID returned by frpp_log_fmt_id
+ * @return Format string, or NULL if ID is out of range
+ */
+const char *frpp_log_fmt_str(uint16_t id);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_log_fmt_h */
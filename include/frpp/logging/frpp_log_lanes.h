@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_lanes.h
+ * @author Evan Stoddard
+ * @brief Per-thread deferred log buffers.  Each thread or task owns a lane,
+ * a single-producer/single-consumer ring it packages records into with a
+ * timestamp, stored as a delta from the lane's previous record.  Producers
+ * never write a cache line another producer or the consumer writes, so
+ * logging throughput scales with core count where a shared frpp_log_queue
+ * contends on its head.
+ *
+ * A single consumer merges lanes by timestamp (k-way) and renders records
+ * with frpp_snprintf.  Records are merged in order among those visible to
+ * the consumer; a record published after later-stamped records from other
+ * lanes were rendered is rendered when it is seen.
+ */
+
+#include <stdarg.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frpp/logging/frpp_log_fmt.h"
+#include "frpp/sys/frpp_printf.h"
+#include "frpp/sys/frpp_timestamp.h"
+#include "frpp/utils/atomic.h"
+
+#ifndef frpp_log_lanes_h
+#define frpp_log_lanes_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Cache line size.  Producer and consumer state of a lane are kept on
+ * separate lines, and lanes never share one.
+ */
+#ifndef FRPP_LOG_LANES_CACHE_LINE
+#define FRPP_LOG_LANES_CACHE_LINE (64U)
+#endif
+
+/**
+ * @brief Alignment of records within a lane.  Must be at least the
+ * alignment of the largest packaged argument.
+ */
+#ifndef FRPP_LOG_LANES_ALIGN
+#define FRPP_LOG_LANES_ALIGN (8U)
+#endif
+
+/**
+ * @brief Most lanes merged by one consumer.  Bounds the consumer's stack.
+ */
+#ifndef FRPP_LOG_LANES_MAX
+#define FRPP_LOG_LANES_MAX (16U)
+#endif
+
+/**
+ * @brief Package flags used by frpp_log_lane_printf (see
+ * FRPP_LOG_QUEUE_PKG_FLAGS)
+ */
+#ifndef FRPP_LOG_LANES_PKG_FLAGS
+#define FRPP_LOG_LANES_PKG_FLAGS (0U)
+#endif
+
+/**
+ * @brief Log to lane with format string interned.  fmt_ must be a string
+ * literal.
+ */
+#define FRPP_LOG_LANE_PRINTF(lane_, fmt_, ...)                                 \
+  frpp_log_lane_printf((lane_), FRPP_LOG_FMT(fmt_), ##__VA_ARGS__)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Lane instance.  Treat members as private.
+ */
+struct frpp_log_lane {
+  /* Written by producer: monotonic position of next record, the last tail
+   * seen, timestamp of the last record, and records dropped because the
+   * lane was full */
+  alignas(FRPP_LOG_LANES_CACHE_LINE) FRPP_ATOMIC(size_t) head;
+  size_t tail_cache;
+  uint64_t last_ts;
+  FRPP_ATOMIC(size_t) dropped;
+
+  /* Written by consumer: monotonic position of oldest record, the last head
+   * seen, and timestamp of the last record consumed */
+  alignas(FRPP_LOG_LANES_CACHE_LINE) FRPP_ATOMIC(size_t) tail;
+  size_t head_cache;
+  uint64_t ts;
+
+  /* Read only once set up */
+  alignas(FRPP_LOG_LANES_CACHE_LINE) uint8_t *buf;
+  size_t size;
+  frpp_timestamp_source_t clock;
+  FRPP_ATOMIC(bool) claimed;
+};
+
+/**
+ * @brief Set of lanes merged by one consumer
+ */
+struct frpp_log_lanes {
+  /* Lanes */
+  struct frpp_log_lane *lanes;
+
+  /* Number of lanes */
+  size_t count;
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize lane over caller-provided storage
+ *
+ * @param lane Lane instance
+ * @param buf Ring storage.  Must be aligned to FRPP_LOG_LANES_ALIGN
+ * @param size Size of ring storage.  Must be a power of two
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_log_lane_init(struct frpp_log_lane *lane, void *buf, size_t size);
+
+/**
+ * @brief Initialize set of lanes.  Lanes must be initialized first.
+ *
+ * @param lanes Lanes instance
+ * @param lane Array of lanes
+ * @param count Number of lanes, at most FRPP_LOG_LANES_MAX
+ * @param clock Timestamp source, e.g. frpp_timestamp_cycles
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_log_lanes_init(struct frpp_log_lanes *lanes,
+                        struct frpp_log_lane *lane, size_t count,
+                        frpp_timestamp_source_t clock);
+
+/**
+ * @brief Claim an unused lane, e.g. once when a thread starts.  Keep it in
+ * the thread's context or thread local storage.
+ *
+ * @param lanes Lanes instance
+ * @return Lane, or NULL if all are claimed
+ */
+struct frpp_log_lane *frpp_log_lanes_claim(struct frpp_log_lanes *lanes);
+
+/**
+ * @brief Release a claimed lane.  Records already logged are still
+ * rendered.
+ *
+ * @param lane Lane instance
+ */
+void frpp_log_lane_release(struct frpp_log_lane *lane);
+
+/**
+ * @brief Log to lane.  Only the thread owning the lane may call this.
+ *
+ * @param lane Lane instance
+ * @param fmt_str Format string.  Must be in RO memory
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Lane is full, record dropped
+ */
+int frpp_log_lane_printf(struct frpp_log_lane *lane, const char *fmt_str,
+                         ...);
+
+/**
+ * @brief Same as frpp_log_lane_printf, taking a va_list
+ *
+ * @param lane Lane instance
+ * @param fmt_str Format string.  Must be in RO memory
+ * @param args va_list instance
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Lane is full, record dropped
+ */
+int frpp_log_lane_vprintf(struct frpp_log_lane *lane, const char *fmt_str,
+                          va_list args);
+
+/**
+ * @brief Same as frpp_log_lane_vprintf, with package flags given per call
+ *
+ * @param lane Lane instance
+ * @param flags FRPP_PRINTF_FLAG_* package flags
+ * @param fmt_str Format string.  Must be in RO memory
+ * @param args va_list instance
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Lane is full, record dropped
+ */
+int frpp_log_lane_vprintf_ex(struct frpp_log_lane *lane, uint32_t flags,
+                             const char *fmt_str, va_list args);
+
+/**
+ * @brief Get number of records dropped because the lane was full
+ *
+ * @param lane Lane instance
+ * @return Records dropped
+ */
+size_t frpp_log_lane_dropped(struct frpp_log_lane *lane);
+
+/**
+ * @brief Render and release the oldest record across lanes.  Consumer only.
+ *
+ * @param lanes Lanes instance
+ * @param out_buf Output buffer
+ * @param out_buf_size_bytes Size of output buffer
+ * @param timestamp Timestamp of record output, may be NULL
+ * @retval Non-negative Return value of frpp_snprintf for record
+ * @retval -EINVAL Invalid input arguments
+ * @retval -EAGAIN No record available
+ */
+int frpp_log_lanes_render(struct frpp_log_lanes *lanes, void *out_buf,
+                          size_t out_buf_size_bytes, uint64_t *timestamp);
+
+/**
+ * @brief Merge records across lanes by timestamp and render them back to
+ * back into one output buffer, until lanes are empty or the next record
+ * doesn't fit.  A record too large for the whole buffer is rendered
+ * truncated.  Consumer only.
+ *
+ * @param lanes Lanes instance
+ * @param out_buf Output buffer, NULL terminated after the last record
+ * @param out_buf_size_bytes Size of output buffer
+ * @param len Length of rendered output, excluding the NULL terminator
+ * @retval Positive Number of records rendered
+ * @retval -EINVAL Invalid input arguments
+ * @retval -EAGAIN No record available
+ * @retval Negative Error rendering the oldest record, which is released.
+ * Records rendered before it are returned first.
+ */
+int frpp_log_lanes_render_batch(struct frpp_log_lanes *lanes, void *out_buf,
+                                size_t out_buf_size_bytes, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_log_lanes_h */
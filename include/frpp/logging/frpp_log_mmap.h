@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_mmap.h
+ * @author Evan Stoddard
+ * @brief Memory-mapped file sink for Linux hosts.  Records are packaged by
+ * frpp_vprintf_package straight into a mapped segment file, so persisting a
+ * record costs no syscall and no copy; the kernel writes dirty pages back.
+ *
+ * Segments roll over when full.  Each starts with a header and ends with an
+ * index footer: a trailer at the very end of the file and, growing down
+ * from it, an entry every FRPP_LOG_MMAP_INDEX_STRIDE records so readers can
+ * seek without walking the whole segment.  A segment whose writer crashed
+ * has no trailer and is read by walking its records.
+ *
+ * Records hold interned format string IDs (see FRPP_LOG_FMT), %s arguments
+ * are always captured, and timestamps are stored as deltas (see
+ * frpp_timestamp).  Host tools map IDs back to format strings with the ELF.
+ *
+ * A sink has a single writer.  Threads that log concurrently should each
+ * open their own sink, like log lanes.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frpp/logging/frpp_log_fmt.h"
+#include "frpp/sys/frpp_printf.h"
+#include "frpp/sys/frpp_timestamp.h"
+
+#ifndef frpp_log_mmap_h
+#define frpp_log_mmap_h
+
+#if defined(__linux__)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Longest path of a segment file, including the terminator
+ */
+#ifndef FRPP_LOG_MMAP_PATH_MAX
+#define FRPP_LOG_MMAP_PATH_MAX (256U)
+#endif
+
+/**
+ * @brief Records between index entries
+ */
+#ifndef FRPP_LOG_MMAP_INDEX_STRIDE
+#define FRPP_LOG_MMAP_INDEX_STRIDE (64U)
+#endif
+
+/**
+ * @brief Alignment of records within a segment.  Must be at least the
+ * alignment of the largest packaged argument.
+ */
+#ifndef FRPP_LOG_MMAP_ALIGN
+#define FRPP_LOG_MMAP_ALIGN (8U)
+#endif
+
+/**
+ * @brief Log to sink with format string interned.  fmt_ must be a string
+ * literal.
+ */
+#define FRPP_LOG_MMAP_PRINTF(sink_, fmt_, ...)                                 \
+  frpp_log_mmap_printf((sink_), FRPP_LOG_FMT(fmt_), ##__VA_ARGS__)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Sink instance.  Treat members as private.
+ */
+struct frpp_log_mmap {
+  /* Segment files are <prefix>.<number> */
+  char prefix[FRPP_LOG_MMAP_PATH_MAX];
+
+  /* Size of each segment, and most segments kept (0 keeps all) */
+  size_t seg_size;
+  uint32_t max_segs;
+
+  /* Timestamp source, NULL if records aren't timestamped */
+  frpp_timestamp_source_t clock;
+
+  /* Mapping of current segment and its number */
+  uint8_t *base;
+  uint32_t seg;
+
+  /* Offset of next record, and of lowest index entry */
+  size_t head;
+  size_t index;
+
+  /* Records in current segment, and number of its first record */
+  uint32_t records;
+  uint64_t first;
+
+  /* Timestamp of last record */
+  uint64_t last_ts;
+
+  /* Records dropped */
+  size_t dropped;
+};
+
+/**
+ * @brief Segment reader instance.  Treat members as private.
+ */
+struct frpp_log_mmap_reader {
+  /* Mapping of segment */
+  const uint8_t *base;
+  size_t size;
+
+  /* Offset of next record, and end of records */
+  size_t off;
+  size_t end;
+
+  /* Number of next record, and timestamp of the record before it */
+  uint64_t record;
+  uint64_t ts;
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Open sink, creating its first segment.  Existing segments with the
+ * same prefix are overwritten as the sink reaches them.
+ *
+ * @param sink Sink instance
+ * @param prefix Path prefix of segment files
+ * @param seg_size Size of each segment, at least 4 KiB
+ * @param max_segs Most segments kept, the oldest are deleted (0 keeps all)
+ * @param clock Timestamp source, NULL for none
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENAMETOOLONG Prefix too long
+ * @retval Negative Other errno of open, ftruncate or mmap
+ */
+int frpp_log_mmap_open(struct frpp_log_mmap *sink, const char *prefix,
+                       size_t seg_size, uint32_t max_segs,
+                       frpp_timestamp_source_t clock);
+
+/**
+ * @brief Write index trailer of current segment and unmap it
+ *
+ * @param sink Sink instance
+ */
+void frpp_log_mmap_close(struct frpp_log_mmap *sink);
+
+/**
+ * @brief Log to sink
+ *
+ * @param sink Sink instance
+ * @param fmt_str Interned format string
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments, or fmt_str isn't interned
+ * @retval -ENOSPC Record doesn't fit in a segment, record dropped
+ * @retval Negative Other errno rolling over to the next segment
+ */
+int frpp_log_mmap_printf(struct frpp_log_mmap *sink, const char *fmt_str,
+                         ...);
+
+/**
+ * @brief Same as frpp_log_mmap_printf, taking a va_list
+ *
+ * @param sink Sink instance
+ * @param fmt_str Interned format string
+ * @param args va_list instance
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments, or fmt_str isn't interned
+ * @retval -ENOSPC Record doesn't fit in a segment, record dropped
+ * @retval Negative Other errno rolling over to the next segment
+ */
+int frpp_log_mmap_vprintf(struct frpp_log_mmap *sink, const char *fmt_str,
+                          va_list args);
+
+/**
+ * @brief Start writeback of current segment without waiting for it.  Only
+ * needed to bound loss on power failure; a crash of the process loses
+ * nothing.
+ *
+ * @param sink Sink instance
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval Negative Other errno of msync
+ */
+int frpp_log_mmap_sync(struct frpp_log_mmap *sink);
+
+/**
+ * @brief Get path of a segment
+ *
+ * @param sink Sink instance
+ * @param seg Number of segment
+ * @param path Path output
+ * @param size Size of path output
+ * @retval 0 Success
+ * @retval -ENAMETOOLONG Path doesn't fit
+ */
+int frpp_log_mmap_path(const struct frpp_log_mmap *sink, uint32_t seg,
+                       char *path, size_t size);
+
+/**
+ * @brief Open segment for reading
+ *
+ * @param reader Reader instance
+ * @param path Path of segment
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -EBADMSG Not a segment
+ * @retval Negative Other errno of open or mmap
+ */
+int frpp_log_mmap_reader_open(struct frpp_log_mmap_reader *reader,
+                              const char *path);
+
+/**
+ * @brief Close segment
+ *
+ * @param reader Reader instance
+ */
+void frpp_log_mmap_reader_close(struct frpp_log_mmap_reader *reader);
+
+/**
+ * @brief Move to a record, using the segment's index if it has one
+ *
+ * @param reader Reader instance
+ * @param record Number of record, counted across segments
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOENT Record isn't in segment
+ */
+int frpp_log_mmap_reader_seek(struct frpp_log_mmap_reader *reader,
+                              uint64_t record);
+
+/**
+ * @brief Render next record
+ *
+ * @param reader Reader instance
+ * @param out_buf Output buffer
+ * @param out_buf_size_bytes Size of output buffer
+ * @param timestamp Timestamp of record output, may be NULL
+ * @retval Non-negative Return value of frpp_snprintf for record
+ * @retval -EINVAL Invalid input arguments
+ * @retval -EAGAIN No more records
+ * @retval -EBADMSG Record is corrupt
+ */
+int frpp_log_mmap_reader_render(struct frpp_log_mmap_reader *reader,
+                                void *out_buf, size_t out_buf_size_bytes,
+                                uint64_t *timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __linux__ */
+#endif /* frpp_log_mmap_h */
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_queue.h
+ * @author Evan Stoddard
+ * @brief Lock-free multi-producer/single-consumer queue of deferred log
+ * records.  Producers package their format string arguments straight into a
+ * ring buffer with frpp_printf_package, and a single consumer renders them
+ * later with frpp_snprintf, moving formatting cost off the caller.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frpp/logging/frpp_log_fmt.h"
+#include "frpp/sys/frpp_printf.h"
+#include "frpp/utils/atomic.h"
+
+#ifndef frpp_log_queue_h
+#define frpp_log_queue_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Alignment of records within the ring.  Must be at least the
+ * alignment of the largest packaged argument.
+ */
+#ifndef FRPP_LOG_QUEUE_ALIGN
+#define FRPP_LOG_QUEUE_ALIGN (8U)
+#endif
+
+/**
+ * @brief Package bytes reserved up front by frpp_log_queue_printf so records
+ * can be packaged in a single pass.  Unused bytes are given back on commit.
+ * Larger packages fall back to sizing the package first.
+ */
+#ifndef FRPP_LOG_QUEUE_RESERVE_HINT
+#define FRPP_LOG_QUEUE_RESERVE_HINT (64U)
+#endif
+
+/**
+ * @brief Package flags used by frpp_log_queue_printf.  Set to
+ * FRPP_PRINTF_FLAG_CAPTURE_STR to copy non-RO %s arguments into records so
+ * stack and heap strings can be logged, and/or FRPP_PRINTF_FLAG_DENSE to
+ * shrink records at the cost of decoding them when rendered.
+ */
+#ifndef FRPP_LOG_QUEUE_PKG_FLAGS
+#define FRPP_LOG_QUEUE_PKG_FLAGS (0U)
+#endif
+
+/**
+ * @brief Log to queue with format string interned, so its record carries a
+ * 2 byte ID rather than a pointer.  fmt_ must be a string literal.
+ */
+#define FRPP_LOG_QUEUE_PRINTF(queue_, fmt_, ...)                               \
+  frpp_log_queue_printf((queue_), FRPP_LOG_FMT(fmt_), ##__VA_ARGS__)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Queue instance.  Treat members as private.
+ */
+struct frpp_log_queue {
+  /* Ring storage */
+  uint8_t *buf;
+
+  /* Size of ring storage in bytes (power of two) */
+  size_t size;
+
+  /* Monotonic position of next reservation (written by producers) */
+  FRPP_ATOMIC(size_t) head;
+
+  /* Monotonic position of oldest unconsumed record (written by consumer) */
+  FRPP_ATOMIC(size_t) tail;
+};
+
+/**
+ * @brief Record handed to the consumer by frpp_log_queue_peek
+ */
+struct frpp_log_record {
+  /* Format string of record */
+  const char *fmt;
+
+  /* Interned format string ID, FRPP_LOG_FMT_ID_NONE if not interned */
+  uint16_t fmt_id;
+
+  /* Flags to render package with (see frpp_snprintf_ex) */
+  uint32_t flags;
+
+  /* Package of record's arguments */
+  const void *pkg;
+
+  /* Length of package in bytes */
+  size_t pkg_len;
+
+  /* Position and span of record in ring (private) */
+  size_t pos;
+  size_t span;
+};
+
+/**
+ * @brief Slot reserved by frpp_log_queue_reserve.  Package into pkg with
+ * frpp_printf_reserve_package, then commit or abort.  Flags of the most
+ * recent package are kept with the record.
+ */
+struct frpp_log_queue_slot {
+  /* Package region of slot */
+  struct frpp_printf_reservation pkg;
+
+  /* Position and span of slot in ring (private) */
+  size_t pos;
+  size_t span;
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize queue over caller-provided storage
+ *
+ * @param queue Queue instance
+ * @param buf Ring storage.  Must be aligned to FRPP_LOG_QUEUE_ALIGN
+ * @param size Size of ring storage.  Must be a power of two
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_log_queue_init(struct frpp_log_queue *queue, void *buf, size_t size);
+
+/**
+ * @brief Package a log record into the queue.  Safe to call concurrently from
+ * any number of producers.
+ *
+ * @param queue Queue instance
+ * @param fmt_str Format string.  Must be in RO memory
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Queue does not have space for record
+ */
+int frpp_log_queue_printf(struct frpp_log_queue *queue, const char *fmt_str,
+                          ...);
+
+/**
+ * @brief Same as frpp_log_queue_printf but takes a va_list
+ *
+ * @param queue Queue instance
+ * @param fmt_str Format string.  Must be in RO memory
+ * @param args va_list instance
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Queue does not have space for record
+ */
+int frpp_log_queue_vprintf(struct frpp_log_queue *queue, const char *fmt_str,
+                           va_list args);
+
+/**
+ * @brief Same as frpp_log_queue_vprintf but packages with the given flags
+ * rather than FRPP_LOG_QUEUE_PKG_FLAGS
+ *
+ * @param queue Queue instance
+ * @param flags FRPP_PRINTF_FLAG_* package flags
+ * @param fmt_str Format string.  Must be in RO memory
+ * @param args va_list instance
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Queue does not have space for record
+ */
+int frpp_log_queue_vprintf_ex(struct frpp_log_queue *queue, uint32_t flags,
+                              const char *fmt_str, va_list args);
+
+/**
+ * @brief Reserve a slot for a package of up to max_len bytes.  Safe to call
+ * concurrently from any number of producers.  The slot must be committed or
+ * aborted promptly since the consumer can't pass it until then.
+ *
+ * @param queue Queue instance
+ * @param max_len Maximum package length
+ * @param slot Slot output
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Queue does not have space for slot
+ */
+int frpp_log_queue_reserve(struct frpp_log_queue *queue, size_t max_len,
+                           struct frpp_log_queue_slot *slot);
+
+/**
+ * @brief Publish a reserved slot as a record.  Space reserved beyond the
+ * package is given back to the ring if no later reservation has been made.
+ *
+ * @param queue Queue instance
+ * @param slot Slot to commit
+ * @param fmt_str Format string package was created with
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_log_queue_commit(struct frpp_log_queue *queue,
+                          struct frpp_log_queue_slot *slot,
+                          const char *fmt_str);
+
+/**
+ * @brief Abandon a reserved slot.  Nothing is published to the consumer.
+ *
+ * @param queue Queue instance
+ * @param slot Slot to abort
+ */
+void frpp_log_queue_abort(struct frpp_log_queue *queue,
+                          struct frpp_log_queue_slot *slot);
+
+/**
+ * @brief Get oldest committed record without removing it.  Consumer only.
+ *
+ * @param queue Queue instance
+ * @param record Record output.  Valid until frpp_log_queue_release
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -EAGAIN Queue is empty or oldest record is not yet committed
+ */
+int frpp_log_queue_peek(struct frpp_log_queue *queue,
+                        struct frpp_log_record *record);
+
+/**
+ * @brief Release record returned by frpp_log_queue_peek, making its space
+ * available to producers.  Consumer only.
+ *
+ * @param queue Queue instance
+ * @param record Record to release
+ */
+void frpp_log_queue_release(struct frpp_log_queue *queue,
+                            const struct frpp_log_record *record);
+
+/**
+ * @brief Render and release oldest record.  Consumer only.
+ *
+ * @param queue Queue instance
+ * @param out_buf Output buffer
+ * @param out_buf_size_bytes Size of output buffer
+ * @retval Non-negative Return value of frpp_snprintf for record
+ * @retval -EINVAL Invalid input arguments
+ * @retval -EAGAIN No record available
+ */
+int frpp_log_queue_render(struct frpp_log_queue *queue, void *out_buf,
+                          size_t out_buf_size_bytes);
+
+/**
+ * @brief Render and release records back to back into one output buffer,
+ * oldest first, until the queue is empty or the next record doesn't fit.
+ * A record too large for the whole buffer is rendered truncated, so the
+ * queue always makes progress.  Consumer only.
+ *
+ * @param queue Queue instance
+ * @param out_buf Output buffer, NULL terminated after the last record
+ * @param out_buf_size_bytes Size of output buffer
+ * @param len Length of rendered output, excluding the NULL terminator
+ * @retval Positive Number of records rendered
+ * @retval -EINVAL Invalid input arguments
+ * @retval -EAGAIN No record available
+ * @retval Negative Error rendering the oldest record, which is released.
+ * Records rendered before it are returned first.
+ */
+int frpp_log_queue_render_batch(struct frpp_log_queue *queue, void *out_buf,
+                                size_t out_buf_size_bytes, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_log_queue_h */
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_retain.h
+ * @author Evan Stoddard
+ * @brief Retained log ring.  Records are kept in a caller-provided region
+ * that survives a reset (a .noinit section on an MCU, a file mapped with
+ * frpp_log_retain_map on a Linux host) so the records logged before a crash
+ * can be recovered and rendered after restart.
+ *
+ * Every record carries a sequence number and a CRC, and the region header
+ * points at the oldest record.  Recovery walks forward from there until a
+ * record fails its CRC or breaks the sequence, so it only touches retained
+ * records and a record torn by the reset is dropped.  The writer overwrites
+ * the oldest records when the ring is full.
+ *
+ * Records are only meaningful to the image that wrote them: format strings
+ * must be interned (see FRPP_LOG_FMT), %s arguments are always captured, and
+ * a region written with another build ID is discarded on attach.
+ *
+ * Not thread safe.  Callers must serialize access, e.g. write from the log
+ * consumer only.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frpp/logging/frpp_log_fmt.h"
+#include "frpp/sys/frpp_printf.h"
+
+#ifndef frpp_log_retain_h
+#define frpp_log_retain_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Alignment of the region and of records within it.  Must be at least
+ * the alignment of the largest packaged argument.
+ */
+#ifndef FRPP_LOG_RETAIN_ALIGN
+#define FRPP_LOG_RETAIN_ALIGN (8U)
+#endif
+
+/**
+ * @brief Largest package of a record.  Packages are built on the stack
+ * before the oldest records are evicted to make room for them.
+ */
+#ifndef FRPP_LOG_RETAIN_PKG_MAX
+#define FRPP_LOG_RETAIN_PKG_MAX (256U)
+#endif
+
+/**
+ * @brief Log to retained ring with format string interned.  fmt_ must be a
+ * string literal.
+ */
+#define FRPP_LOG_RETAIN_PRINTF(retain_, fmt_, ...)                             \
+  frpp_log_retain_printf((retain_), FRPP_LOG_FMT(fmt_), ##__VA_ARGS__)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Retained ring instance.  Lives in ordinary RAM and is rebuilt from
+ * the region on attach.  Treat members as private.
+ */
+struct frpp_log_retain {
+  /* Region header and record storage */
+  uint8_t *region;
+  uint8_t *data;
+  size_t size;
+
+  /* Offsets of next record and oldest record, and bytes in use */
+  size_t head;
+  size_t tail;
+  size_t used;
+
+  /* Sequence number of next record and of oldest record */
+  uint32_t seq;
+  uint32_t tail_seq;
+
+  /* Generation of last tail written to the region header */
+  uint32_t gen;
+
+  /* Records retained, and records overwritten before being rendered */
+  size_t count;
+  size_t lost;
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Attach to retained region.  Records left by a previous run with the
+ * same build ID and size are recovered; anything else is discarded and the
+ * region is formatted.
+ *
+ * @param retain Retained ring instance
+ * @param region Region.  Must be aligned to FRPP_LOG_RETAIN_ALIGN
+ * @param size Size of region
+ * @param build_id ID of the running image, e.g. a hash of its build
+ * @retval Non-negative Number of records recovered
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_log_retain_init(struct frpp_log_retain *retain, void *region,
+                         size_t size, uint32_t build_id);
+
+/**
+ * @brief Log to retained ring, evicting the oldest records if needed
+ *
+ * @param retain Retained ring instance
+ * @param fmt_str Interned format string
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments, or fmt_str isn't interned
+ * @retval -ENOSPC Record is larger than FRPP_LOG_RETAIN_PKG_MAX or the ring
+ */
+int frpp_log_retain_printf(struct frpp_log_retain *retain, const char *fmt_str,
+                           ...);
+
+/**
+ * @brief Same as frpp_log_retain_printf, taking a va_list
+ *
+ * @param retain Retained ring instance
+ * @param fmt_str Interned format string
+ * @param args va_list instance
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments, or fmt_str isn't interned
+ * @retval -ENOSPC Record is larger than FRPP_LOG_RETAIN_PKG_MAX or the ring
+ */
+int frpp_log_retain_vprintf(struct frpp_log_retain *retain,
+                            const char *fmt_str, va_list args);
+
+/**
+ * @brief Render and release the oldest record
+ *
+ * @param retain Retained ring instance
+ * @param out_buf Output buffer
+ * @param out_buf_size_bytes Size of output buffer
+ * @retval Non-negative Return value of frpp_snprintf for record
+ * @retval -EINVAL Invalid input arguments
+ * @retval -EAGAIN No record available
+ */
+int frpp_log_retain_render(struct frpp_log_retain *retain, void *out_buf,
+                           size_t out_buf_size_bytes);
+
+/**
+ * @brief Get number of records retained
+ *
+ * @param retain Retained ring instance
+ * @return Records retained
+ */
+size_t frpp_log_retain_count(struct frpp_log_retain *retain);
+
+/**
+ * @brief Get number of records overwritten before being rendered
+ *
+ * @param retain Retained ring instance
+ * @return Records lost
+ */
+size_t frpp_log_retain_lost(struct frpp_log_retain *retain);
+
+#if defined(__linux__)
+/**
+ * @brief Map a file as retained region, creating it if needed.  Stands in
+ * for retained RAM on a Linux host; records persist across crashes of the
+ * process.
+ *
+ * @param path Path of file
+ * @param size Size of region
+ * @param region Region output
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval Negative Other errno of open, ftruncate or mmap
+ */
+int frpp_log_retain_map(const char *path, size_t size, void **region);
+
+/**
+ * @brief Unmap region mapped with frpp_log_retain_map
+ *
+ * @param region Region
+ * @param size Size of region
+ */
+void frpp_log_retain_unmap(void *region, size_t size);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_log_retain_h */
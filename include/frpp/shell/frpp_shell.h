@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_shell.h
+ * @author Evan Stoddard
+ * @brief Command shell dispatching to a statically registered command table.
+ *
+ * Commands are looked up with a minimal perfect hash (hash and displace), so
+ * dispatch costs one hash of the command name, one displacement load and a
+ * single string compare regardless of how many commands are registered.
+ * Tables are generated at compile time by frpp::shell::make_table (see
+ * frpp_shell_table.hpp).  Nothing is allocated.
+ *
+ * Lines are split into arguments in place, so handlers get slices of the
+ * line itself:
+ *
+ *   whitespace  Separates arguments
+ *   '...'       Taken literally
+ *   "..."       Taken literally, except for backslash escapes
+ *   \x          x taken literally (outside single quotes)
+ *
+ * Quoted and unquoted parts of an argument join, so a"b c"d is "ab cd".
+ *
+ * Tables also carry a radix trie of command names, so completing a prefix
+ * walks only the characters typed, regardless of how many commands are
+ * registered.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef frpp_shell_h
+#define frpp_shell_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Most arguments (including the command name) passed to a handler
+ */
+#ifndef FRPP_SHELL_ARGC_MAX
+#define FRPP_SHELL_ARGC_MAX (16U)
+#endif
+
+/* FNV-1a parameters of frpp_shell_hash */
+#define FRPP_SHELL_HASH_BASIS (0x811C9DC5U)
+#define FRPP_SHELL_HASH_PRIME (0x01000193U)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+struct frpp_shell;
+struct frpp_shell_out;
+
+/**
+ * @brief Command handler
+ *
+ * @param shell Shell instance
+ * @param argc Number of arguments, including command name
+ * @param argv Arguments, argv[0] is the command name
+ * @return Command specific, returned by frpp_shell_execute
+ */
+typedef int (*frpp_shell_handler_t)(struct frpp_shell *shell, int argc,
+                                    char *argv[]);
+
+/**
+ * @brief Command
+ */
+struct frpp_shell_cmd {
+  /* Name command is invoked by */
+  const char *name;
+
+  /* Handler */
+  frpp_shell_handler_t handler;
+
+  /* One line description */
+  const char *help;
+};
+
+/**
+ * @brief Radix trie node.  Commands under a node share its first depth
+ * characters, and are table->sorted[first] to table->sorted[first +
+ * matches - 1].  Node 0 is the root.
+ */
+struct frpp_shell_trie_node {
+  /* Index of first child.  Children are adjacent, ordered by the character
+   * following this node's prefix. */
+  uint16_t child;
+
+  /* Index in sorted of first command under node */
+  uint16_t first;
+
+  /* Number of commands under node */
+  uint16_t matches;
+
+  /* Number of children */
+  uint8_t children;
+
+  /* Length of prefix shared by commands under node */
+  uint8_t depth;
+};
+
+/**
+ * @brief Perfect hash command table.  Command with hash h is at
+ * cmds[frpp_shell_mix(h, disp[h % buckets]) % count].
+ */
+struct frpp_shell_table {
+  /* Commands, ordered by slot */
+  const struct frpp_shell_cmd *cmds;
+
+  /* Displacement of each bucket */
+  const uint16_t *disp;
+
+  /* Slots of commands, ordered by name.  NULL if not completing. */
+  const uint16_t *sorted;
+
+  /* Radix trie over sorted.  NULL if not completing. */
+  const struct frpp_shell_trie_node *trie;
+
+  /* Number of commands */
+  uint16_t count;
+
+  /* Number of buckets */
+  uint16_t buckets;
+};
+
+/**
+ * @brief Commands matching a prefix, see frpp_shell_complete
+ */
+struct frpp_shell_match {
+  /* Table matched against */
+  const struct frpp_shell_table *table;
+
+  /* Index in table->sorted of first match */
+  uint16_t first;
+
+  /* Number of matches */
+  uint16_t count;
+
+  /* Length of prefix shared by all matches */
+  uint16_t common;
+};
+
+/**
+ * @brief Shell instance.  Treat members as private.
+ */
+struct frpp_shell {
+  /* Commands */
+  const struct frpp_shell_table *table;
+
+  /* Output handlers print to, NULL if none */
+  struct frpp_shell_out *out;
+
+  /* User context, for handlers */
+  void *ctx;
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Hash a command name (FNV-1a, finalized so low bits are usable).
+ * Mirrored by frpp_shell_table.hpp.
+ *
+ * @param name Name
+ * @param len Length of name
+ * @return Hash
+ */
+uint32_t frpp_shell_hash(const char *name, size_t len);
+
+/**
+ * @brief Mix a name's hash with its bucket's displacement.  Mirrored by
+ * frpp_shell_table.hpp.
+ *
+ * @param hash Hash of frpp_shell_hash
+ * @param disp Displacement
+ * @return Mixed hash, slot is this modulo the number of commands
+ */
+uint32_t frpp_shell_mix(uint32_t hash, uint32_t disp);
+
+/**
+ * @brief Initialize shell
+ *
+ * @param shell Shell instance
+ * @param table Command table
+ * @param ctx User context, for handlers
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_shell_init(struct frpp_shell *shell,
+                    const struct frpp_shell_table *table, void *ctx);
+
+/**
+ * @brief Set output handlers print to with frpp_shell_printf
+ *
+ * @param shell Shell instance
+ * @param out Output instance (see frpp_shell_out.h), NULL for none
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_shell_set_out(struct frpp_shell *shell, struct frpp_shell_out *out);
+
+/**
+ * @brief Print from a handler.  Output is queued and written later, so this
+ * never waits on the link.
+ *
+ * @param shell Shell instance
+ * @param fmt_str Format string.  Must be in RO memory
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENODEV Shell has no output
+ * @retval -ENOSPC Output queue is full
+ */
+int frpp_shell_printf(struct frpp_shell *shell, const char *fmt_str, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Same as frpp_shell_printf, taking a va_list
+ *
+ * @param shell Shell instance
+ * @param fmt_str Format string.  Must be in RO memory
+ * @param args va_list instance
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENODEV Shell has no output
+ * @retval -ENOSPC Output queue is full
+ */
+int frpp_shell_vprintf(struct frpp_shell *shell, const char *fmt_str,
+                       va_list args);
+
+/**
+ * @brief Look up a command
+ *
+ * @param table Command table
+ * @param name Name (need not be NULL terminated)
+ * @param len Length of name
+ * @return Command, or NULL if none has that name
+ */
+const struct frpp_shell_cmd *
+frpp_shell_find(const struct frpp_shell_table *table, const char *name,
+                size_t len);
+
+/**
+ * @brief Complete a command name.  The first common characters of any match
+ * are the longest completion of prefix.
+ *
+ * @param table Command table
+ * @param prefix Prefix (need not be NULL terminated)
+ * @param len Length of prefix
+ * @param match Matches output
+ * @retval Non-negative Number of commands starting with prefix
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOTSUP Table has no trie
+ */
+int frpp_shell_complete(const struct frpp_shell_table *table,
+                        const char *prefix, size_t len,
+                        struct frpp_shell_match *match);
+
+/**
+ * @brief Get a match, in name order
+ *
+ * @param match Matches from frpp_shell_complete
+ * @param index Index of match
+ * @return Command, or NULL if index is out of range
+ */
+const struct frpp_shell_cmd *
+frpp_shell_match_get(const struct frpp_shell_match *match, size_t index);
+
+/**
+ * @brief Split a line into arguments in place.  Arguments are unquoted and
+ * unescaped in place, so argv points into line.
+ *
+ * @param line Line, modified in place
+ * @param argv Arguments output
+ * @param argc_max Size of argv
+ * @retval Non-negative Number of arguments
+ * @retval -EINVAL Invalid input arguments
+ * @retval -E2BIG More than argc_max arguments
+ * @retval -EBADMSG Unterminated quote, or line ends in a backslash
+ */
+int frpp_shell_tokenize(char *line, char *argv[], int argc_max);
+
+/**
+ * @brief Split a line into arguments in place and run its command
+ *
+ * @param shell Shell instance
+ * @param line Line, modified in place
+ * @retval Handler's return value
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENODATA Line is blank
+ * @retval -ENOENT Unknown command
+ * @retval -E2BIG More than FRPP_SHELL_ARGC_MAX arguments
+ * @retval -EBADMSG Unterminated quote, or line ends in a backslash
+ */
+int frpp_shell_execute(struct frpp_shell *shell, char *line);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_shell_h */
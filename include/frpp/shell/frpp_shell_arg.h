@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_shell_arg.h
+ * @author Evan Stoddard
+ * @brief Typed conversion of shell arguments.  Converters parse the whole
+ * argument in one pass without locale lookups or errno, and reject trailing
+ * characters, so handlers can check and convert an argument in one call.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef frpp_shell_arg_h
+#define frpp_shell_arg_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Convert a decimal integer, with optional sign
+ *
+ * @param arg Argument
+ * @param value Value output, unchanged on error
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments, or arg isn't an integer
+ * @retval -ERANGE Value doesn't fit
+ */
+int frpp_shell_arg_int(const char *arg, int32_t *value);
+
+/**
+ * @brief Convert a hexadecimal integer, with optional 0x prefix
+ *
+ * @param arg Argument
+ * @param value Value output, unchanged on error
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments, or arg isn't hexadecimal
+ * @retval -ERANGE Value doesn't fit
+ */
+int frpp_shell_arg_hex(const char *arg, uint32_t *value);
+
+/**
+ * @brief Convert a decimal floating point number, with optional sign,
+ * fraction and exponent (e.g. -1.5e3).  Scaled in double and rounded to
+ * float once, so the result matches strtof except for inputs within about
+ * 1e-15 (relative) of halfway between two floats.  Digits past the
+ * eighteenth significant digit are ignored.
+ *
+ * @param arg Argument
+ * @param value Value output, unchanged on error
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments, or arg isn't a number
+ * @retval -ERANGE Value overflows or underflows float
+ */
+int frpp_shell_arg_float(const char *arg, float *value);
+
+/**
+ * @brief Convert a boolean: 1/0, true/false, on/off or yes/no, in any case
+ *
+ * @param arg Argument
+ * @param value Value output, unchanged on error
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments, or arg isn't a boolean
+ */
+int frpp_shell_arg_bool(const char *arg, bool *value);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_shell_arg_h */
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_shell_line.h
+ * @author Evan Stoddard
+ * @brief Non-blocking line editor for the shell.  Input is fed a byte at a
+ * time (e.g. from a UART ISR or a poll loop) and edited in place, with a
+ * fixed-size history and VT100 escape sequence handling.  Every byte is
+ * handled in time bounded by FRPP_SHELL_LINE_MAX, and nothing blocks or
+ * allocates.
+ *
+ * Echo is never written directly.  It's queued in a single-producer/
+ * single-consumer ring drained with frpp_shell_line_echo, so feeding bytes
+ * from an ISR and draining echo from a task is safe.  Echo that doesn't fit
+ * is dropped.
+ *
+ * Keys handled:
+ *
+ *   Left/Right, Ctrl-B/Ctrl-F    Move cursor
+ *   Home/End, Ctrl-A/Ctrl-E      Move cursor to start/end of line
+ *   Up/Down, Ctrl-P/Ctrl-N       Walk history
+ *   Backspace, Delete            Delete before/at cursor
+ *   Ctrl-K/Ctrl-U                Delete to end/start of line
+ *   Ctrl-C                       Discard line
+ *   Tab                          Complete command name
+ *   Enter (CR, LF or CRLF)       Complete line
+ *
+ * Tab completes the command name when the cursor is at its end, from the
+ * table set with frpp_shell_line_set_table.  A unique match is completed
+ * and followed by a space, several are completed as far as they agree.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frpp/shell/frpp_shell.h"
+#include "frpp/utils/atomic.h"
+
+#ifndef frpp_shell_line_h
+#define frpp_shell_line_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Size of line buffer, including the NULL terminator
+ */
+#ifndef FRPP_SHELL_LINE_MAX
+#define FRPP_SHELL_LINE_MAX (128U)
+#endif
+
+/**
+ * @brief Lines kept in history.  0 disables history.
+ */
+#ifndef FRPP_SHELL_LINE_HISTORY
+#define FRPP_SHELL_LINE_HISTORY (8U)
+#endif
+
+/**
+ * @brief Size of echo ring.  Must be a power of two.
+ */
+#ifndef FRPP_SHELL_LINE_ECHO_SIZE
+#define FRPP_SHELL_LINE_ECHO_SIZE (512U)
+#endif
+
+/**
+ * @brief Returned by frpp_shell_line_feed when a line is complete
+ */
+#define FRPP_SHELL_LINE_READY (1)
+
+#if (FRPP_SHELL_LINE_ECHO_SIZE & (FRPP_SHELL_LINE_ECHO_SIZE - 1)) != 0
+#error "FRPP_SHELL_LINE_ECHO_SIZE must be a power of two"
+#endif
+
+#if FRPP_SHELL_LINE_MAX < 2 || FRPP_SHELL_LINE_MAX > UINT16_MAX
+#error "FRPP_SHELL_LINE_MAX must be between 2 and 65535"
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Line editor instance.  Treat members as private.
+ */
+struct frpp_shell_line {
+  /* Line being edited, NULL terminated once complete */
+  char buf[FRPP_SHELL_LINE_MAX];
+
+  /* Length of line */
+  uint16_t len;
+
+  /* Cursor position within line */
+  uint16_t cursor;
+
+  /* Escape sequence state and numeric parameter */
+  uint8_t esc;
+  uint8_t esc_param;
+
+  /* Last byte was a CR, so a following LF is swallowed */
+  bool last_cr;
+
+  /* Line is complete and hasn't been released with frpp_shell_line_next.
+   * Hands the line (and the echo ring's producer side) between feeder and
+   * the task handling lines. */
+  FRPP_ATOMIC(bool) ready;
+
+  /* Prompt echoed before every line */
+  const char *prompt;
+
+  /* Commands Tab completes, NULL if none */
+  const struct frpp_shell_table *table;
+
+#if FRPP_SHELL_LINE_HISTORY
+  /* History ring, most recent at hist_head - 1 */
+  char hist[FRPP_SHELL_LINE_HISTORY][FRPP_SHELL_LINE_MAX];
+  uint8_t hist_head;
+  uint8_t hist_count;
+
+  /* Entry being shown (1 is most recent), 0 when editing a new line */
+  uint8_t hist_pos;
+
+  /* Line being edited before walking history */
+  char stash[FRPP_SHELL_LINE_MAX];
+  uint16_t stash_len;
+#endif
+
+  /* Echo ring.  Written by feeder, drained by frpp_shell_line_echo. */
+  uint8_t echo[FRPP_SHELL_LINE_ECHO_SIZE];
+  FRPP_ATOMIC(size_t) echo_head;
+  FRPP_ATOMIC(size_t) echo_tail;
+
+  /* Echo bytes dropped because the ring was full */
+  FRPP_ATOMIC(size_t) echo_dropped;
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize line editor and echo first prompt
+ *
+ * @param line Line editor instance
+ * @param prompt Prompt, may be NULL
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_shell_line_init(struct frpp_shell_line *line, const char *prompt);
+
+/**
+ * @brief Set commands completed by Tab
+ *
+ * @param line Line editor instance
+ * @param table Command table, NULL to disable completion
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_shell_line_set_table(struct frpp_shell_line *line,
+                              const struct frpp_shell_table *table);
+
+/**
+ * @brief Feed one input byte
+ *
+ * @param line Line editor instance
+ * @param byte Input byte
+ * @retval 0 Byte consumed
+ * @retval FRPP_SHELL_LINE_READY Line complete, see frpp_shell_line_get
+ * @retval -EINVAL Invalid input arguments
+ * @retval -EBUSY Previous line hasn't been released, byte dropped
+ */
+int frpp_shell_line_feed(struct frpp_shell_line *line, uint8_t byte);
+
+/**
+ * @brief Get completed line.  It may be modified in place (e.g. by
+ * frpp_shell_execute) until released.
+ *
+ * @param line Line editor instance
+ * @return Line, or NULL if no line is complete
+ */
+char *frpp_shell_line_get(struct frpp_shell_line *line);
+
+/**
+ * @brief Release completed line, start a new one and echo the prompt
+ *
+ * @param line Line editor instance
+ */
+void frpp_shell_line_next(struct frpp_shell_line *line);
+
+/**
+ * @brief Drain queued echo
+ *
+ * @param line Line editor instance
+ * @param out Output buffer
+ * @param size Size of output buffer
+ * @return Number of bytes output
+ */
+size_t frpp_shell_line_echo(struct frpp_shell_line *line, void *out,
+                            size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_shell_line_h */
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_shell_out.h
+ * @author Evan Stoddard
+ * @brief Deferred shell output.  Handlers printing through
+ * frpp_shell_out_printf only package their arguments into a queue and
+ * return; a writer calling frpp_shell_out_poll renders queued output and
+ * hands it to the link as fast as the link accepts it.  %s arguments are
+ * captured, so handlers may print strings from their stack or argv.
+ * Captured strings longer than FRPP_SHELL_OUT_STR_CAP bytes end in
+ * FRPP_PRINTF_CAPTURE_TRUNC_MARKER; print longer ones in pieces.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frpp/logging/frpp_log_queue.h"
+
+#ifndef frpp_shell_out_h
+#define frpp_shell_out_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Size of buffer output is rendered into before being written.  Also
+ * the longest a single printf's output can be before it's truncated.
+ */
+#ifndef FRPP_SHELL_OUT_RENDER_SIZE
+#define FRPP_SHELL_OUT_RENDER_SIZE (256U)
+#endif
+
+/**
+ * @brief Most bytes captured per %s argument (1-254).  Defaults to the
+ * largest cap a package supports rather than the smaller
+ * FRPP_PRINTF_CAPTURE_CAP_DEFAULT, so paths and argv print in full.
+ */
+#ifndef FRPP_SHELL_OUT_STR_CAP
+#define FRPP_SHELL_OUT_STR_CAP (254U)
+#endif
+
+#if FRPP_SHELL_OUT_STR_CAP < 1 || FRPP_SHELL_OUT_STR_CAP > 254
+#error "FRPP_SHELL_OUT_STR_CAP must be between 1 and 254"
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Link write.  Must not block.
+ *
+ * @param ctx User context
+ * @param buf Bytes to write
+ * @param len Number of bytes
+ * @return Number of bytes accepted, 0 if the link is busy
+ */
+typedef size_t (*frpp_shell_write_t)(void *ctx, const void *buf, size_t len);
+
+/**
+ * @brief Output instance.  Treat members as private.
+ */
+struct frpp_shell_out {
+  /* Packaged output, not yet rendered */
+  struct frpp_log_queue queue;
+
+  /* Link */
+  frpp_shell_write_t write;
+  void *ctx;
+
+  /* Rendered output, written up to pos */
+  char buf[FRPP_SHELL_OUT_RENDER_SIZE];
+  size_t len;
+  size_t pos;
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize output
+ *
+ * @param out Output instance
+ * @param ring Storage of output queue (see frpp_log_queue_init)
+ * @param ring_size Size of storage, a power of two
+ * @param write Link write
+ * @param ctx User context passed to write
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_shell_out_init(struct frpp_shell_out *out, void *ring,
+                        size_t ring_size, frpp_shell_write_t write, void *ctx);
+
+/**
+ * @brief Queue formatted output.  Safe to call concurrently.
+ *
+ * @param out Output instance
+ * @param fmt_str Format string.  Must be in RO memory
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Output queue is full
+ */
+int frpp_shell_out_printf(struct frpp_shell_out *out, const char *fmt_str,
+                          ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Same as frpp_shell_out_printf, taking a va_list
+ *
+ * @param out Output instance
+ * @param fmt_str Format string.  Must be in RO memory
+ * @param args va_list instance
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Output queue is full
+ */
+int frpp_shell_out_vprintf(struct frpp_shell_out *out, const char *fmt_str,
+                           va_list args);
+
+/**
+ * @brief Render queued output and write it until the link is busy or
+ * nothing is left.  Only one writer may poll at a time.
+ *
+ * @param out Output instance
+ * @retval Non-negative Number of bytes written
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_shell_out_poll(struct frpp_shell_out *out);
+
+/**
+ * @brief Check whether all queued output has been written
+ *
+ * @param out Output instance
+ * @return true if nothing is pending
+ */
+bool frpp_shell_out_idle(struct frpp_shell_out *out);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_shell_out_h */
@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_shell_table.hpp
+ * @author Evan Stoddard
+ * @brief Compile-time generation of perfect hash command tables for
+ * frpp_shell, along with the radix trie used to complete command names.
+ * Duplicate names and hash collisions are compile errors.
+ *
+ * Usage:
+ *
+ *   static constexpr auto cmds = frpp::shell::make_table({
+ *       {"led", cmd_led, "Set LED state"},
+ *       {"reset", cmd_reset, "Reset device"},
+ *   });
+ *   static constexpr frpp_shell_table table = cmds.view();
+ *
+ *   frpp_shell_init(&shell, &table, NULL);
+ */
+
+#ifndef frpp_shell_table_hpp
+#define frpp_shell_table_hpp
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "frpp/shell/frpp_shell.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Average commands per displacement bucket.  Larger values shrink the
+ * displacement table and lengthen the compile-time search.
+ */
+#ifndef FRPP_SHELL_TABLE_BUCKET_LOAD
+#define FRPP_SHELL_TABLE_BUCKET_LOAD (4U)
+#endif
+
+namespace frpp::shell {
+
+namespace detail {
+
+/*****************************************************************************
+ * Hashing
+ *****************************************************************************/
+
+constexpr size_t length(const char *str) {
+  size_t len = 0;
+  while (str[len] != '\0') {
+    len++;
+  }
+  return len;
+}
+
+constexpr bool equal(const char *a, const char *b) {
+  size_t i = 0;
+  while (a[i] != '\0' && a[i] == b[i]) {
+    i++;
+  }
+  return a[i] == b[i];
+}
+
+/**
+ * @brief Compare as unsigned characters, like strcmp
+ */
+constexpr int compare(const char *a, const char *b) {
+  size_t i = 0;
+  while (a[i] != '\0' && a[i] == b[i]) {
+    i++;
+  }
+  return static_cast<int>(static_cast<uint8_t>(a[i])) -
+         static_cast<int>(static_cast<uint8_t>(b[i]));
+}
+
+/**
+ * @brief Length of common prefix
+ */
+constexpr size_t common(const char *a, const char *b) {
+  size_t i = 0;
+  while (a[i] != '\0' && a[i] == b[i]) {
+    i++;
+  }
+  return i;
+}
+
+constexpr uint32_t fmix(uint32_t hash) {
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6BU;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35U;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+/**
+ * @brief Mirror of frpp_shell_hash
+ */
+constexpr uint32_t hash(const char *name, size_t len) {
+  uint32_t ret = FRPP_SHELL_HASH_BASIS;
+  for (size_t i = 0; i < len; i++) {
+    ret = (ret ^ static_cast<uint8_t>(name[i])) * FRPP_SHELL_HASH_PRIME;
+  }
+  return fmix(ret);
+}
+
+/**
+ * @brief Mirror of frpp_shell_mix
+ */
+constexpr uint32_t mix(uint32_t hash, uint32_t disp) {
+  return fmix(hash ^ (disp * 0x9E3779B9U));
+}
+
+/**
+ * @brief Slot of a hash for a displacement, as computed by frpp_shell_find
+ */
+constexpr size_t slot(uint32_t hash, uint32_t disp, size_t count) {
+  return mix(hash, disp) % count;
+}
+
+constexpr size_t bucket_count(size_t count) {
+  return (count + FRPP_SHELL_TABLE_BUCKET_LOAD - 1) /
+         FRPP_SHELL_TABLE_BUCKET_LOAD;
+}
+
+/**
+ * @brief Most nodes of a radix trie over count names: one per name, plus at
+ * most count - 1 branching nodes
+ */
+constexpr size_t trie_size(size_t count) { return 2 * count - 1; }
+
+} // namespace detail
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Command table of N commands.  Must have static storage so view
+ * can point into it.
+ */
+template <size_t N> struct command_table {
+  static constexpr size_t buckets = detail::bucket_count(N);
+
+  std::array<frpp_shell_cmd, N> cmds;
+  std::array<uint16_t, buckets> disp;
+  std::array<uint16_t, N> sorted;
+  std::array<frpp_shell_trie_node, detail::trie_size(N)> trie;
+
+  /**
+   * @brief Table as handed to frpp_shell_init
+   */
+  constexpr frpp_shell_table view() const {
+    return {cmds.data(),
+            disp.data(),
+            sorted.data(),
+            trie.data(),
+            static_cast<uint16_t>(N),
+            static_cast<uint16_t>(buckets)};
+  }
+};
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Build a perfect hash command table (hash and displace).  Buckets
+ * are placed largest first, each at the first displacement that lands all
+ * of its commands on free slots.  Commands are then sorted by name and a
+ * radix trie is laid out breadth first over them, so each node's children
+ * are adjacent.
+ *
+ * @param cmds Commands, in any order
+ * @return Table
+ */
+template <size_t N>
+consteval command_table<N> make_table(const frpp_shell_cmd (&cmds)[N]) {
+  static_assert(N > 0 && N <= UINT16_MAX,
+                "frpp::shell: table must have 1 to 65535 commands");
+
+  constexpr size_t buckets = command_table<N>::buckets;
+
+  command_table<N> table{};
+  std::array<uint32_t, N> hashes{};
+  std::array<size_t, buckets> sizes{};
+
+  for (size_t i = 0; i < N; i++) {
+    if (cmds[i].name == nullptr || cmds[i].handler == nullptr) {
+      throw "frpp::shell: command without name or handler";
+    }
+
+    hashes[i] = detail::hash(cmds[i].name, detail::length(cmds[i].name));
+    sizes[hashes[i] % buckets]++;
+
+    for (size_t j = 0; j < i; j++) {
+      if (detail::equal(cmds[i].name, cmds[j].name)) {
+        throw "frpp::shell: duplicate command name";
+      }
+
+      if (hashes[i] == hashes[j]) {
+        throw "frpp::shell: command names collide, rename one";
+      }
+    }
+  }
+
+  std::array<bool, N> taken{};
+  std::array<bool, buckets> placed{};
+  std::array<size_t, N> members{};
+  std::array<size_t, N> slots{};
+  std::array<size_t, N> slot_of{};
+
+  for (size_t n = 0; n < buckets; n++) {
+    size_t bucket = buckets;
+    for (size_t b = 0; b < buckets; b++) {
+      if (!placed[b] && (bucket == buckets || sizes[b] > sizes[bucket])) {
+        bucket = b;
+      }
+    }
+
+    placed[bucket] = true;
+
+    size_t count = 0;
+    for (size_t i = 0; i < N; i++) {
+      if (hashes[i] % buckets == bucket) {
+        members[count++] = i;
+      }
+    }
+
+    if (count == 0) {
+      continue;
+    }
+
+    bool found = false;
+
+    for (uint32_t disp = 0; !found && disp <= UINT16_MAX; disp++) {
+      found = true;
+
+      for (size_t m = 0; found && m < count; m++) {
+        slots[m] = detail::slot(hashes[members[m]], disp, N);
+        found = !taken[slots[m]];
+
+        for (size_t k = 0; found && k < m; k++) {
+          found = slots[k] != slots[m];
+        }
+      }
+
+      if (found) {
+        for (size_t m = 0; m < count; m++) {
+          taken[slots[m]] = true;
+          table.cmds[slots[m]] = cmds[members[m]];
+          slot_of[members[m]] = slots[m];
+        }
+
+        table.disp[bucket] = static_cast<uint16_t>(disp);
+      }
+    }
+
+    if (!found) {
+      throw "frpp::shell: no perfect hash found";
+    }
+  }
+
+  // Sort by name (insertion sort, names are mostly registered in order)
+  std::array<size_t, N> order{};
+  for (size_t i = 0; i < N; i++) {
+    size_t j = i;
+    for (; j > 0 && detail::compare(cmds[order[j - 1]].name, cmds[i].name) > 0;
+         j--) {
+      order[j] = order[j - 1];
+    }
+    order[j] = i;
+  }
+
+  for (size_t i = 0; i < N; i++) {
+    table.sorted[i] = static_cast<uint16_t>(slot_of[order[i]]);
+  }
+
+  // Each node covers a range of sorted names.  A name equal to the node's
+  // prefix sorts first and ends at the node, the rest are grouped by their
+  // next character into children.
+  std::array<size_t, detail::trie_size(N)> lo{};
+  std::array<size_t, detail::trie_size(N)> hi{};
+  size_t nodes = 1;
+  lo[0] = 0;
+  hi[0] = N;
+
+  for (size_t n = 0; n < nodes; n++) {
+    const char *first = cmds[order[lo[n]]].name;
+    size_t depth = detail::common(first, cmds[order[hi[n] - 1]].name);
+
+    if (depth > UINT8_MAX) {
+      throw "frpp::shell: command name longer than 255 characters";
+    }
+
+    frpp_shell_trie_node &node = table.trie[n];
+    node.first = static_cast<uint16_t>(lo[n]);
+    node.matches = static_cast<uint16_t>(hi[n] - lo[n]);
+    node.depth = static_cast<uint8_t>(depth);
+    node.child = static_cast<uint16_t>(nodes);
+
+    size_t i = lo[n];
+    if (first[depth] == '\0') {
+      i++;
+    }
+
+    while (i < hi[n]) {
+      char c = cmds[order[i]].name[depth];
+      size_t j = i + 1;
+      while (j < hi[n] && cmds[order[j]].name[depth] == c) {
+        j++;
+      }
+
+      lo[nodes] = i;
+      hi[nodes] = j;
+      nodes++;
+      node.children++;
+      i = j;
+    }
+
+    if (node.children == 0) {
+      node.child = 0;
+    }
+  }
+
+  return table;
+}
+
+} // namespace frpp::shell
+
+#endif /* frpp_shell_table_hpp */
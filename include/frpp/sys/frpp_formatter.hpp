@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_formatter.hpp
+ * @author Evan Stoddard
+ * @brief Formatter registry for logging C++ types with %@.  A type is
+ * registered by specializing frpp::formatter, after which its objects are
+ * serialized into packages at log time and only rendered by the consumer.
+ *
+ * Usage:
+ *
+ *   template <> struct frpp::formatter<ip_addr> {
+ *     static constexpr size_t max_size = 4;
+ *
+ *     static size_t serialize(const ip_addr &addr, void *dst, size_t len) {
+ *       if (dst != nullptr && len >= 4) {
+ *         memcpy(dst, addr.octets, 4);
+ *       }
+ *       return 4;
+ *     }
+ *
+ *     static int render(const void *data, size_t len, char *out,
+ *                       size_t out_size) {
+ *       const uint8_t *b = static_cast<const uint8_t *>(data);
+ *       return snprintf(out, out_size, "%u.%u.%u.%u", b[0], b[1], b[2], b[3]);
+ *     }
+ *   };
+ *
+ *   auto arg = frpp::udt(addr);
+ *   frpp_printf_package(buf, sizeof(buf), 0, "peer %@", &arg);
+ *
+ * or with the compile-time packer, frpp::package<"peer %@">(buf, len, addr).
+ */
+
+#ifndef frpp_formatter_hpp
+#define frpp_formatter_hpp
+
+#include <cstddef>
+#include <type_traits>
+
+#include "frpp/sys/frpp_printf.h"
+
+namespace frpp {
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Formatter for type T.  Specializations provide:
+ *
+ *   static constexpr size_t max_size;  // Largest serialized size
+ *   static size_t serialize(const T &obj, void *dst, size_t len);
+ *   static int render(const void *data, size_t len, char *out,
+ *                     size_t out_size);
+ *
+ * with the semantics of struct frpp_printf_udt_ops.
+ */
+template <typename T> struct formatter;
+
+namespace detail {
+
+template <typename T, typename = void>
+inline constexpr bool has_formatter_v = false;
+
+template <typename T>
+inline constexpr bool has_formatter_v<
+    T, std::void_t<decltype(formatter<T>::max_size),
+                   decltype(&formatter<T>::serialize),
+                   decltype(&formatter<T>::render)>> = true;
+
+template <typename T>
+size_t serialize_thunk(const void *obj, void *dst, size_t len) {
+  return formatter<T>::serialize(*static_cast<const T *>(obj), dst, len);
+}
+
+template <typename T>
+int render_thunk(const void *data, size_t len, char *out, size_t out_size) {
+  return formatter<T>::render(data, len, out, out_size);
+}
+
+} // namespace detail
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Whether T has a registered formatter
+ */
+template <typename T>
+inline constexpr bool has_formatter_v =
+    detail::has_formatter_v<std::remove_cv_t<std::remove_reference_t<T>>>;
+
+/**
+ * @brief Hooks for type T.  One instance per type, so its address identifies
+ * the type in packages.
+ */
+template <typename T>
+inline constexpr frpp_printf_udt_ops udt_ops = {
+    &detail::serialize_thunk<T>,
+    &detail::render_thunk<T>,
+};
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Wrap an object for a %@ argument.  Pass the address of the result,
+ * which must live until packaging returns.
+ *
+ * @param obj Object with a registered formatter
+ * @return Argument
+ */
+template <typename T> inline frpp_printf_udt udt(const T &obj) {
+  static_assert(has_formatter_v<T>, "frpp::udt: no formatter for type");
+  static_assert(formatter<T>::max_size <= FRPP_PRINTF_UDT_SIZE_MAX,
+                "frpp::udt: max_size exceeds FRPP_PRINTF_UDT_SIZE_MAX");
+
+  return frpp_printf_udt{&udt_ops<T>, &obj};
+}
+
+} // namespace frpp
+
+#endif /* frpp_formatter_hpp */
@@ -0,0 +1,587 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_package.hpp
+ * @author Evan Stoddard
+ * @brief Compile-time counterpart to frpp_printf_package.  The format string
+ * is a template argument, so it is parsed entirely in constexpr, argument
+ * types are checked against the specifiers, and the resulting package layout
+ * (offsets and total size) is fixed at compile time.  Output is byte
+ * compatible with frpp_printf_package and can be rendered with frpp_snprintf.
+ * Types with a registered frpp::formatter can be passed for %@.
+ *
+ * Usage:
+ *
+ *   uint8_t buf[frpp::package_size<"x=%d y=%s">];
+ *   frpp::package<"x=%d y=%s">(buf, sizeof(buf), 42, "str");
+ *   frpp_snprintf(frpp::format_str<"x=%d y=%s">(), buf, out, sizeof(out));
+ */
+
+#ifndef frpp_package_hpp
+#define frpp_package_hpp
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <type_traits>
+#include <utility>
+
+#include "frpp/sys/frpp_formatter.hpp"
+#include "frpp/utils/utils.h"
+
+namespace frpp {
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Structural wrapper so string literals can be used as template
+ * arguments.  Template parameter objects have static storage duration, so
+ * value is suitable as the RO format string handed to frpp_snprintf.
+ */
+template <size_t N> struct format_string {
+  char value[N];
+
+  consteval format_string(const char (&str)[N]) {
+    for (size_t i = 0; i < N; i++) {
+      value[i] = str[i];
+    }
+  }
+};
+
+/**
+ * @brief Argument slot kinds, mirroring the cases handled by
+ * frpp_vprintf_package
+ */
+enum class arg_kind : uint8_t {
+  int_,
+  long_,
+  long_long,
+  size,
+  ptrdiff,
+  intmax,
+  string,
+  pointer,
+  int_pointer,
+  double_,
+  udt,
+  wint,
+  wstring,
+};
+
+namespace detail {
+
+/*****************************************************************************
+ * Format String Parsing
+ *****************************************************************************/
+
+/**
+ * @brief Walk a format string and invoke fn for each argument consumed.
+ * Constructs that frpp_vprintf_package would silently mis-package are
+ * rejected at compile time rather than reproduced.
+ *
+ * @param fmt Format string
+ * @param fn Callback taking arg_kind
+ */
+template <typename Fn> constexpr void parse(const char *fmt, Fn fn) {
+  const char *ptr = fmt;
+
+  while (*ptr) {
+    if (*ptr != '%') {
+      ptr++;
+      continue;
+    }
+
+    ptr++;
+
+    while (*ptr == '-' || *ptr == '+' || *ptr == ' ' || *ptr == '#' ||
+           *ptr == '0') {
+      ptr++;
+    }
+
+    while (*ptr >= '0' && *ptr <= '9') {
+      ptr++;
+    }
+
+    if (*ptr == '.') {
+      ptr++;
+      while (*ptr >= '0' && *ptr <= '9') {
+        ptr++;
+      }
+    }
+
+    char length = '\0';
+    switch (*ptr) {
+    case 'h':
+    case 'l':
+      length = *ptr;
+      ptr++;
+      if (*ptr == length) {
+        length = (length == 'l') ? 'q' : 'H';
+        ptr++;
+      }
+      break;
+
+    case 'z':
+    case 't':
+    case 'j':
+      length = *ptr;
+      ptr++;
+      break;
+
+    default:
+      break;
+    }
+
+    switch (*ptr) {
+    case '%':
+      if (length != '\0') {
+        throw "frpp::package: length modifier applied to %%";
+      }
+      break;
+
+    case 'd':
+    case 'i':
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+      switch (length) {
+      case 'l':
+        fn(arg_kind::long_);
+        break;
+      case 'q':
+        fn(arg_kind::long_long);
+        break;
+      case 'z':
+        fn(arg_kind::size);
+        break;
+      case 't':
+        fn(arg_kind::ptrdiff);
+        break;
+      case 'j':
+        fn(arg_kind::intmax);
+        break;
+      default:
+        fn(arg_kind::int_);
+        break;
+      }
+      break;
+
+    case 'c':
+      fn((length == 'l') ? arg_kind::wint : arg_kind::int_);
+      break;
+
+    case 's':
+      fn((length == 'l') ? arg_kind::wstring : arg_kind::string);
+      break;
+
+    case 'p':
+      fn(arg_kind::pointer);
+      break;
+
+    case 'n':
+      fn(arg_kind::int_pointer);
+      break;
+
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+      fn(arg_kind::double_);
+      break;
+
+    case '@':
+      fn(arg_kind::udt);
+      break;
+
+    case '\0':
+      throw "frpp::package: truncated conversion specifier";
+
+    default:
+      throw "frpp::package: unsupported conversion specifier";
+    }
+
+    ptr++;
+  }
+}
+
+/**
+ * @brief Size of a package slot for a given kind
+ *
+ * @param kind Argument kind
+ * @return Slot size in bytes, identical to FRPP_VA_STACK_ALIGN
+ */
+constexpr size_t slot_size(arg_kind kind) {
+  switch (kind) {
+  case arg_kind::int_:
+    return FRPP_VA_STACK_ALIGN(int);
+  case arg_kind::long_:
+    return FRPP_VA_STACK_ALIGN(long);
+  case arg_kind::long_long:
+    return FRPP_VA_STACK_ALIGN(long long);
+  case arg_kind::size:
+    return FRPP_VA_STACK_ALIGN(size_t);
+  case arg_kind::ptrdiff:
+    return FRPP_VA_STACK_ALIGN(ptrdiff_t);
+  case arg_kind::intmax:
+    return FRPP_VA_STACK_ALIGN(intmax_t);
+  case arg_kind::string:
+    return FRPP_VA_STACK_ALIGN(char *);
+  case arg_kind::pointer:
+    return FRPP_VA_STACK_ALIGN(void *);
+  case arg_kind::int_pointer:
+    return FRPP_VA_STACK_ALIGN(int *);
+  case arg_kind::double_:
+    return FRPP_VA_STACK_ALIGN(double);
+  case arg_kind::udt:
+    return FRPP_VA_STACK_ALIGN(void *);
+  case arg_kind::wint:
+    return FRPP_VA_STACK_ALIGN(wint_t);
+  case arg_kind::wstring:
+    return FRPP_VA_STACK_ALIGN(wchar_t *);
+  }
+  return 0;
+}
+
+/**
+ * @brief Number of arguments consumed by a format string
+ */
+constexpr size_t count_args(const char *fmt) {
+  size_t count = 0;
+  parse(fmt, [&](arg_kind) { count++; });
+  return count;
+}
+
+/**
+ * @brief Compile-time layout of a format string's package
+ */
+template <format_string Fmt> struct layout {
+  static constexpr size_t count = count_args(Fmt.value);
+
+  static constexpr std::array<arg_kind, count> kinds = [] {
+    std::array<arg_kind, count> ret{};
+    size_t idx = 0;
+    parse(Fmt.value, [&](arg_kind kind) { ret[idx++] = kind; });
+    return ret;
+  }();
+
+  static constexpr std::array<size_t, count> offsets = [] {
+    std::array<size_t, count> ret{};
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+      ret[i] = offset;
+      offset += slot_size(kinds[i]);
+    }
+    return ret;
+  }();
+
+  static constexpr size_t size = [] {
+    size_t ret = 0;
+    for (size_t i = 0; i < count; i++) {
+      ret += slot_size(kinds[i]);
+    }
+    return ret;
+  }();
+
+  static constexpr size_t udt_count = [] {
+    size_t ret = 0;
+    for (size_t i = 0; i < count; i++) {
+      ret += (kinds[i] == arg_kind::udt) ? 1 : 0;
+    }
+    return ret;
+  }();
+};
+
+/*****************************************************************************
+ * Argument Type Checking
+ *****************************************************************************/
+
+template <typename T>
+using bare_t = std::remove_cv_t<std::remove_reference_t<T>>;
+
+template <typename T>
+inline constexpr bool is_int_like_v =
+    (std::is_integral_v<T> || std::is_enum_v<T>) && !std::is_same_v<T, bool>;
+
+/**
+ * @brief Whether an argument of type T may be packaged into a slot of kind.
+ * Integers must match the width of the specifier's type so that a
+ * mismatched length modifier is a compile error, not a desynced package.
+ */
+template <arg_kind Kind, typename T> consteval bool accepts() {
+  using U = std::decay_t<bare_t<T>>;
+
+  if constexpr (Kind == arg_kind::int_) {
+    return (is_int_like_v<U> && sizeof(U) <= sizeof(int)) ||
+           std::is_same_v<U, bool>;
+  } else if constexpr (Kind == arg_kind::long_) {
+    return is_int_like_v<U> && sizeof(U) == sizeof(long);
+  } else if constexpr (Kind == arg_kind::long_long) {
+    return is_int_like_v<U> && sizeof(U) == sizeof(long long);
+  } else if constexpr (Kind == arg_kind::size) {
+    return is_int_like_v<U> && sizeof(U) == sizeof(size_t);
+  } else if constexpr (Kind == arg_kind::ptrdiff) {
+    return is_int_like_v<U> && sizeof(U) == sizeof(ptrdiff_t);
+  } else if constexpr (Kind == arg_kind::intmax) {
+    return is_int_like_v<U> && sizeof(U) == sizeof(intmax_t);
+  } else if constexpr (Kind == arg_kind::string) {
+    return std::is_same_v<U, const char *> || std::is_same_v<U, char *>;
+  } else if constexpr (Kind == arg_kind::pointer) {
+    return std::is_pointer_v<U> || std::is_null_pointer_v<U>;
+  } else if constexpr (Kind == arg_kind::int_pointer) {
+    return std::is_same_v<U, int *>;
+  } else if constexpr (Kind == arg_kind::double_) {
+    return std::is_floating_point_v<U> && sizeof(U) <= sizeof(double);
+  } else if constexpr (Kind == arg_kind::udt) {
+    return std::is_same_v<U, const frpp_printf_udt *> ||
+           std::is_same_v<U, frpp_printf_udt *> ||
+           (frpp::has_formatter_v<T> && !std::is_pointer_v<U>);
+  } else if constexpr (Kind == arg_kind::wint) {
+    return is_int_like_v<U> && sizeof(U) <= sizeof(wint_t);
+  } else if constexpr (Kind == arg_kind::wstring) {
+    return std::is_same_v<U, const wchar_t *> || std::is_same_v<U, wchar_t *>;
+  } else {
+    return false;
+  }
+}
+
+/**
+ * @brief Argument for a %@ specifier, either passed as is or wrapped from an
+ * object with a registered formatter
+ */
+template <typename T> inline frpp_printf_udt to_udt(const T &arg) {
+  using U = std::decay_t<bare_t<T>>;
+
+  if constexpr (std::is_pointer_v<U>) {
+    return (arg != nullptr) ? *arg : frpp_printf_udt{nullptr, nullptr};
+  } else {
+    return udt(arg);
+  }
+}
+
+/**
+ * @brief Convert an argument to the type va_arg would have read for kind and
+ * write it to its slot
+ */
+template <arg_kind Kind, typename T>
+inline void write_slot(uint8_t *dst, T &&arg) {
+  if constexpr (Kind == arg_kind::int_) {
+    int val = static_cast<int>(arg);
+    std::memcpy(dst, &val, sizeof(val));
+  } else if constexpr (Kind == arg_kind::long_) {
+    long val = static_cast<long>(arg);
+    std::memcpy(dst, &val, sizeof(val));
+  } else if constexpr (Kind == arg_kind::long_long) {
+    long long val = static_cast<long long>(arg);
+    std::memcpy(dst, &val, sizeof(val));
+  } else if constexpr (Kind == arg_kind::size) {
+    size_t val = static_cast<size_t>(arg);
+    std::memcpy(dst, &val, sizeof(val));
+  } else if constexpr (Kind == arg_kind::ptrdiff) {
+    ptrdiff_t val = static_cast<ptrdiff_t>(arg);
+    std::memcpy(dst, &val, sizeof(val));
+  } else if constexpr (Kind == arg_kind::intmax) {
+    intmax_t val = static_cast<intmax_t>(arg);
+    std::memcpy(dst, &val, sizeof(val));
+  } else if constexpr (Kind == arg_kind::string) {
+    const char *val = arg;
+    std::memcpy(dst, &val, sizeof(val));
+  } else if constexpr (Kind == arg_kind::pointer) {
+    const void *val = arg;
+    std::memcpy(dst, &val, sizeof(val));
+  } else if constexpr (Kind == arg_kind::int_pointer) {
+    int *val = arg;
+    std::memcpy(dst, &val, sizeof(val));
+  } else if constexpr (Kind == arg_kind::double_) {
+    double val = static_cast<double>(arg);
+    std::memcpy(dst, &val, sizeof(val));
+  } else if constexpr (Kind == arg_kind::udt) {
+    const frpp_printf_udt_ops *val = to_udt(arg).ops;
+    std::memcpy(dst, &val, sizeof(val));
+  } else if constexpr (Kind == arg_kind::wint) {
+    wint_t val = static_cast<wint_t>(arg);
+    std::memcpy(dst, &val, sizeof(val));
+  } else if constexpr (Kind == arg_kind::wstring) {
+    const wchar_t *val = arg;
+    std::memcpy(dst, &val, sizeof(val));
+  }
+}
+
+/**
+ * @brief Append the captured entry of a %@ argument after the fixed size
+ * arguments, matching frpp_vprintf_package.  Other kinds append nothing.
+ *
+ * @param dst Destination buffer
+ * @param len Length of destination buffer
+ * @param idx Offset of entry, advanced past it
+ * @param arg Argument
+ * @return 0 or -ENOSPC
+ */
+template <arg_kind Kind, typename T>
+inline int write_trailing(uint8_t *dst, size_t len, size_t &idx, T &&arg) {
+  if constexpr (Kind == arg_kind::udt) {
+    frpp_printf_udt udt = to_udt(arg);
+    size_t size = 0;
+
+    if (udt.ops != nullptr && udt.ops->serialize != nullptr) {
+      size = udt.ops->serialize(udt.obj, nullptr, 0);
+    }
+
+    if (size > FRPP_PRINTF_UDT_SIZE_MAX || idx + 1 + size > len) {
+      return -ENOSPC;
+    }
+
+    dst[idx] = static_cast<uint8_t>(size);
+    if (size > 0) {
+      udt.ops->serialize(udt.obj, dst + idx + 1, size);
+    }
+
+    idx += 1 + size;
+  } else {
+    (void)dst;
+    (void)len;
+    (void)idx;
+    (void)arg;
+  }
+
+  return 0;
+}
+
+template <format_string Fmt, typename... Args, size_t... Idx>
+inline void write_all(uint8_t *dst, std::index_sequence<Idx...>,
+                      Args &&...args) {
+  using L = layout<Fmt>;
+  (write_slot<L::kinds[Idx]>(dst + L::offsets[Idx],
+                             static_cast<Args &&>(args)),
+   ...);
+}
+
+template <format_string Fmt, typename... Args, size_t... Idx>
+inline int write_all_trailing(uint8_t *dst, size_t len, size_t &idx,
+                              std::index_sequence<Idx...>, Args &&...args) {
+  using L = layout<Fmt>;
+  int ret = 0;
+  ((ret = (ret < 0) ? ret
+                    : write_trailing<L::kinds[Idx]>(
+                          dst, len, idx, static_cast<Args &&>(args))),
+   ...);
+  return ret;
+}
+
+template <format_string Fmt, typename... Args, size_t... Idx>
+consteval bool check_all(std::index_sequence<Idx...>) {
+  using L = layout<Fmt>;
+  return (accepts<L::kinds[Idx], Args>() && ...);
+}
+
+} // namespace detail
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Package size in bytes for format string Fmt.  Equal to what
+ * frpp_printf_package(NULL, 0, 0, Fmt, ...) returns, except for format
+ * strings with %@ where it is an upper bound.
+ */
+template <format_string Fmt>
+inline constexpr size_t package_size =
+    detail::layout<Fmt>::size +
+    detail::layout<Fmt>::udt_count * (1 + FRPP_PRINTF_UDT_SIZE_MAX);
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Format string with static storage duration for use with
+ * frpp_snprintf.  Returns the same pointer for every use of Fmt.
+ */
+template <format_string Fmt> constexpr const char *format_str() {
+  return Fmt.value;
+}
+
+/**
+ * @brief Package arguments for format string Fmt with a layout computed at
+ * compile time.  No format string parsing happens at runtime.
+ *
+ * @param dst Destination buffer
+ * @param len Length of destination buffer
+ * @param args Arguments matching specifiers in Fmt
+ * @retval Non-negative Length of package in bytes
+ * @retval -EINVAL dst is NULL
+ * @retval -ENOSPC Package exceeds len
+ */
+template <format_string Fmt, typename... Args>
+inline int package(void *dst, size_t len, Args &&...args) {
+  using L = detail::layout<Fmt>;
+
+  static_assert(sizeof...(Args) == L::count,
+                "frpp::package: argument count does not match format string");
+  static_assert(detail::check_all<Fmt, Args...>(
+                    std::make_index_sequence<sizeof...(Args)>{}),
+                "frpp::package: argument type does not match specifier");
+
+  if (dst == nullptr) {
+    return -EINVAL;
+  }
+
+  if (len < L::size) {
+    return -ENOSPC;
+  }
+
+  detail::write_all<Fmt>(static_cast<uint8_t *>(dst),
+                         std::make_index_sequence<sizeof...(Args)>{},
+                         static_cast<Args &&>(args)...);
+
+  if constexpr (L::udt_count > 0) {
+    size_t idx = L::size;
+    int ret = detail::write_all_trailing<Fmt>(
+        static_cast<uint8_t *>(dst), len, idx,
+        std::make_index_sequence<sizeof...(Args)>{},
+        static_cast<Args &&>(args)...);
+
+    return (ret < 0) ? ret : static_cast<int>(idx);
+  }
+
+  return static_cast<int>(L::size);
+}
+
+/**
+ * @brief Fixed-size package storage for format string Fmt
+ */
+template <format_string Fmt> struct packaged {
+  alignas(FRPP_STACK_MIN_ALIGN) uint8_t
+      buf[package_size<Fmt> ? package_size<Fmt> : 1];
+
+  static constexpr const char *fmt() { return format_str<Fmt>(); }
+  static constexpr size_t size() { return package_size<Fmt>; }
+  const void *data() const { return buf; }
+};
+
+/**
+ * @brief Package arguments into a packaged<Fmt> value
+ *
+ * @param args Arguments matching specifiers in Fmt
+ * @return Package storage
+ */
+template <format_string Fmt, typename... Args>
+inline packaged<Fmt> make_package(Args &&...args) {
+  packaged<Fmt> ret;
+  package<Fmt>(ret.buf, sizeof(ret.buf), static_cast<Args &&>(args)...);
+  return ret;
+}
+
+} // namespace frpp
+
+#endif /* frpp_package_hpp */
@@ -11,6 +11,7 @@
  */
 
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -25,10 +26,143 @@ extern "C" {
  * Definitions
  *****************************************************************************/
 
+/**
+ * @brief Package flag to copy %s arguments into the package so they don't
+ * need to outlive it.  Strings in ranges registered with
+ * frpp_printf_ro_range_add, and NULL strings, are still stored by pointer,
+ * as are %ls wide strings.  Packages created with this flag must be rendered
+ * with frpp_snprintf_ex and the same flags.
+ */
+#define FRPP_PRINTF_FLAG_CAPTURE_STR (1U << 0)
+
+/**
+ * @brief Package flag selecting the dense encoding.  Instead of a stack slot
+ * per argument, chars and shorts are stored at their natural width, other
+ * integers as varints (zigzag for signed conversions), and pointers and
+ * doubles unaligned at their natural width.  Format strings with positional
+ * (%n$) arguments ignore this flag.  Packages created with this flag must be
+ * rendered with frpp_snprintf_ex and the same flags.
+ */
+#define FRPP_PRINTF_FLAG_DENSE (1U << 1)
+
+/**
+ * @brief Package flag setting the most bytes copied per captured string
+ * (1-254).  Defaults to FRPP_PRINTF_CAPTURE_CAP_DEFAULT if not given.
+ */
+#define FRPP_PRINTF_FLAG_STR_CAP(cap_) ((((uint32_t)(cap_)) & 0xFFU) << 8)
+
+/**
+ * @brief Default most bytes copied per captured string
+ */
+#ifndef FRPP_PRINTF_CAPTURE_CAP_DEFAULT
+#define FRPP_PRINTF_CAPTURE_CAP_DEFAULT (32U)
+#endif
+
+/**
+ * @brief Marker ending captured strings that were cut short by the cap.
+ * Counts toward the cap.
+ */
+#ifndef FRPP_PRINTF_CAPTURE_TRUNC_MARKER
+#define FRPP_PRINTF_CAPTURE_TRUNC_MARKER "..."
+#endif
+
+/**
+ * @brief Number of read-only ranges that can be registered
+ */
+#ifndef FRPP_PRINTF_RO_RANGES_MAX
+#define FRPP_PRINTF_RO_RANGES_MAX (4U)
+#endif
+
+/**
+ * @brief Largest serialized user-defined type (%@ argument)
+ */
+#define FRPP_PRINTF_UDT_SIZE_MAX (0xFFU)
+
+/**
+ * @brief Wrap a user-defined type for a %@ argument
+ *
+ * @param ops_ Pointer to the type's struct frpp_printf_udt_ops
+ * @param obj_ Pointer to object
+ */
+#define FRPP_PRINTF_UDT(ops_, obj_)                                            \
+  (&(const struct frpp_printf_udt){.ops = (ops_), .obj = (obj_)})
+
 /*****************************************************************************
  * Structs, Unions, Enums, & Typedefs
  *****************************************************************************/
 
+/**
+ * @brief Hooks for a user-defined type logged with %@.  The object is
+ * serialized into the package when it's created and only rendered when the
+ * package is.  Ops must outlive every package referencing them.
+ */
+struct frpp_printf_udt_ops {
+  /**
+   * @brief Serialize object
+   *
+   * @param obj Object
+   * @param dst Destination, NULL to only determine size
+   * @param len Length of destination
+   * @return Serialized size in bytes.  Nothing is written if it exceeds len.
+   */
+  size_t (*serialize)(const void *obj, void *dst, size_t len);
+
+  /**
+   * @brief Render serialized object, with snprintf semantics
+   *
+   * @param data Serialized object.  Not aligned.
+   * @param len Length of serialized object
+   * @param out Output buffer (may be NULL if out_size is 0)
+   * @param out_size Size of output buffer
+   * @return Length of rendered text, excluding the NULL terminator
+   */
+  int (*render)(const void *data, size_t len, char *out, size_t out_size);
+};
+
+/**
+ * @brief Argument passed for a %@ specifier.  Flags, width and precision of
+ * %@ are ignored.
+ */
+struct frpp_printf_udt {
+  /* Type hooks, NULL renders as "(null)" */
+  const struct frpp_printf_udt_ops *ops;
+
+  /* Object, only accessed while packaging */
+  const void *obj;
+};
+
+/**
+ * @brief Package to render with frpp_snprintf_batch
+ */
+struct frpp_printf_record {
+  /* Format string */
+  const char *fmt;
+
+  /* Package */
+  const void *arg_buf;
+
+  /* Flags package was created with */
+  uint32_t flags;
+};
+
+/**
+ * @brief Region reserved for single-pass packaging.  Packages are appended
+ * at used, and a failed package leaves everything before used untouched.
+ */
+struct frpp_printf_reservation {
+  /* Start of reserved region */
+  uint8_t *region;
+
+  /* Size of reserved region in bytes */
+  size_t capacity;
+
+  /* Bytes committed so far */
+  size_t used;
+
+  /* Flags of most recent package */
+  uint32_t flags;
+};
+
 /*****************************************************************************
  * Function Prototypes
  *****************************************************************************/
@@ -41,12 +175,19 @@ extern "C" {
  * @param dst Destination buffer to write package to.  If NULL and len == 0,
  * will return required buffer space for package.
  * @param len Length of destination buffer.  If dst NULL, then len MUST be 0
- * @param flags Currently unused and ignored
- * @param fmt_str Format string.  Must be in RO memory
+ * @param flags FRPP_PRINTF_FLAG_* package flags
+ * @param fmt_str Format string.  Must be in RO memory.  Takes the C11
+ * conversions, including '*' width and precision, and POSIX positional
+ * (%n$, *n$) arguments, up to FRPP_PRINTF_POS_ARGS_MAX of them.  Besides
+ * those, %@ takes a const struct frpp_printf_udt * (see FRPP_PRINTF_UDT)
+ * whose object is serialized into the package
  * @retval Non-negative Length of package in bytes (will not exceed length if
  * dst != NULL && len != 0)
- * @retval -EINVAL Invalid input arguments
- * @retval -ENOSPC If dst != NULL and package exceeds len
+ * @retval -EINVAL Invalid input arguments, or positional arguments mixed
+ * with ones taken in order, skipped, or used with conflicting types
+ * @retval -E2BIG More than FRPP_PRINTF_POS_ARGS_MAX positional arguments
+ * @retval -ENOSPC If dst != NULL and package exceeds len, or a %@ object
+ * serializes to more than FRPP_PRINTF_UDT_SIZE_MAX bytes
  */
 int frpp_printf_package(void *dst, size_t len, uint32_t flags,
                         const char *fmt_str, ...);
@@ -58,7 +199,7 @@ int frpp_printf_package(void *dst, size_t len, uint32_t flags,
  * @param dst Destination buffer to write package to.  If NULL and len == 0,
  * will return required buffer space for package.
  * @param len Length of destination buffer.  If dst NULL, then len MUST be 0
- * @param flags Currently unused and ignored
+ * @param flags FRPP_PRINTF_FLAG_* package flags
  * @param fmt_str Format string.  Must be in RO memory
  * @param args va_list instance
  * @retval Non-negative Length of package in bytes (will not exceed length if
@@ -69,6 +210,89 @@ int frpp_printf_package(void *dst, size_t len, uint32_t flags,
 int frpp_vprintf_package(void *dst, size_t len, uint32_t flags,
                          const char *fmt_str, va_list args);
 
+/**
+ * @brief Begin single-pass packaging into a caller-provided region, such as a
+ * queue slot sized for the largest expected package
+ *
+ * @param res Reservation to initialize
+ * @param region Start of region
+ * @param capacity Size of region in bytes
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_printf_reserve(struct frpp_printf_reservation *res, void *region,
+                        size_t capacity);
+
+/**
+ * @brief Package format string arguments into a reservation in a single pass.
+ * Unlike sizing with frpp_vprintf_package first, the format string is walked
+ * once and args is consumed once.
+ *
+ * @param res Reservation
+ * @param flags FRPP_PRINTF_FLAG_* package flags
+ * @param fmt_str Format string.  Must be in RO memory
+ * @retval Non-negative Length of package in bytes
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Package exceeds remaining capacity
+ * @retval Negative Any other error of frpp_printf_package.  On every error,
+ * bytes before res->used are untouched and bytes after are zeroed, so a
+ * failed package never leaves a partial one behind.
+ */
+int frpp_printf_reserve_package(struct frpp_printf_reservation *res,
+                                uint32_t flags, const char *fmt_str, ...);
+
+/**
+ * @brief Same as frpp_printf_reserve_package, but takes a va_list
+ *
+ * @param res Reservation
+ * @param flags FRPP_PRINTF_FLAG_* package flags
+ * @param fmt_str Format string.  Must be in RO memory
+ * @param args va_list instance
+ * @retval Non-negative Length of package in bytes
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC Package exceeds remaining capacity
+ */
+int frpp_vprintf_reserve_package(struct frpp_printf_reservation *res,
+                                 uint32_t flags, const char *fmt_str,
+                                 va_list args);
+
+/**
+ * @brief Finish packaging into a reservation
+ *
+ * @param res Reservation
+ * @return Bytes used in region
+ */
+size_t frpp_printf_commit(struct frpp_printf_reservation *res);
+
+/**
+ * @brief Abandon packaging into a reservation.  Everything packaged so far is
+ * discarded and the region is zeroed.
+ *
+ * @param res Reservation
+ */
+void frpp_printf_abort(struct frpp_printf_reservation *res);
+
+/**
+ * @brief Register a read-only memory range.  %s arguments pointing into it
+ * are stored by pointer even when FRPP_PRINTF_FLAG_CAPTURE_STR is set.
+ * Ranges should be registered during init, before any packaging.
+ *
+ * @param start Start of range
+ * @param len Length of range in bytes
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOSPC FRPP_PRINTF_RO_RANGES_MAX ranges already registered
+ */
+int frpp_printf_ro_range_add(const void *start, size_t len);
+
+/**
+ * @brief Determine if pointer is in a registered read-only range
+ *
+ * @param ptr Pointer
+ * @return true if in a registered range
+ */
+bool frpp_printf_is_ro(const void *ptr);
+
 /**
  * @brief Perform sprintf with packaged args
  *
@@ -83,6 +307,42 @@ int frpp_vprintf_package(void *dst, size_t len, uint32_t flags,
 int frpp_snprintf(const char *fmt_str, const void *arg_buf, void *out_buf,
                   size_t out_buf_size_bytes);
 
+/**
+ * @brief Same as frpp_snprintf, for packages created with flags
+ *
+ * @param fmt_str Format string
+ * @param flags Flags package was created with
+ * @param arg_buf Pointer to argument buffer
+ * @param out_buf Output buffer to write process string to
+ * @param out_buf_size_bytes Length of output buffer
+ * @retval -EINVAL Invalid input arguments
+ * @return Returns error condition outlined above or standard return value
+ * expected from snprintf
+ */
+int frpp_snprintf_ex(const char *fmt_str, uint32_t flags, const void *arg_buf,
+                     void *out_buf, size_t out_buf_size_bytes);
+
+/**
+ * @brief Render packages back to back into one output buffer, so a log
+ * consumer can hand a single write to its sink.  Records are rendered in
+ * order until one doesn't fit; no record is ever split.
+ *
+ * @param records Packages to render
+ * @param count Number of packages
+ * @param out_buf Output buffer.  NULL terminated after the last rendered
+ * record
+ * @param out_buf_size_bytes Size of output buffer
+ * @param offsets Output of count + 1 entries.  Record i was rendered to
+ * [offsets[i], offsets[i + 1]), for each rendered record.  offsets[0] is
+ * always 0
+ * @retval Non-negative Number of records rendered.  The rest didn't fit.
+ * @retval -EINVAL Invalid input arguments, or a record has a NULL format
+ * string or package
+ */
+int frpp_snprintf_batch(const struct frpp_printf_record *records, size_t count,
+                        void *out_buf, size_t out_buf_size_bytes,
+                        size_t *offsets);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_printf_cache.h
+ * @author Evan Stoddard
+ * @brief Cache of parsed format string signatures keyed by format string
+ * pointer.  Since format strings passed to frpp_printf_package must live in
+ * RO memory, the pointer uniquely identifies the layout of a package and the
+ * format string only needs to be parsed the first time it is seen.
+ *
+ * When a format string's probe run is full, an entry not hit since the last
+ * eviction passed over it is replaced (second chance), so a working set
+ * larger than the cache keeps its hottest format strings cached.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frpp/sys/frpp_printf_parse.h"
+
+#ifndef frpp_printf_cache_h
+#define frpp_printf_cache_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Number of cache entries, sized for a working set of a few hundred
+ * format strings.  Each costs about 56 bytes of RAM.  Must be a power of
+ * two.  Set to 0 to compile the cache out entirely.
+ */
+#ifndef FRPP_PRINTF_CACHE_SIZE
+#define FRPP_PRINTF_CACHE_SIZE (256U)
+#endif
+
+/**
+ * @brief Maximum number of arguments a cacheable format string may consume
+ */
+#ifndef FRPP_PRINTF_CACHE_MAX_ARGS
+#define FRPP_PRINTF_CACHE_MAX_ARGS (12U)
+#endif
+
+/**
+ * @brief Maximum number of slots probed for a format string, and searched
+ * for one to replace when all are taken
+ */
+#ifndef FRPP_PRINTF_CACHE_MAX_PROBE
+#define FRPP_PRINTF_CACHE_MAX_PROBE (8U)
+#endif
+
+#if (FRPP_PRINTF_CACHE_SIZE & (FRPP_PRINTF_CACHE_SIZE - 1)) != 0
+#error "FRPP_PRINTF_CACHE_SIZE must be a power of two"
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Precomputed argument signature of a format string
+ */
+struct frpp_printf_signature {
+  /* Total package size in bytes */
+  uint16_t size;
+
+  /* Number of arguments consumed */
+  uint8_t count;
+
+  /* Argument types (frpp_printf_arg_t) */
+  uint8_t types[FRPP_PRINTF_CACHE_MAX_ARGS];
+
+  /* Offset of each argument within package */
+  uint16_t offsets[FRPP_PRINTF_CACHE_MAX_ARGS];
+};
+
+/**
+ * @brief Cache counters
+ */
+struct frpp_printf_cache_stats {
+  /* Lookups satisfied by an existing entry */
+  uint32_t hits;
+
+  /* Lookups that had to parse the format string */
+  uint32_t misses;
+
+  /* Lookups of format strings that cannot be cached (too many or invalid
+   * arguments), or whose entry was being written by another thread.  These
+   * fall back to parsing. */
+  uint32_t uncacheable;
+
+  /* Entries replaced by another format string */
+  uint32_t evictions;
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Build signature of a format string
+ *
+ * @param fmt_str Format string
+ * @param sig Signature output
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments, or invalid positional arguments
+ * (see frpp_printf_parse_positions)
+ * @retval -E2BIG Format string consumes more than FRPP_PRINTF_CACHE_MAX_ARGS
+ */
+int frpp_printf_signature_build(const char *fmt_str,
+                                struct frpp_printf_signature *sig);
+
+/**
+ * @brief Look up signature of format string, parsing and inserting it on a
+ * miss.  Safe to call concurrently from multiple threads.  The signature is
+ * copied out since its entry may be replaced at any time.
+ *
+ * @param fmt_str Format string.  Must be in RO memory
+ * @param sig Signature output
+ * @retval 0 Success
+ * @retval -ENOENT Format string can't be cached, or its entry is being
+ * written by another thread.  Parse it instead.
+ */
+int frpp_printf_cache_lookup(const char *fmt_str,
+                             struct frpp_printf_signature *sig);
+
+/**
+ * @brief Read cache counters
+ *
+ * @param stats Counters output
+ */
+void frpp_printf_cache_get_stats(struct frpp_printf_cache_stats *stats);
+
+/**
+ * @brief Drop all cached signatures and zero counters.  Must not be called
+ * concurrently with packaging.
+ */
+void frpp_printf_cache_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_printf_cache_h */
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_printf_parse.h
+ * @author Evan Stoddard
+ * @brief Format string specifier parser shared by the packager, descriptor
+ * cache, and renderer so all of them agree on package layout.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef frpp_printf_parse_h
+#define frpp_printf_parse_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/* Specifier flag characters */
+#define FRPP_PRINTF_SPEC_LEFT (1U << 0)  /* '-' */
+#define FRPP_PRINTF_SPEC_PLUS (1U << 1)  /* '+' */
+#define FRPP_PRINTF_SPEC_SPACE (1U << 2) /* ' ' */
+#define FRPP_PRINTF_SPEC_ALT (1U << 3)   /* '#' */
+#define FRPP_PRINTF_SPEC_ZERO (1U << 4)  /* '0' */
+
+/* Width and precision given as '*', read from int arguments */
+#define FRPP_PRINTF_SPEC_WIDTH_ARG (1U << 5)
+#define FRPP_PRINTF_SPEC_PREC_ARG (1U << 6)
+
+/**
+ * @brief Most arguments consumed by a single specifier: width, precision
+ * and value
+ */
+#define FRPP_PRINTF_SPEC_ARGS_MAX (3U)
+
+/**
+ * @brief Most arguments a format string with positional (%n$) specifiers
+ * may consume
+ */
+#ifndef FRPP_PRINTF_POS_ARGS_MAX
+#define FRPP_PRINTF_POS_ARGS_MAX (16U)
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Type of argument consumed by a conversion specifier, as read by
+ * va_arg
+ */
+typedef enum {
+  FRPP_PRINTF_ARG_NONE = 0,
+  FRPP_PRINTF_ARG_INT,
+  FRPP_PRINTF_ARG_LONG,
+  FRPP_PRINTF_ARG_LONG_LONG,
+  FRPP_PRINTF_ARG_SIZE,
+  FRPP_PRINTF_ARG_PTRDIFF,
+  FRPP_PRINTF_ARG_INTMAX,
+  FRPP_PRINTF_ARG_STR,
+  FRPP_PRINTF_ARG_PTR,
+  FRPP_PRINTF_ARG_DOUBLE,
+  FRPP_PRINTF_ARG_UDT,
+  FRPP_PRINTF_ARG_WINT,
+  FRPP_PRINTF_ARG_WSTR,
+  FRPP_PRINTF_ARG_LONG_DOUBLE,
+} frpp_printf_arg_t;
+
+/**
+ * @brief Length modifier of a conversion specifier
+ */
+typedef enum {
+  FRPP_PRINTF_LEN_NONE = 0,
+  FRPP_PRINTF_LEN_HH,
+  FRPP_PRINTF_LEN_H,
+  FRPP_PRINTF_LEN_L,
+  FRPP_PRINTF_LEN_LL,
+  FRPP_PRINTF_LEN_Z,
+  FRPP_PRINTF_LEN_T,
+  FRPP_PRINTF_LEN_J,
+  FRPP_PRINTF_LEN_BIG_L,
+} frpp_printf_len_t;
+
+/**
+ * @brief Single parsed conversion specifier
+ */
+struct frpp_printf_spec {
+  /* Pointer to the '%' that starts the specifier */
+  const char *start;
+
+  /* Pointer to one past the conversion character */
+  const char *end;
+
+  /* Argument consumed, FRPP_PRINTF_ARG_NONE for "%%" and unknown */
+  frpp_printf_arg_t arg;
+
+  /* Conversion character */
+  char conversion;
+
+  /* Length modifier */
+  uint8_t length;
+
+  /* Flag characters (FRPP_PRINTF_SPEC_*) */
+  uint8_t flags;
+
+  /* Minimum field width, -1 if not specified or read from an argument */
+  int width;
+
+  /* Precision, -1 if not specified or read from an argument */
+  int precision;
+
+  /* 1-based positions of the value, width and precision arguments given as
+   * %n$ and *n$, 0 if taken in order */
+  uint8_t pos;
+  uint8_t width_pos;
+  uint8_t prec_pos;
+};
+
+/**
+ * @brief Argument types of a format string with positional specifiers, in
+ * va_list order
+ */
+struct frpp_printf_pos_args {
+  /* Number of arguments */
+  uint8_t count;
+
+  /* Argument types (frpp_printf_arg_t) */
+  uint8_t types[FRPP_PRINTF_POS_ARGS_MAX];
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Find and parse the next conversion specifier in a format string
+ *
+ * @param ptr Position in format string to start searching from
+ * @param spec Parsed specifier output
+ * @return Position to resume parsing from, or NULL if no specifier remains
+ */
+const char *frpp_printf_parse_next(const char *ptr,
+                                   struct frpp_printf_spec *spec);
+
+/**
+ * @brief Arguments consumed by a specifier taking its arguments in order
+ *
+ * @param spec Specifier
+ * @param types Argument types output in va_list order, room for
+ * FRPP_PRINTF_SPEC_ARGS_MAX
+ * @return Number of arguments
+ */
+size_t frpp_printf_spec_args(const struct frpp_printf_spec *spec,
+                             frpp_printf_arg_t *types);
+
+/**
+ * @brief Collect argument types of a format string with positional
+ * specifiers.  Every argument up to the highest position must be referenced.
+ *
+ * @param fmt_str Format string
+ * @param args Argument types output
+ * @retval 1 Format string is positional, args is valid
+ * @retval 0 Format string takes its arguments in order
+ * @retval -EINVAL Format string mixes positional and in-order arguments,
+ * skips a position, or uses one with conflicting types
+ * @retval -E2BIG Format string consumes more than FRPP_PRINTF_POS_ARGS_MAX
+ */
+int frpp_printf_parse_positions(const char *fmt_str,
+                                struct frpp_printf_pos_args *args);
+
+/**
+ * @brief Size of an argument's slot in a package
+ *
+ * @param arg Argument type
+ * @return Slot size in bytes (0 for FRPP_PRINTF_ARG_NONE)
+ */
+size_t frpp_printf_arg_size(frpp_printf_arg_t arg);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_printf_parse_h */
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_printf_stats.h
+ * @author Evan Stoddard
+ * @brief Optional per-call-site instrumentation of packaging and rendering,
+ * keyed by format string pointer.  Compiled out unless FRPP_PRINTF_STATS is
+ * set.  Each thread counts into its own table with plain relaxed stores, so
+ * instrumented calls never contend with each other; readers sum the tables.
+ * Threads without a table of their own count into a shared one with atomic
+ * read-modify-writes.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef frpp_printf_stats_h
+#define frpp_printf_stats_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Set to 1 to instrument frpp_vprintf_package and frpp_snprintf_ex
+ */
+#ifndef FRPP_PRINTF_STATS
+#define FRPP_PRINTF_STATS (0)
+#endif
+
+/**
+ * @brief Most threads with a table of their own.  Further threads count into
+ * the shared table.
+ */
+#ifndef FRPP_PRINTF_STATS_THREADS
+#define FRPP_PRINTF_STATS_THREADS (8U)
+#endif
+
+/**
+ * @brief Per-thread storage of the calling thread's table.
+ * FRPP_PRINTF_STATS_TLS_GET() returns the pointer the calling thread last
+ * stored with FRPP_PRINTF_STATS_TLS_SET(ptr_), NULL before that.  Defaults to
+ * a _Thread_local variable on Linux and macOS.  On FreeRTOS, reserve a
+ * thread local storage pointer index (configNUM_THREAD_LOCAL_STORAGE_POINTERS)
+ * and point the hooks at it:
+ *
+ *   #define FRPP_PRINTF_STATS_TLS_GET()                                   \
+ *     pvTaskGetThreadLocalStoragePointer(NULL, 0)
+ *   #define FRPP_PRINTF_STATS_TLS_SET(ptr_)                               \
+ *     vTaskSetThreadLocalStoragePointer(NULL, 0, (ptr_))
+ *
+ * Without per-thread storage, every thread counts into the shared table.
+ */
+#ifndef FRPP_PRINTF_STATS_TLS
+#if defined(FRPP_PRINTF_STATS_TLS_GET) || defined(__linux__) ||               \
+    defined(__APPLE__)
+#define FRPP_PRINTF_STATS_TLS (1)
+#else
+#define FRPP_PRINTF_STATS_TLS (0)
+#endif
+#endif
+
+/**
+ * @brief Call sites tracked per table.  Must be a power of two.
+ */
+#ifndef FRPP_PRINTF_STATS_SITES
+#define FRPP_PRINTF_STATS_SITES (32U)
+#endif
+
+/**
+ * @brief Cycle counter read around packaging and rendering.  Defaults to the
+ * TSC on x86; other targets should point it at their cycle counter (e.g. the
+ * DWT on Cortex-M), otherwise cycles read as 0.
+ */
+#ifndef FRPP_PRINTF_STATS_CYCLES
+#if defined(__x86_64__) || defined(__i386__)
+#define FRPP_PRINTF_STATS_CYCLES() ((uint64_t)__builtin_ia32_rdtsc())
+#else
+#define FRPP_PRINTF_STATS_CYCLES() ((uint64_t)0)
+#endif
+#endif
+
+#if (FRPP_PRINTF_STATS_SITES & (FRPP_PRINTF_STATS_SITES - 1)) != 0
+#error "FRPP_PRINTF_STATS_SITES must be a power of two"
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Counters of a single call site, summed over all threads
+ */
+struct frpp_printf_stats_site {
+  /* Format string identifying call site */
+  const char *fmt;
+
+  /* Packages written (calculate mode calls aren't counted) */
+  uint32_t packages;
+
+  /* Packages that failed with -ENOSPC */
+  uint32_t enospc;
+
+  /* Total bytes of successful packages */
+  uint64_t package_bytes;
+
+  /* Cycles spent packaging */
+  uint64_t package_cycles;
+
+  /* Packages rendered */
+  uint32_t renders;
+
+  /* Cycles spent rendering */
+  uint64_t render_cycles;
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Record a package written.  Called by frpp_vprintf_package.
+ *
+ * @param fmt_str Format string
+ * @param ret Return value of frpp_vprintf_package
+ * @param cycles Cycles spent
+ */
+void frpp_printf_stats_package(const char *fmt_str, int ret, uint64_t cycles);
+
+/**
+ * @brief Record a package rendered.  Called by frpp_snprintf_ex.
+ *
+ * @param fmt_str Format string
+ * @param cycles Cycles spent
+ */
+void frpp_printf_stats_render(const char *fmt_str, uint64_t cycles);
+
+/**
+ * @brief Read counters of all call sites seen so far
+ *
+ * @param sites Output array
+ * @param max Size of output array
+ * @retval Non-negative Number of call sites written to sites
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOTSUP Built without FRPP_PRINTF_STATS
+ */
+int frpp_printf_stats_read(struct frpp_printf_stats_site *sites, size_t max);
+
+/**
+ * @brief Calls that weren't counted because their thread's table was full
+ *
+ * @return Number of dropped calls
+ */
+uint32_t frpp_printf_stats_dropped(void);
+
+/**
+ * @brief Zero all counters and forget call sites.  Must not be called
+ * concurrently with packaging or rendering.
+ */
+void frpp_printf_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_printf_stats_h */
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_timestamp.h
+ * @author Evan Stoddard
+ * @brief Timestamp sources for deferred records, and the delta encoding
+ * records store them in.  A record keeps the difference from the previous
+ * record's timestamp as a varint, usually one to three bytes instead of
+ * eight, and the consumer adds deltas back up while rendering.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef frpp_timestamp_h
+#define frpp_timestamp_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Free running cycle counter read by frpp_timestamp_cycles.
+ * Defaults to the TSC on x86 and the virtual counter on AArch64; other
+ * targets should point it at their counter extended to 64 bits (e.g. the DWT
+ * on Cortex-M), otherwise frpp_timestamp_monotonic is used.
+ */
+#ifndef FRPP_TIMESTAMP_CYCLES
+#if defined(__x86_64__) || defined(__i386__)
+#define FRPP_TIMESTAMP_CYCLES() ((uint64_t)__builtin_ia32_rdtsc())
+#elif defined(__aarch64__)
+#define FRPP_TIMESTAMP_CYCLES() frpp_timestamp_cntvct()
+#endif
+#endif
+
+/**
+ * @brief Monotonic tick read by frpp_timestamp_monotonic.  Defaults to
+ * CLOCK_MONOTONIC in nanoseconds on Linux; other targets should point it at
+ * their tick count (e.g. xTaskGetTickCount extended to 64 bits), otherwise
+ * it reads as 0.
+ */
+#ifndef FRPP_TIMESTAMP_MONOTONIC
+#if defined(__linux__)
+#define FRPP_TIMESTAMP_MONOTONIC() frpp_timestamp_clock_monotonic()
+#else
+#define FRPP_TIMESTAMP_MONOTONIC() ((uint64_t)0)
+#endif
+#endif
+
+/**
+ * @brief Longest encoded delta in bytes
+ */
+#define FRPP_TIMESTAMP_DELTA_MAX (10U)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Timestamp source.  Must not go backwards on any one thread, and
+ * must be comparable across threads whose records are merged.
+ */
+typedef uint64_t (*frpp_timestamp_source_t)(void);
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Read the cycle counter (see FRPP_TIMESTAMP_CYCLES)
+ *
+ * @return Cycles
+ */
+uint64_t frpp_timestamp_cycles(void);
+
+/**
+ * @brief Read the monotonic tick (see FRPP_TIMESTAMP_MONOTONIC)
+ *
+ * @return Ticks
+ */
+uint64_t frpp_timestamp_monotonic(void);
+
+#if defined(__aarch64__)
+/**
+ * @brief Read the AArch64 virtual counter
+ *
+ * @return Counter value
+ */
+uint64_t frpp_timestamp_cntvct(void);
+#endif
+
+#if defined(__linux__)
+/**
+ * @brief Read CLOCK_MONOTONIC
+ *
+ * @return Nanoseconds
+ */
+uint64_t frpp_timestamp_clock_monotonic(void);
+#endif
+
+/**
+ * @brief Encode difference between a timestamp and the previous one.  The
+ * difference is zigzag encoded, so timestamps that go backwards (e.g. a
+ * counter read on another core) still encode compactly.
+ *
+ * @param ts Timestamp
+ * @param prev Previous timestamp
+ * @param dst Destination, at least FRPP_TIMESTAMP_DELTA_MAX bytes
+ * @return Number of bytes written
+ */
+size_t frpp_timestamp_delta_encode(uint64_t ts, uint64_t prev, uint8_t *dst);
+
+/**
+ * @brief Decode delta and rebuild timestamp
+ *
+ * @param src Encoded delta
+ * @param len Bytes available at src
+ * @param prev Previous timestamp
+ * @param ts Timestamp output
+ * @retval Positive Number of bytes read
+ * @retval -EINVAL Invalid input arguments
+ * @retval -EBADMSG Delta is truncated or longer than FRPP_TIMESTAMP_DELTA_MAX
+ */
+int frpp_timestamp_delta_decode(const uint8_t *src, size_t len, uint64_t prev,
+                                uint64_t *ts);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_timestamp_h */
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_tlsf.h
+ * @author Evan Stoddard
+ * @brief Two-level segregated fit allocator over caller-provided memory.
+ * Free blocks are kept in lists by size class, found through two levels of
+ * bitmaps, so allocation and free run in constant time with no loop over
+ * blocks: worst case is bounded and independent of heap state.  Freed
+ * blocks merge with free neighbours immediately.
+ *
+ * Sized for packages: classes are 8 bytes apart below 128 bytes and 1/16th
+ * of a power of two above, and each block costs 8 bytes of overhead.
+ *
+ * Not thread safe.  Guard calls with a lock or critical section when the
+ * heap is shared; both are short and bounded.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frpp/sys/frpp_printf.h"
+
+#ifndef frpp_tlsf_h
+#define frpp_tlsf_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Log2 of the largest block.  Memory past it is left unused.
+ */
+#ifndef FRPP_TLSF_FL_MAX
+#define FRPP_TLSF_FL_MAX (20U)
+#endif
+
+/**
+ * @brief Log2 of size classes per power of two
+ */
+#define FRPP_TLSF_SL_LOG2 (4U)
+
+#define FRPP_TLSF_SL_COUNT (1U << FRPP_TLSF_SL_LOG2)
+
+/**
+ * @brief Alignment of allocations
+ */
+#define FRPP_TLSF_ALIGN (8U)
+
+/**
+ * @brief Sizes below this are classed linearly
+ */
+#define FRPP_TLSF_SMALL (FRPP_TLSF_SL_COUNT * FRPP_TLSF_ALIGN)
+
+/**
+ * @brief First-level classes: one for small sizes, and one per power of two
+ * from FRPP_TLSF_SMALL up to 1 << FRPP_TLSF_FL_MAX
+ */
+#define FRPP_TLSF_FL_COUNT (FRPP_TLSF_FL_MAX - 6U)
+
+#if FRPP_TLSF_FL_MAX < 8 || FRPP_TLSF_FL_MAX > 30
+#error "FRPP_TLSF_FL_MAX must be between 8 and 30"
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Usage statistics
+ */
+struct frpp_tlsf_stats {
+  /* Bytes managed, in use (including block overhead), and free */
+  size_t total;
+  size_t used;
+  size_t free;
+
+  /* Most bytes ever in use */
+  size_t high_water;
+
+  /* Largest free block, and number of free blocks */
+  size_t largest_free;
+  size_t free_blocks;
+
+  /* Share of free block bytes outside the largest free block, in percent:
+   * 0 when free memory is one block */
+  uint32_t fragmentation;
+
+  /* Calls to alloc and free, and allocations that failed */
+  size_t allocs;
+  size_t frees;
+  size_t failures;
+};
+
+/**
+ * @brief Allocator instance.  Treat members as private.
+ */
+struct frpp_tlsf {
+  /* Bitmap of first-level classes with free blocks, and per first-level
+   * class, bitmap of second-level classes with free blocks */
+  uint32_t fl_bitmap;
+  uint32_t sl_bitmap[FRPP_TLSF_FL_COUNT];
+
+  /* Heads of free lists */
+  void *blocks[FRPP_TLSF_FL_COUNT][FRPP_TLSF_SL_COUNT];
+
+  /* First block */
+  void *first;
+
+  /* Counters kept in constant time */
+  size_t total;
+  size_t used;
+  size_t high_water;
+  size_t allocs;
+  size_t frees;
+  size_t failures;
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize allocator over memory
+ *
+ * @param tlsf Allocator instance
+ * @param mem Memory.  Must be aligned to FRPP_TLSF_ALIGN
+ * @param size Size of memory
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments, or memory too small
+ */
+int frpp_tlsf_init(struct frpp_tlsf *tlsf, void *mem, size_t size);
+
+/**
+ * @brief Allocate block
+ *
+ * @param tlsf Allocator instance
+ * @param size Bytes needed
+ * @return Block aligned to FRPP_TLSF_ALIGN, or NULL if none is free
+ */
+void *frpp_tlsf_alloc(struct frpp_tlsf *tlsf, size_t size);
+
+/**
+ * @brief Free block
+ *
+ * @param tlsf Allocator instance
+ * @param ptr Block from frpp_tlsf_alloc, or NULL
+ */
+void frpp_tlsf_free(struct frpp_tlsf *tlsf, void *ptr);
+
+/**
+ * @brief Get usable size of a block, at least the size requested
+ *
+ * @param ptr Block from frpp_tlsf_alloc
+ * @return Usable bytes
+ */
+size_t frpp_tlsf_block_size(const void *ptr);
+
+/**
+ * @brief Get usage statistics.  Walks all blocks, so unlike allocation its
+ * time grows with the heap.
+ *
+ * @param tlsf Allocator instance
+ * @param stats Statistics output
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_tlsf_stats(struct frpp_tlsf *tlsf, struct frpp_tlsf_stats *stats);
+
+/**
+ * @brief Package arguments into a block allocated to fit them exactly, to be
+ * rendered later and then freed with frpp_tlsf_free
+ *
+ * @param tlsf Allocator instance
+ * @param pkg Block output
+ * @param flags FRPP_PRINTF_FLAG_* package flags
+ * @param fmt_str Format string
+ * @retval Non-negative Length of package
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOMEM No block free
+ */
+int frpp_tlsf_package(struct frpp_tlsf *tlsf, void **pkg, uint32_t flags,
+                      const char *fmt_str, ...);
+
+/**
+ * @brief Same as frpp_tlsf_package, taking a va_list
+ *
+ * @param tlsf Allocator instance
+ * @param pkg Block output
+ * @param flags FRPP_PRINTF_FLAG_* package flags
+ * @param fmt_str Format string
+ * @param args va_list instance
+ * @retval Non-negative Length of package
+ * @retval -EINVAL Invalid input arguments
+ * @retval -ENOMEM No block free
+ */
+int frpp_tlsf_vpackage(struct frpp_tlsf *tlsf, void **pkg, uint32_t flags,
+                       const char *fmt_str, va_list args);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_tlsf_h */
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file atomic.h
+ * @author Evan Stoddard
+ * @brief Atomic members for public structs that C++ callers also include.
+ * C11 atomic types aren't C++, so C++ sees std::atomic of the same type,
+ * which GCC and Clang lay out the same for lock-free types.  Members are
+ * only accessed from the C sources.
+ */
+
+#ifdef __cplusplus
+#include <atomic>
+#else
+#include <stdatomic.h>
+#endif
+
+#ifndef frpp_atomic_h
+#define frpp_atomic_h
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Atomic member of type type_
+ */
+#ifdef __cplusplus
+#define FRPP_ATOMIC(type_) std::atomic<type_>
+#else
+#define FRPP_ATOMIC(type_) _Atomic(type_)
+#endif
+
+#endif /* frpp_atomic_h */
@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/logging/frpp_log.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#if FRPP_LOG_LIMIT_SLOTS
+#define PRV_LIMIT_SETS (FRPP_LOG_LIMIT_SLOTS / FRPP_LOG_LIMIT_WAYS)
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+typedef uint32_t (*prv_tick_fn)(void);
+
+/**
+ * @brief Rate limiting state of a format string.  Producers update it
+ * without locks, so counts are approximate when they race on the same
+ * format string; a record is never lost without being counted.
+ */
+struct prv_limit {
+  /* Format string owning slot, 0 if unused */
+  atomic_uintptr_t key;
+
+  /* Tick window started at */
+  atomic_uint_least32_t start;
+
+  /* Records logged in window */
+  atomic_uint_least32_t count;
+
+  /* Records suppressed since last reported */
+  atomic_uint_least32_t suppressed;
+
+  /* Set's clock when last checked against */
+  atomic_uint_least32_t used;
+};
+
+/**
+ * @brief Format strings whose pointers hash to the same set
+ */
+struct prv_limit_set {
+  /* Advanced on every check against the set, to find its least recently
+   * used slot */
+  atomic_uint_least32_t clock;
+
+  struct prv_limit ways[FRPP_LOG_LIMIT_WAYS];
+};
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/* Bounds of section, defined by the linker.  Weak so images without any
+ * module still link. */
+extern struct frpp_log_module __start_frpp_log_mod[] __attribute__((weak));
+extern struct frpp_log_module __stop_frpp_log_mod[] __attribute__((weak));
+
+static struct frpp_log_queue *_Atomic prv_queue;
+
+static _Atomic prv_tick_fn prv_tick;
+
+#if FRPP_LOG_LIMIT_SLOTS
+static struct prv_limit_set prv_limits[PRV_LIMIT_SETS];
+#endif
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+#if FRPP_LOG_LIMIT_SLOTS
+/**
+ * @brief Hash a format string pointer to its set
+ *
+ * @param key Format string pointer
+ * @return Set index
+ */
+static inline size_t prv_hash(uintptr_t key) {
+  uint32_t hash = (uint32_t)(key ^ (key >> 16)) * 0x9E3779B1U;
+  return (hash >> 16) & (PRV_LIMIT_SETS - 1);
+}
+
+/**
+ * @brief Current tick, 0 without a tick source
+ */
+static inline uint32_t prv_now(void) {
+  prv_tick_fn tick = atomic_load_explicit(&prv_tick, memory_order_relaxed);
+
+  return (tick != NULL) ? tick() : 0;
+}
+
+/**
+ * @brief Report records of a format string suppressed so far
+ *
+ * @param queue Queue instance
+ * @param limit Rate limiting state
+ * @param key Format string of state
+ * @return true if a record was logged
+ */
+static bool prv_limit_report(struct frpp_log_queue *queue,
+                             struct prv_limit *limit, uintptr_t key) {
+  uint_least32_t suppressed =
+      atomic_exchange_explicit(&limit->suppressed, 0, memory_order_relaxed);
+
+  if (suppressed == 0 || key == 0) {
+    return false;
+  }
+
+  frpp_log_queue_printf(queue, FRPP_LOG_FMT("%s (repeated %u times)"),
+                        (const char *)key, (unsigned int)suppressed);
+
+  return true;
+}
+
+/**
+ * @brief Count a record against its format string's limit
+ *
+ * @param queue Queue instance
+ * @param fmt_str Format string
+ * @return true if record should be logged, false if suppressed
+ */
+static bool prv_limit_check(struct frpp_log_queue *queue,
+                            const char *fmt_str) {
+  prv_tick_fn tick = atomic_load_explicit(&prv_tick, memory_order_relaxed);
+
+  // Without a tick source windows never roll over, so suppressing would
+  // silence the format string for good
+  if (tick == NULL) {
+    return true;
+  }
+
+  const uintptr_t key = (uintptr_t)fmt_str;
+  struct prv_limit_set *set = &prv_limits[prv_hash(key)];
+  uint32_t now = tick();
+  uint32_t clock =
+      atomic_fetch_add_explicit(&set->clock, 1, memory_order_relaxed) + 1;
+
+  // Find the format string's slot, or else an unused slot or the least
+  // recently used one to evict
+  struct prv_limit *limit = NULL;
+  struct prv_limit *victim = &set->ways[0];
+  uintptr_t victim_key = 0;
+  uint32_t victim_age = 0;
+
+  for (size_t i = 0; i < FRPP_LOG_LIMIT_WAYS; i++) {
+    struct prv_limit *way = &set->ways[i];
+    uintptr_t cur = atomic_load_explicit(&way->key, memory_order_relaxed);
+
+    if (cur == key) {
+      limit = way;
+      break;
+    }
+
+    uint32_t age =
+        (cur == 0)
+            ? UINT32_MAX
+            : clock - atomic_load_explicit(&way->used, memory_order_relaxed);
+
+    if (i == 0 || age > victim_age) {
+      victim = way;
+      victim_key = cur;
+      victim_age = age;
+    }
+  }
+
+  if (limit == NULL) {
+    // Evict previous owner, reporting what it suppressed.  Losing the race
+    // to another format string just means this record isn't tracked.
+    if (atomic_compare_exchange_strong_explicit(
+            &victim->key, &victim_key, key, memory_order_relaxed,
+            memory_order_relaxed)) {
+      prv_limit_report(queue, victim, victim_key);
+      atomic_store_explicit(&victim->start, now, memory_order_relaxed);
+      atomic_store_explicit(&victim->count, 1, memory_order_relaxed);
+      atomic_store_explicit(&victim->used, clock, memory_order_relaxed);
+    }
+
+    return true;
+  }
+
+  atomic_store_explicit(&limit->used, clock, memory_order_relaxed);
+
+  uint_least32_t start =
+      atomic_load_explicit(&limit->start, memory_order_relaxed);
+
+  // Only the producer that moves the window start reports and resets
+  if ((uint32_t)(now - start) >= FRPP_LOG_LIMIT_WINDOW &&
+      atomic_compare_exchange_strong_explicit(&limit->start, &start, now,
+                                              memory_order_relaxed,
+                                              memory_order_relaxed)) {
+    prv_limit_report(queue, limit, key);
+    atomic_store_explicit(&limit->count, 0, memory_order_relaxed);
+  }
+
+  if (atomic_load_explicit(&limit->count, memory_order_relaxed) >=
+      FRPP_LOG_LIMIT_BURST) {
+    atomic_fetch_add_explicit(&limit->suppressed, 1, memory_order_relaxed);
+    return false;
+  }
+
+  atomic_fetch_add_explicit(&limit->count, 1, memory_order_relaxed);
+
+  return true;
+}
+#endif
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_log_init(struct frpp_log_queue *queue) {
+  if (queue == NULL) {
+    return -EINVAL;
+  }
+
+  atomic_store_explicit(&prv_queue, queue, memory_order_release);
+
+  return 0;
+}
+
+int frpp_log_printf(const char *fmt_str, ...) {
+  va_list args;
+  va_start(args, fmt_str);
+
+  int ret = frpp_log_vprintf(fmt_str, args);
+
+  va_end(args);
+
+  return ret;
+}
+
+int frpp_log_vprintf(const char *fmt_str, va_list args) {
+  struct frpp_log_queue *queue =
+      atomic_load_explicit(&prv_queue, memory_order_acquire);
+
+  if (queue == NULL) {
+    return -ENODEV;
+  }
+
+#if FRPP_LOG_LIMIT_SLOTS
+  if (!prv_limit_check(queue, fmt_str)) {
+    return 0;
+  }
+#endif
+
+  return frpp_log_queue_vprintf(queue, fmt_str, args);
+}
+
+void frpp_log_limit_set_tick(uint32_t (*tick)(void)) {
+  atomic_store_explicit(&prv_tick, tick, memory_order_relaxed);
+}
+
+int frpp_log_limit_flush(void) {
+  struct frpp_log_queue *queue =
+      atomic_load_explicit(&prv_queue, memory_order_acquire);
+
+  if (queue == NULL) {
+    return -ENODEV;
+  }
+
+  int count = 0;
+
+#if FRPP_LOG_LIMIT_SLOTS
+  uint32_t now = prv_now();
+
+  for (size_t i = 0; i < FRPP_LOG_LIMIT_SLOTS; i++) {
+    struct prv_limit *limit =
+        &prv_limits[i / FRPP_LOG_LIMIT_WAYS].ways[i % FRPP_LOG_LIMIT_WAYS];
+    uintptr_t key = atomic_load_explicit(&limit->key, memory_order_relaxed);
+
+    if (prv_limit_report(queue, limit, key)) {
+      count++;
+    }
+
+    atomic_store_explicit(&limit->start, now, memory_order_relaxed);
+    atomic_store_explicit(&limit->count, 0, memory_order_relaxed);
+  }
+#endif
+
+  return count;
+}
+
+int frpp_log_module_set_level(struct frpp_log_module *mod, uint8_t level) {
+  if (mod == NULL || level > FRPP_LOG_LEVEL_DEBUG) {
+    return -EINVAL;
+  }
+
+  __atomic_store_n(&mod->level, level, __ATOMIC_RELAXED);
+
+  return 0;
+}
+
+uint8_t frpp_log_module_get_level(const struct frpp_log_module *mod) {
+  if (mod == NULL) {
+    return FRPP_LOG_LEVEL_OFF;
+  }
+
+  return __atomic_load_n(&mod->level, __ATOMIC_RELAXED);
+}
+
+struct frpp_log_module *frpp_log_module_find(const char *name) {
+  size_t count;
+  struct frpp_log_module *mods = frpp_log_modules(&count);
+
+  if (name == NULL) {
+    return NULL;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (strcmp(mods[i].name, name) == 0) {
+      return &mods[i];
+    }
+  }
+
+  return NULL;
+}
+
+struct frpp_log_module *frpp_log_modules(size_t *count) {
+  if (count != NULL) {
+    *count = (size_t)(__stop_frpp_log_mod - __start_frpp_log_mod);
+  }
+
+  return __start_frpp_log_mod;
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_dict.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/logging/frpp_log_dict.h"
+
+#include <errno.h>
+#include <float.h>
+#include <stdbool.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "frpp/logging/frpp_log_fmt.h"
+#include "frpp/sys/frpp_printf.h"
+#include "frpp/utils/utils.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Offset of format string address or ID within a record frame
+ */
+#define FRPP_LOG_DICT_ADDR_OFFSET FRPP_LOG_DICT_HDR_SIZE
+
+/**
+ * @brief Offset the package is written at before being moved into place, so
+ * frpp_vprintf_package can store arguments aligned
+ */
+#define FRPP_LOG_DICT_PKG_STAGE                                                \
+  ((FRPP_LOG_DICT_ADDR_OFFSET + sizeof(void *) + (sizeof(uint64_t) - 1)) &     \
+   ~(sizeof(uint64_t) - 1))
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+const char frpp_log_dict_anchor[] = "frpp";
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Fill in frame header
+ *
+ * @param frame Frame
+ * @param type Frame type
+ * @param payload_len Length of payload
+ */
+static void prv_frame_hdr(uint8_t *frame, uint8_t type, size_t payload_len) {
+  frame[0] = type;
+  frame[1] = (uint8_t)(payload_len & 0xFFU);
+  frame[2] = (uint8_t)((payload_len >> 8) & 0xFFU);
+}
+
+/**
+ * @brief Determine if target is big endian
+ *
+ * @return true if big endian
+ */
+static bool prv_is_big_endian(void) {
+  const uint16_t probe = 1;
+  uint8_t first;
+
+  memcpy(&first, &probe, sizeof(first));
+
+  return first == 0;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_log_dict_init(struct frpp_log_dict *dict, frpp_log_dict_write_t write,
+                       void *ctx) {
+  if (dict == NULL || write == NULL) {
+    return -EINVAL;
+  }
+
+  dict->write = write;
+  dict->ctx = ctx;
+
+  return 0;
+}
+
+int frpp_log_dict_sync(struct frpp_log_dict *dict) {
+  if (dict == NULL) {
+    return -EINVAL;
+  }
+
+  uint8_t frame[FRPP_LOG_DICT_HDR_SIZE + 14 + sizeof(void *)];
+  uint8_t *payload = &frame[FRPP_LOG_DICT_HDR_SIZE];
+  const char *anchor = frpp_log_dict_anchor;
+
+  memcpy(payload, "FRPD", 4);
+  payload[4] = FRPP_LOG_DICT_VERSION;
+  payload[5] = FRPP_LOG_DICT_SYNC_DENSE;
+  payload[5] |= prv_is_big_endian() ? FRPP_LOG_DICT_SYNC_BIG_ENDIAN : 0;
+  payload[6] = (uint8_t)sizeof(void *);
+  payload[7] = (uint8_t)sizeof(long);
+  payload[8] = (uint8_t)FRPP_STACK_MIN_ALIGN;
+  payload[9] = (uint8_t)FRPP_LOG_FMT_ALIGN;
+  payload[10] = (uint8_t)sizeof(long double);
+  payload[11] = (uint8_t)LDBL_MANT_DIG;
+  payload[12] = (uint8_t)sizeof(wchar_t);
+  payload[13] = (uint8_t)sizeof(wint_t);
+  memcpy(&payload[14], &anchor, sizeof(anchor));
+
+  prv_frame_hdr(frame, FRPP_LOG_DICT_FRAME_SYNC,
+                sizeof(frame) - FRPP_LOG_DICT_HDR_SIZE);
+
+  return dict->write(dict->ctx, frame, sizeof(frame));
+}
+
+int frpp_log_dict_printf(struct frpp_log_dict *dict, const char *fmt_str,
+                         ...) {
+  va_list args;
+  va_start(args, fmt_str);
+  int ret = frpp_log_dict_vprintf(dict, fmt_str, args);
+  va_end(args);
+
+  return ret;
+}
+
+int frpp_log_dict_vprintf(struct frpp_log_dict *dict, const char *fmt_str,
+                          va_list args) {
+  if (dict == NULL || fmt_str == NULL) {
+    return -EINVAL;
+  }
+
+  // uint64_t backing keeps the staged package aligned for the packager.
+  // Dense packages don't need it, but positional format strings still use
+  // the regular layout.
+  uint64_t storage[(FRPP_LOG_DICT_FRAME_MAX + sizeof(uint64_t) - 1) /
+                   sizeof(uint64_t)];
+  uint8_t *frame = (uint8_t *)storage;
+
+  int ret = frpp_vprintf_package(&frame[FRPP_LOG_DICT_PKG_STAGE],
+                                 sizeof(storage) - FRPP_LOG_DICT_PKG_STAGE,
+                                 FRPP_PRINTF_FLAG_DENSE, fmt_str, args);
+  if (ret < 0) {
+    return ret;
+  }
+
+  // Interned format strings are identified by ID instead of address
+  uint16_t fmt_id = frpp_log_fmt_id(fmt_str);
+  uint8_t type = FRPP_LOG_DICT_FRAME_RECORD;
+  size_t id_len = sizeof(fmt_str);
+
+  if (fmt_id != FRPP_LOG_FMT_ID_NONE) {
+    type = FRPP_LOG_DICT_FRAME_RECORD_ID;
+    id_len = sizeof(fmt_id);
+  }
+
+  size_t pkg_len = (size_t)ret;
+  size_t pkg_offset = FRPP_LOG_DICT_ADDR_OFFSET + id_len;
+  if (pkg_offset + pkg_len > FRPP_LOG_DICT_FRAME_MAX) {
+    return -ENOSPC;
+  }
+
+  memmove(&frame[pkg_offset], &frame[FRPP_LOG_DICT_PKG_STAGE], pkg_len);
+
+  if (type == FRPP_LOG_DICT_FRAME_RECORD_ID) {
+    memcpy(&frame[FRPP_LOG_DICT_ADDR_OFFSET], &fmt_id, sizeof(fmt_id));
+  } else {
+    memcpy(&frame[FRPP_LOG_DICT_ADDR_OFFSET], &fmt_str, sizeof(fmt_str));
+  }
+
+  prv_frame_hdr(frame, type, id_len + pkg_len);
+
+  return dict->write(dict->ctx, frame, pkg_offset + pkg_len);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_fmt.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/logging/frpp_log_fmt.h"
+
+#include <stddef.h>
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/* Bounds of section, defined by the linker.  Weak so images that never
+ * intern a string still link. */
+extern const char __start_frpp_log_fmt[] __attribute__((weak));
+extern const char __stop_frpp_log_fmt[] __attribute__((weak));
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+uint16_t frpp_log_fmt_id(const char *fmt_str) {
+  uintptr_t start = (uintptr_t)__start_frpp_log_fmt;
+  uintptr_t stop = (uintptr_t)__stop_frpp_log_fmt;
+  uintptr_t addr = (uintptr_t)fmt_str;
+
+  if (addr < start || addr >= stop) {
+    return FRPP_LOG_FMT_ID_NONE;
+  }
+
+  uintptr_t off = addr - start;
+  if ((off % FRPP_LOG_FMT_ALIGN) != 0 ||
+      (off / FRPP_LOG_FMT_ALIGN) >= FRPP_LOG_FMT_ID_NONE) {
+    return FRPP_LOG_FMT_ID_NONE;
+  }
+
+  return (uint16_t)(off / FRPP_LOG_FMT_ALIGN);
+}
+
+const char *frpp_log_fmt_str(uint16_t id) {
+  size_t off = (size_t)id * FRPP_LOG_FMT_ALIGN;
+
+  if (id == FRPP_LOG_FMT_ID_NONE ||
+      off >= (size_t)(__stop_frpp_log_fmt - __start_frpp_log_fmt)) {
+    return NULL;
+  }
+
+  return __start_frpp_log_fmt + off;
+}
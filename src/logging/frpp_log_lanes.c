@@ -0,0 +1,617 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_lanes.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/logging/frpp_log_lanes.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "frpp/sys/frpp_timestamp.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Record is padding to the end of the ring and should be skipped
+ */
+#define PRV_PAD (1UL << 31)
+
+/**
+ * @brief Record's package was created with FRPP_PRINTF_FLAG_CAPTURE_STR
+ */
+#define PRV_CAPTURE (1UL << 30)
+
+/**
+ * @brief Record's package was created with FRPP_PRINTF_FLAG_DENSE
+ */
+#define PRV_DENSE (1UL << 29)
+
+#define PRV_SPAN_MASK (PRV_DENSE - 1)
+
+#define PRV_ALIGN_UP(val_)                                                     \
+  (((val_) + (FRPP_LOG_LANES_ALIGN - 1)) & ~(size_t)(FRPP_LOG_LANES_ALIGN - 1))
+
+#define PRV_HDR_SIZE PRV_ALIGN_UP(sizeof(struct prv_lane_hdr))
+
+/**
+ * @brief Space for the format string pointer of records whose format string
+ * isn't interned
+ */
+#define PRV_FMT_PTR_SIZE PRV_ALIGN_UP(sizeof(const char *))
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Header preceding every record in a lane.  Package follows at
+ * PRV_HDR_SIZE.  Records whose format string isn't interned store its
+ * pointer after the package.  Last is the record's timestamp, as a delta
+ * from the previous record's in the lane.
+ *
+ * Records are published by the producer's release store of head, so the
+ * header needs no atomics.  Padding only writes word, which fits in the
+ * smallest gap left at the end of the ring.
+ */
+struct prv_lane_hdr {
+  /* Span of record in bytes (including header) and flags */
+  uint32_t word;
+
+  /* Interned format string ID, FRPP_LOG_FMT_ID_NONE if not interned */
+  uint16_t fmt_id;
+
+  /* Length of package */
+  uint16_t pkg_len;
+};
+
+/**
+ * @brief Lane in merge heap, keyed by timestamp of its oldest record
+ */
+struct prv_heap_entry {
+  uint64_t ts;
+  uint16_t lane;
+};
+
+/**
+ * @brief Min heap of lanes with records
+ */
+struct prv_heap {
+  struct prv_heap_entry entries[FRPP_LOG_LANES_MAX];
+  size_t count;
+};
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Get header at monotonic position
+ *
+ * @param lane Lane instance
+ * @param pos Monotonic position
+ * @return Pointer to header
+ */
+static inline struct prv_lane_hdr *prv_hdr(struct frpp_log_lane *lane,
+                                           size_t pos) {
+  return (struct prv_lane_hdr *)(lane->buf + (pos & (lane->size - 1)));
+}
+
+/**
+ * @brief Get contiguous free space at head.  The consumer's tail is only
+ * read when the last one seen doesn't leave enough.
+ *
+ * @param lane Lane instance
+ * @param head Monotonic position of head
+ * @param contig Bytes before the end of the ring
+ * @return Free bytes, at most contig
+ */
+static size_t prv_room(struct frpp_log_lane *lane, size_t head,
+                       size_t contig) {
+  size_t avail = lane->size - (head - lane->tail_cache);
+
+  if (avail < contig) {
+    lane->tail_cache = atomic_load_explicit(&lane->tail, memory_order_acquire);
+    avail = lane->size - (head - lane->tail_cache);
+  }
+
+  return (avail < contig) ? avail : contig;
+}
+
+/**
+ * @brief Package record straight into free space at head and publish it
+ *
+ * @param lane Lane instance
+ * @param head Monotonic position of head
+ * @param room Contiguous free bytes at head
+ * @param ts Timestamp
+ * @param flags Package flags
+ * @param fmt_str Format string
+ * @param args va_list instance
+ * @retval 0 Success
+ * @retval -ENOSPC Record doesn't fit in room
+ */
+static int prv_write(struct frpp_log_lane *lane, size_t head, size_t room,
+                     uint64_t ts, uint32_t flags, const char *fmt_str,
+                     va_list args) {
+  struct prv_lane_hdr *hdr = prv_hdr(lane, head);
+  uint8_t delta[FRPP_TIMESTAMP_DELTA_MAX];
+  size_t cap = room - PRV_HDR_SIZE;
+
+  if (cap > UINT16_MAX) {
+    cap = UINT16_MAX;
+  }
+
+  // Nothing is visible to the consumer until head moves, so a package that
+  // runs out of room is simply abandoned
+  int pkg_len = frpp_vprintf_package((uint8_t *)hdr + PRV_HDR_SIZE, cap,
+                                     flags, fmt_str, args);
+  if (pkg_len < 0) {
+    return pkg_len;
+  }
+
+  uint16_t fmt_id = frpp_log_fmt_id(fmt_str);
+  size_t end = PRV_HDR_SIZE + (size_t)pkg_len;
+  size_t delta_len = frpp_timestamp_delta_encode(ts, lane->last_ts, delta);
+
+  if (fmt_id == FRPP_LOG_FMT_ID_NONE) {
+    end = PRV_ALIGN_UP(end) + PRV_FMT_PTR_SIZE;
+  }
+
+  size_t span = PRV_ALIGN_UP(end + delta_len);
+
+  if (span > room) {
+    return -ENOSPC;
+  }
+
+  if (fmt_id == FRPP_LOG_FMT_ID_NONE) {
+    memcpy((uint8_t *)hdr + end - PRV_FMT_PTR_SIZE, &fmt_str,
+           sizeof(fmt_str));
+  }
+
+  memcpy((uint8_t *)hdr + end, delta, delta_len);
+  lane->last_ts = ts;
+
+  uint32_t word = (uint32_t)span;
+
+  if (flags & FRPP_PRINTF_FLAG_CAPTURE_STR) {
+    word |= PRV_CAPTURE;
+  }
+
+  if (flags & FRPP_PRINTF_FLAG_DENSE) {
+    word |= PRV_DENSE;
+  }
+
+  hdr->word = word;
+  hdr->fmt_id = fmt_id;
+  hdr->pkg_len = (uint16_t)pkg_len;
+
+  atomic_store_explicit(&lane->head, head + span, memory_order_release);
+
+  return 0;
+}
+
+/**
+ * @brief Get oldest record of lane, skipping padding, and rebuild its
+ * timestamp.  Consumer only.
+ *
+ * @param lane Lane instance
+ * @param ts Timestamp of record output
+ * @return Header of record, or NULL if lane is empty
+ */
+static struct prv_lane_hdr *prv_front(struct frpp_log_lane *lane,
+                                      uint64_t *ts) {
+  size_t tail = atomic_load_explicit(&lane->tail, memory_order_relaxed);
+
+  for (;;) {
+    if (tail == lane->head_cache) {
+      lane->head_cache =
+          atomic_load_explicit(&lane->head, memory_order_acquire);
+
+      if (tail == lane->head_cache) {
+        return NULL;
+      }
+    }
+
+    struct prv_lane_hdr *hdr = prv_hdr(lane, tail);
+
+    if ((hdr->word & PRV_PAD) == 0) {
+      size_t off = PRV_HDR_SIZE + hdr->pkg_len;
+
+      if (hdr->fmt_id == FRPP_LOG_FMT_ID_NONE) {
+        off = PRV_ALIGN_UP(off) + PRV_FMT_PTR_SIZE;
+      }
+
+      // Written by the producer, so it always decodes
+      frpp_timestamp_delta_decode((const uint8_t *)hdr + off,
+                                  (hdr->word & PRV_SPAN_MASK) - off, lane->ts,
+                                  ts);
+      return hdr;
+    }
+
+    tail += hdr->word & PRV_SPAN_MASK;
+    atomic_store_explicit(&lane->tail, tail, memory_order_release);
+  }
+}
+
+/**
+ * @brief Hand oldest record's space back to the producer.  Consumer only.
+ *
+ * @param lane Lane instance
+ * @param hdr Header of oldest record
+ * @param ts Timestamp of oldest record
+ */
+static void prv_pop(struct frpp_log_lane *lane,
+                    const struct prv_lane_hdr *hdr, uint64_t ts) {
+  size_t tail = atomic_load_explicit(&lane->tail, memory_order_relaxed);
+
+  lane->ts = ts;
+
+  atomic_store_explicit(&lane->tail, tail + (hdr->word & PRV_SPAN_MASK),
+                        memory_order_release);
+}
+
+/**
+ * @brief Describe a record for frpp_snprintf
+ *
+ * @param hdr Header of record
+ * @param record Record output
+ */
+static void prv_record(const struct prv_lane_hdr *hdr,
+                       struct frpp_printf_record *record) {
+  record->arg_buf = (const uint8_t *)hdr + PRV_HDR_SIZE;
+  record->flags = 0;
+
+  if (hdr->word & PRV_CAPTURE) {
+    record->flags |= FRPP_PRINTF_FLAG_CAPTURE_STR;
+  }
+
+  if (hdr->word & PRV_DENSE) {
+    record->flags |= FRPP_PRINTF_FLAG_DENSE;
+  }
+
+  if (hdr->fmt_id == FRPP_LOG_FMT_ID_NONE) {
+    memcpy(&record->fmt,
+           (const uint8_t *)hdr + PRV_ALIGN_UP(PRV_HDR_SIZE + hdr->pkg_len),
+           sizeof(record->fmt));
+  } else {
+    record->fmt = frpp_log_fmt_str(hdr->fmt_id);
+  }
+}
+
+/**
+ * @brief Check if heap entry a orders before b.  Ties go to the lower lane
+ * so merging is deterministic.
+ */
+static inline bool prv_heap_less(const struct prv_heap_entry *a,
+                                 const struct prv_heap_entry *b) {
+  return (a->ts != b->ts) ? (a->ts < b->ts) : (a->lane < b->lane);
+}
+
+/**
+ * @brief Restore heap order below an entry whose key grew
+ *
+ * @param heap Heap
+ * @param idx Index of entry
+ */
+static void prv_heap_down(struct prv_heap *heap, size_t idx) {
+  struct prv_heap_entry entry = heap->entries[idx];
+
+  for (;;) {
+    size_t child = 2 * idx + 1;
+    if (child >= heap->count) {
+      break;
+    }
+
+    if (child + 1 < heap->count &&
+        prv_heap_less(&heap->entries[child + 1], &heap->entries[child])) {
+      child++;
+    }
+
+    if (!prv_heap_less(&heap->entries[child], &entry)) {
+      break;
+    }
+
+    heap->entries[idx] = heap->entries[child];
+    idx = child;
+  }
+
+  heap->entries[idx] = entry;
+}
+
+/**
+ * @brief Add lane to heap
+ *
+ * @param heap Heap
+ * @param ts Timestamp of lane's oldest record
+ * @param lane Index of lane
+ */
+static void prv_heap_push(struct prv_heap *heap, uint64_t ts, size_t lane) {
+  struct prv_heap_entry entry = {.ts = ts, .lane = (uint16_t)lane};
+  size_t idx = heap->count++;
+
+  while (idx > 0) {
+    size_t parent = (idx - 1) / 2;
+
+    if (!prv_heap_less(&entry, &heap->entries[parent])) {
+      break;
+    }
+
+    heap->entries[idx] = heap->entries[parent];
+    idx = parent;
+  }
+
+  heap->entries[idx] = entry;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_log_lane_init(struct frpp_log_lane *lane, void *buf, size_t size) {
+  if (lane == NULL || buf == NULL) {
+    return -EINVAL;
+  }
+
+  if (size < PRV_HDR_SIZE + PRV_FMT_PTR_SIZE || (size & (size - 1)) != 0 ||
+      size > PRV_SPAN_MASK) {
+    return -EINVAL;
+  }
+
+  if (((uintptr_t)buf & (FRPP_LOG_LANES_ALIGN - 1)) != 0) {
+    return -EINVAL;
+  }
+
+  atomic_init(&lane->head, 0);
+  lane->tail_cache = 0;
+  lane->last_ts = 0;
+  atomic_init(&lane->dropped, 0);
+
+  atomic_init(&lane->tail, 0);
+  lane->head_cache = 0;
+  lane->ts = 0;
+
+  lane->buf = (uint8_t *)buf;
+  lane->size = size;
+  lane->clock = NULL;
+  atomic_init(&lane->claimed, false);
+
+  return 0;
+}
+
+int frpp_log_lanes_init(struct frpp_log_lanes *lanes,
+                        struct frpp_log_lane *lane, size_t count,
+                        frpp_timestamp_source_t clock) {
+  if (lanes == NULL || lane == NULL || clock == NULL || count == 0 ||
+      count > FRPP_LOG_LANES_MAX) {
+    return -EINVAL;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    if (lane[i].buf == NULL) {
+      return -EINVAL;
+    }
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    lane[i].clock = clock;
+  }
+
+  lanes->lanes = lane;
+  lanes->count = count;
+
+  return 0;
+}
+
+struct frpp_log_lane *frpp_log_lanes_claim(struct frpp_log_lanes *lanes) {
+  if (lanes == NULL) {
+    return NULL;
+  }
+
+  for (size_t i = 0; i < lanes->count; i++) {
+    bool expected = false;
+
+    if (atomic_compare_exchange_strong(&lanes->lanes[i].claimed, &expected,
+                                       true)) {
+      return &lanes->lanes[i];
+    }
+  }
+
+  return NULL;
+}
+
+void frpp_log_lane_release(struct frpp_log_lane *lane) {
+  if (lane == NULL) {
+    return;
+  }
+
+  atomic_store(&lane->claimed, false);
+}
+
+int frpp_log_lane_printf(struct frpp_log_lane *lane, const char *fmt_str,
+                         ...) {
+  va_list args;
+
+  va_start(args, fmt_str);
+  int ret = frpp_log_lane_vprintf(lane, fmt_str, args);
+  va_end(args);
+
+  return ret;
+}
+
+int frpp_log_lane_vprintf(struct frpp_log_lane *lane, const char *fmt_str,
+                          va_list args) {
+  return frpp_log_lane_vprintf_ex(lane, FRPP_LOG_LANES_PKG_FLAGS, fmt_str,
+                                  args);
+}
+
+int frpp_log_lane_vprintf_ex(struct frpp_log_lane *lane, uint32_t flags,
+                             const char *fmt_str, va_list args) {
+  if (lane == NULL || fmt_str == NULL || lane->clock == NULL) {
+    return -EINVAL;
+  }
+
+  // Stamped when logged, not when space was found
+  uint64_t ts = lane->clock();
+  size_t head = atomic_load_explicit(&lane->head, memory_order_relaxed);
+
+  for (int pass = 0; pass < 2; pass++) {
+    size_t off = head & (lane->size - 1);
+    size_t contig = lane->size - off;
+    size_t room = prv_room(lane, head, contig);
+
+    if (room > PRV_HDR_SIZE) {
+      va_list copy;
+
+      va_copy(copy, args);
+      int ret = prv_write(lane, head, room, ts, flags, fmt_str, copy);
+      va_end(copy);
+
+      if (ret != -ENOSPC) {
+        return ret;
+      }
+    }
+
+    // Record doesn't fit before the end of the ring.  Pad to the end, if the
+    // rest of the ring is free, and try again from the start.
+    if (off == 0 || room < contig) {
+      break;
+    }
+
+    prv_hdr(lane, head)->word = (uint32_t)contig | PRV_PAD;
+    head += contig;
+    atomic_store_explicit(&lane->head, head, memory_order_release);
+  }
+
+  atomic_fetch_add_explicit(&lane->dropped, 1, memory_order_relaxed);
+
+  return -ENOSPC;
+}
+
+size_t frpp_log_lane_dropped(struct frpp_log_lane *lane) {
+  if (lane == NULL) {
+    return 0;
+  }
+
+  return atomic_load_explicit(&lane->dropped, memory_order_relaxed);
+}
+
+int frpp_log_lanes_render(struct frpp_log_lanes *lanes, void *out_buf,
+                          size_t out_buf_size_bytes, uint64_t *timestamp) {
+  if (lanes == NULL || out_buf == NULL) {
+    return -EINVAL;
+  }
+
+  struct frpp_log_lane *oldest = NULL;
+  struct prv_lane_hdr *oldest_hdr = NULL;
+  uint64_t oldest_ts = 0;
+
+  for (size_t i = 0; i < lanes->count; i++) {
+    uint64_t ts;
+    struct prv_lane_hdr *hdr = prv_front(&lanes->lanes[i], &ts);
+
+    if (hdr != NULL && (oldest_hdr == NULL || ts < oldest_ts)) {
+      oldest = &lanes->lanes[i];
+      oldest_hdr = hdr;
+      oldest_ts = ts;
+    }
+  }
+
+  if (oldest == NULL) {
+    return -EAGAIN;
+  }
+
+  struct frpp_printf_record record;
+  prv_record(oldest_hdr, &record);
+
+  if (timestamp != NULL) {
+    *timestamp = oldest_ts;
+  }
+
+  int ret = frpp_snprintf_ex(record.fmt, record.flags, record.arg_buf,
+                             out_buf, out_buf_size_bytes);
+  prv_pop(oldest, oldest_hdr, oldest_ts);
+
+  return ret;
+}
+
+int frpp_log_lanes_render_batch(struct frpp_log_lanes *lanes, void *out_buf,
+                                size_t out_buf_size_bytes, size_t *len) {
+  if (lanes == NULL || out_buf == NULL || out_buf_size_bytes == 0 ||
+      len == NULL) {
+    return -EINVAL;
+  }
+
+  char *buf = (char *)out_buf;
+  struct prv_heap heap = {.count = 0};
+  size_t pos = 0;
+  int count = 0;
+
+  buf[0] = '\0';
+
+  for (size_t i = 0; i < lanes->count; i++) {
+    uint64_t ts;
+
+    if (prv_front(&lanes->lanes[i], &ts) != NULL) {
+      prv_heap_push(&heap, ts, i);
+    }
+  }
+
+  while (heap.count > 0) {
+    struct frpp_log_lane *lane = &lanes->lanes[heap.entries[0].lane];
+    uint64_t ts;
+    struct prv_lane_hdr *hdr = prv_front(lane, &ts);
+    struct frpp_printf_record record;
+    size_t offsets[2];
+
+    prv_record(hdr, &record);
+
+    int ret = frpp_snprintf_batch(&record, 1, &buf[pos],
+                                  out_buf_size_bytes - pos, offsets);
+
+    if (ret == 0 && pos == 0) {
+      // Doesn't fit even on its own.  Truncate rather than stall the lane.
+      frpp_snprintf_ex(record.fmt, record.flags, record.arg_buf, buf,
+                       out_buf_size_bytes);
+      offsets[1] = out_buf_size_bytes - 1;
+      ret = 1;
+    }
+
+    if (ret < 0 && count == 0) {
+      // Drop a record that can't be rendered, so it doesn't stall its lane,
+      // and report why
+      prv_pop(lane, hdr, ts);
+      *len = 0;
+      return ret;
+    }
+
+    // A bad record after others is left to report on the next call
+    if (ret <= 0) {
+      break;
+    }
+
+    pos += offsets[1];
+    prv_pop(lane, hdr, ts);
+    count++;
+
+    // Lane's next record replaces it in the heap, or it drops out
+    if (prv_front(lane, &ts) != NULL) {
+      heap.entries[0].ts = ts;
+    } else {
+      heap.entries[0] = heap.entries[--heap.count];
+    }
+
+    prv_heap_down(&heap, 0);
+  }
+
+  *len = pos;
+
+  return (count > 0) ? count : -EAGAIN;
+}
@@ -0,0 +1,663 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_mmap.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#if defined(__linux__)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "frpp/logging/frpp_log_mmap.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Marks a segment ("FRSG")
+ */
+#define PRV_SEG_MAGIC (0x47535246UL)
+
+/**
+ * @brief Marks an index trailer ("FRIX")
+ */
+#define PRV_TRAILER_MAGIC (0x58495246UL)
+
+/**
+ * @brief Version of segment layout
+ */
+#define PRV_SEG_VERSION (1U)
+
+/**
+ * @brief Records of segment carry timestamp deltas
+ */
+#define PRV_SEG_TIMESTAMPS (1U << 0)
+
+/**
+ * @brief Smallest segment
+ */
+#define PRV_SEG_MIN (4096U)
+
+#define PRV_ALIGN_UP(val_)                                                     \
+  (((val_) + (FRPP_LOG_MMAP_ALIGN - 1)) & ~(size_t)(FRPP_LOG_MMAP_ALIGN - 1))
+
+#define PRV_SEG_HDR_SIZE PRV_ALIGN_UP(sizeof(struct prv_seg_hdr))
+
+#define PRV_HDR_SIZE PRV_ALIGN_UP(sizeof(struct prv_record_hdr))
+
+#define PRV_ENTRY_SIZE sizeof(struct prv_index_entry)
+
+#define PRV_TRAILER_SIZE sizeof(struct prv_trailer)
+
+/**
+ * @brief Largest span of a record
+ */
+#define PRV_SPAN_MAX (UINT16_MAX & ~(size_t)(FRPP_LOG_MMAP_ALIGN - 1))
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Header at the start of a segment.  Records follow at
+ * PRV_SEG_HDR_SIZE.
+ */
+struct prv_seg_hdr {
+  uint32_t magic;
+  uint16_t version;
+
+  /* PRV_SEG_* */
+  uint16_t flags;
+
+  /* Number of segment, and its size */
+  uint32_t seg;
+  uint32_t size;
+
+  /* Number of first record, counted across segments */
+  uint64_t first;
+
+  /* Timestamp the first record's delta is from */
+  uint64_t base_ts;
+};
+
+/**
+ * @brief Header preceding every record.  Package follows at PRV_HDR_SIZE,
+ * then the timestamp delta.  span is written last with release order, and
+ * read with acquire, so a record with span 0 was never finished and one
+ * with a nonzero span is complete even while its segment is being written.
+ */
+struct prv_record_hdr {
+  /* Span of record in bytes (including header) */
+  uint16_t span;
+
+  /* Interned format string ID */
+  uint16_t fmt_id;
+
+  /* Length of package */
+  uint16_t pkg_len;
+  uint16_t reserved;
+};
+
+/**
+ * @brief Index entry.  Entries grow down from the trailer.
+ */
+struct prv_index_entry {
+  /* Number of record, counted across segments */
+  uint64_t record;
+
+  /* Timestamp the record's delta is from */
+  uint64_t base_ts;
+
+  /* Offset of record */
+  uint32_t off;
+  uint32_t reserved;
+};
+
+/**
+ * @brief Trailer at the very end of a finished segment
+ */
+struct prv_trailer {
+  uint32_t magic;
+
+  /* Number of index entries and of records */
+  uint32_t entries;
+  uint32_t records;
+
+  /* End of records */
+  uint32_t end;
+
+  /* Timestamp of last record */
+  uint64_t last_ts;
+};
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Get index entry of a segment
+ *
+ * @param base Mapping of segment
+ * @param size Size of segment
+ * @param idx Index of entry, 0 being the one nearest the trailer
+ * @return Pointer to entry
+ */
+static inline struct prv_index_entry *prv_entry(const uint8_t *base,
+                                                size_t size, size_t idx) {
+  return (struct prv_index_entry *)(base + size - PRV_TRAILER_SIZE -
+                                    (idx + 1) * PRV_ENTRY_SIZE);
+}
+
+/**
+ * @brief Write trailer of current segment and unmap it
+ *
+ * @param sink Sink instance
+ */
+static void prv_finish(struct frpp_log_mmap *sink) {
+  struct prv_trailer *trailer =
+      (struct prv_trailer *)(sink->base + sink->seg_size - PRV_TRAILER_SIZE);
+
+  trailer->entries = (uint32_t)((sink->seg_size - PRV_TRAILER_SIZE -
+                                 sink->index) /
+                                PRV_ENTRY_SIZE);
+  trailer->records = sink->records;
+  trailer->end = (uint32_t)sink->head;
+  trailer->last_ts = sink->last_ts;
+  trailer->magic = PRV_TRAILER_MAGIC;
+
+  munmap(sink->base, sink->seg_size);
+  sink->base = NULL;
+}
+
+/**
+ * @brief Create and map a segment
+ *
+ * @param sink Sink instance
+ * @param seg Number of segment
+ * @retval 0 Success
+ * @retval Negative errno of open, ftruncate or mmap
+ */
+static int prv_start(struct frpp_log_mmap *sink, uint32_t seg) {
+  char path[FRPP_LOG_MMAP_PATH_MAX];
+  int ret = frpp_log_mmap_path(sink, seg, path, sizeof(path));
+
+  if (ret != 0) {
+    return ret;
+  }
+
+  // Truncating leaves the file zeroed, so unfinished records read as span 0
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+  if (fd < 0) {
+    return -errno;
+  }
+
+  if (ftruncate(fd, (off_t)sink->seg_size) != 0) {
+    ret = -errno;
+    close(fd);
+    return ret;
+  }
+
+  void *base = mmap(NULL, sink->seg_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0);
+  ret = (base == MAP_FAILED) ? -errno : 0;
+
+  close(fd);
+
+  if (ret != 0) {
+    return ret;
+  }
+
+  struct prv_seg_hdr *hdr = (struct prv_seg_hdr *)base;
+
+  hdr->magic = PRV_SEG_MAGIC;
+  hdr->version = PRV_SEG_VERSION;
+  hdr->flags = (sink->clock != NULL) ? PRV_SEG_TIMESTAMPS : 0;
+  hdr->seg = seg;
+  hdr->size = (uint32_t)sink->seg_size;
+  hdr->first = sink->first;
+  hdr->base_ts = sink->last_ts;
+
+  sink->base = (uint8_t *)base;
+  sink->seg = seg;
+  sink->head = PRV_SEG_HDR_SIZE;
+  sink->index = sink->seg_size - PRV_TRAILER_SIZE;
+  sink->records = 0;
+
+  if (sink->max_segs != 0 && seg >= sink->max_segs &&
+      frpp_log_mmap_path(sink, seg - sink->max_segs, path, sizeof(path)) ==
+          0) {
+    unlink(path);
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Package record straight into current segment
+ *
+ * @param sink Sink instance
+ * @param fmt_id Interned format string ID
+ * @param ts Timestamp
+ * @param fmt_str Format string
+ * @param args va_list instance
+ * @retval 0 Success
+ * @retval -ENOSPC Record doesn't fit in segment
+ */
+static int prv_write(struct frpp_log_mmap *sink, uint16_t fmt_id, uint64_t ts,
+                     const char *fmt_str, va_list args) {
+  bool indexed = (sink->records % FRPP_LOG_MMAP_INDEX_STRIDE) == 0;
+  size_t limit = sink->index - (indexed ? PRV_ENTRY_SIZE : 0);
+  size_t trail = PRV_HDR_SIZE +
+                 ((sink->clock != NULL) ? FRPP_TIMESTAMP_DELTA_MAX : 0);
+
+  if (limit < sink->head + trail + 1) {
+    return -ENOSPC;
+  }
+
+  size_t cap = limit - sink->head;
+
+  if (cap > PRV_SPAN_MAX) {
+    cap = PRV_SPAN_MAX;
+  }
+
+  uint8_t *rec = sink->base + sink->head;
+  int pkg_len = frpp_vprintf_package(rec + PRV_HDR_SIZE, cap - trail,
+                                     FRPP_PRINTF_FLAG_CAPTURE_STR, fmt_str,
+                                     args);
+  if (pkg_len < 0) {
+    return pkg_len;
+  }
+
+  size_t end = PRV_HDR_SIZE + (size_t)pkg_len;
+
+  if (sink->clock != NULL) {
+    end += frpp_timestamp_delta_encode(ts, sink->last_ts, rec + end);
+  }
+
+  if (indexed) {
+    sink->index -= PRV_ENTRY_SIZE;
+
+    struct prv_index_entry *entry =
+        (struct prv_index_entry *)(sink->base + sink->index);
+
+    entry->record = sink->first + sink->records;
+    entry->base_ts = sink->last_ts;
+    entry->off = (uint32_t)sink->head;
+  }
+
+  struct prv_record_hdr *hdr = (struct prv_record_hdr *)rec;
+  size_t span = PRV_ALIGN_UP(end);
+
+  hdr->fmt_id = fmt_id;
+  hdr->pkg_len = (uint16_t)pkg_len;
+
+  // Readers of a live segment take a nonzero span as the record being
+  // complete, so it's published after everything else
+  __atomic_store_n(&hdr->span, (uint16_t)span, __ATOMIC_RELEASE);
+
+  sink->head += span;
+  sink->records++;
+  sink->last_ts = ts;
+
+  return 0;
+}
+
+/**
+ * @brief Get segment header of reader
+ *
+ * @param reader Reader instance
+ * @return Pointer to segment header
+ */
+static inline const struct prv_seg_hdr *
+prv_seg_hdr(const struct frpp_log_mmap_reader *reader) {
+  return (const struct prv_seg_hdr *)reader->base;
+}
+
+/**
+ * @brief Get trailer of a finished segment
+ *
+ * @param reader Reader instance
+ * @return Pointer to trailer, or NULL if segment wasn't finished
+ */
+static const struct prv_trailer *
+prv_trailer(const struct frpp_log_mmap_reader *reader) {
+  const struct prv_trailer *trailer =
+      (const struct prv_trailer *)(reader->base + reader->size -
+                                   PRV_TRAILER_SIZE);
+  size_t index_size = (size_t)trailer->entries * PRV_ENTRY_SIZE;
+
+  if (trailer->magic != PRV_TRAILER_MAGIC ||
+      index_size > reader->size - PRV_TRAILER_SIZE - PRV_SEG_HDR_SIZE ||
+      trailer->end > reader->size - PRV_TRAILER_SIZE - index_size) {
+    return NULL;
+  }
+
+  return trailer;
+}
+
+/**
+ * @brief Get next record and its timestamp, and move past it
+ *
+ * @param reader Reader instance
+ * @param ts Timestamp of record output
+ * @param ret 0, -EAGAIN if no more records, or -EBADMSG if corrupt
+ * @return Header of record, or NULL
+ */
+static const struct prv_record_hdr *
+prv_next(struct frpp_log_mmap_reader *reader, uint64_t *ts, int *ret) {
+  if (reader->end - reader->off < PRV_HDR_SIZE) {
+    *ret = -EAGAIN;
+    return NULL;
+  }
+
+  const struct prv_record_hdr *hdr =
+      (const struct prv_record_hdr *)(reader->base + reader->off);
+  const size_t span = __atomic_load_n(&hdr->span, __ATOMIC_ACQUIRE);
+
+  if (span == 0) {
+    *ret = -EAGAIN;
+    return NULL;
+  }
+
+  size_t end = PRV_HDR_SIZE + hdr->pkg_len;
+
+  if (span > reader->end - reader->off || end > span ||
+      frpp_log_fmt_str(hdr->fmt_id) == NULL) {
+    *ret = -EBADMSG;
+    return NULL;
+  }
+
+  *ts = 0;
+
+  if (prv_seg_hdr(reader)->flags & PRV_SEG_TIMESTAMPS) {
+    if (frpp_timestamp_delta_decode((const uint8_t *)hdr + end,
+                                    span - end, reader->ts, ts) < 0) {
+      *ret = -EBADMSG;
+      return NULL;
+    }
+
+    reader->ts = *ts;
+  }
+
+  reader->off += span;
+  reader->record++;
+  *ret = 0;
+
+  return hdr;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_log_mmap_open(struct frpp_log_mmap *sink, const char *prefix,
+                       size_t seg_size, uint32_t max_segs,
+                       frpp_timestamp_source_t clock) {
+  if (sink == NULL || prefix == NULL || seg_size < PRV_SEG_MIN ||
+      seg_size > UINT32_MAX || (seg_size % FRPP_LOG_MMAP_ALIGN) != 0) {
+    return -EINVAL;
+  }
+
+  memset(sink, 0, sizeof(*sink));
+
+  if (strlen(prefix) >= sizeof(sink->prefix)) {
+    return -ENAMETOOLONG;
+  }
+
+  strcpy(sink->prefix, prefix);
+  sink->seg_size = seg_size;
+  sink->max_segs = max_segs;
+  sink->clock = clock;
+
+  return prv_start(sink, 0);
+}
+
+void frpp_log_mmap_close(struct frpp_log_mmap *sink) {
+  if (sink == NULL || sink->base == NULL) {
+    return;
+  }
+
+  prv_finish(sink);
+}
+
+int frpp_log_mmap_printf(struct frpp_log_mmap *sink, const char *fmt_str,
+                         ...) {
+  va_list args;
+
+  va_start(args, fmt_str);
+  int ret = frpp_log_mmap_vprintf(sink, fmt_str, args);
+  va_end(args);
+
+  return ret;
+}
+
+int frpp_log_mmap_vprintf(struct frpp_log_mmap *sink, const char *fmt_str,
+                          va_list args) {
+  if (sink == NULL || fmt_str == NULL || sink->base == NULL) {
+    return -EINVAL;
+  }
+
+  uint16_t fmt_id = frpp_log_fmt_id(fmt_str);
+
+  if (fmt_id == FRPP_LOG_FMT_ID_NONE) {
+    return -EINVAL;
+  }
+
+  uint64_t ts = (sink->clock != NULL) ? sink->clock() : 0;
+  int ret;
+
+  for (;;) {
+    va_list copy;
+
+    va_copy(copy, args);
+    ret = prv_write(sink, fmt_id, ts, fmt_str, copy);
+    va_end(copy);
+
+    // Roll over once, unless the record doesn't fit an empty segment
+    if (ret != -ENOSPC || sink->records == 0) {
+      break;
+    }
+
+    sink->first += sink->records;
+    uint32_t next = sink->seg + 1;
+
+    prv_finish(sink);
+    ret = prv_start(sink, next);
+
+    if (ret != 0) {
+      break;
+    }
+  }
+
+  if (ret != 0) {
+    sink->dropped++;
+  }
+
+  return ret;
+}
+
+int frpp_log_mmap_sync(struct frpp_log_mmap *sink) {
+  if (sink == NULL || sink->base == NULL) {
+    return -EINVAL;
+  }
+
+  return (msync(sink->base, sink->seg_size, MS_ASYNC) == 0) ? 0 : -errno;
+}
+
+int frpp_log_mmap_path(const struct frpp_log_mmap *sink, uint32_t seg,
+                       char *path, size_t size) {
+  if (sink == NULL || path == NULL) {
+    return -EINVAL;
+  }
+
+  int len = snprintf(path, size, "%s.%06u", sink->prefix, (unsigned int)seg);
+
+  return (len < 0 || (size_t)len >= size) ? -ENAMETOOLONG : 0;
+}
+
+int frpp_log_mmap_reader_open(struct frpp_log_mmap_reader *reader,
+                              const char *path) {
+  if (reader == NULL || path == NULL) {
+    return -EINVAL;
+  }
+
+  memset(reader, 0, sizeof(*reader));
+
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0) {
+    return -errno;
+  }
+
+  struct stat st;
+  int ret = (fstat(fd, &st) == 0) ? 0 : -errno;
+
+  if (ret == 0 && (size_t)st.st_size < PRV_SEG_MIN) {
+    ret = -EBADMSG;
+  }
+
+  void *base = MAP_FAILED;
+
+  if (ret == 0) {
+    // Shared, so a segment still being written reads up to date.  Its
+    // records show up as their spans are published (see prv_next).
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ret = (base == MAP_FAILED) ? -errno : 0;
+  }
+
+  close(fd);
+
+  if (ret != 0) {
+    return ret;
+  }
+
+  reader->base = (const uint8_t *)base;
+  reader->size = (size_t)st.st_size;
+
+  const struct prv_seg_hdr *hdr = prv_seg_hdr(reader);
+
+  if (hdr->magic != PRV_SEG_MAGIC || hdr->version != PRV_SEG_VERSION ||
+      hdr->size != reader->size) {
+    frpp_log_mmap_reader_close(reader);
+    return -EBADMSG;
+  }
+
+  frpp_log_mmap_reader_seek(reader, hdr->first);
+
+  return 0;
+}
+
+void frpp_log_mmap_reader_close(struct frpp_log_mmap_reader *reader) {
+  if (reader == NULL || reader->base == NULL) {
+    return;
+  }
+
+  munmap((void *)reader->base, reader->size);
+  reader->base = NULL;
+}
+
+int frpp_log_mmap_reader_seek(struct frpp_log_mmap_reader *reader,
+                              uint64_t record) {
+  if (reader == NULL || reader->base == NULL) {
+    return -EINVAL;
+  }
+
+  const struct prv_seg_hdr *hdr = prv_seg_hdr(reader);
+  const struct prv_trailer *trailer = prv_trailer(reader);
+
+  if (record < hdr->first) {
+    return -ENOENT;
+  }
+
+  reader->off = PRV_SEG_HDR_SIZE;
+  reader->record = hdr->first;
+  reader->ts = hdr->base_ts;
+
+  // A crashed writer left no trailer, so records are walked to the end of
+  // the index it may have started
+  reader->end = reader->size - PRV_TRAILER_SIZE;
+
+  if (trailer != NULL) {
+    reader->end = trailer->end;
+
+    // Last entry at or before record
+    size_t lo = 0;
+    size_t hi = trailer->entries;
+
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (prv_entry(reader->base, reader->size, mid)->record <= record) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+
+    if (lo > 0) {
+      const struct prv_index_entry *entry =
+          prv_entry(reader->base, reader->size, lo - 1);
+
+      if (entry->off >= PRV_SEG_HDR_SIZE && entry->off < reader->end) {
+        reader->off = entry->off;
+        reader->record = entry->record;
+        reader->ts = entry->base_ts;
+      }
+    }
+  }
+
+  while (reader->record < record) {
+    uint64_t ts;
+    int ret;
+
+    if (prv_next(reader, &ts, &ret) == NULL) {
+      return -ENOENT;
+    }
+  }
+
+  return 0;
+}
+
+int frpp_log_mmap_reader_render(struct frpp_log_mmap_reader *reader,
+                                void *out_buf, size_t out_buf_size_bytes,
+                                uint64_t *timestamp) {
+  if (reader == NULL || reader->base == NULL || out_buf == NULL) {
+    return -EINVAL;
+  }
+
+  uint64_t ts;
+  int ret;
+  const struct prv_record_hdr *hdr = prv_next(reader, &ts, &ret);
+
+  if (hdr == NULL) {
+    return ret;
+  }
+
+  if (timestamp != NULL) {
+    *timestamp = ts;
+  }
+
+  return frpp_snprintf_ex(frpp_log_fmt_str(hdr->fmt_id),
+                          FRPP_PRINTF_FLAG_CAPTURE_STR,
+                          (const uint8_t *)hdr + PRV_HDR_SIZE, out_buf,
+                          out_buf_size_bytes);
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,526 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_queue.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/logging/frpp_log_queue.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "frpp/logging/frpp_log_fmt.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Record has been fully written by its producer
+ */
+#define FRPP_LOG_QUEUE_COMMITTED (1UL << 31)
+
+/**
+ * @brief Record is padding to the end of the ring or an aborted slot and
+ * should be skipped
+ */
+#define FRPP_LOG_QUEUE_PAD (1UL << 30)
+
+/**
+ * @brief Record's package was created with FRPP_PRINTF_FLAG_CAPTURE_STR
+ */
+#define FRPP_LOG_QUEUE_CAPTURE (1UL << 29)
+
+/**
+ * @brief Record's package was created with FRPP_PRINTF_FLAG_DENSE
+ */
+#define FRPP_LOG_QUEUE_DENSE (1UL << 28)
+
+#define FRPP_LOG_QUEUE_SPAN_MASK (FRPP_LOG_QUEUE_DENSE - 1)
+
+#define FRPP_LOG_QUEUE_ALIGN_UP(val_)                                          \
+  (((val_) + (FRPP_LOG_QUEUE_ALIGN - 1)) & ~(size_t)(FRPP_LOG_QUEUE_ALIGN - 1))
+
+#define FRPP_LOG_QUEUE_HDR_SIZE                                                \
+  FRPP_LOG_QUEUE_ALIGN_UP(sizeof(struct prv_record_hdr))
+
+/**
+ * @brief Space for the format string pointer of records whose format string
+ * isn't interned
+ */
+#define FRPP_LOG_QUEUE_FMT_PTR_SIZE FRPP_LOG_QUEUE_ALIGN_UP(sizeof(const char *))
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Header preceding every record in the ring.  Package follows at
+ * FRPP_LOG_QUEUE_HDR_SIZE.  Records whose format string isn't interned
+ * store its pointer after the package.
+ *
+ * Every byte of the ring is zero until reserved by a producer, and is zeroed
+ * again by the consumer before being handed back.  So a header whose word
+ * lacks FRPP_LOG_QUEUE_COMMITTED is always one a producer is still writing.
+ */
+struct prv_record_hdr {
+  /* Span of record in bytes (including header) and state flags */
+  atomic_uint_least32_t word;
+
+  /* Interned format string ID, FRPP_LOG_FMT_ID_NONE if not interned */
+  uint16_t fmt_id;
+
+  /* Length of package */
+  uint16_t pkg_len;
+};
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Get header at monotonic position
+ *
+ * @param queue Queue instance
+ * @param pos Monotonic position
+ * @return Pointer to header
+ */
+static inline struct prv_record_hdr *prv_hdr(struct frpp_log_queue *queue,
+                                             size_t pos) {
+  return (struct prv_record_hdr *)(queue->buf + (pos & (queue->size - 1)));
+}
+
+/**
+ * @brief Publish header of a record
+ *
+ * @param queue Queue instance
+ * @param pos Monotonic position of record
+ * @param span Span of record
+ * @param flags Additional state flags
+ */
+static inline void prv_publish(struct frpp_log_queue *queue, size_t pos,
+                               size_t span, uint_least32_t flags) {
+  struct prv_record_hdr *hdr = prv_hdr(queue, pos);
+
+  atomic_store_explicit(&hdr->word,
+                        (uint_least32_t)span | FRPP_LOG_QUEUE_COMMITTED | flags,
+                        memory_order_release);
+}
+
+/**
+ * @brief Reserve contiguous span in ring.  If span doesn't fit before the end
+ * of the ring, the remainder is claimed in the same step and marked as
+ * padding.
+ *
+ * @param queue Queue instance
+ * @param span Bytes to reserve (aligned)
+ * @param pos Monotonic position of reservation output
+ * @retval 0 Success
+ * @retval -ENOSPC Not enough free space
+ */
+static int prv_reserve(struct frpp_log_queue *queue, size_t span,
+                       size_t *pos) {
+  size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  size_t pad;
+
+  do {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    size_t off = head & (queue->size - 1);
+
+    pad = (off + span > queue->size) ? (queue->size - off) : 0;
+
+    if (head + pad + span - tail > queue->size) {
+      return -ENOSPC;
+    }
+  } while (!atomic_compare_exchange_weak_explicit(
+      &queue->head, &head, head + pad + span, memory_order_acq_rel,
+      memory_order_relaxed));
+
+  if (pad) {
+    prv_publish(queue, head, pad, FRPP_LOG_QUEUE_PAD);
+  }
+
+  *pos = head + pad;
+
+  return 0;
+}
+
+/**
+ * @brief Give back the end of the most recent reservation
+ *
+ * @param queue Queue instance
+ * @param pos Monotonic position of reservation
+ * @param span Span currently reserved
+ * @param new_span Span to shrink to
+ * @return true if shrunk, false if a later reservation exists
+ */
+static bool prv_shrink(struct frpp_log_queue *queue, size_t pos, size_t span,
+                       size_t new_span) {
+  size_t end = pos + span;
+
+  return atomic_compare_exchange_strong_explicit(
+      &queue->head, &end, pos + new_span, memory_order_acq_rel,
+      memory_order_relaxed);
+}
+
+/**
+ * @brief Package and commit a record whose size is determined first.  Used
+ * when a package doesn't fit in FRPP_LOG_QUEUE_RESERVE_HINT.
+ *
+ * @param queue Queue instance
+ * @param flags Package flags
+ * @param fmt_str Format string
+ * @param args va_list instance
+ * @return 0 on success, negative error otherwise
+ */
+static int prv_vprintf_sized(struct frpp_log_queue *queue, uint32_t flags,
+                             const char *fmt_str, va_list args) {
+  struct frpp_log_queue_slot slot;
+
+  int pkg_len = frpp_vprintf_package(NULL, 0, flags, fmt_str, args);
+  if (pkg_len < 0) {
+    return pkg_len;
+  }
+
+  int ret = frpp_log_queue_reserve(queue, pkg_len, &slot);
+  if (ret < 0) {
+    return ret;
+  }
+
+  ret = frpp_vprintf_reserve_package(&slot.pkg, flags, fmt_str, args);
+  if (ret < 0) {
+    frpp_log_queue_abort(queue, &slot);
+    return ret;
+  }
+
+  return frpp_log_queue_commit(queue, &slot, fmt_str);
+}
+
+/**
+ * @brief Zero a consumed span and hand it back to producers
+ *
+ * @param queue Queue instance
+ * @param pos Monotonic position of span
+ * @param span Span in bytes
+ */
+static void prv_consume(struct frpp_log_queue *queue, size_t pos,
+                        size_t span) {
+  struct prv_record_hdr *hdr = prv_hdr(queue, pos);
+
+  memset((uint8_t *)hdr + sizeof(hdr->word), 0, span - sizeof(hdr->word));
+  atomic_store_explicit(&hdr->word, 0, memory_order_relaxed);
+
+  atomic_store_explicit(&queue->tail, pos + span, memory_order_release);
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_log_queue_init(struct frpp_log_queue *queue, void *buf, size_t size) {
+  if (queue == NULL || buf == NULL) {
+    return -EINVAL;
+  }
+
+  if (size < FRPP_LOG_QUEUE_HDR_SIZE || (size & (size - 1)) != 0 ||
+      size > FRPP_LOG_QUEUE_SPAN_MASK) {
+    return -EINVAL;
+  }
+
+  if (((uintptr_t)buf & (FRPP_LOG_QUEUE_ALIGN - 1)) != 0) {
+    return -EINVAL;
+  }
+
+  memset(buf, 0, size);
+
+  queue->buf = (uint8_t *)buf;
+  queue->size = size;
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+
+  return 0;
+}
+
+int frpp_log_queue_printf(struct frpp_log_queue *queue, const char *fmt_str,
+                          ...) {
+  va_list args;
+
+  va_start(args, fmt_str);
+  int ret = frpp_log_queue_vprintf(queue, fmt_str, args);
+  va_end(args);
+
+  return ret;
+}
+
+int frpp_log_queue_vprintf(struct frpp_log_queue *queue, const char *fmt_str,
+                           va_list args) {
+  return frpp_log_queue_vprintf_ex(queue, FRPP_LOG_QUEUE_PKG_FLAGS, fmt_str,
+                                   args);
+}
+
+int frpp_log_queue_vprintf_ex(struct frpp_log_queue *queue, uint32_t flags,
+                              const char *fmt_str, va_list args) {
+  if (queue == NULL || fmt_str == NULL) {
+    return -EINVAL;
+  }
+
+  struct frpp_log_queue_slot slot;
+
+  // Reserve a slot large enough for most packages and package straight into
+  // it.  Only when that fails is the format string walked a second time.
+  int ret = frpp_log_queue_reserve(queue, FRPP_LOG_QUEUE_RESERVE_HINT, &slot);
+  if (ret < 0) {
+    return prv_vprintf_sized(queue, flags, fmt_str, args);
+  }
+
+  ret = frpp_vprintf_reserve_package(&slot.pkg, flags, fmt_str, args);
+  if (ret == -ENOSPC) {
+    frpp_log_queue_abort(queue, &slot);
+    return prv_vprintf_sized(queue, flags, fmt_str, args);
+  }
+
+  if (ret < 0) {
+    frpp_log_queue_abort(queue, &slot);
+    return ret;
+  }
+
+  return frpp_log_queue_commit(queue, &slot, fmt_str);
+}
+
+int frpp_log_queue_reserve(struct frpp_log_queue *queue, size_t max_len,
+                           struct frpp_log_queue_slot *slot) {
+  if (queue == NULL || slot == NULL) {
+    return -EINVAL;
+  }
+
+  if (max_len > queue->size || max_len > UINT16_MAX) {
+    return -ENOSPC;
+  }
+
+  // Room for a format string pointer is reserved in case the format string
+  // turns out not to be interned, and given back on commit if it is
+  size_t pkg_span = FRPP_LOG_QUEUE_ALIGN_UP(FRPP_LOG_QUEUE_HDR_SIZE + max_len);
+  size_t span = pkg_span + FRPP_LOG_QUEUE_FMT_PTR_SIZE;
+  size_t pos = 0;
+
+  int ret = prv_reserve(queue, span, &pos);
+  if (ret < 0) {
+    return ret;
+  }
+
+  slot->pos = pos;
+  slot->span = span;
+
+  return frpp_printf_reserve(&slot->pkg,
+                             (uint8_t *)prv_hdr(queue, pos) +
+                                 FRPP_LOG_QUEUE_HDR_SIZE,
+                             pkg_span - FRPP_LOG_QUEUE_HDR_SIZE);
+}
+
+int frpp_log_queue_commit(struct frpp_log_queue *queue,
+                          struct frpp_log_queue_slot *slot,
+                          const char *fmt_str) {
+  if (queue == NULL || slot == NULL || fmt_str == NULL) {
+    return -EINVAL;
+  }
+
+  size_t pkg_len = frpp_printf_commit(&slot->pkg);
+  size_t pkg_span = FRPP_LOG_QUEUE_ALIGN_UP(FRPP_LOG_QUEUE_HDR_SIZE + pkg_len);
+  uint16_t fmt_id = frpp_log_fmt_id(fmt_str);
+  size_t span = pkg_span;
+
+  if (fmt_id == FRPP_LOG_FMT_ID_NONE) {
+    span += FRPP_LOG_QUEUE_FMT_PTR_SIZE;
+    memcpy((uint8_t *)prv_hdr(queue, slot->pos) + pkg_span, &fmt_str,
+           sizeof(fmt_str));
+  }
+
+  // Bytes past the package are still zero (a failed package zeroes what it
+  // touched), so they can be handed straight back
+  if (span < slot->span && prv_shrink(queue, slot->pos, slot->span, span)) {
+    slot->span = span;
+  }
+
+  struct prv_record_hdr *hdr = prv_hdr(queue, slot->pos);
+  hdr->fmt_id = fmt_id;
+  hdr->pkg_len = (uint16_t)pkg_len;
+
+  uint_least32_t flags = 0;
+
+  if (slot->pkg.flags & FRPP_PRINTF_FLAG_CAPTURE_STR) {
+    flags |= FRPP_LOG_QUEUE_CAPTURE;
+  }
+
+  if (slot->pkg.flags & FRPP_PRINTF_FLAG_DENSE) {
+    flags |= FRPP_LOG_QUEUE_DENSE;
+  }
+
+  prv_publish(queue, slot->pos, slot->span, flags);
+
+  return 0;
+}
+
+void frpp_log_queue_abort(struct frpp_log_queue *queue,
+                          struct frpp_log_queue_slot *slot) {
+  if (queue == NULL || slot == NULL) {
+    return;
+  }
+
+  // A failed package may have scribbled anywhere in the slot
+  frpp_printf_abort(&slot->pkg);
+
+  if (prv_shrink(queue, slot->pos, slot->span, 0)) {
+    return;
+  }
+
+  prv_publish(queue, slot->pos, slot->span, FRPP_LOG_QUEUE_PAD);
+}
+
+int frpp_log_queue_peek(struct frpp_log_queue *queue,
+                        struct frpp_log_record *record) {
+  if (queue == NULL || record == NULL) {
+    return -EINVAL;
+  }
+
+  size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+  while (tail != atomic_load_explicit(&queue->head, memory_order_acquire)) {
+    struct prv_record_hdr *hdr = prv_hdr(queue, tail);
+    uint_least32_t word =
+        atomic_load_explicit(&hdr->word, memory_order_acquire);
+
+    if ((word & FRPP_LOG_QUEUE_COMMITTED) == 0) {
+      return -EAGAIN;
+    }
+
+    size_t span = word & FRPP_LOG_QUEUE_SPAN_MASK;
+
+    if (word & FRPP_LOG_QUEUE_PAD) {
+      prv_consume(queue, tail, span);
+      tail += span;
+      continue;
+    }
+
+    record->fmt_id = hdr->fmt_id;
+    record->flags = 0;
+
+    if (word & FRPP_LOG_QUEUE_CAPTURE) {
+      record->flags |= FRPP_PRINTF_FLAG_CAPTURE_STR;
+    }
+
+    if (word & FRPP_LOG_QUEUE_DENSE) {
+      record->flags |= FRPP_PRINTF_FLAG_DENSE;
+    }
+    record->pkg = (const uint8_t *)hdr + FRPP_LOG_QUEUE_HDR_SIZE;
+    record->pkg_len = hdr->pkg_len;
+
+    if (hdr->fmt_id == FRPP_LOG_FMT_ID_NONE) {
+      memcpy(&record->fmt,
+             (const uint8_t *)hdr +
+                 FRPP_LOG_QUEUE_ALIGN_UP(FRPP_LOG_QUEUE_HDR_SIZE +
+                                         record->pkg_len),
+             sizeof(record->fmt));
+    } else {
+      record->fmt = frpp_log_fmt_str(hdr->fmt_id);
+    }
+    record->pos = tail;
+    record->span = span;
+
+    return 0;
+  }
+
+  return -EAGAIN;
+}
+
+void frpp_log_queue_release(struct frpp_log_queue *queue,
+                            const struct frpp_log_record *record) {
+  if (queue == NULL || record == NULL) {
+    return;
+  }
+
+  prv_consume(queue, record->pos, record->span);
+}
+
+int frpp_log_queue_render(struct frpp_log_queue *queue, void *out_buf,
+                          size_t out_buf_size_bytes) {
+  if (queue == NULL || out_buf == NULL) {
+    return -EINVAL;
+  }
+
+  struct frpp_log_record record;
+  int ret = frpp_log_queue_peek(queue, &record);
+  if (ret < 0) {
+    return ret;
+  }
+
+  ret = frpp_snprintf_ex(record.fmt, record.flags, record.pkg, out_buf,
+                         out_buf_size_bytes);
+  frpp_log_queue_release(queue, &record);
+
+  return ret;
+}
+
+int frpp_log_queue_render_batch(struct frpp_log_queue *queue, void *out_buf,
+                                size_t out_buf_size_bytes, size_t *len) {
+  if (queue == NULL || out_buf == NULL || out_buf_size_bytes == 0 ||
+      len == NULL) {
+    return -EINVAL;
+  }
+
+  char *buf = (char *)out_buf;
+  struct frpp_log_record record;
+  size_t pos = 0;
+  int count = 0;
+
+  buf[0] = '\0';
+
+  while (frpp_log_queue_peek(queue, &record) == 0) {
+    const struct frpp_printf_record batch = {
+        .fmt = record.fmt,
+        .arg_buf = record.pkg,
+        .flags = record.flags,
+    };
+    size_t offsets[2];
+
+    int ret = frpp_snprintf_batch(&batch, 1, &buf[pos],
+                                  out_buf_size_bytes - pos, offsets);
+
+    if (ret == 0 && pos == 0) {
+      // Doesn't fit even on its own.  Truncate rather than stall the queue.
+      frpp_snprintf_ex(record.fmt, record.flags, record.pkg, buf,
+                       out_buf_size_bytes);
+      offsets[1] = out_buf_size_bytes - 1;
+      ret = 1;
+    }
+
+    if (ret < 0 && count == 0) {
+      // Release a record that can't be rendered, so it doesn't stall the
+      // queue, and report why
+      frpp_log_queue_release(queue, &record);
+      *len = 0;
+      return ret;
+    }
+
+    // A bad record after others is left to report on the next call
+    if (ret <= 0) {
+      break;
+    }
+
+    pos += offsets[1];
+    frpp_log_queue_release(queue, &record);
+    count++;
+  }
+
+  *len = pos;
+
+  return (count > 0) ? count : -EAGAIN;
+}
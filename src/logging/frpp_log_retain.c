@@ -0,0 +1,669 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_retain.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#if defined(__linux__)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "frpp/logging/frpp_log_retain.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Marks a formatted region ("FRLR")
+ */
+#define PRV_REGION_MAGIC (0x524C5246UL)
+
+/**
+ * @brief Version of region layout
+ */
+#define PRV_REGION_VERSION (1U)
+
+/**
+ * @brief Marks a record
+ */
+#define PRV_RECORD_MAGIC (0xF10CU)
+
+/**
+ * @brief Marks padding to the end of the ring
+ */
+#define PRV_PAD_MAGIC (0xF1FFU)
+
+#define PRV_ALIGN_UP(val_)                                                     \
+  (((val_) + (FRPP_LOG_RETAIN_ALIGN - 1)) &                                    \
+   ~(size_t)(FRPP_LOG_RETAIN_ALIGN - 1))
+
+#define PRV_REGION_SIZE PRV_ALIGN_UP(sizeof(struct prv_region))
+
+#define PRV_HDR_SIZE PRV_ALIGN_UP(sizeof(struct prv_record_hdr))
+
+/**
+ * @brief Keep stores to the region in program order, so a reset between
+ * any two of them leaves a region recovery can walk
+ */
+#define PRV_ORDER() atomic_signal_fence(memory_order_seq_cst)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Position of the oldest record.  Written alternately to two slots,
+ * so a slot torn by a reset leaves the previous one intact.  Records are
+ * only overwritten once the tail moving past them has been written.
+ */
+struct prv_tail {
+  /* Incremented on every write, newest valid slot wins */
+  uint32_t gen;
+
+  /* Offset and sequence number of oldest record */
+  uint32_t off;
+  uint32_t seq;
+
+  /* CRC of the above */
+  uint32_t crc;
+};
+
+/**
+ * @brief Header at the start of the region.  Records follow at
+ * PRV_REGION_SIZE.
+ */
+struct prv_region {
+  /* Layout, checked on attach */
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+  uint32_t build_id;
+
+  /* CRC of the above */
+  uint32_t crc;
+  uint32_t reserved;
+
+  /* Position of oldest record */
+  struct prv_tail tail[2];
+};
+
+/**
+ * @brief Header preceding every record.  Package follows at PRV_HDR_SIZE.
+ * Padding uses the same header with no package, and the sequence number of
+ * the record after it.
+ */
+struct prv_record_hdr {
+  /* PRV_RECORD_MAGIC or PRV_PAD_MAGIC */
+  uint16_t magic;
+  uint16_t reserved;
+
+  /* Interned format string ID */
+  uint16_t fmt_id;
+
+  /* Length of package */
+  uint16_t pkg_len;
+
+  /* Sequence number */
+  uint32_t seq;
+
+  /* CRC of the above and the package */
+  uint32_t crc;
+};
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief CRC-32 (IEEE 802.3, reflected) lookup table
+ */
+static const uint32_t prv_crc_table[256] = {
+    0x00000000U, 0x77073096U, 0xEE0E612CU, 0x990951BAU, 0x076DC419U,
+    0x706AF48FU, 0xE963A535U, 0x9E6495A3U, 0x0EDB8832U, 0x79DCB8A4U,
+    0xE0D5E91EU, 0x97D2D988U, 0x09B64C2BU, 0x7EB17CBDU, 0xE7B82D07U,
+    0x90BF1D91U, 0x1DB71064U, 0x6AB020F2U, 0xF3B97148U, 0x84BE41DEU,
+    0x1ADAD47DU, 0x6DDDE4EBU, 0xF4D4B551U, 0x83D385C7U, 0x136C9856U,
+    0x646BA8C0U, 0xFD62F97AU, 0x8A65C9ECU, 0x14015C4FU, 0x63066CD9U,
+    0xFA0F3D63U, 0x8D080DF5U, 0x3B6E20C8U, 0x4C69105EU, 0xD56041E4U,
+    0xA2677172U, 0x3C03E4D1U, 0x4B04D447U, 0xD20D85FDU, 0xA50AB56BU,
+    0x35B5A8FAU, 0x42B2986CU, 0xDBBBC9D6U, 0xACBCF940U, 0x32D86CE3U,
+    0x45DF5C75U, 0xDCD60DCFU, 0xABD13D59U, 0x26D930ACU, 0x51DE003AU,
+    0xC8D75180U, 0xBFD06116U, 0x21B4F4B5U, 0x56B3C423U, 0xCFBA9599U,
+    0xB8BDA50FU, 0x2802B89EU, 0x5F058808U, 0xC60CD9B2U, 0xB10BE924U,
+    0x2F6F7C87U, 0x58684C11U, 0xC1611DABU, 0xB6662D3DU, 0x76DC4190U,
+    0x01DB7106U, 0x98D220BCU, 0xEFD5102AU, 0x71B18589U, 0x06B6B51FU,
+    0x9FBFE4A5U, 0xE8B8D433U, 0x7807C9A2U, 0x0F00F934U, 0x9609A88EU,
+    0xE10E9818U, 0x7F6A0DBBU, 0x086D3D2DU, 0x91646C97U, 0xE6635C01U,
+    0x6B6B51F4U, 0x1C6C6162U, 0x856530D8U, 0xF262004EU, 0x6C0695EDU,
+    0x1B01A57BU, 0x8208F4C1U, 0xF50FC457U, 0x65B0D9C6U, 0x12B7E950U,
+    0x8BBEB8EAU, 0xFCB9887CU, 0x62DD1DDFU, 0x15DA2D49U, 0x8CD37CF3U,
+    0xFBD44C65U, 0x4DB26158U, 0x3AB551CEU, 0xA3BC0074U, 0xD4BB30E2U,
+    0x4ADFA541U, 0x3DD895D7U, 0xA4D1C46DU, 0xD3D6F4FBU, 0x4369E96AU,
+    0x346ED9FCU, 0xAD678846U, 0xDA60B8D0U, 0x44042D73U, 0x33031DE5U,
+    0xAA0A4C5FU, 0xDD0D7CC9U, 0x5005713CU, 0x270241AAU, 0xBE0B1010U,
+    0xC90C2086U, 0x5768B525U, 0x206F85B3U, 0xB966D409U, 0xCE61E49FU,
+    0x5EDEF90EU, 0x29D9C998U, 0xB0D09822U, 0xC7D7A8B4U, 0x59B33D17U,
+    0x2EB40D81U, 0xB7BD5C3BU, 0xC0BA6CADU, 0xEDB88320U, 0x9ABFB3B6U,
+    0x03B6E20CU, 0x74B1D29AU, 0xEAD54739U, 0x9DD277AFU, 0x04DB2615U,
+    0x73DC1683U, 0xE3630B12U, 0x94643B84U, 0x0D6D6A3EU, 0x7A6A5AA8U,
+    0xE40ECF0BU, 0x9309FF9DU, 0x0A00AE27U, 0x7D079EB1U, 0xF00F9344U,
+    0x8708A3D2U, 0x1E01F268U, 0x6906C2FEU, 0xF762575DU, 0x806567CBU,
+    0x196C3671U, 0x6E6B06E7U, 0xFED41B76U, 0x89D32BE0U, 0x10DA7A5AU,
+    0x67DD4ACCU, 0xF9B9DF6FU, 0x8EBEEFF9U, 0x17B7BE43U, 0x60B08ED5U,
+    0xD6D6A3E8U, 0xA1D1937EU, 0x38D8C2C4U, 0x4FDFF252U, 0xD1BB67F1U,
+    0xA6BC5767U, 0x3FB506DDU, 0x48B2364BU, 0xD80D2BDAU, 0xAF0A1B4CU,
+    0x36034AF6U, 0x41047A60U, 0xDF60EFC3U, 0xA867DF55U, 0x316E8EEFU,
+    0x4669BE79U, 0xCB61B38CU, 0xBC66831AU, 0x256FD2A0U, 0x5268E236U,
+    0xCC0C7795U, 0xBB0B4703U, 0x220216B9U, 0x5505262FU, 0xC5BA3BBEU,
+    0xB2BD0B28U, 0x2BB45A92U, 0x5CB36A04U, 0xC2D7FFA7U, 0xB5D0CF31U,
+    0x2CD99E8BU, 0x5BDEAE1DU, 0x9B64C2B0U, 0xEC63F226U, 0x756AA39CU,
+    0x026D930AU, 0x9C0906A9U, 0xEB0E363FU, 0x72076785U, 0x05005713U,
+    0x95BF4A82U, 0xE2B87A14U, 0x7BB12BAEU, 0x0CB61B38U, 0x92D28E9BU,
+    0xE5D5BE0DU, 0x7CDCEFB7U, 0x0BDBDF21U, 0x86D3D2D4U, 0xF1D4E242U,
+    0x68DDB3F8U, 0x1FDA836EU, 0x81BE16CDU, 0xF6B9265BU, 0x6FB077E1U,
+    0x18B74777U, 0x88085AE6U, 0xFF0F6A70U, 0x66063BCAU, 0x11010B5CU,
+    0x8F659EFFU, 0xF862AE69U, 0x616BFFD3U, 0x166CCF45U, 0xA00AE278U,
+    0xD70DD2EEU, 0x4E048354U, 0x3903B3C2U, 0xA7672661U, 0xD06016F7U,
+    0x4969474DU, 0x3E6E77DBU, 0xAED16A4AU, 0xD9D65ADCU, 0x40DF0B66U,
+    0x37D83BF0U, 0xA9BCAE53U, 0xDEBB9EC5U, 0x47B2CF7FU, 0x30B5FFE9U,
+    0xBDBDF21CU, 0xCABAC28AU, 0x53B39330U, 0x24B4A3A6U, 0xBAD03605U,
+    0xCDD70693U, 0x54DE5729U, 0x23D967BFU, 0xB3667A2EU, 0xC4614AB8U,
+    0x5D681B02U, 0x2A6F2B94U, 0xB40BBE37U, 0xC30C8EA1U, 0x5A05DF1BU,
+    0x2D02EF8DU,
+};
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Update CRC-32 over a buffer
+ *
+ * @param crc CRC so far, 0 to start
+ * @param buf Buffer
+ * @param len Length of buffer
+ * @return Updated CRC
+ */
+static uint32_t prv_crc(uint32_t crc, const void *buf, size_t len) {
+  const uint8_t *bytes = (const uint8_t *)buf;
+
+  crc = ~crc;
+
+  for (size_t i = 0; i < len; i++) {
+    crc = prv_crc_table[(crc ^ bytes[i]) & 0xFFU] ^ (crc >> 8);
+  }
+
+  return ~crc;
+}
+
+/**
+ * @brief Compute CRC of a record
+ *
+ * @param hdr Header of record
+ * @return CRC
+ */
+static uint32_t prv_record_crc(const struct prv_record_hdr *hdr) {
+  uint32_t crc = prv_crc(0, hdr, offsetof(struct prv_record_hdr, crc));
+
+  return prv_crc(crc, (const uint8_t *)hdr + PRV_HDR_SIZE, hdr->pkg_len);
+}
+
+/**
+ * @brief Get header at offset
+ *
+ * @param retain Retained ring instance
+ * @param off Offset
+ * @return Pointer to header
+ */
+static inline struct prv_record_hdr *prv_hdr(struct frpp_log_retain *retain,
+                                             size_t off) {
+  return (struct prv_record_hdr *)(retain->data + off);
+}
+
+/**
+ * @brief Get region header
+ *
+ * @param retain Retained ring instance
+ * @return Pointer to region header
+ */
+static inline struct prv_region *prv_region(struct frpp_log_retain *retain) {
+  return (struct prv_region *)retain->region;
+}
+
+/**
+ * @brief Check whether a slot holds a valid tail
+ *
+ * @param retain Retained ring instance
+ * @param tail Slot
+ * @return true if valid
+ */
+static bool prv_tail_valid(struct frpp_log_retain *retain,
+                           const struct prv_tail *tail) {
+  return tail->crc == prv_crc(0, tail, offsetof(struct prv_tail, crc)) &&
+         tail->off < retain->size &&
+         (tail->off & (FRPP_LOG_RETAIN_ALIGN - 1)) == 0;
+}
+
+/**
+ * @brief Write tail to the region
+ *
+ * @param retain Retained ring instance
+ */
+static void prv_tail_write(struct frpp_log_retain *retain) {
+  retain->gen++;
+
+  struct prv_tail *tail = &prv_region(retain)->tail[retain->gen & 1U];
+
+  PRV_ORDER();
+
+  tail->gen = retain->gen;
+  tail->off = (uint32_t)retain->tail;
+  tail->seq = retain->tail_seq;
+  tail->crc = prv_crc(0, tail, offsetof(struct prv_tail, crc));
+
+  PRV_ORDER();
+}
+
+/**
+ * @brief Check whether a valid record, rather than padding, is at offset
+ *
+ * @param retain Retained ring instance
+ * @param off Offset
+ * @return true if a record
+ */
+static bool prv_is_record(struct frpp_log_retain *retain, size_t off) {
+  return retain->size - off >= PRV_HDR_SIZE &&
+         prv_hdr(retain, off)->magic == PRV_RECORD_MAGIC;
+}
+
+/**
+ * @brief Get span of a valid record or padding at offset
+ *
+ * @param retain Retained ring instance
+ * @param off Offset
+ * @return Span in bytes
+ */
+static size_t prv_span(struct frpp_log_retain *retain, size_t off) {
+  struct prv_record_hdr *hdr = prv_hdr(retain, off);
+
+  if (!prv_is_record(retain, off)) {
+    return retain->size - off;
+  }
+
+  return PRV_ALIGN_UP(PRV_HDR_SIZE + hdr->pkg_len);
+}
+
+/**
+ * @brief Check whether offset holds a record or padding that continues the
+ * sequence.  Space too small for a header at the end of the ring is implicit
+ * padding.
+ *
+ * @param retain Retained ring instance
+ * @param off Offset
+ * @param seq Expected sequence number
+ * @return true if valid
+ */
+static bool prv_valid(struct frpp_log_retain *retain, size_t off,
+                      uint32_t seq) {
+  if (retain->size - off < PRV_HDR_SIZE) {
+    return true;
+  }
+
+  const struct prv_record_hdr *hdr = prv_hdr(retain, off);
+
+  if (hdr->seq != seq || hdr->reserved != 0) {
+    return false;
+  }
+
+  if (hdr->magic == PRV_PAD_MAGIC) {
+    return hdr->pkg_len == 0 && hdr->crc == prv_record_crc(hdr);
+  }
+
+  return hdr->magic == PRV_RECORD_MAGIC &&
+         hdr->pkg_len <= FRPP_LOG_RETAIN_PKG_MAX &&
+         PRV_ALIGN_UP(PRV_HDR_SIZE + hdr->pkg_len) <= retain->size - off &&
+         frpp_log_fmt_str(hdr->fmt_id) != NULL &&
+         hdr->crc == prv_record_crc(hdr);
+}
+
+/**
+ * @brief Drop oldest record or padding
+ *
+ * @param retain Retained ring instance
+ * @return true if a record was dropped, false if padding
+ */
+static bool prv_evict(struct frpp_log_retain *retain) {
+  bool record = prv_is_record(retain, retain->tail);
+  size_t span = prv_span(retain, retain->tail);
+
+  retain->tail += span;
+  retain->used -= span;
+
+  if (retain->tail == retain->size) {
+    retain->tail = 0;
+  }
+
+  if (record) {
+    retain->tail_seq++;
+    retain->count--;
+  }
+
+  return record;
+}
+
+/**
+ * @brief Discard region contents and write a fresh header
+ *
+ * @param retain Retained ring instance
+ * @param build_id ID of the running image
+ */
+static void prv_format(struct frpp_log_retain *retain, uint32_t build_id) {
+  struct prv_region *region = prv_region(retain);
+
+  // Stale records must not continue the new sequence
+  memset(retain->region, 0, PRV_REGION_SIZE + retain->size);
+
+  region->magic = PRV_REGION_MAGIC;
+  region->version = PRV_REGION_VERSION;
+  region->size = (uint32_t)retain->size;
+  region->build_id = build_id;
+  region->crc = prv_crc(0, region, offsetof(struct prv_region, crc));
+
+  prv_tail_write(retain);
+}
+
+/**
+ * @brief Rebuild ring state from the region
+ *
+ * @param retain Retained ring instance
+ * @param build_id ID of the running image
+ * @return true if region held a valid tail
+ */
+static bool prv_recover(struct frpp_log_retain *retain, uint32_t build_id) {
+  struct prv_region *region = prv_region(retain);
+
+  if (region->magic != PRV_REGION_MAGIC ||
+      region->version != PRV_REGION_VERSION ||
+      region->size != retain->size || region->build_id != build_id ||
+      region->crc != prv_crc(0, region, offsetof(struct prv_region, crc))) {
+    return false;
+  }
+
+  const struct prv_tail *tail = NULL;
+
+  for (size_t i = 0; i < 2; i++) {
+    const struct prv_tail *slot = &region->tail[i];
+
+    if (prv_tail_valid(retain, slot) &&
+        (tail == NULL || (int32_t)(slot->gen - tail->gen) > 0)) {
+      tail = slot;
+    }
+  }
+
+  if (tail == NULL) {
+    return false;
+  }
+
+  retain->gen = tail->gen;
+  retain->tail = tail->off;
+  retain->tail_seq = tail->seq;
+
+  // Follow the sequence from the oldest record until it breaks.  A record
+  // torn by the reset fails its CRC and ends the walk.
+  size_t off = retain->tail;
+  uint32_t seq = retain->tail_seq;
+
+  while (retain->used < retain->size && prv_valid(retain, off, seq)) {
+    size_t span = prv_span(retain, off);
+
+    if (retain->used + span > retain->size) {
+      break;
+    }
+
+    if (prv_is_record(retain, off)) {
+      seq++;
+      retain->count++;
+    }
+
+    retain->used += span;
+    off += span;
+
+    if (off == retain->size) {
+      off = 0;
+    }
+  }
+
+  retain->head = off;
+  retain->seq = seq;
+
+  return true;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_log_retain_init(struct frpp_log_retain *retain, void *region,
+                         size_t size, uint32_t build_id) {
+  if (retain == NULL || region == NULL ||
+      ((uintptr_t)region & (FRPP_LOG_RETAIN_ALIGN - 1)) != 0) {
+    return -EINVAL;
+  }
+
+  if (size < PRV_REGION_SIZE + PRV_HDR_SIZE) {
+    return -EINVAL;
+  }
+
+  size_t data_size = (size - PRV_REGION_SIZE) &
+                     ~(size_t)(FRPP_LOG_RETAIN_ALIGN - 1);
+
+  if (data_size > UINT32_MAX) {
+    return -EINVAL;
+  }
+
+  memset(retain, 0, sizeof(*retain));
+  retain->region = (uint8_t *)region;
+  retain->data = retain->region + PRV_REGION_SIZE;
+  retain->size = data_size;
+
+  if (!prv_recover(retain, build_id)) {
+    memset(retain, 0, sizeof(*retain));
+    retain->region = (uint8_t *)region;
+    retain->data = retain->region + PRV_REGION_SIZE;
+    retain->size = data_size;
+
+    prv_format(retain, build_id);
+  }
+
+  return (int)retain->count;
+}
+
+int frpp_log_retain_printf(struct frpp_log_retain *retain, const char *fmt_str,
+                           ...) {
+  va_list args;
+
+  va_start(args, fmt_str);
+  int ret = frpp_log_retain_vprintf(retain, fmt_str, args);
+  va_end(args);
+
+  return ret;
+}
+
+int frpp_log_retain_vprintf(struct frpp_log_retain *retain,
+                            const char *fmt_str, va_list args) {
+  if (retain == NULL || fmt_str == NULL) {
+    return -EINVAL;
+  }
+
+  uint16_t fmt_id = frpp_log_fmt_id(fmt_str);
+
+  if (fmt_id == FRPP_LOG_FMT_ID_NONE) {
+    return -EINVAL;
+  }
+
+  // Strings may not survive the reset, so they're always captured
+  _Alignas(FRPP_LOG_RETAIN_ALIGN) uint8_t pkg[FRPP_LOG_RETAIN_PKG_MAX];
+  int pkg_len = frpp_vprintf_package(pkg, sizeof(pkg),
+                                     FRPP_PRINTF_FLAG_CAPTURE_STR, fmt_str,
+                                     args);
+  if (pkg_len < 0) {
+    return pkg_len;
+  }
+
+  size_t span = PRV_ALIGN_UP(PRV_HDR_SIZE + (size_t)pkg_len);
+
+  if (span > retain->size) {
+    return -ENOSPC;
+  }
+
+  // Record doesn't fit before the end of the ring, so the rest is padding
+  size_t pad = (retain->head + span > retain->size)
+                   ? (retain->size - retain->head)
+                   : 0;
+  bool evicted = false;
+
+  while (retain->size - retain->used < pad + span) {
+    if (retain->used == 0) {
+      retain->head = 0;
+      retain->tail = 0;
+      pad = 0;
+    } else {
+      retain->lost += prv_evict(retain);
+    }
+
+    evicted = true;
+  }
+
+  // Space is only reused once the region no longer points at it
+  if (evicted) {
+    prv_tail_write(retain);
+  }
+
+  if (pad != 0) {
+    if (pad >= PRV_HDR_SIZE) {
+      struct prv_record_hdr *hdr = prv_hdr(retain, retain->head);
+
+      memset(hdr, 0, sizeof(*hdr));
+      hdr->magic = PRV_PAD_MAGIC;
+      hdr->seq = retain->seq;
+      hdr->crc = prv_record_crc(hdr);
+    }
+
+    retain->used += pad;
+    retain->head = 0;
+  }
+
+  struct prv_record_hdr *hdr = prv_hdr(retain, retain->head);
+
+  memcpy((uint8_t *)hdr + PRV_HDR_SIZE, pkg, (size_t)pkg_len);
+  hdr->magic = PRV_RECORD_MAGIC;
+  hdr->reserved = 0;
+  hdr->fmt_id = fmt_id;
+  hdr->pkg_len = (uint16_t)pkg_len;
+  hdr->seq = retain->seq;
+  hdr->crc = prv_record_crc(hdr);
+
+  PRV_ORDER();
+
+  retain->head += span;
+  retain->used += span;
+  retain->seq++;
+  retain->count++;
+
+  if (retain->head == retain->size) {
+    retain->head = 0;
+  }
+
+  return 0;
+}
+
+int frpp_log_retain_render(struct frpp_log_retain *retain, void *out_buf,
+                           size_t out_buf_size_bytes) {
+  if (retain == NULL || out_buf == NULL) {
+    return -EINVAL;
+  }
+
+  if (retain->count == 0) {
+    return -EAGAIN;
+  }
+
+  // Skip padding ahead of the oldest record
+  while (!prv_is_record(retain, retain->tail)) {
+    prv_evict(retain);
+  }
+
+  const struct prv_record_hdr *hdr = prv_hdr(retain, retain->tail);
+  int ret = frpp_snprintf_ex(frpp_log_fmt_str(hdr->fmt_id),
+                             FRPP_PRINTF_FLAG_CAPTURE_STR,
+                             (const uint8_t *)hdr + PRV_HDR_SIZE, out_buf,
+                             out_buf_size_bytes);
+
+  prv_evict(retain);
+  prv_tail_write(retain);
+
+  return ret;
+}
+
+size_t frpp_log_retain_count(struct frpp_log_retain *retain) {
+  return (retain != NULL) ? retain->count : 0;
+}
+
+size_t frpp_log_retain_lost(struct frpp_log_retain *retain) {
+  return (retain != NULL) ? retain->lost : 0;
+}
+
+#if defined(__linux__)
+int frpp_log_retain_map(const char *path, size_t size, void **region) {
+  if (path == NULL || region == NULL || size == 0) {
+    return -EINVAL;
+  }
+
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+
+  if (fd < 0) {
+    return -errno;
+  }
+
+  if (ftruncate(fd, (off_t)size) != 0) {
+    int err = -errno;
+    close(fd);
+    return err;
+  }
+
+  // Pages of a shared file mapping outlive the process
+  void *addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  int err = (addr == MAP_FAILED) ? -errno : 0;
+
+  close(fd);
+
+  if (err != 0) {
+    return err;
+  }
+
+  *region = addr;
+
+  return 0;
+}
+
+void frpp_log_retain_unmap(void *region, size_t size) {
+  if (region != NULL) {
+    munmap(region, size);
+  }
+}
+#endif
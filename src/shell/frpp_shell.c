@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_shell.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/shell/frpp_shell.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "frpp/shell/frpp_shell_out.h"
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Finalizer of MurmurHash3
+ */
+static inline uint32_t prv_fmix(uint32_t hash) {
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6BU;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35U;
+  hash ^= hash >> 16;
+
+  return hash;
+}
+
+/**
+ * @brief Check if character separates arguments
+ */
+static inline bool prv_is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/**
+ * @brief Find child of a trie node by the character following its prefix
+ *
+ * @param table Command table
+ * @param node Parent node
+ * @param c Character
+ * @return Index of child, or -1 if none
+ */
+static int prv_trie_child(const struct frpp_shell_table *table,
+                          const struct frpp_shell_trie_node *node, uint8_t c) {
+  size_t lo = node->child;
+  size_t hi = lo + node->children;
+
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    const char *name = table->cmds[table->sorted[table->trie[mid].first]].name;
+    uint8_t key = (uint8_t)name[node->depth];
+
+    if (key == c) {
+      return (int)mid;
+    }
+
+    if (key < c) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return -1;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+uint32_t frpp_shell_hash(const char *name, size_t len) {
+  uint32_t hash = FRPP_SHELL_HASH_BASIS;
+
+  for (size_t i = 0; i < len; i++) {
+    hash = (hash ^ (uint8_t)name[i]) * FRPP_SHELL_HASH_PRIME;
+  }
+
+  return prv_fmix(hash);
+}
+
+uint32_t frpp_shell_mix(uint32_t hash, uint32_t disp) {
+  return prv_fmix(hash ^ (disp * 0x9E3779B9U));
+}
+
+int frpp_shell_init(struct frpp_shell *shell,
+                    const struct frpp_shell_table *table, void *ctx) {
+  if (shell == NULL || table == NULL) {
+    return -EINVAL;
+  }
+
+  if (table->count != 0 &&
+      (table->cmds == NULL || table->disp == NULL || table->buckets == 0)) {
+    return -EINVAL;
+  }
+
+  shell->table = table;
+  shell->out = NULL;
+  shell->ctx = ctx;
+
+  return 0;
+}
+
+int frpp_shell_set_out(struct frpp_shell *shell, struct frpp_shell_out *out) {
+  if (shell == NULL) {
+    return -EINVAL;
+  }
+
+  shell->out = out;
+
+  return 0;
+}
+
+int frpp_shell_printf(struct frpp_shell *shell, const char *fmt_str, ...) {
+  va_list args;
+  va_start(args, fmt_str);
+
+  int ret = frpp_shell_vprintf(shell, fmt_str, args);
+
+  va_end(args);
+
+  return ret;
+}
+
+int frpp_shell_vprintf(struct frpp_shell *shell, const char *fmt_str,
+                       va_list args) {
+  if (shell == NULL) {
+    return -EINVAL;
+  }
+
+  if (shell->out == NULL) {
+    return -ENODEV;
+  }
+
+  return frpp_shell_out_vprintf(shell->out, fmt_str, args);
+}
+
+const struct frpp_shell_cmd *
+frpp_shell_find(const struct frpp_shell_table *table, const char *name,
+                size_t len) {
+  if (table == NULL || name == NULL || table->count == 0) {
+    return NULL;
+  }
+
+  uint32_t hash = frpp_shell_hash(name, len);
+  uint32_t disp = table->disp[hash % table->buckets];
+  uint32_t slot = frpp_shell_mix(hash, disp) % table->count;
+
+  // Every name hashes to some slot, so the candidate must still be compared
+  const struct frpp_shell_cmd *cmd = &table->cmds[slot];
+  if (strncmp(cmd->name, name, len) != 0 || cmd->name[len] != '\0') {
+    return NULL;
+  }
+
+  return cmd;
+}
+
+int frpp_shell_complete(const struct frpp_shell_table *table,
+                        const char *prefix, size_t len,
+                        struct frpp_shell_match *match) {
+  if (table == NULL || (prefix == NULL && len != 0) || match == NULL) {
+    return -EINVAL;
+  }
+
+  if (table->trie == NULL || table->sorted == NULL) {
+    return -ENOTSUP;
+  }
+
+  match->table = table;
+  match->first = 0;
+  match->count = 0;
+  match->common = 0;
+
+  if (table->count == 0) {
+    return 0;
+  }
+
+  const struct frpp_shell_trie_node *node = &table->trie[0];
+  size_t pos = 0;
+
+  for (;;) {
+    const char *name = table->cmds[table->sorted[node->first]].name;
+
+    // Match the rest of the node's prefix, stopping early if prefix ends
+    for (; pos < node->depth && pos < len; pos++) {
+      if (name[pos] != prefix[pos]) {
+        return 0;
+      }
+    }
+
+    if (pos == len) {
+      break;
+    }
+
+    int child = prv_trie_child(table, node, (uint8_t)prefix[pos]);
+    if (child < 0) {
+      return 0;
+    }
+
+    node = &table->trie[child];
+  }
+
+  match->first = node->first;
+  match->count = node->matches;
+  match->common = node->depth;
+
+  return match->count;
+}
+
+const struct frpp_shell_cmd *
+frpp_shell_match_get(const struct frpp_shell_match *match, size_t index) {
+  if (match == NULL || index >= match->count) {
+    return NULL;
+  }
+
+  const struct frpp_shell_table *table = match->table;
+
+  return &table->cmds[table->sorted[match->first + index]];
+}
+
+int frpp_shell_tokenize(char *line, char *argv[], int argc_max) {
+  if (line == NULL || argv == NULL || argc_max < 0) {
+    return -EINVAL;
+  }
+
+  int argc = 0;
+  char *src = line;
+
+  // Each argument starts where it is in the line, and is only compacted
+  // when quotes and escapes are dropped.  dst never passes src, as every
+  // byte written consumes at least one byte read.
+  for (;;) {
+    while (prv_is_space(*src)) {
+      src++;
+    }
+
+    if (*src == '\0') {
+      break;
+    }
+
+    if (argc == argc_max) {
+      return -E2BIG;
+    }
+
+    char *dst = src;
+    argv[argc++] = dst;
+
+    char quote = '\0';
+
+    while (*src != '\0') {
+      char c = *src++;
+
+      if (quote == '\'') {
+        if (c == '\'') {
+          quote = '\0';
+        } else {
+          *dst++ = c;
+        }
+      } else if (c == '\\') {
+        if (*src == '\0') {
+          return -EBADMSG;
+        }
+        *dst++ = *src++;
+      } else if (quote == '"') {
+        if (c == '"') {
+          quote = '\0';
+        } else {
+          *dst++ = c;
+        }
+      } else if (c == '"' || c == '\'') {
+        quote = c;
+      } else if (prv_is_space(c)) {
+        break;
+      } else {
+        *dst++ = c;
+      }
+    }
+
+    if (quote != '\0') {
+      return -EBADMSG;
+    }
+
+    // Separator (or the end of line) was read, so dst is at most src
+    *dst = '\0';
+  }
+
+  return argc;
+}
+
+int frpp_shell_execute(struct frpp_shell *shell, char *line) {
+  if (shell == NULL || line == NULL) {
+    return -EINVAL;
+  }
+
+  char *argv[FRPP_SHELL_ARGC_MAX];
+
+  int argc = frpp_shell_tokenize(line, argv, FRPP_SHELL_ARGC_MAX);
+  if (argc < 0) {
+    return argc;
+  }
+
+  if (argc == 0) {
+    return -ENODATA;
+  }
+
+  const struct frpp_shell_cmd *cmd =
+      frpp_shell_find(shell->table, argv[0], strlen(argv[0]));
+  if (cmd == NULL) {
+    return -ENOENT;
+  }
+
+  return cmd->handler(shell, argc, argv);
+}
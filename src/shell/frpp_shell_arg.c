@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_shell_arg.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/shell/frpp_shell_arg.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stddef.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/* Significant digits kept by frpp_shell_arg_float, fits in uint64_t.  Far
+ * past float's precision, so dropping the rest can't change the result. */
+#define PRV_FLOAT_DIGITS (18U)
+
+/* Exponents past this over/underflow float whatever the mantissa */
+#define PRV_FLOAT_EXP_MAX (100)
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/* Powers of ten exactly representable as double */
+static const double prv_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/* Spellings of true and false accepted by frpp_shell_arg_bool */
+static const struct {
+  const char *name;
+  bool value;
+} prv_bools[] = {
+    {"1", true},   {"0", false},  {"true", true}, {"false", false},
+    {"on", true},  {"off", false}, {"yes", true}, {"no", false},
+};
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Value of a hexadecimal digit
+ *
+ * @return Value, or -1 if c isn't a hexadecimal digit
+ */
+static inline int prv_hex_digit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+
+  // Fold case
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+
+  return -1;
+}
+
+/**
+ * @brief Compare ignoring ASCII case
+ */
+static bool prv_equal_nocase(const char *a, const char *b) {
+  for (; *a != '\0' && *b != '\0'; a++, b++) {
+    char ca = (*a >= 'A' && *a <= 'Z') ? (char)(*a | 0x20) : *a;
+    if (ca != *b) {
+      return false;
+    }
+  }
+
+  return *a == *b;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_shell_arg_int(const char *arg, int32_t *value) {
+  if (arg == NULL || value == NULL) {
+    return -EINVAL;
+  }
+
+  bool negative = (*arg == '-');
+  if (*arg == '-' || *arg == '+') {
+    arg++;
+  }
+
+  if (*arg == '\0') {
+    return -EINVAL;
+  }
+
+  // Accumulate magnitude, INT32_MIN's magnitude is one more than INT32_MAX's
+  uint32_t limit = (uint32_t)INT32_MAX + (negative ? 1U : 0U);
+  uint32_t mag = 0;
+
+  for (; *arg != '\0'; arg++) {
+    uint32_t digit = (uint32_t)(*arg - '0');
+    if (digit > 9) {
+      return -EINVAL;
+    }
+
+    if (mag > (limit - digit) / 10) {
+      return -ERANGE;
+    }
+
+    mag = mag * 10 + digit;
+  }
+
+  *value = negative ? (int32_t)(0U - mag) : (int32_t)mag;
+
+  return 0;
+}
+
+int frpp_shell_arg_hex(const char *arg, uint32_t *value) {
+  if (arg == NULL || value == NULL) {
+    return -EINVAL;
+  }
+
+  if (arg[0] == '0' && (arg[1] | 0x20) == 'x') {
+    arg += 2;
+  }
+
+  if (*arg == '\0') {
+    return -EINVAL;
+  }
+
+  uint32_t ret = 0;
+
+  for (; *arg != '\0'; arg++) {
+    int digit = prv_hex_digit(*arg);
+    if (digit < 0) {
+      return -EINVAL;
+    }
+
+    if (ret > (UINT32_MAX >> 4)) {
+      return -ERANGE;
+    }
+
+    ret = (ret << 4) | (uint32_t)digit;
+  }
+
+  *value = ret;
+
+  return 0;
+}
+
+int frpp_shell_arg_float(const char *arg, float *value) {
+  if (arg == NULL || value == NULL) {
+    return -EINVAL;
+  }
+
+  bool negative = (*arg == '-');
+  if (*arg == '-' || *arg == '+') {
+    arg++;
+  }
+
+  uint64_t mant = 0;
+  size_t sig = 0;
+  size_t digits = 0;
+  int exp = 0;
+
+  // Integer part, digits past the significant ones only scale the value
+  for (; *arg >= '0' && *arg <= '9'; arg++, digits++) {
+    if (sig < PRV_FLOAT_DIGITS) {
+      mant = mant * 10 + (uint64_t)(*arg - '0');
+      sig += (mant != 0);
+    } else {
+      exp++;
+    }
+  }
+
+  // Fraction, digits past the significant ones are dropped
+  if (*arg == '.') {
+    for (arg++; *arg >= '0' && *arg <= '9'; arg++, digits++) {
+      if (sig < PRV_FLOAT_DIGITS) {
+        mant = mant * 10 + (uint64_t)(*arg - '0');
+        sig += (mant != 0);
+        exp--;
+      }
+    }
+  }
+
+  if (digits == 0) {
+    return -EINVAL;
+  }
+
+  if ((*arg | 0x20) == 'e') {
+    arg++;
+
+    bool exp_negative = (*arg == '-');
+    if (*arg == '-' || *arg == '+') {
+      arg++;
+    }
+
+    if (*arg < '0' || *arg > '9') {
+      return -EINVAL;
+    }
+
+    int e = 0;
+    for (; *arg >= '0' && *arg <= '9'; arg++) {
+      if (e < PRV_FLOAT_EXP_MAX * 2) {
+        e = e * 10 + (*arg - '0');
+      }
+    }
+
+    exp += exp_negative ? -e : e;
+  }
+
+  if (*arg != '\0') {
+    return -EINVAL;
+  }
+
+  float ret = 0.0f;
+
+  if (mant != 0) {
+    if (exp > PRV_FLOAT_EXP_MAX || exp < -PRV_FLOAT_EXP_MAX) {
+      return -ERANGE;
+    }
+
+    // Scale in double, in steps of the largest exactly representable power
+    // of ten.  Each step's error is far below float's precision, so the
+    // only rounding that matters is the final one to float.
+    const int step = (int)(sizeof(prv_pow10) / sizeof(prv_pow10[0])) - 1;
+    double scaled = (double)mant;
+
+    for (; exp > step; exp -= step) {
+      scaled *= prv_pow10[step];
+    }
+
+    for (; exp < -step; exp += step) {
+      scaled /= prv_pow10[step];
+    }
+
+    scaled = (exp >= 0) ? scaled * prv_pow10[exp] : scaled / prv_pow10[-exp];
+    ret = (float)scaled;
+
+    if (isinf(ret) || ret == 0.0f) {
+      return -ERANGE;
+    }
+  }
+
+  *value = negative ? -ret : ret;
+
+  return 0;
+}
+
+int frpp_shell_arg_bool(const char *arg, bool *value) {
+  if (arg == NULL || value == NULL) {
+    return -EINVAL;
+  }
+
+  for (size_t i = 0; i < sizeof(prv_bools) / sizeof(prv_bools[0]); i++) {
+    if (prv_equal_nocase(arg, prv_bools[i].name)) {
+      *value = prv_bools[i].value;
+      return 0;
+    }
+  }
+
+  return -EINVAL;
+}
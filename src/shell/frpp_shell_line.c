@@ -0,0 +1,603 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_shell_line.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/shell/frpp_shell_line.h"
+
+#include <errno.h>
+#include <string.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define PRV_CTRL(c_) ((uint8_t)((c_) & 0x1F))
+
+#define PRV_ESC_PARAM_MAX (99U)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Escape sequence state
+ */
+enum prv_esc {
+  PRV_ESC_NONE = 0,
+  PRV_ESC_START,
+  PRV_ESC_CSI,
+  PRV_ESC_SS3,
+};
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Queue echo.  Dropped entirely if it doesn't fit, so escape
+ * sequences are never cut short.
+ *
+ * @param line Line editor instance
+ * @param data Bytes to echo
+ * @param len Number of bytes
+ */
+static void prv_echo(struct frpp_shell_line *line, const void *data,
+                     size_t len) {
+  size_t head = atomic_load_explicit(&line->echo_head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&line->echo_tail, memory_order_acquire);
+
+  if (len > FRPP_SHELL_LINE_ECHO_SIZE - (head - tail)) {
+    atomic_fetch_add_explicit(&line->echo_dropped, len, memory_order_relaxed);
+    return;
+  }
+
+  size_t off = head & (FRPP_SHELL_LINE_ECHO_SIZE - 1);
+  size_t first = FRPP_SHELL_LINE_ECHO_SIZE - off;
+
+  if (first > len) {
+    first = len;
+  }
+
+  memcpy(&line->echo[off], data, first);
+  memcpy(&line->echo[0], (const uint8_t *)data + first, len - first);
+
+  atomic_store_explicit(&line->echo_head, head + len, memory_order_release);
+}
+
+static inline void prv_echo_str(struct frpp_shell_line *line,
+                                const char *str) {
+  prv_echo(line, str, strlen(str));
+}
+
+/**
+ * @brief Echo a cursor movement
+ *
+ * @param line Line editor instance
+ * @param count Columns to move
+ * @param dir 'C' for right, 'D' for left
+ */
+static void prv_echo_move(struct frpp_shell_line *line, uint16_t count,
+                          char dir) {
+  char seq[2 + 5 + 1];
+  char digits[5];
+  size_t len = 0;
+  size_t ndigits = 0;
+
+  if (count == 0) {
+    return;
+  }
+
+  do {
+    digits[ndigits++] = (char)('0' + (count % 10));
+    count /= 10;
+  } while (count != 0);
+
+  seq[len++] = '\x1b';
+  seq[len++] = '[';
+
+  while (ndigits != 0) {
+    seq[len++] = digits[--ndigits];
+  }
+
+  seq[len++] = dir;
+
+  prv_echo(line, seq, len);
+}
+
+/**
+ * @brief Redraw line from cursor to end, clearing anything past the end,
+ * and put the cursor back
+ *
+ * @param line Line editor instance
+ */
+static void prv_redraw_tail(struct frpp_shell_line *line) {
+  prv_echo(line, &line->buf[line->cursor], line->len - line->cursor);
+  prv_echo_str(line, "\x1b[K");
+  prv_echo_move(line, line->len - line->cursor, 'D');
+}
+
+/**
+ * @brief Replace whole line
+ *
+ * @param line Line editor instance
+ * @param src New line (need not be NULL terminated)
+ * @param len Length of new line
+ */
+static void prv_replace(struct frpp_shell_line *line, const char *src,
+                        uint16_t len) {
+  prv_echo_move(line, line->cursor, 'D');
+
+  memmove(line->buf, src, len);
+  line->len = len;
+  line->cursor = len;
+
+  prv_echo(line, line->buf, len);
+  prv_echo_str(line, "\x1b[K");
+}
+
+static void prv_insert(struct frpp_shell_line *line, char c) {
+  if (line->len >= FRPP_SHELL_LINE_MAX - 1) {
+    prv_echo_str(line, "\a");
+    return;
+  }
+
+  memmove(&line->buf[line->cursor + 1], &line->buf[line->cursor],
+          line->len - line->cursor);
+  line->buf[line->cursor] = c;
+  line->len++;
+
+  prv_echo(line, &line->buf[line->cursor], line->len - line->cursor);
+  line->cursor++;
+  prv_echo_move(line, line->len - line->cursor, 'D');
+}
+
+/**
+ * @brief Delete characters
+ *
+ * @param line Line editor instance
+ * @param start First character to delete
+ * @param count Number of characters
+ */
+static void prv_delete(struct frpp_shell_line *line, uint16_t start,
+                       uint16_t count) {
+  if (count == 0) {
+    return;
+  }
+
+  memmove(&line->buf[start], &line->buf[start + count],
+          line->len - start - count);
+  line->len -= count;
+
+  prv_echo_move(line, line->cursor - start, 'D');
+  line->cursor = start;
+  prv_redraw_tail(line);
+}
+
+static void prv_left(struct frpp_shell_line *line) {
+  if (line->cursor > 0) {
+    line->cursor--;
+    prv_echo_move(line, 1, 'D');
+  }
+}
+
+static void prv_right(struct frpp_shell_line *line) {
+  if (line->cursor < line->len) {
+    line->cursor++;
+    prv_echo_move(line, 1, 'C');
+  }
+}
+
+static void prv_home(struct frpp_shell_line *line) {
+  prv_echo_move(line, line->cursor, 'D');
+  line->cursor = 0;
+}
+
+static void prv_end(struct frpp_shell_line *line) {
+  prv_echo_move(line, line->len - line->cursor, 'C');
+  line->cursor = line->len;
+}
+
+#if FRPP_SHELL_LINE_HISTORY
+/**
+ * @brief Show history entry
+ *
+ * @param line Line editor instance
+ * @param pos Entry (1 is most recent), 0 for the stashed line
+ */
+static void prv_hist_show(struct frpp_shell_line *line, uint8_t pos) {
+  if (pos == 0) {
+    prv_replace(line, line->stash, line->stash_len);
+  } else {
+    const char *entry =
+        line->hist[(line->hist_head + FRPP_SHELL_LINE_HISTORY - pos) %
+                   FRPP_SHELL_LINE_HISTORY];
+    prv_replace(line, entry, (uint16_t)strlen(entry));
+  }
+
+  line->hist_pos = pos;
+}
+
+static void prv_hist_up(struct frpp_shell_line *line) {
+  if (line->hist_pos >= line->hist_count) {
+    return;
+  }
+
+  if (line->hist_pos == 0) {
+    memcpy(line->stash, line->buf, line->len);
+    line->stash_len = line->len;
+  }
+
+  prv_hist_show(line, line->hist_pos + 1);
+}
+
+static void prv_hist_down(struct frpp_shell_line *line) {
+  if (line->hist_pos == 0) {
+    return;
+  }
+
+  prv_hist_show(line, line->hist_pos - 1);
+}
+
+/**
+ * @brief Add completed line to history, unless blank or a repeat of the
+ * most recent entry
+ *
+ * @param line Line editor instance
+ */
+static void prv_hist_push(struct frpp_shell_line *line) {
+  line->hist_pos = 0;
+
+  if (line->len == 0) {
+    return;
+  }
+
+  if (line->hist_count != 0) {
+    const char *last =
+        line->hist[(line->hist_head + FRPP_SHELL_LINE_HISTORY - 1) %
+                   FRPP_SHELL_LINE_HISTORY];
+    if (strcmp(last, line->buf) == 0) {
+      return;
+    }
+  }
+
+  memcpy(line->hist[line->hist_head], line->buf, line->len + 1U);
+  line->hist_head = (line->hist_head + 1) % FRPP_SHELL_LINE_HISTORY;
+
+  if (line->hist_count < FRPP_SHELL_LINE_HISTORY) {
+    line->hist_count++;
+  }
+}
+#else
+static void prv_hist_up(struct frpp_shell_line *line) { (void)line; }
+static void prv_hist_down(struct frpp_shell_line *line) { (void)line; }
+static void prv_hist_push(struct frpp_shell_line *line) { (void)line; }
+#endif
+
+/**
+ * @brief Complete command name before the cursor
+ *
+ * @param line Line editor instance
+ */
+static void prv_complete(struct frpp_shell_line *line) {
+  struct frpp_shell_match match;
+  uint16_t start = 0;
+
+  while (start < line->len && line->buf[start] == ' ') {
+    start++;
+  }
+
+  // Only the command name is completed, and only from its end
+  bool name = (line->table != NULL && line->cursor == line->len);
+  for (uint16_t i = start; name && i < line->len; i++) {
+    name = (line->buf[i] != ' ');
+  }
+
+  if (!name) {
+    prv_echo_str(line, "\a");
+    return;
+  }
+
+  size_t typed = line->len - start;
+  int count = frpp_shell_complete(line->table, &line->buf[start], typed,
+                                  &match);
+
+  if (count <= 0 || (count > 1 && match.common == typed)) {
+    prv_echo_str(line, "\a");
+    return;
+  }
+
+  const char *cmd = frpp_shell_match_get(&match, 0)->name;
+
+  for (size_t i = typed; i < match.common; i++) {
+    prv_insert(line, cmd[i]);
+  }
+
+  if (count == 1) {
+    prv_insert(line, ' ');
+  }
+}
+
+/**
+ * @brief Start a new line and echo the prompt
+ *
+ * @param line Line editor instance
+ */
+static void prv_reset(struct frpp_shell_line *line) {
+  line->buf[0] = '\0';
+  line->len = 0;
+  line->cursor = 0;
+  line->esc = PRV_ESC_NONE;
+
+#if FRPP_SHELL_LINE_HISTORY
+  line->hist_pos = 0;
+#endif
+
+  if (line->prompt != NULL) {
+    prv_echo_str(line, line->prompt);
+  }
+}
+
+/**
+ * @brief Handle final byte of a CSI or SS3 sequence
+ *
+ * @param line Line editor instance
+ * @param byte Final byte
+ */
+static void prv_escape_final(struct frpp_shell_line *line, uint8_t byte) {
+  switch (byte) {
+  case 'A':
+    prv_hist_up(line);
+    break;
+  case 'B':
+    prv_hist_down(line);
+    break;
+  case 'C':
+    prv_right(line);
+    break;
+  case 'D':
+    prv_left(line);
+    break;
+  case 'H':
+    prv_home(line);
+    break;
+  case 'F':
+    prv_end(line);
+    break;
+  case '~':
+    switch (line->esc_param) {
+    case 1:
+    case 7:
+      prv_home(line);
+      break;
+    case 4:
+    case 8:
+      prv_end(line);
+      break;
+    case 3:
+      if (line->cursor < line->len) {
+        prv_delete(line, line->cursor, 1);
+      }
+      break;
+    default:
+      break;
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * @brief Advance escape sequence state machine
+ *
+ * @param line Line editor instance
+ * @param byte Input byte
+ */
+static void prv_escape(struct frpp_shell_line *line, uint8_t byte) {
+  switch (line->esc) {
+  case PRV_ESC_START:
+    line->esc_param = 0;
+    line->esc = (byte == '[')   ? PRV_ESC_CSI
+                : (byte == 'O') ? PRV_ESC_SS3
+                                : PRV_ESC_NONE;
+    break;
+
+  case PRV_ESC_CSI:
+    if (byte >= '0' && byte <= '9') {
+      unsigned int param = line->esc_param * 10U + (byte - '0');
+      line->esc_param =
+          (uint8_t)(param > PRV_ESC_PARAM_MAX ? PRV_ESC_PARAM_MAX : param);
+    } else if (byte >= 0x40 && byte <= 0x7E) {
+      line->esc = PRV_ESC_NONE;
+      prv_escape_final(line, byte);
+    } else if (byte < 0x20 || byte > 0x3F) {
+      // Not part of a CSI sequence, abandon it
+      line->esc = PRV_ESC_NONE;
+    }
+    break;
+
+  case PRV_ESC_SS3:
+  default:
+    line->esc = PRV_ESC_NONE;
+    prv_escape_final(line, byte);
+    break;
+  }
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_shell_line_init(struct frpp_shell_line *line, const char *prompt) {
+  if (line == NULL) {
+    return -EINVAL;
+  }
+
+  memset(line, 0, sizeof(*line));
+  atomic_init(&line->echo_head, 0);
+  atomic_init(&line->echo_tail, 0);
+  atomic_init(&line->echo_dropped, 0);
+  atomic_init(&line->ready, false);
+
+  line->prompt = prompt;
+  prv_reset(line);
+
+  return 0;
+}
+
+int frpp_shell_line_set_table(struct frpp_shell_line *line,
+                              const struct frpp_shell_table *table) {
+  if (line == NULL) {
+    return -EINVAL;
+  }
+
+  line->table = table;
+
+  return 0;
+}
+
+int frpp_shell_line_feed(struct frpp_shell_line *line, uint8_t byte) {
+  if (line == NULL) {
+    return -EINVAL;
+  }
+
+  if (atomic_load_explicit(&line->ready, memory_order_acquire)) {
+    return -EBUSY;
+  }
+
+  bool last_cr = line->last_cr;
+  line->last_cr = false;
+
+  if (line->esc != PRV_ESC_NONE) {
+    prv_escape(line, byte);
+    return 0;
+  }
+
+  switch (byte) {
+  case '\n':
+    if (last_cr) {
+      return 0;
+    }
+    // fall through
+  case '\r':
+    line->last_cr = (byte == '\r');
+    line->buf[line->len] = '\0';
+    prv_echo_str(line, "\r\n");
+    prv_hist_push(line);
+    atomic_store_explicit(&line->ready, true, memory_order_release);
+    return FRPP_SHELL_LINE_READY;
+
+  case 0x1B:
+    line->esc = PRV_ESC_START;
+    break;
+
+  case 0x7F:
+  case '\b':
+    if (line->cursor > 0) {
+      prv_delete(line, line->cursor - 1, 1);
+    }
+    break;
+
+  case PRV_CTRL('D'):
+    if (line->cursor < line->len) {
+      prv_delete(line, line->cursor, 1);
+    }
+    break;
+
+  case PRV_CTRL('A'):
+    prv_home(line);
+    break;
+  case PRV_CTRL('E'):
+    prv_end(line);
+    break;
+  case PRV_CTRL('B'):
+    prv_left(line);
+    break;
+  case PRV_CTRL('F'):
+    prv_right(line);
+    break;
+  case PRV_CTRL('P'):
+    prv_hist_up(line);
+    break;
+  case PRV_CTRL('N'):
+    prv_hist_down(line);
+    break;
+
+  case PRV_CTRL('K'):
+    prv_delete(line, line->cursor, line->len - line->cursor);
+    break;
+  case PRV_CTRL('U'):
+    prv_delete(line, 0, line->cursor);
+    break;
+
+  case PRV_CTRL('C'):
+    prv_echo_str(line, "^C\r\n");
+    prv_reset(line);
+    break;
+
+  case '\t':
+    prv_complete(line);
+    break;
+
+  default:
+    if (byte >= 0x20 && byte < 0x7F) {
+      prv_insert(line, (char)byte);
+    }
+    break;
+  }
+
+  return 0;
+}
+
+char *frpp_shell_line_get(struct frpp_shell_line *line) {
+  if (line == NULL ||
+      !atomic_load_explicit(&line->ready, memory_order_acquire)) {
+    return NULL;
+  }
+
+  return line->buf;
+}
+
+void frpp_shell_line_next(struct frpp_shell_line *line) {
+  if (line == NULL) {
+    return;
+  }
+
+  prv_reset(line);
+  atomic_store_explicit(&line->ready, false, memory_order_release);
+}
+
+size_t frpp_shell_line_echo(struct frpp_shell_line *line, void *out,
+                            size_t size) {
+  if (line == NULL || out == NULL) {
+    return 0;
+  }
+
+  size_t tail = atomic_load_explicit(&line->echo_tail, memory_order_relaxed);
+  size_t head = atomic_load_explicit(&line->echo_head, memory_order_acquire);
+  size_t len = head - tail;
+
+  if (len > size) {
+    len = size;
+  }
+
+  size_t off = tail & (FRPP_SHELL_LINE_ECHO_SIZE - 1);
+  size_t first = FRPP_SHELL_LINE_ECHO_SIZE - off;
+
+  if (first > len) {
+    first = len;
+  }
+
+  memcpy(out, &line->echo[off], first);
+  memcpy((uint8_t *)out + first, &line->echo[0], len - first);
+
+  atomic_store_explicit(&line->echo_tail, tail + len, memory_order_release);
+
+  return len;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_shell_out.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/shell/frpp_shell_out.h"
+
+#include <errno.h>
+#include <limits.h>
+
+#include "frpp/sys/frpp_printf.h"
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_shell_out_init(struct frpp_shell_out *out, void *ring,
+                        size_t ring_size, frpp_shell_write_t write, void *ctx) {
+  if (out == NULL || write == NULL) {
+    return -EINVAL;
+  }
+
+  int ret = frpp_log_queue_init(&out->queue, ring, ring_size);
+  if (ret < 0) {
+    return ret;
+  }
+
+  out->write = write;
+  out->ctx = ctx;
+  out->len = 0;
+  out->pos = 0;
+
+  return 0;
+}
+
+int frpp_shell_out_printf(struct frpp_shell_out *out, const char *fmt_str,
+                          ...) {
+  va_list args;
+  va_start(args, fmt_str);
+
+  int ret = frpp_shell_out_vprintf(out, fmt_str, args);
+
+  va_end(args);
+
+  return ret;
+}
+
+int frpp_shell_out_vprintf(struct frpp_shell_out *out, const char *fmt_str,
+                           va_list args) {
+  if (out == NULL) {
+    return -EINVAL;
+  }
+
+  // Handlers commonly print their arguments, which don't outlive them
+  return frpp_log_queue_vprintf_ex(
+      &out->queue,
+      FRPP_PRINTF_FLAG_CAPTURE_STR |
+          FRPP_PRINTF_FLAG_STR_CAP(FRPP_SHELL_OUT_STR_CAP),
+      fmt_str, args);
+}
+
+int frpp_shell_out_poll(struct frpp_shell_out *out) {
+  if (out == NULL) {
+    return -EINVAL;
+  }
+
+  size_t written = 0;
+
+  for (;;) {
+    if (out->pos == out->len) {
+      size_t len = 0;
+
+      int ret = frpp_log_queue_render_batch(&out->queue, out->buf,
+                                            sizeof(out->buf), &len);
+      if (ret == -EAGAIN) {
+        break;
+      }
+
+      // A record that couldn't be rendered was dropped, go on to the next
+      if (ret < 0) {
+        continue;
+      }
+
+      out->len = len;
+      out->pos = 0;
+      continue;
+    }
+
+    size_t count = out->write(out->ctx, &out->buf[out->pos],
+                              out->len - out->pos);
+    if (count == 0) {
+      break;
+    }
+
+    out->pos += count;
+    written += count;
+  }
+
+  return (written > INT_MAX) ? INT_MAX : (int)written;
+}
+
+bool frpp_shell_out_idle(struct frpp_shell_out *out) {
+  if (out == NULL) {
+    return true;
+  }
+
+  struct frpp_log_record record;
+
+  return out->pos == out->len &&
+         frpp_log_queue_peek(&out->queue, &record) == -EAGAIN;
+}
@@ -11,110 +11,1852 @@
 #include "frpp/sys/frpp_printf.h"
 
 #include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#include <wchar.h>
 
+#include "frpp/sys/frpp_printf_cache.h"
+#include "frpp/sys/frpp_printf_parse.h"
+#include "frpp/sys/frpp_printf_stats.h"
 #include "frpp/utils/utils.h"
 
 /*****************************************************************************
  * Definitions
  *****************************************************************************/
 
-#define FRPP_HANDLE_BUF_OVERRUN(dst_, len_, idx_, type_)                       \
+/**
+ * @brief Digits needed for the largest integer in the smallest base (octal)
+ */
+#define FRPP_PRINTF_INT_DIGITS_MAX ((sizeof(uintmax_t) * 8 + 2) / 3)
+
+/**
+ * @brief Longest specifier forwarded to libc for floating point and wide
+ * character conversions
+ */
+#define FRPP_PRINTF_SPEC_MAX (32U)
+
+/**
+ * @brief Captured string entry tag for strings stored by pointer.  Other tag
+ * values are the length of the inline copy that follows.
+ */
+#define FRPP_PRINTF_CAPTURE_BY_PTR (0xFFU)
+
+/**
+ * @brief Largest cap on captured string length
+ */
+#define FRPP_PRINTF_CAPTURE_CAP_MAX (0xFEU)
+
+/**
+ * @brief Largest encoding of a single fixed size argument in a dense package
+ * (a varint of uintmax_t, or a long double)
+ */
+#define FRPP_PRINTF_DENSE_ARG_MAX                                              \
+  FRPP_MAX((sizeof(uintmax_t) * 8 + 6) / 7, sizeof(long double))
+
+#define FRPP_WRITE_ARG(dst_, args_, idx_, type_)                               \
   do {                                                                         \
-    if (dst_ && ((idx_ + sizeof(type_) > len_)))                               \
-      return -ENOSPC;                                                          \
+    *(type_ *)(((uint8_t *)dst_) + idx_) = va_arg(args_, type_);               \
   } while (0);
 
-#define FRPP_WRITE_ARG(dst_, args_, idx_, type_)                               \
-  do {                                                                         \
-    if (dst_)                                                                  \
-      *(type_ *)(((uint8_t *)dst_) + idx_) = va_arg(args_, type_);             \
-  } while (0);
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Renderer output state.  pos keeps counting past size so the return
+ * value matches snprintf.
+ */
+struct prv_out {
+  char *buf;
+  size_t size;
+  size_t pos;
+};
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Registered read-only ranges, [start, end)
+ */
+static struct {
+  uintptr_t start;
+  uintptr_t end;
+} prv_ro_ranges[FRPP_PRINTF_RO_RANGES_MAX];
+
+static size_t prv_ro_range_count;
+
+/**
+ * @brief Specifier standing in for '*' width and precision arguments, which
+ * are ints
+ */
+static const struct frpp_printf_spec prv_star_spec = {
+    .arg = FRPP_PRINTF_ARG_INT,
+    .conversion = 'd',
+    .width = -1,
+    .precision = -1,
+};
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Length of a string, looking at no more than max characters.  Same
+ * as POSIX strnlen, which C11 doesn't have.
+ *
+ * @param str String
+ * @param max Most characters to look at
+ * @return Length of str, or max if it has no terminator within max
+ */
+static inline size_t prv_strnlen(const char *str, size_t max) {
+  size_t len = 0;
+
+  while (len < max && str[len] != '\0') {
+    len++;
+  }
+
+  return len;
+}
+
+/**
+ * @brief Append a character to output, counting it even if it doesn't fit
+ *
+ * @param out Output state
+ * @param c Character
+ */
+static inline void prv_out_char(struct prv_out *out, char c) {
+  if (out->pos + 1 < out->size) {
+    out->buf[out->pos] = c;
+  }
+  out->pos++;
+}
+
+/**
+ * @brief Append a run of characters to output
+ *
+ * @param out Output state
+ * @param str Characters
+ * @param len Number of characters
+ */
+static inline void prv_out_str(struct prv_out *out, const char *str,
+                               size_t len) {
+  if (len == 0) {
+    return;
+  }
+
+  if (out->pos + 1 < out->size) {
+    size_t room = out->size - 1 - out->pos;
+    memcpy(out->buf + out->pos, str, (len < room) ? len : room);
+  }
+  out->pos += len;
+}
+
+/**
+ * @brief Append a character repeated count times
+ *
+ * @param out Output state
+ * @param c Character
+ * @param count Number of repetitions
+ */
+static void prv_out_fill(struct prv_out *out, char c, int count) {
+  if (count <= 0) {
+    return;
+  }
+
+  if (out->pos + 1 < out->size) {
+    size_t room = out->size - 1 - out->pos;
+    memset(out->buf + out->pos, c, ((size_t)count < room) ? (size_t)count : room);
+  }
+  out->pos += (size_t)count;
+}
+
+/**
+ * @brief Append a field, padded to the specifier's width
+ *
+ * @param out Output state
+ * @param spec Specifier
+ * @param prefix Sign/radix prefix emitted before zero padding
+ * @param prefix_len Length of prefix
+ * @param zeros Leading zeros required by precision
+ * @param body Field contents
+ * @param body_len Length of field contents
+ */
+static void prv_out_field(struct prv_out *out,
+                          const struct frpp_printf_spec *spec,
+                          const char *prefix, size_t prefix_len, int zeros,
+                          const char *body, size_t body_len) {
+  int len = (int)(prefix_len + body_len) + zeros;
+  int pad = (spec->width > len) ? (spec->width - len) : 0;
+
+  if (pad == 0 && zeros == 0) {
+    prv_out_str(out, prefix, prefix_len);
+    prv_out_str(out, body, body_len);
+  } else if (spec->flags & FRPP_PRINTF_SPEC_LEFT) {
+    prv_out_str(out, prefix, prefix_len);
+    prv_out_fill(out, '0', zeros);
+    prv_out_str(out, body, body_len);
+    prv_out_fill(out, ' ', pad);
+  } else if (spec->flags & FRPP_PRINTF_SPEC_ZERO) {
+    prv_out_str(out, prefix, prefix_len);
+    prv_out_fill(out, '0', zeros + pad);
+    prv_out_str(out, body, body_len);
+  } else {
+    prv_out_fill(out, ' ', pad);
+    prv_out_str(out, prefix, prefix_len);
+    prv_out_fill(out, '0', zeros);
+    prv_out_str(out, body, body_len);
+  }
+}
+
+/**
+ * @brief Read an integer argument from package, truncated to the width of
+ * its length modifier
+ *
+ * @param spec Specifier
+ * @param arg Pointer to argument in package
+ * @param is_signed Whether conversion is signed
+ * @return Argument widened to uintmax_t (sign extended if signed)
+ */
+static uintmax_t prv_read_int(const struct frpp_printf_spec *spec,
+                              const uint8_t *arg, bool is_signed) {
+#define PRV_READ(type_, utype_)                                                \
+  do {                                                                         \
+    type_ v_;                                                                  \
+    memcpy(&v_, arg, sizeof(v_));                                              \
+    return is_signed ? (uintmax_t)(intmax_t)v_ : (uintmax_t)(utype_)v_;        \
+  } while (0)
+
+  switch (spec->arg) {
+  case FRPP_PRINTF_ARG_LONG:
+    PRV_READ(long, unsigned long);
+  case FRPP_PRINTF_ARG_LONG_LONG:
+    PRV_READ(long long, unsigned long long);
+  case FRPP_PRINTF_ARG_SIZE:
+    PRV_READ(ptrdiff_t, size_t);
+  case FRPP_PRINTF_ARG_PTRDIFF:
+    PRV_READ(ptrdiff_t, size_t);
+  case FRPP_PRINTF_ARG_INTMAX:
+    PRV_READ(intmax_t, uintmax_t);
+  default:
+    break;
+  }
+
+  switch (spec->length) {
+  case FRPP_PRINTF_LEN_HH:
+    PRV_READ(signed char, unsigned char);
+  case FRPP_PRINTF_LEN_H:
+    PRV_READ(short, unsigned short);
+  default:
+    PRV_READ(int, unsigned int);
+  }
+
+#undef PRV_READ
+}
+
+/**
+ * @brief Render an integer conversion
+ *
+ * @param out Output state
+ * @param spec Specifier
+ * @param val Value (sign extended for signed conversions)
+ */
+static void prv_render_int(struct prv_out *out,
+                           const struct frpp_printf_spec *spec,
+                           uintmax_t val) {
+  char digits[FRPP_PRINTF_INT_DIGITS_MAX];
+  char prefix[2];
+  size_t prefix_len = 0;
+  size_t len;
+  unsigned int base = 10;
+  const char *alphabet = "0123456789abcdef";
+
+  switch (spec->conversion) {
+  case 'd':
+  case 'i':
+    if ((intmax_t)val < 0) {
+      prefix[prefix_len++] = '-';
+      val = (uintmax_t)0 - val;
+    } else if (spec->flags & FRPP_PRINTF_SPEC_PLUS) {
+      prefix[prefix_len++] = '+';
+    } else if (spec->flags & FRPP_PRINTF_SPEC_SPACE) {
+      prefix[prefix_len++] = ' ';
+    }
+    break;
+
+  case 'o':
+    base = 8;
+    break;
+
+  case 'X':
+    alphabet = "0123456789ABCDEF";
+    // fall through
+  case 'x':
+  case 'p':
+    base = 16;
+    if ((spec->flags & FRPP_PRINTF_SPEC_ALT) && val != 0) {
+      prefix[prefix_len++] = '0';
+      prefix[prefix_len++] = (spec->conversion == 'X') ? 'X' : 'x';
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  // Digits are generated least significant first from the end of the buffer.
+  // Bases are constant per loop so division reduces to multiplies and shifts.
+  char *end = digits + sizeof(digits);
+  char *dig = end;
+  if (base == 10) {
+    while (val > UINT32_MAX) {
+      *--dig = (char)('0' + (val % 10U));
+      val /= 10U;
+    }
+    for (uint32_t v = (uint32_t)val; v != 0; v /= 10U) {
+      *--dig = (char)('0' + (v % 10U));
+    }
+  } else if (base == 16) {
+    for (; val != 0; val >>= 4) {
+      *--dig = alphabet[val & 0xFU];
+    }
+  } else {
+    for (; val != 0; val >>= 3) {
+      *--dig = (char)('0' + (val & 0x7U));
+    }
+  }
+  len = (size_t)(end - dig);
+
+  int zeros = 0;
+  if (spec->precision >= 0) {
+    zeros = (spec->precision > (int)len) ? (spec->precision - (int)len) : 0;
+  } else if (len == 0) {
+    // Zero is printed as a single digit unless precision is explicitly 0
+    zeros = 1;
+  }
+
+  // Alternate octal form guarantees a leading zero
+  if (base == 8 && (spec->flags & FRPP_PRINTF_SPEC_ALT) && zeros == 0 &&
+      (len == 0 || *dig != '0')) {
+    zeros = 1;
+  }
+
+  // Zero flag is ignored when precision is given
+  struct frpp_printf_spec field = *spec;
+  if (spec->precision >= 0) {
+    field.flags &= ~FRPP_PRINTF_SPEC_ZERO;
+  }
+
+  prv_out_field(out, &field, prefix, prefix_len, zeros, dig, len);
+}
+
+/**
+ * @brief Rebuild a specifier for libc from its parsed fields, so width and
+ * precision read from arguments are inline and positions are dropped
+ *
+ * @param spec Specifier
+ * @param fmt Specifier output, FRPP_PRINTF_SPEC_MAX bytes
+ */
+static void prv_spec_fmt(const struct frpp_printf_spec *spec, char *fmt) {
+  static const char *const lengths[] = {
+      [FRPP_PRINTF_LEN_NONE] = "", [FRPP_PRINTF_LEN_HH] = "hh",
+      [FRPP_PRINTF_LEN_H] = "h",   [FRPP_PRINTF_LEN_L] = "l",
+      [FRPP_PRINTF_LEN_LL] = "ll", [FRPP_PRINTF_LEN_Z] = "z",
+      [FRPP_PRINTF_LEN_T] = "t",   [FRPP_PRINTF_LEN_J] = "j",
+      [FRPP_PRINTF_LEN_BIG_L] = "L",
+  };
+  size_t len = 0;
+
+  fmt[len++] = '%';
+
+  if (spec->flags & FRPP_PRINTF_SPEC_LEFT) {
+    fmt[len++] = '-';
+  }
+  if (spec->flags & FRPP_PRINTF_SPEC_PLUS) {
+    fmt[len++] = '+';
+  }
+  if (spec->flags & FRPP_PRINTF_SPEC_SPACE) {
+    fmt[len++] = ' ';
+  }
+  if (spec->flags & FRPP_PRINTF_SPEC_ALT) {
+    fmt[len++] = '#';
+  }
+  if (spec->flags & FRPP_PRINTF_SPEC_ZERO) {
+    fmt[len++] = '0';
+  }
+
+  // Flags, two ints, and the length and conversion always fit
+  if (spec->width >= 0) {
+    len += (size_t)snprintf(&fmt[len], FRPP_PRINTF_SPEC_MAX - len, "%d",
+                            spec->width);
+  }
+
+  if (spec->precision >= 0) {
+    len += (size_t)snprintf(&fmt[len], FRPP_PRINTF_SPEC_MAX - len, ".%d",
+                            spec->precision);
+  }
+
+  snprintf(&fmt[len], FRPP_PRINTF_SPEC_MAX - len, "%s%c",
+           lengths[spec->length], spec->conversion);
+}
+
+/**
+ * @brief Render a floating point or wide character conversion.  Correctly
+ * rounded decimal conversion and multibyte conversion are delegated to libc,
+ * one specifier at a time, with a properly typed argument so no va_list has
+ * to be reconstructed.
+ *
+ * @param out Output state
+ * @param spec Specifier
+ * @param arg Pointer to specifier's argument in package
+ */
+static void prv_render_libc(struct prv_out *out,
+                            const struct frpp_printf_spec *spec,
+                            const uint8_t *arg) {
+  char fmt[FRPP_PRINTF_SPEC_MAX];
+
+  prv_spec_fmt(spec, fmt);
+
+  char *dst = NULL;
+  size_t room = 0;
+  if (out->pos + 1 < out->size) {
+    dst = out->buf + out->pos;
+    room = out->size - out->pos;
+  }
+
+  int ret;
+
+  switch (spec->arg) {
+  case FRPP_PRINTF_ARG_LONG_DOUBLE: {
+    long double val;
+    memcpy(&val, arg, sizeof(val));
+    ret = snprintf(dst, room, fmt, val);
+    break;
+  }
+  case FRPP_PRINTF_ARG_WINT: {
+    wint_t val;
+    memcpy(&val, arg, sizeof(val));
+    ret = snprintf(dst, room, fmt, val);
+    break;
+  }
+  case FRPP_PRINTF_ARG_WSTR: {
+    const wchar_t *val;
+    memcpy(&val, arg, sizeof(val));
+    ret = snprintf(dst, room, fmt, val);
+    break;
+  }
+  default: {
+    double val;
+    memcpy(&val, arg, sizeof(val));
+    ret = snprintf(dst, room, fmt, val);
+    break;
+  }
+  }
+
+  if (ret > 0) {
+    out->pos += ret;
+  }
+}
+
+/**
+ * @brief Apply a width read from an argument.  A negative width is a '-'
+ * flag and a positive width.
+ *
+ * @param spec Specifier
+ * @param width Width argument
+ */
+static void prv_spec_width(struct frpp_printf_spec *spec, int width) {
+  if (width < 0) {
+    spec->flags |= FRPP_PRINTF_SPEC_LEFT;
+    width = (width == INT_MIN) ? INT_MAX : -width;
+  }
+
+  spec->width = width;
+}
+
+/**
+ * @brief Apply a precision read from an argument.  A negative precision is
+ * taken as if it were omitted.
+ *
+ * @param spec Specifier
+ * @param precision Precision argument
+ */
+static void prv_spec_precision(struct frpp_printf_spec *spec, int precision) {
+  spec->precision = (precision < 0) ? -1 : precision;
+}
+
+/**
+ * @brief Read an int slot from package
+ *
+ * @param arg Pointer to slot
+ * @return Value
+ */
+static inline int prv_slot_int(const uint8_t *arg) {
+  int val;
+  memcpy(&val, arg, sizeof(val));
+  return val;
+}
+
+/**
+ * @brief Render a string conversion
+ *
+ * @param out Output state
+ * @param spec Specifier
+ * @param str String
+ * @param len Length of string, already limited by precision
+ */
+static void prv_render_str(struct prv_out *out,
+                           const struct frpp_printf_spec *spec, const char *str,
+                           size_t len) {
+  struct frpp_printf_spec field = *spec;
+
+  field.flags &= ~FRPP_PRINTF_SPEC_ZERO;
+  prv_out_field(out, &field, NULL, 0, 0, str, len);
+}
+
+/**
+ * @brief Render a single conversion specifier from package
+ *
+ * @param out Output state
+ * @param spec Specifier
+ * @param arg Pointer to specifier's argument in package
+ */
+static void prv_render_spec(struct prv_out *out,
+                            const struct frpp_printf_spec *spec,
+                            const uint8_t *arg) {
+  switch (spec->conversion) {
+  case '%':
+    prv_out_char(out, '%');
+    break;
+
+  case 'd':
+  case 'i':
+    prv_render_int(out, spec, prv_read_int(spec, arg, true));
+    break;
+
+  case 'o':
+  case 'u':
+  case 'x':
+  case 'X':
+    prv_render_int(out, spec, prv_read_int(spec, arg, false));
+    break;
+
+  case 'c': {
+    if (spec->arg == FRPP_PRINTF_ARG_WINT) {
+      prv_render_libc(out, spec, arg);
+      break;
+    }
+
+    char c = (char)prv_slot_int(arg);
+    prv_out_field(out, spec, NULL, 0, 0, &c, 1);
+    break;
+  }
+
+  case 's': {
+    if (spec->arg == FRPP_PRINTF_ARG_WSTR) {
+      prv_render_libc(out, spec, arg);
+      break;
+    }
+
+    const char *str;
+    memcpy(&str, arg, sizeof(str));
+
+    if (str == NULL) {
+      // Matches glibc, which prints nothing if "(null)" would be truncated
+      str = (spec->precision < 0 || spec->precision >= 6) ? "(null)" : "";
+    }
+
+    size_t len = (spec->precision >= 0) ? prv_strnlen(str, spec->precision)
+                                        : strlen(str);
+    prv_render_str(out, spec, str, len);
+    break;
+  }
+
+  case 'p': {
+    const void *ptr;
+    memcpy(&ptr, arg, sizeof(ptr));
+
+    struct frpp_printf_spec field = *spec;
+    field.flags |= FRPP_PRINTF_SPEC_ALT;
+
+#if defined(__GLIBC__)
+    if (ptr == NULL) {
+      field.flags &= ~FRPP_PRINTF_SPEC_ZERO;
+      prv_out_field(out, &field, NULL, 0, 0, "(nil)", 5);
+      break;
+    }
+#endif
+
+    prv_render_int(out, &field, (uintmax_t)(uintptr_t)ptr);
+    break;
+  }
+
+  case 'n': {
+    void *ptr;
+    memcpy(&ptr, arg, sizeof(ptr));
+
+    if (ptr == NULL) {
+      break;
+    }
+
+    switch (spec->length) {
+    case FRPP_PRINTF_LEN_HH:
+      *(signed char *)ptr = (signed char)out->pos;
+      break;
+    case FRPP_PRINTF_LEN_H:
+      *(short *)ptr = (short)out->pos;
+      break;
+    case FRPP_PRINTF_LEN_L:
+      *(long *)ptr = (long)out->pos;
+      break;
+    case FRPP_PRINTF_LEN_LL:
+      *(long long *)ptr = (long long)out->pos;
+      break;
+    case FRPP_PRINTF_LEN_Z:
+      *(size_t *)ptr = out->pos;
+      break;
+    case FRPP_PRINTF_LEN_T:
+      *(ptrdiff_t *)ptr = (ptrdiff_t)out->pos;
+      break;
+    case FRPP_PRINTF_LEN_J:
+      *(intmax_t *)ptr = (intmax_t)out->pos;
+      break;
+    default:
+      *(int *)ptr = (int)out->pos;
+      break;
+    }
+    break;
+  }
+
+  case 'f':
+  case 'F':
+  case 'e':
+  case 'E':
+  case 'g':
+  case 'G':
+  case 'a':
+  case 'A':
+    prv_render_libc(out, spec, arg);
+    break;
+
+  default:
+    // Unknown conversions are emitted verbatim
+    prv_out_str(out, spec->start, (size_t)(spec->end - spec->start));
+    break;
+  }
+}
+
+/**
+ * @brief Size of the fixed size arguments of a package
+ *
+ * @param fmt_str Format string
+ * @return Size in bytes
+ */
+static size_t prv_fixed_size(const char *fmt_str) {
+  struct frpp_printf_signature sig;
+  if (frpp_printf_cache_lookup(fmt_str, &sig) == 0) {
+    return sig.size;
+  }
+
+  struct frpp_printf_spec spec;
+  const char *ptr = fmt_str;
+  size_t size = 0;
+
+  while ((ptr = frpp_printf_parse_next(ptr, &spec)) != NULL) {
+    frpp_printf_arg_t types[FRPP_PRINTF_SPEC_ARGS_MAX];
+    size_t count = frpp_printf_spec_args(&spec, types);
+
+    for (size_t i = 0; i < count; i++) {
+      size += frpp_printf_arg_size(types[i]);
+    }
+  }
+
+  return size;
+}
+
+/**
+ * @brief Collect positional argument types, skipping the parse for format
+ * strings without a '$'
+ *
+ * @param fmt_str Format string
+ * @param pos Argument types output
+ * @return Return value of frpp_printf_parse_positions
+ */
+static int prv_positions(const char *fmt_str,
+                         struct frpp_printf_pos_args *pos) {
+  if (strchr(fmt_str, '$') == NULL) {
+    return 0;
+  }
+
+  return frpp_printf_parse_positions(fmt_str, pos);
+}
+
+/**
+ * @brief Render a user-defined type (%@) with its hooks
+ *
+ * @param out Output state
+ * @param ops Type hooks, NULL if package held a NULL argument
+ * @param data Serialized object
+ * @param len Length of serialized object
+ */
+static void prv_render_udt(struct prv_out *out,
+                           const struct frpp_printf_udt_ops *ops,
+                           const uint8_t *data, size_t len) {
+  if (ops == NULL || ops->render == NULL) {
+    prv_out_str(out, "(null)", 6);
+    return;
+  }
+
+  // Rendered straight into output, which the hook terminates like snprintf
+  int ret = (out->pos + 1 < out->size)
+                ? ops->render(data, len, out->buf + out->pos,
+                              out->size - out->pos)
+                : ops->render(data, len, NULL, 0);
+
+  if (ret > 0) {
+    out->pos += (size_t)ret;
+  }
+}
+
+/**
+ * @brief Whether an argument has an entry in the captured area
+ *
+ * @param arg Argument type
+ * @param capture_str Whether strings were captured
+ * @return true if it has an entry
+ */
+static inline bool prv_has_entry(frpp_printf_arg_t arg, bool capture_str) {
+  return arg == FRPP_PRINTF_ARG_UDT ||
+         (capture_str && arg == FRPP_PRINTF_ARG_STR);
+}
+
+/**
+ * @brief Size of an entry in the captured area
+ *
+ * @param arg Argument type
+ * @param entry Entry
+ * @return Size in bytes
+ */
+static inline size_t prv_entry_size(frpp_printf_arg_t arg,
+                                    const uint8_t *entry) {
+  // User-defined types have no by-pointer tag, their length can be 0xFF
+  if (arg != FRPP_PRINTF_ARG_UDT && *entry == FRPP_PRINTF_CAPTURE_BY_PTR) {
+    return 1;
+  }
+
+  return 1 + (size_t)*entry;
+}
+
+/**
+ * @brief Render a specifier's value from its slot and captured entry
+ *
+ * @param out Output state
+ * @param spec Specifier, with width and precision arguments applied
+ * @param arg Pointer to value's slot in package
+ * @param entry Value's entry in the captured area, NULL if it has none
+ */
+static void prv_render_value(struct prv_out *out,
+                             const struct frpp_printf_spec *spec,
+                             const uint8_t *arg, const uint8_t *entry) {
+  if (spec->arg == FRPP_PRINTF_ARG_UDT) {
+    const struct frpp_printf_udt_ops *ops;
+    memcpy(&ops, arg, sizeof(ops));
+
+    prv_render_udt(out, ops, entry + 1, *entry);
+  } else if (entry != NULL && *entry != FRPP_PRINTF_CAPTURE_BY_PTR) {
+    size_t len = *entry;
+
+    if (spec->precision >= 0 && (size_t)spec->precision < len) {
+      len = (size_t)spec->precision;
+    }
+
+    prv_render_str(out, spec, (const char *)entry + 1, len);
+  } else {
+    prv_render_spec(out, spec, arg);
+  }
+}
+
+/**
+ * @brief Render a format string using arguments from a package
+ *
+ * @param fmt_str Format string
+ * @param flags Flags package was created with
+ * @param arg_buf Package
+ * @param out Output state
+ */
+static void prv_render(const char *fmt_str, uint32_t flags,
+                       const uint8_t *arg_buf, struct prv_out *out) {
+  const bool capture_str = (flags & FRPP_PRINTF_FLAG_CAPTURE_STR) != 0;
+  const size_t int_size = frpp_printf_arg_size(FRPP_PRINTF_ARG_INT);
+  struct frpp_printf_spec spec;
+  const char *ptr = fmt_str;
+  const char *next;
+  size_t offset = 0;
+
+  // Captured strings and user-defined types following the fixed size
+  // arguments.  Only located once an entry is needed.
+  const uint8_t *capture = NULL;
+
+  while ((next = frpp_printf_parse_next(ptr, &spec)) != NULL) {
+    const uint8_t *entry = NULL;
+
+    prv_out_str(out, ptr, (size_t)(spec.start - ptr));
+
+    // Width and precision arguments precede the value
+    if (spec.flags & FRPP_PRINTF_SPEC_WIDTH_ARG) {
+      prv_spec_width(&spec, prv_slot_int(arg_buf + offset));
+      offset += int_size;
+    }
+
+    if (spec.flags & FRPP_PRINTF_SPEC_PREC_ARG) {
+      prv_spec_precision(&spec, prv_slot_int(arg_buf + offset));
+      offset += int_size;
+    }
+
+    if (prv_has_entry(spec.arg, capture_str)) {
+      if (capture == NULL) {
+        capture = arg_buf + prv_fixed_size(fmt_str);
+      }
+
+      entry = capture;
+      capture += prv_entry_size(spec.arg, capture);
+    }
+
+    prv_render_value(out, &spec, arg_buf + offset, entry);
+
+    offset += frpp_printf_arg_size(spec.arg);
+    ptr = next;
+  }
+
+  prv_out_str(out, ptr, strlen(ptr));
+}
+
+/**
+ * @brief Render a format string with positional arguments using arguments
+ * from a package.  Slots and captured entries are in va_list order, so both
+ * are located up front.
+ *
+ * @param fmt_str Format string
+ * @param flags Flags package was created with
+ * @param pos Argument types of format string
+ * @param arg_buf Package
+ * @param out Output state
+ */
+static void prv_render_positional(const char *fmt_str, uint32_t flags,
+                                  const struct frpp_printf_pos_args *pos,
+                                  const uint8_t *arg_buf,
+                                  struct prv_out *out) {
+  const bool capture_str = (flags & FRPP_PRINTF_FLAG_CAPTURE_STR) != 0;
+  const uint8_t *slots[FRPP_PRINTF_POS_ARGS_MAX];
+  const uint8_t *entries[FRPP_PRINTF_POS_ARGS_MAX];
+  const uint8_t *capture = arg_buf;
+
+  for (uint8_t i = 0; i < pos->count; i++) {
+    slots[i] = capture;
+    capture += frpp_printf_arg_size((frpp_printf_arg_t)pos->types[i]);
+  }
+
+  for (uint8_t i = 0; i < pos->count; i++) {
+    entries[i] = NULL;
+
+    if (prv_has_entry((frpp_printf_arg_t)pos->types[i], capture_str)) {
+      entries[i] = capture;
+      capture += prv_entry_size((frpp_printf_arg_t)pos->types[i], capture);
+    }
+  }
+
+  struct frpp_printf_spec spec;
+  const char *ptr = fmt_str;
+  const char *next;
+
+  // Positions were validated when the package was created
+  while ((next = frpp_printf_parse_next(ptr, &spec)) != NULL) {
+    prv_out_str(out, ptr, (size_t)(spec.start - ptr));
+
+    if (spec.flags & FRPP_PRINTF_SPEC_WIDTH_ARG) {
+      prv_spec_width(&spec, prv_slot_int(slots[spec.width_pos - 1]));
+    }
+
+    if (spec.flags & FRPP_PRINTF_SPEC_PREC_ARG) {
+      prv_spec_precision(&spec, prv_slot_int(slots[spec.prec_pos - 1]));
+    }
+
+    if (spec.arg == FRPP_PRINTF_ARG_NONE) {
+      prv_render_spec(out, &spec, NULL);
+    } else {
+      prv_render_value(out, &spec, slots[spec.pos - 1],
+                       entries[spec.pos - 1]);
+    }
+
+    ptr = next;
+  }
+
+  prv_out_str(out, ptr, strlen(ptr));
+}
+
+/**
+ * @brief Write a single argument to package
+ *
+ * @param dst Destination buffer
+ * @param len Length of destination buffer
+ * @param idx Offset in destination buffer to write argument to
+ * @param arg Argument type
+ * @param args Pointer to va_list to consume argument from
+ * @retval Non-negative Size of argument's slot
+ * @retval -ENOSPC Argument does not fit in destination buffer
+ */
+static int prv_package_arg(uint8_t *dst, size_t len, size_t idx,
+                           frpp_printf_arg_t arg, va_list *args) {
+  const size_t slot = frpp_printf_arg_size(arg);
+
+  // Nothing is consumed in calculate mode since only the size matters
+  if (dst == NULL) {
+    return slot;
+  }
+
+  if (idx + slot > len) {
+    return -ENOSPC;
+  }
+
+  switch (arg) {
+  case FRPP_PRINTF_ARG_INT:
+    FRPP_WRITE_ARG(dst, *args, idx, int);
+    break;
+  case FRPP_PRINTF_ARG_LONG:
+    FRPP_WRITE_ARG(dst, *args, idx, long);
+    break;
+  case FRPP_PRINTF_ARG_LONG_LONG:
+    FRPP_WRITE_ARG(dst, *args, idx, long long);
+    break;
+  case FRPP_PRINTF_ARG_SIZE:
+    FRPP_WRITE_ARG(dst, *args, idx, size_t);
+    break;
+  case FRPP_PRINTF_ARG_PTRDIFF:
+    FRPP_WRITE_ARG(dst, *args, idx, ptrdiff_t);
+    break;
+  case FRPP_PRINTF_ARG_INTMAX:
+    FRPP_WRITE_ARG(dst, *args, idx, intmax_t);
+    break;
+  case FRPP_PRINTF_ARG_STR:
+    FRPP_WRITE_ARG(dst, *args, idx, char *);
+    break;
+  case FRPP_PRINTF_ARG_PTR:
+    FRPP_WRITE_ARG(dst, *args, idx, void *);
+    break;
+  case FRPP_PRINTF_ARG_DOUBLE:
+    FRPP_WRITE_ARG(dst, *args, idx, double);
+    break;
+  case FRPP_PRINTF_ARG_WINT:
+    FRPP_WRITE_ARG(dst, *args, idx, wint_t);
+    break;
+  case FRPP_PRINTF_ARG_WSTR:
+    FRPP_WRITE_ARG(dst, *args, idx, wchar_t *);
+    break;
+  case FRPP_PRINTF_ARG_LONG_DOUBLE: {
+    // Slots are only aligned to FRPP_STACK_MIN_ALIGN
+    long double val = va_arg(*args, long double);
+    memcpy(dst + idx, &val, sizeof(val));
+    break;
+  }
+  case FRPP_PRINTF_ARG_UDT: {
+    // Only the hooks go in the slot, the object follows the fixed arguments
+    const struct frpp_printf_udt *udt =
+        va_arg(*args, const struct frpp_printf_udt *);
+    const struct frpp_printf_udt_ops *ops = (udt != NULL) ? udt->ops : NULL;
+    memcpy(dst + idx, &ops, sizeof(ops));
+    break;
+  }
+  default:
+    break;
+  }
+
+  return slot;
+}
+
+/**
+ * @brief Package arguments using a precomputed signature
+ *
+ * @param dst Destination buffer (NULL in calculate mode)
+ * @param len Length of destination buffer
+ * @param sig Signature of format string
+ * @param args va_list instance
+ * @return Package length or -ENOSPC
+ */
+static int prv_package_signature(uint8_t *dst, size_t len,
+                                 const struct frpp_printf_signature *sig,
+                                 va_list args) {
+  // Size is known up front, so calculate mode doesn't touch the arguments
+  if (dst == NULL) {
+    return sig->size;
+  }
+
+  if (sig->size > len) {
+    return -ENOSPC;
+  }
+
+  va_list ap;
+  va_copy(ap, args);
+
+  for (uint8_t i = 0; i < sig->count; i++) {
+    prv_package_arg(dst, len, sig->offsets[i], sig->types[i], &ap);
+  }
+
+  va_end(ap);
+
+  return sig->size;
+}
+
+/**
+ * @brief Package arguments by parsing the format string
+ *
+ * @param dst Destination buffer (NULL in calculate mode)
+ * @param len Length of destination buffer
+ * @param fmt_str Format string
+ * @param args va_list instance
+ * @param has_udt Set if format string has a %@ specifier
+ * @return Package length or -ENOSPC
+ */
+static int prv_package_parse(uint8_t *dst, size_t len, const char *fmt_str,
+                             va_list args, bool *has_udt) {
+  struct frpp_printf_spec spec;
+  const char *ptr = fmt_str;
+  int out_len = 0;
+  int ret = 0;
+
+  va_list ap;
+  va_copy(ap, args);
+
+  while (ret >= 0 && (ptr = frpp_printf_parse_next(ptr, &spec)) != NULL) {
+    frpp_printf_arg_t types[FRPP_PRINTF_SPEC_ARGS_MAX];
+    size_t count = frpp_printf_spec_args(&spec, types);
+
+    if (spec.arg == FRPP_PRINTF_ARG_UDT) {
+      *has_udt = true;
+    }
+
+    for (size_t i = 0; i < count && ret >= 0; i++) {
+      ret = prv_package_arg(dst, len, out_len, types[i], &ap);
+      out_len += (ret > 0) ? ret : 0;
+    }
+  }
+
+  va_end(ap);
+
+  return (ret < 0) ? ret : out_len;
+}
+
+/**
+ * @brief Package arguments from a list of their types, in va_list order
+ *
+ * @param dst Destination buffer (NULL in calculate mode)
+ * @param len Length of destination buffer
+ * @param types Argument types (frpp_printf_arg_t)
+ * @param count Number of arguments
+ * @param args va_list instance
+ * @return Package length or -ENOSPC
+ */
+static int prv_package_types(uint8_t *dst, size_t len, const uint8_t *types,
+                             size_t count, va_list args) {
+  int out_len = 0;
+  int ret = 0;
+
+  va_list ap;
+  va_copy(ap, args);
+
+  for (size_t i = 0; i < count && ret >= 0; i++) {
+    ret = prv_package_arg(dst, len, out_len, (frpp_printf_arg_t)types[i], &ap);
+    out_len += (ret > 0) ? ret : 0;
+  }
+
+  va_end(ap);
+
+  return (ret < 0) ? ret : out_len;
+}
+
+/**
+ * @brief Most bytes to copy per captured string
+ *
+ * @param flags Package flags
+ * @return Cap in bytes
+ */
+static size_t prv_capture_cap(uint32_t flags) {
+  size_t cap = (flags >> 8) & 0xFFU;
+
+  if (cap == 0) {
+    cap = FRPP_PRINTF_CAPTURE_CAP_DEFAULT;
+  }
+
+  return (cap > FRPP_PRINTF_CAPTURE_CAP_MAX) ? FRPP_PRINTF_CAPTURE_CAP_MAX
+                                             : cap;
+}
+
+/**
+ * @brief Append entry for a %s argument to the captured string area
+ *
+ * @param dst Destination buffer (NULL in calculate mode)
+ * @param len Length of destination buffer
+ * @param idx Offset of entry in destination buffer
+ * @param cap Most bytes to copy
+ * @param str String argument
+ * @retval Non-negative Size of entry
+ * @retval -ENOSPC Entry does not fit in destination buffer
+ */
+static int prv_capture_str(uint8_t *dst, size_t len, size_t idx, size_t cap,
+                           const char *str) {
+  const size_t marker_len = sizeof(FRPP_PRINTF_CAPTURE_TRUNC_MARKER) - 1;
+
+  if (str == NULL || frpp_printf_is_ro(str)) {
+    if (dst != NULL) {
+      if (idx + 1 > len) {
+        return -ENOSPC;
+      }
+
+      dst[idx] = FRPP_PRINTF_CAPTURE_BY_PTR;
+    }
+
+    return 1;
+  }
+
+  size_t str_len = prv_strnlen(str, cap + 1);
+  size_t copy_len = str_len;
+  bool truncated = str_len > cap;
+
+  if (truncated) {
+    str_len = cap;
+    copy_len = (cap > marker_len) ? (cap - marker_len) : cap;
+  }
+
+  if (dst != NULL) {
+    if (idx + 1 + str_len > len) {
+      return -ENOSPC;
+    }
+
+    dst[idx] = (uint8_t)str_len;
+    memcpy(&dst[idx + 1], str, copy_len);
+
+    if (copy_len != str_len) {
+      memcpy(&dst[idx + 1 + copy_len], FRPP_PRINTF_CAPTURE_TRUNC_MARKER,
+             marker_len);
+    }
+  }
+
+  return (int)(1 + str_len);
+}
+
+/**
+ * @brief Append entry for a %@ argument: its serialized length followed by
+ * the serialized object
+ *
+ * @param dst Destination buffer (NULL in calculate mode)
+ * @param len Length of destination buffer
+ * @param idx Offset of entry in destination buffer
+ * @param udt User-defined type argument
+ * @retval Non-negative Size of entry
+ * @retval -ENOSPC Entry does not fit in destination buffer, or object
+ * serializes to more than FRPP_PRINTF_UDT_SIZE_MAX bytes
+ * @retval -EINVAL Serialize hook wrote a different size than it reported
+ */
+static int prv_capture_udt(uint8_t *dst, size_t len, size_t idx,
+                           const struct frpp_printf_udt *udt) {
+  size_t size = 0;
+
+  if (udt != NULL && udt->ops != NULL && udt->ops->serialize != NULL) {
+    size = udt->ops->serialize(udt->obj, NULL, 0);
+  }
+
+  if (size > FRPP_PRINTF_UDT_SIZE_MAX) {
+    return -ENOSPC;
+  }
+
+  if (dst != NULL) {
+    if (idx + 1 + size > len) {
+      return -ENOSPC;
+    }
+
+    dst[idx] = (uint8_t)size;
+
+    // Hooks must report the same size both times
+    if (size > 0 &&
+        udt->ops->serialize(udt->obj, &dst[idx + 1], size) != size) {
+      return -EINVAL;
+    }
+  }
+
+  return (int)(1 + size);
+}
+
+/**
+ * @brief Consume an argument from va_list, capturing it if it's a string
+ *
+ * @param dst Destination buffer (NULL in calculate mode)
+ * @param len Length of destination buffer
+ * @param idx Offset of next captured string entry
+ * @param cap Most bytes to copy per string, 0 if strings aren't captured
+ * @param arg Argument type
+ * @param args Pointer to va_list to consume argument from
+ * @retval Non-negative Size of captured entry (0 if nothing was captured)
+ * @retval -ENOSPC Entry does not fit in destination buffer
+ */
+static int prv_capture_arg(uint8_t *dst, size_t len, size_t idx, size_t cap,
+                           frpp_printf_arg_t arg, va_list *args) {
+  switch (arg) {
+  case FRPP_PRINTF_ARG_INT:
+    (void)va_arg(*args, int);
+    break;
+  case FRPP_PRINTF_ARG_LONG:
+    (void)va_arg(*args, long);
+    break;
+  case FRPP_PRINTF_ARG_LONG_LONG:
+    (void)va_arg(*args, long long);
+    break;
+  case FRPP_PRINTF_ARG_SIZE:
+    (void)va_arg(*args, size_t);
+    break;
+  case FRPP_PRINTF_ARG_PTRDIFF:
+    (void)va_arg(*args, ptrdiff_t);
+    break;
+  case FRPP_PRINTF_ARG_INTMAX:
+    (void)va_arg(*args, intmax_t);
+    break;
+  case FRPP_PRINTF_ARG_STR: {
+    const char *str = va_arg(*args, const char *);
+    return (cap > 0) ? prv_capture_str(dst, len, idx, cap, str) : 0;
+  }
+  case FRPP_PRINTF_ARG_PTR:
+    (void)va_arg(*args, void *);
+    break;
+  case FRPP_PRINTF_ARG_DOUBLE:
+    (void)va_arg(*args, double);
+    break;
+  case FRPP_PRINTF_ARG_WINT:
+    (void)va_arg(*args, wint_t);
+    break;
+  case FRPP_PRINTF_ARG_WSTR:
+    (void)va_arg(*args, wchar_t *);
+    break;
+  case FRPP_PRINTF_ARG_LONG_DOUBLE:
+    (void)va_arg(*args, long double);
+    break;
+  case FRPP_PRINTF_ARG_UDT:
+    return prv_capture_udt(dst, len, idx,
+                           va_arg(*args, const struct frpp_printf_udt *));
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Append captured strings and user-defined types after the fixed size
+ * arguments of a package
+ *
+ * @param dst Destination buffer (NULL in calculate mode)
+ * @param len Length of destination buffer
+ * @param idx Offset of captured string area (size of fixed arguments)
+ * @param flags Package flags
+ * @param fmt_str Format string
+ * @param types Argument types in va_list order, NULL to parse fmt_str
+ * @param count Number of argument types
+ * @param args va_list instance
+ * @return Size of captured area or -ENOSPC
+ */
+static int prv_package_capture(uint8_t *dst, size_t len, size_t idx,
+                               uint32_t flags, const char *fmt_str,
+                               const uint8_t *types, size_t count,
+                               va_list args) {
+  size_t cap =
+      (flags & FRPP_PRINTF_FLAG_CAPTURE_STR) ? prv_capture_cap(flags) : 0;
+  size_t start = idx;
+  int ret = 0;
+
+  va_list ap;
+  va_copy(ap, args);
+
+  if (types != NULL) {
+    for (size_t i = 0; i < count && ret >= 0; i++) {
+      ret = prv_capture_arg(dst, len, idx, cap, (frpp_printf_arg_t)types[i],
+                            &ap);
+      idx += (ret > 0) ? ret : 0;
+    }
+  } else {
+    struct frpp_printf_spec spec;
+    const char *ptr = fmt_str;
+
+    while (ret >= 0 && (ptr = frpp_printf_parse_next(ptr, &spec)) != NULL) {
+      frpp_printf_arg_t spec_types[FRPP_PRINTF_SPEC_ARGS_MAX];
+      size_t spec_count = frpp_printf_spec_args(&spec, spec_types);
+
+      for (size_t i = 0; i < spec_count && ret >= 0; i++) {
+        ret = prv_capture_arg(dst, len, idx, cap, spec_types[i], &ap);
+        idx += (ret > 0) ? ret : 0;
+      }
+    }
+  }
+
+  va_end(ap);
+
+  return (ret < 0) ? ret : (int)(idx - start);
+}
+
+/**
+ * @brief Encode varint, least significant 7 bits first
+ *
+ * @param dst Destination, NULL to only determine size
+ * @param val Value
+ * @return Size of encoding in bytes
+ */
+static size_t prv_varint_put(uint8_t *dst, uintmax_t val) {
+  size_t len = 0;
+
+  do {
+    uint8_t byte = (uint8_t)(val & 0x7FU);
+    val >>= 7;
+
+    if (val != 0) {
+      byte |= 0x80U;
+    }
+
+    if (dst != NULL) {
+      dst[len] = byte;
+    }
+
+    len++;
+  } while (val != 0);
+
+  return len;
+}
+
+/**
+ * @brief Decode varint
+ *
+ * @param src Source
+ * @param val Value output
+ * @return Pointer past encoding
+ */
+static const uint8_t *prv_varint_get(const uint8_t *src, uintmax_t *val) {
+  uintmax_t result = 0;
+  unsigned int shift = 0;
+
+  do {
+    if (shift < sizeof(result) * 8) {
+      result |= (uintmax_t)(*src & 0x7FU) << shift;
+    }
+    shift += 7;
+  } while (*src++ & 0x80U);
+
+  *val = result;
+
+  return src;
+}
+
+/**
+ * @brief Width of an integer argument stored at its natural width in a dense
+ * package rather than as a varint
+ *
+ * @param spec Specifier
+ * @return Width in bytes, 0 if stored as a varint
+ */
+static size_t prv_dense_fixed_width(const struct frpp_printf_spec *spec) {
+  if ((spec->conversion == 'c' && spec->arg == FRPP_PRINTF_ARG_INT) ||
+      spec->length == FRPP_PRINTF_LEN_HH) {
+    return sizeof(char);
+  }
+
+  if (spec->length == FRPP_PRINTF_LEN_H) {
+    return sizeof(short);
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Consume an integer argument from va_list
+ *
+ * @param arg Argument type
+ * @param is_signed Whether conversion is signed
+ * @param args Pointer to va_list to consume argument from
+ * @return Argument widened to uintmax_t (sign extended if signed)
+ */
+static uintmax_t prv_va_int(frpp_printf_arg_t arg, bool is_signed,
+                            va_list *args) {
+  switch (arg) {
+  case FRPP_PRINTF_ARG_LONG: {
+    long v = va_arg(*args, long);
+    return is_signed ? (uintmax_t)(intmax_t)v : (uintmax_t)(unsigned long)v;
+  }
+  case FRPP_PRINTF_ARG_LONG_LONG: {
+    long long v = va_arg(*args, long long);
+    return is_signed ? (uintmax_t)(intmax_t)v
+                     : (uintmax_t)(unsigned long long)v;
+  }
+  case FRPP_PRINTF_ARG_SIZE: {
+    size_t v = va_arg(*args, size_t);
+    return is_signed ? (uintmax_t)(intmax_t)(ptrdiff_t)v : (uintmax_t)v;
+  }
+  case FRPP_PRINTF_ARG_PTRDIFF: {
+    ptrdiff_t v = va_arg(*args, ptrdiff_t);
+    return is_signed ? (uintmax_t)(intmax_t)v : (uintmax_t)(size_t)v;
+  }
+  case FRPP_PRINTF_ARG_INTMAX:
+    return (uintmax_t)va_arg(*args, intmax_t);
+  case FRPP_PRINTF_ARG_WINT:
+    return (uintmax_t)va_arg(*args, wint_t);
+  default: {
+    int v = va_arg(*args, int);
+    return is_signed ? (uintmax_t)(intmax_t)v : (uintmax_t)(unsigned int)v;
+  }
+  }
+}
+
+/**
+ * @brief Encode a single argument of a dense package
+ *
+ * @param dst Destination buffer (NULL in calculate mode)
+ * @param len Length of destination buffer
+ * @param idx Offset in destination buffer to write argument to
+ * @param flags Package flags
+ * @param cap Most bytes to copy per captured string
+ * @param spec Specifier
+ * @param args Pointer to va_list to consume argument from
+ * @retval Non-negative Size of encoded argument
+ * @retval -ENOSPC Argument does not fit in destination buffer
+ */
+static int prv_dense_arg(uint8_t *dst, size_t len, size_t idx, uint32_t flags,
+                         size_t cap, const struct frpp_printf_spec *spec,
+                         va_list *args) {
+  uint8_t tmp[FRPP_PRINTF_DENSE_ARG_MAX];
+  size_t size = 0;
 
-/*****************************************************************************
- * Variables
- *****************************************************************************/
+  switch (spec->arg) {
+  case FRPP_PRINTF_ARG_STR: {
+    const char *str = va_arg(*args, const char *);
 
-/*****************************************************************************
- * Private Functions
- *****************************************************************************/
+    if (flags & FRPP_PRINTF_FLAG_CAPTURE_STR) {
+      int ret = prv_capture_str(dst, len, idx, cap, str);
+      if (ret != 1) {
+        return ret;
+      }
+
+      // Stored by pointer, which follows the tag
+      idx++;
+      size = 1;
+    }
+
+    if (dst != NULL && idx + sizeof(str) > len) {
+      return -ENOSPC;
+    }
+
+    if (dst != NULL) {
+      memcpy(&dst[idx], &str, sizeof(str));
+    }
+
+    return (int)(size + sizeof(str));
+  }
+
+  case FRPP_PRINTF_ARG_PTR: {
+    void *ptr = va_arg(*args, void *);
+    memcpy(tmp, &ptr, sizeof(ptr));
+    size = sizeof(ptr);
+    break;
+  }
+
+  case FRPP_PRINTF_ARG_WSTR: {
+    // Wide strings are never captured
+    wchar_t *ptr = va_arg(*args, wchar_t *);
+    memcpy(tmp, &ptr, sizeof(ptr));
+    size = sizeof(ptr);
+    break;
+  }
+
+  case FRPP_PRINTF_ARG_DOUBLE: {
+    double val = va_arg(*args, double);
+    memcpy(tmp, &val, sizeof(val));
+    size = sizeof(val);
+    break;
+  }
+
+  case FRPP_PRINTF_ARG_LONG_DOUBLE: {
+    long double val = va_arg(*args, long double);
+    memcpy(tmp, &val, sizeof(val));
+    size = sizeof(val);
+    break;
+  }
+
+  case FRPP_PRINTF_ARG_UDT: {
+    // Hooks followed by the same entry used in the captured area
+    const struct frpp_printf_udt *udt =
+        va_arg(*args, const struct frpp_printf_udt *);
+    const struct frpp_printf_udt_ops *ops = (udt != NULL) ? udt->ops : NULL;
+
+    if (dst != NULL) {
+      if (idx + sizeof(ops) > len) {
+        return -ENOSPC;
+      }
+
+      memcpy(&dst[idx], &ops, sizeof(ops));
+    }
+
+    int ret = prv_capture_udt(dst, len, idx + sizeof(ops), udt);
+
+    return (ret < 0) ? ret : (int)(sizeof(ops) + (size_t)ret);
+  }
+
+  default: {
+    bool is_signed = spec->conversion == 'd' || spec->conversion == 'i';
+    uintmax_t val = prv_va_int(spec->arg, is_signed, args);
+    size_t width = prv_dense_fixed_width(spec);
+
+    if (width == sizeof(char)) {
+      tmp[0] = (uint8_t)val;
+      size = width;
+    } else if (width == sizeof(short)) {
+      unsigned short half = (unsigned short)val;
+      memcpy(tmp, &half, sizeof(half));
+      size = width;
+    } else if (is_signed) {
+      // Zigzag keeps small negative numbers short
+      intmax_t sval = (intmax_t)val;
+      uintmax_t zz = ((uintmax_t)sval << 1) ^
+                     (uintmax_t)(sval >> (sizeof(sval) * 8 - 1));
+      size = prv_varint_put(tmp, zz);
+    } else {
+      size = prv_varint_put(tmp, val);
+    }
+    break;
+  }
+  }
+
+  if (dst != NULL) {
+    if (idx + size > len) {
+      return -ENOSPC;
+    }
+
+    memcpy(&dst[idx], tmp, size);
+  }
+
+  return (int)size;
+}
 
 /**
- * @brief Reconstruct va_list from buffered va_list
+ * @brief Package arguments with the dense encoding
  *
- * @param fmt_str Pointer to format string
- * @param arg_buf Buffer of arg list
- * @param out_buf Pointer to output buffer
- * @param out_buf_size_bytes Size of output buffer
- * @return Returns size of bytes written
+ * @param dst Destination buffer (NULL in calculate mode)
+ * @param len Length of destination buffer
+ * @param flags Package flags
+ * @param fmt_str Format string
+ * @param args va_list instance
+ * @return Package length or -ENOSPC
  */
-static size_t prv_vsnprintf_from_arg_buffer(const char *fmt_str,
-                                            const void *arg_buf, void *out_buf,
-                                            size_t out_buf_size_bytes) {
-  if (fmt_str == NULL || arg_buf == NULL || out_buf == NULL) {
-    return -EINVAL;
+static int prv_package_dense(uint8_t *dst, size_t len, uint32_t flags,
+                             const char *fmt_str, va_list args) {
+  struct frpp_printf_spec spec;
+  const char *ptr = fmt_str;
+  size_t cap = prv_capture_cap(flags);
+  size_t idx = 0;
+  int ret = 0;
+
+  va_list ap;
+  va_copy(ap, args);
+
+  while (ret >= 0 && (ptr = frpp_printf_parse_next(ptr, &spec)) != NULL) {
+    // Width and precision arguments precede the value, encoded as ints
+    if (spec.flags & FRPP_PRINTF_SPEC_WIDTH_ARG) {
+      ret = prv_dense_arg(dst, len, idx, flags, cap, &prv_star_spec, &ap);
+      idx += (ret > 0) ? ret : 0;
+    }
+
+    if (ret >= 0 && (spec.flags & FRPP_PRINTF_SPEC_PREC_ARG)) {
+      ret = prv_dense_arg(dst, len, idx, flags, cap, &prv_star_spec, &ap);
+      idx += (ret > 0) ? ret : 0;
+    }
+
+    if (ret >= 0 && spec.arg != FRPP_PRINTF_ARG_NONE) {
+      ret = prv_dense_arg(dst, len, idx, flags, cap, &spec, &ap);
+      idx += (ret > 0) ? ret : 0;
+    }
   }
 
-#if defined(__x86_64__)
-  /*
-   * Reference:
-   *
-   * System V Application Binary Interface
-   * AMD64 Architecture Processor Supplement
-   */
+  va_end(ap);
 
-  struct __va_list {
-    unsigned int gp_offset;
-    unsigned int fp_offset;
-    void *overflow_arg_area;
-    void *reg_save_area;
-  };
+  return (ret < 0) ? ret : (int)idx;
+}
 
-  union {
-    va_list ap;
-    struct __va_list __ap;
-  } u = {0};
-
-  /* create a valid va_list with our buffer */
-  u.__ap.overflow_arg_area = (void *)arg_buf;
-  u.__ap.reg_save_area = NULL;
-  u.__ap.gp_offset = (6 * 8);
-  u.__ap.fp_offset = (6 * 8 + 16 * 16);
-
-#elif defined(__aarch64__)
-  // ARM64 - va_list is a complex structure
-  struct __va_list {
-    void *__stack;
-    void *__gr_top;
-    void *__vr_top;
-    int __gr_offs;
-    int __vr_offs;
-  };
+/**
+ * @brief Decode an integer argument of a dense package
+ *
+ * @param spec Specifier
+ * @param src Pointer to position in package, advanced past argument
+ * @return Argument widened to uintmax_t (sign extended if signed)
+ */
+static uintmax_t prv_dense_get_int(const struct frpp_printf_spec *spec,
+                                   const uint8_t **src) {
+  bool is_signed = spec->conversion == 'd' || spec->conversion == 'i';
+  size_t width = prv_dense_fixed_width(spec);
+  uintmax_t val;
 
-  union {
-    va_list ap;
-    struct __va_list __ap;
-  } u;
+  if (width == sizeof(char)) {
+    val = is_signed ? (uintmax_t)(intmax_t)(signed char)**src : **src;
+    *src += width;
+  } else if (width == sizeof(short)) {
+    unsigned short half;
+    memcpy(&half, *src, sizeof(half));
+    val = is_signed ? (uintmax_t)(intmax_t)(short)half : half;
+    *src += width;
+  } else {
+    *src = prv_varint_get(*src, &val);
 
-  // Reconstruct va_list pointing to our buffer
-  u.__ap.__stack = (void *)buffer;
-  u.__ap.__gr_top = NULL;
-  u.__ap.__vr_top = NULL;
-  u.__ap.__gr_offs = 0;
-  u.__ap.__vr_offs = 0;
+    if (is_signed) {
+      val = (val >> 1) ^ ((uintmax_t)0 - (val & 1U));
+    }
+  }
 
-#else
-  // Default: assume va_list is just a pointer (ARM32, many others)
-  // This works for most simple architectures
-  union {
-    va_list ap;
-    void *ptr;
-  } u;
+  return val;
+}
 
-  u.ptr = (void *)arg_buf;
-#endif
-  return vsnprintf(out_buf, out_buf_size_bytes, fmt_str, u.ap);
+/**
+ * @brief Render a format string using arguments from a dense package.  Each
+ * argument is decoded into a regular slot and handed to the slot renderer.
+ *
+ * @param fmt_str Format string
+ * @param flags Package flags
+ * @param src Dense package
+ * @param out Output state
+ */
+static void prv_render_dense(const char *fmt_str, uint32_t flags,
+                             const uint8_t *src, struct prv_out *out) {
+  struct frpp_printf_spec spec;
+  const char *ptr = fmt_str;
+  const char *next;
+
+  while ((next = frpp_printf_parse_next(ptr, &spec)) != NULL) {
+    // uintmax_t backing keeps the decoded slot aligned for any argument
+    uintmax_t slot[(FRPP_PRINTF_DENSE_ARG_MAX + sizeof(uintmax_t) - 1) /
+                   sizeof(uintmax_t)];
+    uint8_t *arg = (uint8_t *)slot;
+
+    prv_out_str(out, ptr, (size_t)(spec.start - ptr));
+    ptr = next;
+
+    if (spec.flags & FRPP_PRINTF_SPEC_WIDTH_ARG) {
+      prv_spec_width(&spec, (int)prv_dense_get_int(&prv_star_spec, &src));
+    }
+
+    if (spec.flags & FRPP_PRINTF_SPEC_PREC_ARG) {
+      prv_spec_precision(&spec,
+                         (int)prv_dense_get_int(&prv_star_spec, &src));
+    }
+
+    switch (spec.arg) {
+    case FRPP_PRINTF_ARG_NONE:
+      break;
+
+    case FRPP_PRINTF_ARG_STR:
+      if (flags & FRPP_PRINTF_FLAG_CAPTURE_STR) {
+        uint8_t tag = *src++;
+
+        if (tag != FRPP_PRINTF_CAPTURE_BY_PTR) {
+          size_t len = tag;
+
+          if (spec.precision >= 0 && (size_t)spec.precision < len) {
+            len = (size_t)spec.precision;
+          }
+
+          prv_render_str(out, &spec, (const char *)src, len);
+          src += tag;
+          continue;
+        }
+      }
+
+      memcpy(arg, src, sizeof(char *));
+      src += sizeof(char *);
+      break;
+
+    case FRPP_PRINTF_ARG_PTR:
+      memcpy(arg, src, sizeof(void *));
+      src += sizeof(void *);
+      break;
+
+    case FRPP_PRINTF_ARG_WSTR:
+      memcpy(arg, src, sizeof(wchar_t *));
+      src += sizeof(wchar_t *);
+      break;
+
+    case FRPP_PRINTF_ARG_DOUBLE:
+      memcpy(arg, src, sizeof(double));
+      src += sizeof(double);
+      break;
+
+    case FRPP_PRINTF_ARG_LONG_DOUBLE:
+      memcpy(arg, src, sizeof(long double));
+      src += sizeof(long double);
+      break;
+
+    case FRPP_PRINTF_ARG_UDT: {
+      const struct frpp_printf_udt_ops *ops;
+      memcpy(&ops, src, sizeof(ops));
+      src += sizeof(ops);
+
+      prv_render_udt(out, ops, src + 1, *src);
+      src += 1 + *src;
+      continue;
+    }
+
+    default: {
+      uintmax_t val = prv_dense_get_int(&spec, &src);
+
+      // Store in the slot's type so the slot renderer reads it back as is
+      switch (spec.arg) {
+      case FRPP_PRINTF_ARG_LONG: {
+        long v = (long)val;
+        memcpy(arg, &v, sizeof(v));
+        break;
+      }
+      case FRPP_PRINTF_ARG_LONG_LONG: {
+        long long v = (long long)val;
+        memcpy(arg, &v, sizeof(v));
+        break;
+      }
+      case FRPP_PRINTF_ARG_SIZE: {
+        size_t v = (size_t)val;
+        memcpy(arg, &v, sizeof(v));
+        break;
+      }
+      case FRPP_PRINTF_ARG_PTRDIFF: {
+        ptrdiff_t v = (ptrdiff_t)val;
+        memcpy(arg, &v, sizeof(v));
+        break;
+      }
+      case FRPP_PRINTF_ARG_INTMAX: {
+        intmax_t v = (intmax_t)val;
+        memcpy(arg, &v, sizeof(v));
+        break;
+      }
+      case FRPP_PRINTF_ARG_WINT: {
+        wint_t v = (wint_t)val;
+        memcpy(arg, &v, sizeof(v));
+        break;
+      }
+      default: {
+        int v = (int)val;
+        memcpy(arg, &v, sizeof(v));
+        break;
+      }
+      }
+      break;
+    }
+    }
+
+    prv_render_spec(out, &spec, arg);
+  }
+
+  prv_out_str(out, ptr, strlen(ptr));
+}
+
+/**
+ * @brief Render a package in either encoding
+ *
+ * @param fmt_str Format string
+ * @param flags Flags package was created with
+ * @param arg_buf Package
+ * @param out Output state
+ */
+static void prv_render_package(const char *fmt_str, uint32_t flags,
+                               const uint8_t *arg_buf, struct prv_out *out) {
+  struct frpp_printf_pos_args pos;
+
+  // Positional packages always use the regular layout, see
+  // prv_vprintf_package
+  if (prv_positions(fmt_str, &pos) > 0) {
+    prv_render_positional(fmt_str, flags, &pos, arg_buf, out);
+  } else if (flags & FRPP_PRINTF_FLAG_DENSE) {
+    prv_render_dense(fmt_str, flags, arg_buf, out);
+  } else {
+    prv_render(fmt_str, flags, arg_buf, out);
+  }
+}
+
+/**
+ * @brief Package arguments, after input validation
+ *
+ * @param dst Destination buffer (NULL in calculate mode)
+ * @param len Length of destination buffer
+ * @param flags Package flags
+ * @param fmt_str Format string
+ * @param args va_list instance
+ * @return Package length or negative error
+ */
+static int prv_vprintf_package(uint8_t *dst, size_t len, uint32_t flags,
+                               const char *fmt_str, va_list args) {
+  // This function has two different modes.  The first determines the amount
+  // of space required to package the arguments without writing anything
+  // (dst == NULL and len == 0).  The second writes the package to dst.
+  //
+  // Both modes first try the signature cache, so a format string seen before
+  // is packaged with a straight copy loop instead of being re-parsed.
+
+  // Positional arguments are packaged in va_list order, which differs from
+  // specifier order, so the renderer finds them through fixed slots.  Such
+  // format strings always use the regular layout, even with the dense flag.
+  struct frpp_printf_pos_args pos;
+  int positional = 0;
+
+  // Dense packages have no fixed layout, so the signature cache doesn't apply
+  if (flags & FRPP_PRINTF_FLAG_DENSE) {
+    positional = prv_positions(fmt_str, &pos);
+
+    if (positional == 0) {
+      return prv_package_dense(dst, len, flags, fmt_str, args);
+    }
+  }
+
+  struct frpp_printf_signature sig;
+  const uint8_t *types = NULL;
+  size_t count = 0;
+  bool has_udt = false;
+  int ret;
+
+  if (frpp_printf_cache_lookup(fmt_str, &sig) == 0) {
+    ret = prv_package_signature(dst, len, &sig, args);
+    types = sig.types;
+    count = sig.count;
+  } else {
+    if ((flags & FRPP_PRINTF_FLAG_DENSE) == 0) {
+      positional = prv_positions(fmt_str, &pos);
+    }
+
+    if (positional < 0) {
+      return positional;
+    }
+
+    if (positional) {
+      types = pos.types;
+      count = pos.count;
+      ret = prv_package_types(dst, len, types, count, args);
+    } else {
+      ret = prv_package_parse(dst, len, fmt_str, args, &has_udt);
+    }
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    has_udt |= (types[i] == FRPP_PRINTF_ARG_UDT);
+  }
+
+  if (ret < 0 || ((flags & FRPP_PRINTF_FLAG_CAPTURE_STR) == 0 && !has_udt)) {
+    return ret;
+  }
+
+  // Captured strings and user-defined types are appended after the fixed size
+  // arguments, so the layout of those (and the signature cache) is the same
+  // in either mode
+  int capture = prv_package_capture(dst, len, (size_t)ret, flags, fmt_str,
+                                    types, count, args);
+
+  return (capture < 0) ? capture : (ret + capture);
 }
+
 /*****************************************************************************
  * Functions
  *****************************************************************************/
@@ -144,163 +1886,209 @@ int frpp_vprintf_package(void *dst, size_t len, uint32_t flags,
     return -EINVAL;
   }
 
-  int out_len = 0;
+#if FRPP_PRINTF_STATS
+  uint64_t start = FRPP_PRINTF_STATS_CYCLES();
+  int ret = prv_vprintf_package(dst, len, flags, fmt_str, args);
 
-  const char *ptr = fmt_str;
-  uint8_t *dst_buf = (uint8_t *)dst;
-  // The predicate for the outer while-loop is a little tricky.
-  //
-  // First and foremost, we want to loop until the NULL terminator of the format
-  // string is reached.
-  //
-  // The next part is a bit more complicated.  This function has two different
-  // modes.  The first to determine the amount of space required to package
-  // the arguments without actually writing the package to the buffer.
-  //
-  // The second mode is to actually write the package to an output buffer.
-  //
-  // The first mode is determined by dst == NULL and len == 0.
-  //
-  // The second mode is determined by dst != NULL and len != 0.
-  //
-  // If in first mode, the while loop should not break out early if the
-  // output length is greater than len, since nothing is being written.
-  //
-  // If in second mode, the while loop should break out if outlen would be
-  // greater than len.
+  // Calculate mode only sizes a package, it doesn't create one
+  if (dst != NULL) {
+    frpp_printf_stats_package(fmt_str, ret,
+                              FRPP_PRINTF_STATS_CYCLES() - start);
+  }
 
-  while (*ptr && ((dst != NULL && (out_len < len)) || (dst == NULL))) {
-    // Ignore anything that is not a specifier
-    if (*ptr != '%') {
-      ptr++;
-      continue;
-    }
+  return ret;
+#else
+  return prv_vprintf_package(dst, len, flags, fmt_str, args);
+#endif
+}
 
-    // Increment to specifier after %
-    ptr++;
+int frpp_printf_reserve(struct frpp_printf_reservation *res, void *region,
+                        size_t capacity) {
+  if (res == NULL || (region == NULL && capacity != 0)) {
+    return -EINVAL;
+  }
 
-    // Length and precision specifiers don't have any impact on package size
-    while (*ptr && (*ptr == '-' || *ptr == '+' || *ptr == ' ' || *ptr == '#' ||
-                    *ptr == '0')) {
-      ptr++;
-    }
+  res->region = (uint8_t *)region;
+  res->capacity = capacity;
+  res->used = 0;
+  res->flags = 0;
 
-    while (*ptr && (*ptr >= '0' && *ptr <= '9')) {
-      ptr++;
-    }
+  return 0;
+}
 
-    if (*ptr == '.') {
-      ptr++;
-      while (*ptr && (*ptr >= '0' && *ptr <= '9')) {
-        ptr++;
-      }
-    }
+int frpp_printf_reserve_package(struct frpp_printf_reservation *res,
+                                uint32_t flags, const char *fmt_str, ...) {
+  va_list args;
 
-    switch (*ptr) {
+  va_start(args, fmt_str);
+  int ret = frpp_vprintf_reserve_package(res, flags, fmt_str, args);
+  va_end(args);
 
-    // Do nothing since double %% is escape
-    case '%':
-      break;
+  return ret;
+}
 
-    case 'h':
-      if (*(ptr + 1) == 'h') {
-        ptr++;
-      }
+int frpp_vprintf_reserve_package(struct frpp_printf_reservation *res,
+                                 uint32_t flags, const char *fmt_str,
+                                 va_list args) {
+  if (res == NULL || fmt_str == NULL) {
+    return -EINVAL;
+  }
 
-      FRPP_HANDLE_BUF_OVERRUN(dst, len, out_len, int);
-      FRPP_WRITE_ARG(dst, args, out_len, int);
-      out_len += FRPP_VA_STACK_ALIGN(int);
-      break;
+  const size_t avail = res->capacity - res->used;
+  int ret;
 
-    case 'l':
-      if (*(ptr + 1) == 'l') {
-        ptr++;
-
-        FRPP_HANDLE_BUF_OVERRUN(dst, len, out_len, long long);
-        FRPP_WRITE_ARG(dst, args, out_len, long long);
-        out_len += FRPP_VA_STACK_ALIGN(long long);
-      } else {
-        FRPP_HANDLE_BUF_OVERRUN(dst, len, out_len, long);
-        FRPP_WRITE_ARG(dst, args, out_len, long);
-        out_len += FRPP_VA_STACK_ALIGN(long);
-      }
-      break;
+  if (avail == 0) {
+    // Only a package without arguments fits in an exhausted reservation
+    ret = frpp_vprintf_package(NULL, 0, flags, fmt_str, args);
+    return (ret > 0) ? -ENOSPC : ret;
+  }
 
-    case 'z':
-      FRPP_HANDLE_BUF_OVERRUN(dst, len, out_len, size_t);
-      FRPP_WRITE_ARG(dst, args, out_len, size_t);
-      out_len += FRPP_VA_STACK_ALIGN(size_t);
-      break;
+  ret = frpp_vprintf_package(res->region + res->used, avail, flags, fmt_str,
+                             args);
+  if (ret < 0) {
+    // Arguments before the failing one may have been written already.  Wipe
+    // them so the unused part of the region stays clean.
+    memset(res->region + res->used, 0, avail);
+    return ret;
+  }
 
-    case 't':
-      FRPP_HANDLE_BUF_OVERRUN(dst, len, out_len, ptrdiff_t);
-      FRPP_WRITE_ARG(dst, args, out_len, ptrdiff_t);
-      out_len += FRPP_VA_STACK_ALIGN(ptrdiff_t);
-      break;
+  res->used += ret;
+  res->flags = flags;
 
-    case 'j':
-      FRPP_HANDLE_BUF_OVERRUN(dst, len, out_len, intmax_t);
-      FRPP_WRITE_ARG(dst, args, out_len, intmax_t);
-      out_len += FRPP_VA_STACK_ALIGN(intmax_t);
-      break;
+  return ret;
+}
 
-    // Handle pointer and string specifiers
-    case 's':
-      FRPP_HANDLE_BUF_OVERRUN(dst, len, out_len, char *);
-      FRPP_WRITE_ARG(dst, args, out_len, char *);
-      out_len += FRPP_VA_STACK_ALIGN(char *);
-      break;
+size_t frpp_printf_commit(struct frpp_printf_reservation *res) {
+  if (res == NULL) {
+    return 0;
+  }
 
-    case 'p':
-      FRPP_HANDLE_BUF_OVERRUN(dst, len, out_len, void *);
-      FRPP_WRITE_ARG(dst, args, out_len, void *);
-      out_len += FRPP_VA_STACK_ALIGN(void *);
-      break;
+  return res->used;
+}
 
-    case 'n':
-      FRPP_HANDLE_BUF_OVERRUN(dst, len, out_len, int *);
-      FRPP_WRITE_ARG(dst, args, out_len, int *);
-      out_len += FRPP_VA_STACK_ALIGN(int *);
-      break;
+void frpp_printf_abort(struct frpp_printf_reservation *res) {
+  if (res == NULL) {
+    return;
+  }
 
-    // Handle integer specifiers
-    case 'd':
-    case 'i':
-    case 'o':
-    case 'u':
-    case 'x':
-    case 'X':
-    case 'c':
-      FRPP_HANDLE_BUF_OVERRUN(dst, len, out_len, int);
-      FRPP_WRITE_ARG(dst, args, out_len, int);
-      out_len += FRPP_VA_STACK_ALIGN(int);
-      break;
+  if (res->region != NULL) {
+    memset(res->region, 0, res->capacity);
+  }
 
-    // Handle float/double specifiers
-    case 'f':
-    case 'F':
-    case 'e':
-    case 'E':
-    case 'g':
-    case 'G':
-      FRPP_HANDLE_BUF_OVERRUN(dst, len, out_len, double);
-      FRPP_WRITE_ARG(dst, args, out_len, double);
-      out_len += FRPP_VA_STACK_ALIGN(double);
-      break;
+  res->used = 0;
+}
 
-    default:
-      ptr++;
-      continue;
-      break;
+int frpp_printf_ro_range_add(const void *start, size_t len) {
+  if (start == NULL || len == 0) {
+    return -EINVAL;
+  }
+
+  if (prv_ro_range_count >= FRPP_PRINTF_RO_RANGES_MAX) {
+    return -ENOSPC;
+  }
+
+  prv_ro_ranges[prv_ro_range_count].start = (uintptr_t)start;
+  prv_ro_ranges[prv_ro_range_count].end = (uintptr_t)start + len;
+  prv_ro_range_count++;
+
+  return 0;
+}
+
+bool frpp_printf_is_ro(const void *ptr) {
+  uintptr_t addr = (uintptr_t)ptr;
+
+  for (size_t i = 0; i < prv_ro_range_count; i++) {
+    if (addr >= prv_ro_ranges[i].start && addr < prv_ro_ranges[i].end) {
+      return true;
     }
-    ptr++;
   }
 
-  return out_len;
+  return false;
 }
 
 int frpp_snprintf(const char *fmt_str, const void *arg_buf, void *out_buf,
                   size_t out_buf_size_bytes) {
-  return prv_vsnprintf_from_arg_buffer(fmt_str, arg_buf, out_buf,
-                                       out_buf_size_bytes);
+  return frpp_snprintf_ex(fmt_str, 0, arg_buf, out_buf, out_buf_size_bytes);
+}
+
+int frpp_snprintf_ex(const char *fmt_str, uint32_t flags, const void *arg_buf,
+                     void *out_buf, size_t out_buf_size_bytes) {
+  if (fmt_str == NULL || arg_buf == NULL || out_buf == NULL) {
+    return -EINVAL;
+  }
+
+  struct prv_out out = {
+      .buf = (char *)out_buf,
+      .size = out_buf_size_bytes,
+      .pos = 0,
+  };
+
+#if FRPP_PRINTF_STATS
+  uint64_t start = FRPP_PRINTF_STATS_CYCLES();
+  prv_render_package(fmt_str, flags, (const uint8_t *)arg_buf, &out);
+  frpp_printf_stats_render(fmt_str, FRPP_PRINTF_STATS_CYCLES() - start);
+#else
+  prv_render_package(fmt_str, flags, (const uint8_t *)arg_buf, &out);
+#endif
+
+  if (out.size > 0) {
+    out.buf[(out.pos < out.size) ? out.pos : (out.size - 1)] = '\0';
+  }
+
+  return (int)out.pos;
+}
+
+int frpp_snprintf_batch(const struct frpp_printf_record *records, size_t count,
+                        void *out_buf, size_t out_buf_size_bytes,
+                        size_t *offsets) {
+  if (records == NULL || out_buf == NULL || out_buf_size_bytes == 0 ||
+      offsets == NULL) {
+    return -EINVAL;
+  }
+
+  char *buf = (char *)out_buf;
+  size_t pos = 0;
+  size_t rendered = 0;
+
+  offsets[0] = 0;
+
+  for (; rendered < count; rendered++) {
+    const struct frpp_printf_record *record = &records[rendered];
+
+    if (record->fmt == NULL || record->arg_buf == NULL) {
+      buf[pos] = '\0';
+      return -EINVAL;
+    }
+
+    // Each record gets its own view of the remaining space, so %n counts
+    // from the start of the record like it would with frpp_snprintf_ex
+    struct prv_out out = {
+        .buf = buf + pos,
+        .size = out_buf_size_bytes - pos,
+        .pos = 0,
+    };
+
+#if FRPP_PRINTF_STATS
+    uint64_t start = FRPP_PRINTF_STATS_CYCLES();
+    prv_render_package(record->fmt, record->flags,
+                       (const uint8_t *)record->arg_buf, &out);
+    frpp_printf_stats_render(record->fmt, FRPP_PRINTF_STATS_CYCLES() - start);
+#else
+    prv_render_package(record->fmt, record->flags,
+                       (const uint8_t *)record->arg_buf, &out);
+#endif
+
+    // Records are never split.  One that doesn't fit (with the terminator)
+    // is dropped from the output, along with everything after it.
+    if (out.pos >= out.size) {
+      break;
+    }
+
+    pos += out.pos;
+    offsets[rendered + 1] = pos;
+  }
+
+  buf[pos] = '\0';
+
+  return (int)rendered;
 }
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_printf_cache.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/sys/frpp_printf_cache.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Signature count marking a format string known to be uncacheable, so
+ * it is not re-parsed on every lookup
+ */
+#define FRPP_PRINTF_CACHE_NEGATIVE (UINT8_MAX)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Single cache entry.  Key is 0 when empty, and otherwise the format
+ * string pointer sig belongs to.  Both are written with seq odd, so readers
+ * copying sig out can tell when it changed under them (sequence lock).
+ */
+struct prv_cache_entry {
+  atomic_uint_least32_t seq;
+  atomic_uintptr_t key;
+
+  /* Hit since an eviction last passed over the entry */
+  atomic_bool ref;
+
+  struct frpp_printf_signature sig;
+};
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+#if FRPP_PRINTF_CACHE_SIZE > 0
+static struct prv_cache_entry prv_cache[FRPP_PRINTF_CACHE_SIZE];
+#endif
+
+static atomic_uint_fast32_t prv_hits;
+static atomic_uint_fast32_t prv_misses;
+static atomic_uint_fast32_t prv_uncacheable;
+static atomic_uint_fast32_t prv_evictions;
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+#if FRPP_PRINTF_CACHE_SIZE > 0
+/**
+ * @brief Hash a format string pointer to a starting slot
+ *
+ * @param key Format string pointer
+ * @return Slot index
+ */
+static inline size_t prv_hash(uintptr_t key) {
+  uint32_t hash = (uint32_t)(key ^ (key >> 16)) * 0x9E3779B1U;
+  return (hash >> 16) & (FRPP_PRINTF_CACHE_SIZE - 1);
+}
+
+/**
+ * @brief Copy an entry's signature out if it belongs to a format string
+ *
+ * @param entry Cache entry
+ * @param key Format string pointer
+ * @param sig Signature output
+ * @retval 0 Success
+ * @retval -ENOENT Entry belongs to another format string, or was being
+ * written
+ */
+static int prv_entry_read(struct prv_cache_entry *entry, uintptr_t key,
+                          struct frpp_printf_signature *sig) {
+  uint_least32_t seq = atomic_load_explicit(&entry->seq, memory_order_acquire);
+
+  if ((seq & 1U) != 0 ||
+      atomic_load_explicit(&entry->key, memory_order_relaxed) != key) {
+    return -ENOENT;
+  }
+
+  memcpy(sig, &entry->sig, sizeof(*sig));
+
+  atomic_thread_fence(memory_order_acquire);
+  if (atomic_load_explicit(&entry->seq, memory_order_relaxed) != seq) {
+    return -ENOENT;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Claim an entry and fill it with a format string's signature
+ *
+ * @param entry Cache entry
+ * @param seq Sequence the entry was seen at, even
+ * @param key Format string pointer
+ * @param sig Signature output
+ * @retval 0 Success
+ * @retval -EAGAIN Entry was claimed by another thread first
+ * @retval -ENOENT Format string can't be cached
+ */
+static int prv_entry_fill(struct prv_cache_entry *entry, uint_least32_t seq,
+                          uintptr_t key, struct frpp_printf_signature *sig) {
+  if (!atomic_compare_exchange_strong_explicit(&entry->seq, &seq, seq + 1U,
+                                               memory_order_relaxed,
+                                               memory_order_relaxed)) {
+    return -EAGAIN;
+  }
+
+  atomic_thread_fence(memory_order_release);
+
+  atomic_store_explicit(&entry->key, key, memory_order_relaxed);
+  atomic_store_explicit(&entry->ref, false, memory_order_relaxed);
+
+  int ret = frpp_printf_signature_build((const char *)key, &entry->sig);
+  if (ret != 0) {
+    entry->sig.count = FRPP_PRINTF_CACHE_NEGATIVE;
+  }
+
+  memcpy(sig, &entry->sig, sizeof(*sig));
+
+  atomic_store_explicit(&entry->seq, seq + 2U, memory_order_release);
+
+  return (ret != 0) ? -ENOENT : 0;
+}
+#endif
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_printf_signature_build(const char *fmt_str,
+                                struct frpp_printf_signature *sig) {
+  if (fmt_str == NULL || sig == NULL) {
+    return -EINVAL;
+  }
+
+  struct frpp_printf_pos_args pos;
+  struct frpp_printf_spec spec;
+  const char *ptr = fmt_str;
+  size_t size = 0;
+  uint8_t count = 0;
+
+  // Positional arguments are packaged in va_list order, not specifier order
+  int positional = frpp_printf_parse_positions(fmt_str, &pos);
+  if (positional < 0) {
+    return positional;
+  }
+
+  if (positional) {
+    if (pos.count > FRPP_PRINTF_CACHE_MAX_ARGS) {
+      return -E2BIG;
+    }
+
+    for (; count < pos.count; count++) {
+      sig->types[count] = pos.types[count];
+      sig->offsets[count] = (uint16_t)size;
+      size += frpp_printf_arg_size((frpp_printf_arg_t)pos.types[count]);
+    }
+  } else {
+    while ((ptr = frpp_printf_parse_next(ptr, &spec)) != NULL) {
+      frpp_printf_arg_t types[FRPP_PRINTF_SPEC_ARGS_MAX];
+      size_t n = frpp_printf_spec_args(&spec, types);
+
+      for (size_t i = 0; i < n; i++) {
+        if (count >= FRPP_PRINTF_CACHE_MAX_ARGS || size > UINT16_MAX) {
+          return -E2BIG;
+        }
+
+        sig->types[count] = (uint8_t)types[i];
+        sig->offsets[count] = (uint16_t)size;
+        size += frpp_printf_arg_size(types[i]);
+        count++;
+      }
+    }
+  }
+
+  if (size > UINT16_MAX) {
+    return -E2BIG;
+  }
+
+  sig->size = (uint16_t)size;
+  sig->count = count;
+
+  return 0;
+}
+
+int frpp_printf_cache_lookup(const char *fmt_str,
+                             struct frpp_printf_signature *sig) {
+#if FRPP_PRINTF_CACHE_SIZE > 0
+  const uintptr_t key = (uintptr_t)fmt_str;
+  size_t idx = prv_hash(key);
+  struct prv_cache_entry *victim = NULL;
+  struct prv_cache_entry *home = &prv_cache[idx];
+
+  for (size_t probe = 0; probe < FRPP_PRINTF_CACHE_MAX_PROBE; probe++) {
+    struct prv_cache_entry *entry = &prv_cache[idx];
+    uint_least32_t seq =
+        atomic_load_explicit(&entry->seq, memory_order_acquire);
+    uintptr_t cur = atomic_load_explicit(&entry->key, memory_order_relaxed);
+
+    idx = (idx + 1) & (FRPP_PRINTF_CACHE_SIZE - 1);
+
+    if (cur == key) {
+      if (prv_entry_read(entry, key, sig) != 0) {
+        // Being replaced, by a thread that has already parsed it
+        atomic_fetch_add_explicit(&prv_misses, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&prv_uncacheable, 1, memory_order_relaxed);
+        return -ENOENT;
+      }
+
+      if (sig->count == FRPP_PRINTF_CACHE_NEGATIVE) {
+        atomic_fetch_add_explicit(&prv_uncacheable, 1, memory_order_relaxed);
+        return -ENOENT;
+      }
+
+      if (!atomic_load_explicit(&entry->ref, memory_order_relaxed)) {
+        atomic_store_explicit(&entry->ref, true, memory_order_relaxed);
+      }
+
+      atomic_fetch_add_explicit(&prv_hits, 1, memory_order_relaxed);
+      return 0;
+    }
+
+    if (cur == 0 && (seq & 1U) == 0) {
+      // Format string can't be further along the run.  If another thread
+      // claims the entry first, keep probing; a duplicate entry for the same
+      // key is harmless.
+      int ret = prv_entry_fill(entry, seq, key, sig);
+      if (ret == -EAGAIN) {
+        continue;
+      }
+
+      atomic_fetch_add_explicit(&prv_misses, 1, memory_order_relaxed);
+      if (ret != 0) {
+        atomic_fetch_add_explicit(&prv_uncacheable, 1, memory_order_relaxed);
+      }
+
+      return ret;
+    }
+
+    // Second chance: pass over entries hit since the last eviction, clearing
+    // their mark, and replace the first one that wasn't
+    if (victim == NULL && (seq & 1U) == 0 &&
+        !atomic_exchange_explicit(&entry->ref, false, memory_order_relaxed)) {
+      victim = entry;
+    }
+  }
+
+  atomic_fetch_add_explicit(&prv_misses, 1, memory_order_relaxed);
+
+  // Every entry of the run was hit recently, replace the first
+  if (victim == NULL) {
+    victim = home;
+  }
+
+  uint_least32_t seq = atomic_load_explicit(&victim->seq, memory_order_acquire);
+  int ret = ((seq & 1U) == 0) ? prv_entry_fill(victim, seq, key, sig) : -EAGAIN;
+
+  if (ret != -EAGAIN) {
+    atomic_fetch_add_explicit(&prv_evictions, 1, memory_order_relaxed);
+  }
+
+  if (ret != 0) {
+    atomic_fetch_add_explicit(&prv_uncacheable, 1, memory_order_relaxed);
+    return -ENOENT;
+  }
+
+  return 0;
+#else
+  (void)fmt_str;
+  (void)sig;
+
+  atomic_fetch_add_explicit(&prv_misses, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&prv_uncacheable, 1, memory_order_relaxed);
+  return -ENOENT;
+#endif
+}
+
+void frpp_printf_cache_get_stats(struct frpp_printf_cache_stats *stats) {
+  if (stats == NULL) {
+    return;
+  }
+
+  stats->hits = atomic_load_explicit(&prv_hits, memory_order_relaxed);
+  stats->misses = atomic_load_explicit(&prv_misses, memory_order_relaxed);
+  stats->uncacheable =
+      atomic_load_explicit(&prv_uncacheable, memory_order_relaxed);
+  stats->evictions =
+      atomic_load_explicit(&prv_evictions, memory_order_relaxed);
+}
+
+void frpp_printf_cache_reset(void) {
+#if FRPP_PRINTF_CACHE_SIZE > 0
+  for (size_t i = 0; i < FRPP_PRINTF_CACHE_SIZE; i++) {
+    atomic_store_explicit(&prv_cache[i].key, 0, memory_order_relaxed);
+    atomic_store_explicit(&prv_cache[i].ref, false, memory_order_relaxed);
+  }
+#endif
+
+  atomic_store_explicit(&prv_hits, 0, memory_order_relaxed);
+  atomic_store_explicit(&prv_misses, 0, memory_order_relaxed);
+  atomic_store_explicit(&prv_uncacheable, 0, memory_order_relaxed);
+  atomic_store_explicit(&prv_evictions, 0, memory_order_relaxed);
+}
@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_printf_parse.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/sys/frpp_printf_parse.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "frpp/utils/utils.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Determine argument type from length modifier and conversion
+ *
+ * @param length Length modifier
+ * @param conversion Conversion character
+ * @return Argument type
+ */
+static frpp_printf_arg_t prv_arg_type(frpp_printf_len_t length,
+                                      char conversion) {
+  switch (conversion) {
+  case 'd':
+  case 'i':
+  case 'o':
+  case 'u':
+  case 'x':
+  case 'X':
+    switch (length) {
+    case FRPP_PRINTF_LEN_L:
+      return FRPP_PRINTF_ARG_LONG;
+    case FRPP_PRINTF_LEN_LL:
+      return FRPP_PRINTF_ARG_LONG_LONG;
+    case FRPP_PRINTF_LEN_Z:
+      return FRPP_PRINTF_ARG_SIZE;
+    case FRPP_PRINTF_LEN_T:
+      return FRPP_PRINTF_ARG_PTRDIFF;
+    case FRPP_PRINTF_LEN_J:
+      return FRPP_PRINTF_ARG_INTMAX;
+    default:
+      // Short types are promoted to int
+      return FRPP_PRINTF_ARG_INT;
+    }
+
+  case 'c':
+    return (length == FRPP_PRINTF_LEN_L) ? FRPP_PRINTF_ARG_WINT
+                                         : FRPP_PRINTF_ARG_INT;
+
+  case 's':
+    return (length == FRPP_PRINTF_LEN_L) ? FRPP_PRINTF_ARG_WSTR
+                                         : FRPP_PRINTF_ARG_STR;
+
+  case 'p':
+  case 'n':
+    return FRPP_PRINTF_ARG_PTR;
+
+  case 'f':
+  case 'F':
+  case 'e':
+  case 'E':
+  case 'g':
+  case 'G':
+  case 'a':
+  case 'A':
+    return (length == FRPP_PRINTF_LEN_BIG_L) ? FRPP_PRINTF_ARG_LONG_DOUBLE
+                                             : FRPP_PRINTF_ARG_DOUBLE;
+
+  case '@':
+    return FRPP_PRINTF_ARG_UDT;
+
+  default:
+    return FRPP_PRINTF_ARG_NONE;
+  }
+}
+
+/**
+ * @brief Parse a run of decimal digits
+ *
+ * @param ptr Pointer to position in format string, advanced past digits
+ * @return Parsed value
+ */
+static int prv_parse_int(const char **ptr) {
+  int val = 0;
+
+  while (**ptr >= '0' && **ptr <= '9') {
+    val = (val * 10) + (**ptr - '0');
+    (*ptr)++;
+  }
+
+  return val;
+}
+
+/**
+ * @brief Parse an argument position, digits followed by '$'
+ *
+ * @param ptr Pointer to position in format string, advanced past the '$' if
+ * there is one
+ * @return Position, clamped to UINT8_MAX, or 0 if there is none
+ */
+static uint8_t prv_parse_pos(const char **ptr) {
+  const char *cur = *ptr;
+
+  if (*cur < '1' || *cur > '9') {
+    return 0;
+  }
+
+  int val = 0;
+
+  while (*cur >= '0' && *cur <= '9') {
+    val = (val < UINT8_MAX) ? (val * 10) + (*cur - '0') : val;
+    cur++;
+  }
+
+  if (*cur != '$') {
+    return 0;
+  }
+
+  *ptr = cur + 1;
+
+  return (uint8_t)((val < UINT8_MAX) ? val : UINT8_MAX);
+}
+
+/**
+ * @brief Record the type of a positional argument
+ *
+ * @param args Argument types
+ * @param pos 1-based position, 0 if the argument was taken in order
+ * @param arg Argument type
+ * @retval 0 Success
+ * @retval -EINVAL Argument taken in order, or position already has another
+ * type
+ * @retval -E2BIG Position exceeds FRPP_PRINTF_POS_ARGS_MAX
+ */
+static int prv_pos_set(struct frpp_printf_pos_args *args, uint8_t pos,
+                       frpp_printf_arg_t arg) {
+  if (pos == 0) {
+    return -EINVAL;
+  }
+
+  if (pos > FRPP_PRINTF_POS_ARGS_MAX) {
+    return -E2BIG;
+  }
+
+  uint8_t *type = &args->types[pos - 1];
+
+  if (*type != FRPP_PRINTF_ARG_NONE && *type != (uint8_t)arg) {
+    return -EINVAL;
+  }
+
+  *type = (uint8_t)arg;
+
+  if (pos > args->count) {
+    args->count = pos;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+const char *frpp_printf_parse_next(const char *ptr,
+                                   struct frpp_printf_spec *spec) {
+  ptr = strchr(ptr, '%');
+  if (ptr == NULL) {
+    return NULL;
+  }
+
+  spec->start = ptr;
+
+  // Increment to specifier after %
+  ptr++;
+
+  spec->pos = prv_parse_pos(&ptr);
+  spec->width_pos = 0;
+  spec->prec_pos = 0;
+
+  // Flags, and width and precision given inline, don't have any impact on
+  // package layout, but are recorded for the renderer.  Ones given as '*'
+  // each consume an int argument before the value.
+  uint8_t flags = 0;
+  for (;; ptr++) {
+    if (*ptr == '-') {
+      flags |= FRPP_PRINTF_SPEC_LEFT;
+    } else if (*ptr == '+') {
+      flags |= FRPP_PRINTF_SPEC_PLUS;
+    } else if (*ptr == ' ') {
+      flags |= FRPP_PRINTF_SPEC_SPACE;
+    } else if (*ptr == '#') {
+      flags |= FRPP_PRINTF_SPEC_ALT;
+    } else if (*ptr == '0') {
+      flags |= FRPP_PRINTF_SPEC_ZERO;
+    } else {
+      break;
+    }
+  }
+
+  spec->width = -1;
+  spec->precision = -1;
+
+  if (*ptr == '*') {
+    ptr++;
+    flags |= FRPP_PRINTF_SPEC_WIDTH_ARG;
+    spec->width_pos = prv_parse_pos(&ptr);
+  } else if (*ptr >= '0' && *ptr <= '9') {
+    spec->width = prv_parse_int(&ptr);
+  }
+
+  if (*ptr == '.') {
+    ptr++;
+
+    if (*ptr == '*') {
+      ptr++;
+      flags |= FRPP_PRINTF_SPEC_PREC_ARG;
+      spec->prec_pos = prv_parse_pos(&ptr);
+    } else {
+      spec->precision = prv_parse_int(&ptr);
+    }
+  }
+
+  spec->flags = flags;
+
+  frpp_printf_len_t length = FRPP_PRINTF_LEN_NONE;
+  switch (*ptr) {
+  case 'h':
+    ptr++;
+    length = FRPP_PRINTF_LEN_H;
+    if (*ptr == 'h') {
+      ptr++;
+      length = FRPP_PRINTF_LEN_HH;
+    }
+    break;
+
+  case 'l':
+    ptr++;
+    length = FRPP_PRINTF_LEN_L;
+    if (*ptr == 'l') {
+      ptr++;
+      length = FRPP_PRINTF_LEN_LL;
+    }
+    break;
+
+  case 'z':
+    ptr++;
+    length = FRPP_PRINTF_LEN_Z;
+    break;
+
+  case 't':
+    ptr++;
+    length = FRPP_PRINTF_LEN_T;
+    break;
+
+  case 'j':
+    ptr++;
+    length = FRPP_PRINTF_LEN_J;
+    break;
+
+  case 'L':
+    ptr++;
+    length = FRPP_PRINTF_LEN_BIG_L;
+    break;
+
+  default:
+    break;
+  }
+
+  spec->length = (uint8_t)length;
+  spec->conversion = *ptr;
+  spec->arg = prv_arg_type(length, *ptr);
+
+  // A trailing lone '%' or length modifier ends at the NULL terminator
+  if (*ptr) {
+    ptr++;
+  }
+
+  spec->end = ptr;
+
+  return ptr;
+}
+
+size_t frpp_printf_spec_args(const struct frpp_printf_spec *spec,
+                             frpp_printf_arg_t *types) {
+  size_t count = 0;
+
+  if (spec->flags & FRPP_PRINTF_SPEC_WIDTH_ARG) {
+    types[count++] = FRPP_PRINTF_ARG_INT;
+  }
+
+  if (spec->flags & FRPP_PRINTF_SPEC_PREC_ARG) {
+    types[count++] = FRPP_PRINTF_ARG_INT;
+  }
+
+  if (spec->arg != FRPP_PRINTF_ARG_NONE) {
+    types[count++] = spec->arg;
+  }
+
+  return count;
+}
+
+int frpp_printf_parse_positions(const char *fmt_str,
+                                struct frpp_printf_pos_args *args) {
+  struct frpp_printf_spec spec;
+  const char *ptr = fmt_str;
+  bool first = true;
+  bool positional = false;
+
+  memset(args, 0, sizeof(*args));
+
+  while ((ptr = frpp_printf_parse_next(ptr, &spec)) != NULL) {
+    const bool width = (spec.flags & FRPP_PRINTF_SPEC_WIDTH_ARG) != 0;
+    const bool prec = (spec.flags & FRPP_PRINTF_SPEC_PREC_ARG) != 0;
+    const bool value = spec.arg != FRPP_PRINTF_ARG_NONE;
+    const bool numbered =
+        spec.pos != 0 || spec.width_pos != 0 || spec.prec_pos != 0;
+
+    if (!width && !prec && !value) {
+      continue;
+    }
+
+    // The first specifier that takes an argument decides the mode
+    if (first) {
+      positional = numbered;
+      first = false;
+    }
+
+    // Positions after in-order arguments are mixed just the same
+    if (!positional) {
+      if (numbered) {
+        return -EINVAL;
+      }
+
+      continue;
+    }
+
+    int ret = 0;
+
+    if (width) {
+      ret = prv_pos_set(args, spec.width_pos, FRPP_PRINTF_ARG_INT);
+    }
+
+    if (ret == 0 && prec) {
+      ret = prv_pos_set(args, spec.prec_pos, FRPP_PRINTF_ARG_INT);
+    }
+
+    if (ret == 0 && value) {
+      ret = prv_pos_set(args, spec.pos, spec.arg);
+    }
+
+    if (ret < 0) {
+      return ret;
+    }
+  }
+
+  if (!positional) {
+    return 0;
+  }
+
+  // Types of unreferenced arguments, and so their slots, are unknown
+  for (uint8_t i = 0; i < args->count; i++) {
+    if (args->types[i] == FRPP_PRINTF_ARG_NONE) {
+      return -EINVAL;
+    }
+  }
+
+  return 1;
+}
+
+size_t frpp_printf_arg_size(frpp_printf_arg_t arg) {
+  switch (arg) {
+  case FRPP_PRINTF_ARG_INT:
+    return FRPP_VA_STACK_ALIGN(int);
+  case FRPP_PRINTF_ARG_LONG:
+    return FRPP_VA_STACK_ALIGN(long);
+  case FRPP_PRINTF_ARG_LONG_LONG:
+    return FRPP_VA_STACK_ALIGN(long long);
+  case FRPP_PRINTF_ARG_SIZE:
+    return FRPP_VA_STACK_ALIGN(size_t);
+  case FRPP_PRINTF_ARG_PTRDIFF:
+    return FRPP_VA_STACK_ALIGN(ptrdiff_t);
+  case FRPP_PRINTF_ARG_INTMAX:
+    return FRPP_VA_STACK_ALIGN(intmax_t);
+  case FRPP_PRINTF_ARG_STR:
+    return FRPP_VA_STACK_ALIGN(char *);
+  case FRPP_PRINTF_ARG_PTR:
+    return FRPP_VA_STACK_ALIGN(void *);
+  case FRPP_PRINTF_ARG_DOUBLE:
+    return FRPP_VA_STACK_ALIGN(double);
+  case FRPP_PRINTF_ARG_UDT:
+    return FRPP_VA_STACK_ALIGN(void *);
+  case FRPP_PRINTF_ARG_WINT:
+    return FRPP_VA_STACK_ALIGN(wint_t);
+  case FRPP_PRINTF_ARG_WSTR:
+    return FRPP_VA_STACK_ALIGN(wchar_t *);
+  case FRPP_PRINTF_ARG_LONG_DOUBLE:
+    return FRPP_VA_STACK_ALIGN(long double);
+  default:
+    return 0;
+  }
+}
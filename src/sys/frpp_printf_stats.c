@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_printf_stats.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/sys/frpp_printf_stats.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+#if FRPP_PRINTF_STATS
+/**
+ * @brief Counters of a call site.  In a thread's own table only that thread
+ * writes, so updates are a relaxed load and store rather than a
+ * read-modify-write, and atomics only keep concurrent readers well defined.
+ * The shared table uses read-modify-writes.
+ */
+struct prv_site {
+  atomic_uintptr_t key;
+  atomic_uint_least32_t packages;
+  atomic_uint_least32_t enospc;
+  atomic_uint_least64_t package_bytes;
+  atomic_uint_least64_t package_cycles;
+  atomic_uint_least32_t renders;
+  atomic_uint_least64_t render_cycles;
+};
+
+/**
+ * @brief Table of a single thread, or the shared table
+ */
+struct prv_table {
+  struct prv_site sites[FRPP_PRINTF_STATS_SITES];
+};
+#endif
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+#if FRPP_PRINTF_STATS
+/* Table of threads without one of their own */
+static struct prv_table prv_shared;
+
+static atomic_uint_fast32_t prv_dropped;
+
+#if FRPP_PRINTF_STATS_TLS
+static struct prv_table prv_tables[FRPP_PRINTF_STATS_THREADS];
+
+/* Number of tables handed out (may exceed FRPP_PRINTF_STATS_THREADS) */
+static atomic_size_t prv_table_count;
+
+#ifndef FRPP_PRINTF_STATS_TLS_GET
+/* Table of calling thread, NULL until its first instrumented call */
+static _Thread_local void *prv_self_table;
+
+#define FRPP_PRINTF_STATS_TLS_GET() (prv_self_table)
+#define FRPP_PRINTF_STATS_TLS_SET(ptr_) (prv_self_table = (ptr_))
+#endif
+#endif
+#endif
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+#if FRPP_PRINTF_STATS
+/**
+ * @brief Hash a format string pointer to a starting slot
+ *
+ * @param key Format string pointer
+ * @return Slot index
+ */
+static inline size_t prv_hash(uintptr_t key) {
+  uint32_t hash = (uint32_t)(key ^ (key >> 16)) * 0x9E3779B1U;
+  return (hash >> 16) & (FRPP_PRINTF_STATS_SITES - 1);
+}
+
+/**
+ * @brief Add to a counter of a call site
+ *
+ * @param shared_ Whether counter is in the shared table
+ */
+#define PRV_ADD(shared_, counter_, val_)                                       \
+  do {                                                                         \
+    if (shared_) {                                                             \
+      atomic_fetch_add_explicit(&(counter_), (val_), memory_order_relaxed);    \
+    } else {                                                                   \
+      atomic_store_explicit(                                                   \
+          &(counter_),                                                         \
+          atomic_load_explicit(&(counter_), memory_order_relaxed) + (val_),    \
+          memory_order_relaxed);                                               \
+    }                                                                          \
+  } while (0)
+
+/**
+ * @brief Table of calling thread, handing it one on its first instrumented
+ * call
+ *
+ * @return Thread's own table, or the shared table
+ */
+static struct prv_table *prv_self(void) {
+#if FRPP_PRINTF_STATS_TLS
+  struct prv_table *table = FRPP_PRINTF_STATS_TLS_GET();
+
+  if (table == NULL) {
+    size_t idx =
+        atomic_fetch_add_explicit(&prv_table_count, 1, memory_order_relaxed);
+
+    table = (idx < FRPP_PRINTF_STATS_THREADS) ? &prv_tables[idx] : &prv_shared;
+    FRPP_PRINTF_STATS_TLS_SET(table);
+  }
+
+  return table;
+#else
+  return &prv_shared;
+#endif
+}
+
+/**
+ * @brief Table by index, the shared table following the threads' own
+ *
+ * @param t Index
+ * @param own Number of threads' own tables
+ * @return Table
+ */
+static struct prv_table *prv_table(size_t t, size_t own) {
+#if FRPP_PRINTF_STATS_TLS
+  if (t < own) {
+    return &prv_tables[t];
+  }
+#else
+  (void)t;
+  (void)own;
+#endif
+
+  return &prv_shared;
+}
+
+/**
+ * @brief Number of threads' own tables
+ *
+ * @param handed_out Only count tables handed out so far
+ * @return Number of tables
+ */
+static size_t prv_own_tables(bool handed_out) {
+#if FRPP_PRINTF_STATS_TLS
+  size_t count = FRPP_PRINTF_STATS_THREADS;
+
+  if (handed_out) {
+    size_t used = atomic_load_explicit(&prv_table_count, memory_order_relaxed);
+    count = (used < count) ? used : count;
+  }
+
+  return count;
+#else
+  (void)handed_out;
+  return 0;
+#endif
+}
+
+/**
+ * @brief Find or insert counters of a call site
+ *
+ * @param table Calling thread's table
+ * @param fmt_str Format string
+ * @return Counters, or NULL if the table is full
+ */
+static struct prv_site *prv_site(struct prv_table *table,
+                                 const char *fmt_str) {
+  const uintptr_t key = (uintptr_t)fmt_str;
+  size_t idx = prv_hash(key);
+
+  for (size_t probe = 0; probe < FRPP_PRINTF_STATS_SITES; probe++) {
+    struct prv_site *site = &table->sites[idx];
+    uintptr_t cur = atomic_load_explicit(&site->key, memory_order_relaxed);
+
+    // Counters of a free slot are zero, so readers may see the key first.
+    // Threads sharing a table may race for the slot.
+    if (cur == 0 && atomic_compare_exchange_strong_explicit(
+                        &site->key, &cur, key, memory_order_release,
+                        memory_order_relaxed)) {
+      return site;
+    }
+
+    if (cur == key) {
+      return site;
+    }
+
+    idx = (idx + 1) & (FRPP_PRINTF_STATS_SITES - 1);
+  }
+
+  return NULL;
+}
+#endif
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+void frpp_printf_stats_package(const char *fmt_str, int ret, uint64_t cycles) {
+#if FRPP_PRINTF_STATS
+  struct prv_table *table = prv_self();
+  struct prv_site *site = prv_site(table, fmt_str);
+  bool shared = (table == &prv_shared);
+
+  if (site == NULL) {
+    atomic_fetch_add_explicit(&prv_dropped, 1, memory_order_relaxed);
+    return;
+  }
+
+  PRV_ADD(shared, site->packages, 1);
+  PRV_ADD(shared, site->package_cycles, cycles);
+
+  if (ret == -ENOSPC) {
+    PRV_ADD(shared, site->enospc, 1);
+  } else if (ret > 0) {
+    PRV_ADD(shared, site->package_bytes, (uint64_t)ret);
+  }
+#else
+  (void)fmt_str;
+  (void)ret;
+  (void)cycles;
+#endif
+}
+
+void frpp_printf_stats_render(const char *fmt_str, uint64_t cycles) {
+#if FRPP_PRINTF_STATS
+  struct prv_table *table = prv_self();
+  struct prv_site *site = prv_site(table, fmt_str);
+  bool shared = (table == &prv_shared);
+
+  if (site == NULL) {
+    atomic_fetch_add_explicit(&prv_dropped, 1, memory_order_relaxed);
+    return;
+  }
+
+  PRV_ADD(shared, site->renders, 1);
+  PRV_ADD(shared, site->render_cycles, cycles);
+#else
+  (void)fmt_str;
+  (void)cycles;
+#endif
+}
+
+int frpp_printf_stats_read(struct frpp_printf_stats_site *sites, size_t max) {
+  if (sites == NULL && max != 0) {
+    return -EINVAL;
+  }
+
+#if FRPP_PRINTF_STATS
+  size_t tables = prv_own_tables(true);
+  size_t count = 0;
+
+  for (size_t t = 0; t <= tables; t++) {
+    for (size_t i = 0; i < FRPP_PRINTF_STATS_SITES; i++) {
+      const struct prv_site *site = &prv_table(t, tables)->sites[i];
+      uintptr_t key = atomic_load_explicit(&site->key, memory_order_acquire);
+
+      if (key == 0) {
+        continue;
+      }
+
+      // Merge with the same call site seen in another table
+      size_t idx = 0;
+      while (idx < count && (uintptr_t)sites[idx].fmt != key) {
+        idx++;
+      }
+
+      if (idx == count) {
+        if (count == max) {
+          continue;
+        }
+
+        sites[idx] = (struct frpp_printf_stats_site){.fmt = (const char *)key};
+        count++;
+      }
+
+      struct frpp_printf_stats_site *out = &sites[idx];
+      out->packages +=
+          atomic_load_explicit(&site->packages, memory_order_relaxed);
+      out->enospc += atomic_load_explicit(&site->enospc, memory_order_relaxed);
+      out->package_bytes +=
+          atomic_load_explicit(&site->package_bytes, memory_order_relaxed);
+      out->package_cycles +=
+          atomic_load_explicit(&site->package_cycles, memory_order_relaxed);
+      out->renders +=
+          atomic_load_explicit(&site->renders, memory_order_relaxed);
+      out->render_cycles +=
+          atomic_load_explicit(&site->render_cycles, memory_order_relaxed);
+    }
+  }
+
+  return (int)count;
+#else
+  return -ENOTSUP;
+#endif
+}
+
+uint32_t frpp_printf_stats_dropped(void) {
+#if FRPP_PRINTF_STATS
+  return atomic_load_explicit(&prv_dropped, memory_order_relaxed);
+#else
+  return 0;
+#endif
+}
+
+void frpp_printf_stats_reset(void) {
+#if FRPP_PRINTF_STATS
+  size_t tables = prv_own_tables(false);
+
+  // Threads keep their tables, only the contents are cleared
+  for (size_t t = 0; t <= tables; t++) {
+    for (size_t i = 0; i < FRPP_PRINTF_STATS_SITES; i++) {
+      struct prv_site *site = &prv_table(t, tables)->sites[i];
+
+      atomic_store_explicit(&site->key, 0, memory_order_relaxed);
+      atomic_store_explicit(&site->packages, 0, memory_order_relaxed);
+      atomic_store_explicit(&site->enospc, 0, memory_order_relaxed);
+      atomic_store_explicit(&site->package_bytes, 0, memory_order_relaxed);
+      atomic_store_explicit(&site->package_cycles, 0, memory_order_relaxed);
+      atomic_store_explicit(&site->renders, 0, memory_order_relaxed);
+      atomic_store_explicit(&site->render_cycles, 0, memory_order_relaxed);
+    }
+  }
+
+  atomic_store_explicit(&prv_dropped, 0, memory_order_relaxed);
+#endif
+}
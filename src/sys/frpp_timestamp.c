@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_timestamp.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#if defined(__linux__)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "frpp/sys/frpp_timestamp.h"
+
+#include <errno.h>
+
+#if defined(__linux__)
+#include <time.h>
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Payload bits per varint byte.  The top bit marks more bytes follow.
+ */
+#define PRV_VARINT_BITS (7U)
+
+#define PRV_VARINT_MORE (0x80U)
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+uint64_t frpp_timestamp_cycles(void) {
+#if defined(FRPP_TIMESTAMP_CYCLES)
+  return FRPP_TIMESTAMP_CYCLES();
+#else
+  return FRPP_TIMESTAMP_MONOTONIC();
+#endif
+}
+
+uint64_t frpp_timestamp_monotonic(void) { return FRPP_TIMESTAMP_MONOTONIC(); }
+
+#if defined(__aarch64__)
+uint64_t frpp_timestamp_cntvct(void) {
+  uint64_t val;
+
+  __asm__ volatile("mrs %0, cntvct_el0" : "=r"(val));
+
+  return val;
+}
+#endif
+
+#if defined(__linux__)
+uint64_t frpp_timestamp_clock_monotonic(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+size_t frpp_timestamp_delta_encode(uint64_t ts, uint64_t prev, uint8_t *dst) {
+  // Differences wrap, so any pair of timestamps round trips
+  uint64_t diff = ts - prev;
+  uint64_t val = (diff << 1) ^ (uint64_t)-(int64_t)(diff >> 63);
+  size_t len = 0;
+
+  while (val >= PRV_VARINT_MORE) {
+    dst[len++] = (uint8_t)(val | PRV_VARINT_MORE);
+    val >>= PRV_VARINT_BITS;
+  }
+
+  dst[len++] = (uint8_t)val;
+
+  return len;
+}
+
+int frpp_timestamp_delta_decode(const uint8_t *src, size_t len, uint64_t prev,
+                                uint64_t *ts) {
+  if (src == NULL || ts == NULL) {
+    return -EINVAL;
+  }
+
+  uint64_t val = 0;
+
+  for (size_t i = 0; i < len && i < FRPP_TIMESTAMP_DELTA_MAX; i++) {
+    val |= (uint64_t)(src[i] & ~PRV_VARINT_MORE) << (i * PRV_VARINT_BITS);
+
+    if ((src[i] & PRV_VARINT_MORE) == 0) {
+      *ts = prev + ((val >> 1) ^ (uint64_t)-(int64_t)(val & 1));
+      return (int)(i + 1);
+    }
+  }
+
+  return -EBADMSG;
+}
@@ -0,0 +1,498 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_tlsf.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp/sys/frpp_tlsf.h"
+
+#include <errno.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Block is free
+ */
+#define PRV_FREE (1U)
+
+/**
+ * @brief Physically previous block is free
+ */
+#define PRV_PREV_FREE (2U)
+
+#define PRV_FLAGS (PRV_FREE | PRV_PREV_FREE)
+
+/**
+ * @brief Log2 of FRPP_TLSF_SMALL
+ */
+#define PRV_SMALL_LOG2 (7U)
+
+/**
+ * @brief Bytes each block costs: its size field.  prev_phys lives in the
+ * last bytes of the previous block, which are only unused while it's free.
+ */
+#define PRV_OVERHEAD (sizeof(uint64_t))
+
+/**
+ * @brief Offset of payload from block
+ */
+#define PRV_START (2U * sizeof(uint64_t))
+
+/**
+ * @brief Smallest payload: must hold the free list links and the next
+ * block's prev_phys while free
+ */
+#define PRV_SIZE_MIN                                                           \
+  PRV_ALIGN_UP(sizeof(struct prv_block) - sizeof(uint64_t))
+
+/**
+ * @brief Block sizes must be below this to have a first-level class
+ */
+#define PRV_SIZE_MAX ((size_t)1 << FRPP_TLSF_FL_MAX)
+
+#define PRV_ALIGN_UP(x_)                                                       \
+  (((x_) + FRPP_TLSF_ALIGN - 1U) & ~(size_t)(FRPP_TLSF_ALIGN - 1U))
+
+#define PRV_ALIGN_DOWN(x_) ((x_) & ~(size_t)(FRPP_TLSF_ALIGN - 1U))
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Block header.  Fields are 64 bits wide on every target so payloads
+ * stay 8-byte aligned; next_free and prev_free are only valid while free.
+ */
+struct prv_block {
+  uint64_t prev_phys;
+  uint64_t size;
+  struct prv_block *next_free;
+  struct prv_block *prev_free;
+};
+
+_Static_assert(FRPP_TLSF_SMALL == (1U << PRV_SMALL_LOG2),
+               "PRV_SMALL_LOG2 doesn't match FRPP_TLSF_SMALL");
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Index of highest set bit
+ */
+static inline uint32_t prv_fls(size_t val) {
+  return 63U - (uint32_t)__builtin_clzll((unsigned long long)val);
+}
+
+/**
+ * @brief Index of lowest set bit
+ */
+static inline uint32_t prv_ffs(uint32_t val) {
+  return (uint32_t)__builtin_ctz(val);
+}
+
+static inline size_t prv_size(const struct prv_block *block) {
+  return (size_t)(block->size & ~(uint64_t)PRV_FLAGS);
+}
+
+static inline void *prv_payload(struct prv_block *block) {
+  return (uint8_t *)block + PRV_START;
+}
+
+static inline struct prv_block *prv_from_payload(const void *ptr) {
+  return (struct prv_block *)((uintptr_t)ptr - PRV_START);
+}
+
+static inline struct prv_block *prv_next(const struct prv_block *block) {
+  return (struct prv_block *)((uintptr_t)block + PRV_START + prv_size(block) -
+                              PRV_OVERHEAD);
+}
+
+static inline struct prv_block *prv_prev(const struct prv_block *block) {
+  return (struct prv_block *)(uintptr_t)block->prev_phys;
+}
+
+/**
+ * @brief Mark block free, recording it in the next block
+ */
+static void prv_mark_free(struct prv_block *block) {
+  struct prv_block *next = prv_next(block);
+
+  block->size |= PRV_FREE;
+  next->prev_phys = (uint64_t)(uintptr_t)block;
+  next->size |= PRV_PREV_FREE;
+}
+
+/**
+ * @brief Mark block used, recording it in the next block
+ */
+static void prv_mark_used(struct prv_block *block) {
+  block->size &= ~(uint64_t)PRV_FREE;
+  prv_next(block)->size &= ~(uint64_t)PRV_PREV_FREE;
+}
+
+/**
+ * @brief Get class of size
+ */
+static void prv_mapping(size_t size, uint32_t *fl, uint32_t *sl) {
+  if (size < FRPP_TLSF_SMALL) {
+    *fl = 0;
+    *sl = (uint32_t)(size / FRPP_TLSF_ALIGN);
+    return;
+  }
+
+  uint32_t bit = prv_fls(size);
+
+  *sl = (uint32_t)(size >> (bit - FRPP_TLSF_SL_LOG2)) ^ FRPP_TLSF_SL_COUNT;
+  *fl = bit - (PRV_SMALL_LOG2 - 1U);
+}
+
+/**
+ * @brief Get lowest class whose every block fits size
+ */
+static void prv_mapping_search(size_t size, uint32_t *fl, uint32_t *sl) {
+  if (size >= FRPP_TLSF_SMALL) {
+    size += ((size_t)1 << (prv_fls(size) - FRPP_TLSF_SL_LOG2)) - 1U;
+  }
+
+  prv_mapping(size, fl, sl);
+}
+
+/**
+ * @brief Find head of the lowest non-empty class at or above fl, sl
+ */
+static struct prv_block *prv_find(struct frpp_tlsf *tlsf, uint32_t *fl,
+                                  uint32_t *sl) {
+  uint32_t sl_map = tlsf->sl_bitmap[*fl] & (~0U << *sl);
+
+  if (sl_map == 0) {
+    uint32_t fl_map = tlsf->fl_bitmap & (~0U << (*fl + 1U));
+
+    if (fl_map == 0) {
+      return NULL;
+    }
+
+    *fl = prv_ffs(fl_map);
+    sl_map = tlsf->sl_bitmap[*fl];
+  }
+
+  *sl = prv_ffs(sl_map);
+
+  return (struct prv_block *)tlsf->blocks[*fl][*sl];
+}
+
+static void prv_insert(struct frpp_tlsf *tlsf, struct prv_block *block) {
+  uint32_t fl;
+  uint32_t sl;
+
+  prv_mapping(prv_size(block), &fl, &sl);
+
+  struct prv_block *head = (struct prv_block *)tlsf->blocks[fl][sl];
+
+  block->next_free = head;
+  block->prev_free = NULL;
+
+  if (head != NULL) {
+    head->prev_free = block;
+  }
+
+  tlsf->blocks[fl][sl] = block;
+  tlsf->fl_bitmap |= 1U << fl;
+  tlsf->sl_bitmap[fl] |= 1U << sl;
+}
+
+static void prv_remove(struct frpp_tlsf *tlsf, struct prv_block *block) {
+  struct prv_block *next = block->next_free;
+  struct prv_block *prev = block->prev_free;
+
+  if (next != NULL) {
+    next->prev_free = prev;
+  }
+
+  if (prev != NULL) {
+    prev->next_free = next;
+    return;
+  }
+
+  uint32_t fl;
+  uint32_t sl;
+
+  prv_mapping(prv_size(block), &fl, &sl);
+  tlsf->blocks[fl][sl] = next;
+
+  if (next == NULL) {
+    tlsf->sl_bitmap[fl] &= ~(1U << sl);
+
+    if (tlsf->sl_bitmap[fl] == 0) {
+      tlsf->fl_bitmap &= ~(1U << fl);
+    }
+  }
+}
+
+/**
+ * @brief Find a free block of at least size, or NULL
+ */
+static struct prv_block *prv_locate(struct frpp_tlsf *tlsf, size_t size) {
+  uint32_t fl;
+  uint32_t sl;
+
+  prv_mapping_search(size, &fl, &sl);
+
+  if (fl < FRPP_TLSF_FL_COUNT) {
+    struct prv_block *block = prv_find(tlsf, &fl, &sl);
+
+    if (block != NULL) {
+      return block;
+    }
+  }
+
+  // Classes above are empty, but the head of size's own class may still be
+  // big enough.  One more check keeps the bound and saves near-full heaps.
+  prv_mapping(size, &fl, &sl);
+
+  struct prv_block *block = (struct prv_block *)tlsf->blocks[fl][sl];
+
+  if (block != NULL && prv_size(block) >= size) {
+    return block;
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Split the tail off a block being allocated, if it can hold a block
+ */
+static void prv_split(struct frpp_tlsf *tlsf, struct prv_block *block,
+                      size_t size) {
+  size_t total = prv_size(block);
+
+  if (total < size + PRV_OVERHEAD + PRV_SIZE_MIN) {
+    return;
+  }
+
+  block->size = (uint64_t)size | (block->size & PRV_FLAGS);
+
+  struct prv_block *rest = prv_next(block);
+
+  rest->size = (uint64_t)(total - size - PRV_OVERHEAD);
+  rest->prev_phys = (uint64_t)(uintptr_t)block;
+
+  // The block after rest already has PRV_PREV_FREE set
+  prv_mark_free(rest);
+  prv_insert(tlsf, rest);
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_tlsf_init(struct frpp_tlsf *tlsf, void *mem, size_t size) {
+  if (tlsf == NULL || mem == NULL ||
+      ((uintptr_t)mem & (FRPP_TLSF_ALIGN - 1U)) != 0) {
+    return -EINVAL;
+  }
+
+  // Room for the first block's size field and the sentinel's
+  size = PRV_ALIGN_DOWN(size);
+
+  if (size < 2U * PRV_OVERHEAD + PRV_SIZE_MIN) {
+    return -EINVAL;
+  }
+
+  size_t pool = size - 2U * PRV_OVERHEAD;
+
+  if (pool >= PRV_SIZE_MAX) {
+    pool = PRV_SIZE_MAX - FRPP_TLSF_ALIGN;
+  }
+
+  *tlsf = (struct frpp_tlsf){0};
+
+  // The first block's prev_phys would sit before mem, but is never touched
+  // because no block precedes it
+  struct prv_block *block =
+      (struct prv_block *)((uintptr_t)mem - PRV_OVERHEAD);
+
+  block->size = (uint64_t)pool;
+
+  // Zero-sized used sentinel stops merging past the end
+  struct prv_block *sentinel = prv_next(block);
+
+  sentinel->size = 0;
+
+  prv_mark_free(block);
+  prv_insert(tlsf, block);
+
+  tlsf->first = block;
+  tlsf->total = pool + PRV_OVERHEAD;
+
+  return 0;
+}
+
+void *frpp_tlsf_alloc(struct frpp_tlsf *tlsf, size_t size) {
+  if (tlsf == NULL) {
+    return NULL;
+  }
+
+  struct prv_block *block = NULL;
+
+  if (size < PRV_SIZE_MAX) {
+    size = PRV_ALIGN_UP(size);
+
+    if (size < PRV_SIZE_MIN) {
+      size = PRV_SIZE_MIN;
+    }
+
+    block = prv_locate(tlsf, size);
+  }
+
+  if (block == NULL) {
+    tlsf->failures++;
+    return NULL;
+  }
+
+  prv_remove(tlsf, block);
+  prv_split(tlsf, block, size);
+  prv_mark_used(block);
+
+  tlsf->used += prv_size(block) + PRV_OVERHEAD;
+  tlsf->allocs++;
+
+  if (tlsf->used > tlsf->high_water) {
+    tlsf->high_water = tlsf->used;
+  }
+
+  return prv_payload(block);
+}
+
+void frpp_tlsf_free(struct frpp_tlsf *tlsf, void *ptr) {
+  if (tlsf == NULL || ptr == NULL) {
+    return;
+  }
+
+  struct prv_block *block = prv_from_payload(ptr);
+
+  tlsf->used -= prv_size(block) + PRV_OVERHEAD;
+  tlsf->frees++;
+
+  // Sizes are multiples of the alignment, so adding them keeps the flags
+  if ((block->size & PRV_PREV_FREE) != 0) {
+    struct prv_block *prev = prv_prev(block);
+
+    prv_remove(tlsf, prev);
+    prev->size += prv_size(block) + PRV_OVERHEAD;
+    block = prev;
+  }
+
+  struct prv_block *next = prv_next(block);
+
+  if ((next->size & PRV_FREE) != 0) {
+    prv_remove(tlsf, next);
+    block->size += prv_size(next) + PRV_OVERHEAD;
+  }
+
+  prv_mark_free(block);
+  prv_insert(tlsf, block);
+}
+
+size_t frpp_tlsf_block_size(const void *ptr) {
+  if (ptr == NULL) {
+    return 0;
+  }
+
+  return prv_size(prv_from_payload(ptr));
+}
+
+int frpp_tlsf_stats(struct frpp_tlsf *tlsf, struct frpp_tlsf_stats *stats) {
+  if (tlsf == NULL || stats == NULL || tlsf->first == NULL) {
+    return -EINVAL;
+  }
+
+  size_t free_sum = 0;
+
+  *stats = (struct frpp_tlsf_stats){0};
+
+  for (struct prv_block *block = (struct prv_block *)tlsf->first;
+       prv_size(block) != 0; block = prv_next(block)) {
+    if ((block->size & PRV_FREE) == 0) {
+      continue;
+    }
+
+    size_t size = prv_size(block);
+
+    free_sum += size;
+    stats->free_blocks++;
+
+    if (size > stats->largest_free) {
+      stats->largest_free = size;
+    }
+  }
+
+  if (free_sum != 0) {
+    stats->fragmentation = (uint32_t)(
+        (100U * (uint64_t)(free_sum - stats->largest_free)) / free_sum);
+  }
+
+  stats->total = tlsf->total;
+  stats->used = tlsf->used;
+  stats->free = tlsf->total - tlsf->used;
+  stats->high_water = tlsf->high_water;
+  stats->allocs = tlsf->allocs;
+  stats->frees = tlsf->frees;
+  stats->failures = tlsf->failures;
+
+  return 0;
+}
+
+int frpp_tlsf_package(struct frpp_tlsf *tlsf, void **pkg, uint32_t flags,
+                      const char *fmt_str, ...) {
+  va_list args;
+  va_start(args, fmt_str);
+  int ret = frpp_tlsf_vpackage(tlsf, pkg, flags, fmt_str, args);
+  va_end(args);
+
+  return ret;
+}
+
+int frpp_tlsf_vpackage(struct frpp_tlsf *tlsf, void **pkg, uint32_t flags,
+                       const char *fmt_str, va_list args) {
+  if (tlsf == NULL || pkg == NULL || fmt_str == NULL) {
+    return -EINVAL;
+  }
+
+  va_list copy;
+  va_copy(copy, args);
+  int len = frpp_vprintf_package(NULL, 0, flags, fmt_str, copy);
+  va_end(copy);
+
+  if (len < 0) {
+    return len;
+  }
+
+  void *block = frpp_tlsf_alloc(tlsf, (size_t)len);
+
+  if (block == NULL) {
+    return -ENOMEM;
+  }
+
+  if (len > 0) {
+    // A captured string that grew since sizing no longer fits
+    int ret = frpp_vprintf_package(block, (size_t)len, flags, fmt_str, args);
+
+    if (ret < 0) {
+      frpp_tlsf_free(tlsf, block);
+      return ret;
+    }
+
+    len = ret;
+  }
+
+  *pkg = block;
+
+  return len;
+}
@@ -0,0 +1,486 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_log.c
+ * @author Evan Stoddard
+ * @brief Tests for frpp_log
+ */
+
+#include "unity.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Compile in everything up to INFO, so DEBUG statements are elided */
+#define FRPP_LOG_LEVEL_COMPILE FRPP_LOG_LEVEL_INFO
+
+#include "frpp/logging/frpp_log.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TEST_RING_SIZE (1024U)
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+FRPP_LOG_MODULE_DEFINE(test, FRPP_LOG_LEVEL_INFO);
+FRPP_LOG_MODULE_DEFINE(other, FRPP_LOG_LEVEL_ERROR);
+
+static _Alignas(FRPP_LOG_QUEUE_ALIGN) uint8_t prv_ring[TEST_RING_SIZE];
+
+static struct frpp_log_queue prv_queue;
+
+/* Incremented by arguments to check whether they are evaluated */
+static int prv_evaluated;
+
+/* Ticks of fake tick source */
+static uint32_t prv_ticks;
+
+/* Format strings flooding the rate limiter: one per slot of a set, and one
+ * more */
+static const char *const prv_flood[] = {
+    "flood a %d", "flood b %d", "flood c %d", "flood d %d", "flood e %d",
+};
+
+_Static_assert(sizeof(prv_flood) / sizeof(prv_flood[0]) ==
+                   FRPP_LOG_LIMIT_WAYS + 1,
+               "One flood format string per slot of a set, and one more");
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief Argument with a side effect
+ */
+static int prv_arg(void) {
+  prv_evaluated++;
+  return 7;
+}
+
+/**
+ * @brief Check whether a string appears anywhere in this executable
+ *
+ * @param str String
+ * @return true if found
+ */
+static bool prv_in_image(const char *str) {
+  FILE *file = fopen("/proc/self/exe", "rb");
+  TEST_ASSERT_NOT_NULL(file);
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  char *image = malloc((size_t)size);
+  TEST_ASSERT_NOT_NULL(image);
+  TEST_ASSERT_EQUAL(size, (long)fread(image, 1, (size_t)size, file));
+  fclose(file);
+
+  size_t len = strlen(str);
+  bool found = false;
+
+  for (long i = 0; !found && i + (long)len <= size; i++) {
+    found = memcmp(&image[i], str, len) == 0;
+  }
+
+  free(image);
+
+  return found;
+}
+
+/**
+ * @brief Fake tick source
+ */
+static uint32_t prv_tick(void) { return prv_ticks; }
+
+/**
+ * @brief Log the same format string repeatedly
+ *
+ * @param count Records to log
+ */
+static void prv_log_repeated(int count) {
+  for (int i = 0; i < count; i++) {
+    FRPP_LOG_INF(test, "loop %d", i);
+  }
+}
+
+/**
+ * @brief Render all queued records
+ *
+ * @param last Last record rendered output, may be NULL
+ * @param size Size of last
+ * @return Number of records rendered
+ */
+static unsigned int prv_drain(char *last, size_t size) {
+  char out_buf[64];
+  unsigned int count = 0;
+
+  while (frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)) >= 0) {
+    if (last != NULL) {
+      snprintf(last, size, "%s", out_buf);
+    }
+    count++;
+  }
+
+  return count;
+}
+
+/**
+ * @brief Reverse a string in place
+ */
+static char *prv_reverse(char *str) {
+  size_t len = strlen(str);
+
+  for (size_t i = 0; i < len / 2; i++) {
+    char tmp = str[i];
+    str[i] = str[len - 1 - i];
+    str[len - 1 - i] = tmp;
+  }
+
+  return str;
+}
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {
+  // Forget rate limiting state of earlier tests before resetting the queue
+  prv_ticks = 0;
+  frpp_log_limit_set_tick(prv_tick);
+  frpp_log_limit_flush();
+
+  frpp_log_queue_init(&prv_queue, prv_ring, sizeof(prv_ring));
+  frpp_log_module_set_level(FRPP_LOG_MODULE(test), FRPP_LOG_LEVEL_INFO);
+  frpp_log_module_set_level(FRPP_LOG_MODULE(other), FRPP_LOG_LEVEL_ERROR);
+  prv_evaluated = 0;
+}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test logging before init
+ */
+void test_not_initialized(void) {
+  TEST_ASSERT_EQUAL(-ENODEV, frpp_log_printf("early"));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_init(NULL));
+}
+
+/**
+ * @brief Test enabled statements land in the queue with their prefix
+ */
+void test_enabled(void) {
+  char out_buf[64] = {0};
+
+  FRPP_LOG_INF(test, "value %d", prv_arg());
+  FRPP_LOG_ERR(test, "failed");
+
+  TEST_ASSERT_EQUAL(1, prv_evaluated);
+
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("I [test] value 7", out_buf);
+
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("E [test] failed", out_buf);
+
+  TEST_ASSERT_EQUAL(-EAGAIN,
+                    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+}
+
+/**
+ * @brief Test statements above the compile level are removed entirely
+ */
+void test_compile_elided(void) {
+  char out_buf[64];
+  char needle[] = "rekram_dedile_gol_pprf";
+
+  frpp_log_module_set_level(FRPP_LOG_MODULE(test), FRPP_LOG_LEVEL_DEBUG);
+  FRPP_LOG_DBG(test, "frpp_log_elided_marker %d", prv_arg());
+
+  TEST_ASSERT_EQUAL(0, prv_evaluated);
+  TEST_ASSERT_EQUAL(-EAGAIN,
+                    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+
+  // Needle is only spelled forwards at runtime, so it can only be found if
+  // the statement's format string was compiled in
+  TEST_ASSERT_FALSE(prv_in_image(prv_reverse(needle)));
+
+  char kept[] = "rekram_tpek_gol_pprf";
+  FRPP_LOG_INF(other, "frpp_log_kept_marker");
+  TEST_ASSERT_TRUE(prv_in_image(prv_reverse(kept)));
+}
+
+/**
+ * @brief Test statements below the runtime level are filtered without
+ * evaluating their arguments
+ */
+void test_runtime_filtered(void) {
+  char out_buf[64] = {0};
+
+  FRPP_LOG_INF(other, "value %d", prv_arg());
+  FRPP_LOG_WRN(other, "value %d", prv_arg());
+  TEST_ASSERT_EQUAL(0, prv_evaluated);
+  TEST_ASSERT_EQUAL(-EAGAIN,
+                    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+
+  TEST_ASSERT_EQUAL(0, frpp_log_module_set_level(FRPP_LOG_MODULE(other),
+                                                 FRPP_LOG_LEVEL_WARN));
+  TEST_ASSERT_EQUAL(FRPP_LOG_LEVEL_WARN,
+                    frpp_log_module_get_level(FRPP_LOG_MODULE(other)));
+
+  FRPP_LOG_INF(other, "value %d", prv_arg());
+  FRPP_LOG_WRN(other, "value %d", prv_arg());
+  TEST_ASSERT_EQUAL(1, prv_evaluated);
+
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("W [other] value 7", out_buf);
+
+  TEST_ASSERT_EQUAL(0, frpp_log_module_set_level(FRPP_LOG_MODULE(other),
+                                                 FRPP_LOG_LEVEL_OFF));
+  FRPP_LOG_ERR(other, "value %d", prv_arg());
+  TEST_ASSERT_EQUAL(1, prv_evaluated);
+}
+
+/**
+ * @brief Test records past the burst are folded into one record on flush
+ */
+void test_limit_burst(void) {
+  char out_buf[64] = {0};
+  char expected[32];
+
+  prv_log_repeated(FRPP_LOG_LIMIT_BURST + 12);
+
+  for (unsigned int i = 0; i < FRPP_LOG_LIMIT_BURST; i++) {
+    TEST_ASSERT_GREATER_THAN(
+        0, frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+    snprintf(expected, sizeof(expected), "I [test] loop %u", i);
+    TEST_ASSERT_EQUAL_STRING(expected, out_buf);
+  }
+
+  TEST_ASSERT_EQUAL(-EAGAIN,
+                    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+
+  TEST_ASSERT_EQUAL(1, frpp_log_limit_flush());
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("I [test] loop %d (repeated 12 times)", out_buf);
+
+  // Nothing left to report, and the flush started a new window
+  TEST_ASSERT_EQUAL(0, frpp_log_limit_flush());
+  prv_log_repeated(1);
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("I [test] loop 0", out_buf);
+}
+
+/**
+ * @brief Test records aren't suppressed without a tick source, since their
+ * window would never roll over
+ */
+void test_limit_no_tick(void) {
+  char out_buf[64] = {0};
+  char expected[32];
+
+  frpp_log_limit_set_tick(NULL);
+  prv_log_repeated(FRPP_LOG_LIMIT_BURST + 4);
+
+  for (unsigned int i = 0; i < FRPP_LOG_LIMIT_BURST + 4; i++) {
+    TEST_ASSERT_GREATER_THAN(
+        0, frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+    snprintf(expected, sizeof(expected), "I [test] loop %u", i);
+    TEST_ASSERT_EQUAL_STRING(expected, out_buf);
+  }
+
+  TEST_ASSERT_EQUAL(-EAGAIN,
+                    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+  TEST_ASSERT_EQUAL(0, frpp_log_limit_flush());
+}
+
+/**
+ * @brief Test suppressed records are reported when the window rolls over
+ */
+void test_limit_window(void) {
+  char out_buf[64] = {0};
+
+  prv_ticks = 100;
+  frpp_log_limit_set_tick(prv_tick);
+  frpp_log_limit_flush();
+
+  prv_log_repeated(FRPP_LOG_LIMIT_BURST + 2);
+
+  prv_ticks += FRPP_LOG_LIMIT_WINDOW - 1;
+  prv_log_repeated(1);
+
+  for (unsigned int i = 0; i < FRPP_LOG_LIMIT_BURST; i++) {
+    TEST_ASSERT_GREATER_THAN(
+        0, frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+  }
+
+  TEST_ASSERT_EQUAL(-EAGAIN,
+                    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+
+  prv_ticks += 1;
+  prv_log_repeated(1);
+
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("I [test] loop %d (repeated 3 times)", out_buf);
+
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("I [test] loop 0", out_buf);
+}
+
+/**
+ * @brief Test format strings are limited independently
+ */
+void test_limit_independent(void) {
+  char out_buf[64] = {0};
+
+  prv_log_repeated(FRPP_LOG_LIMIT_BURST + 1);
+  FRPP_LOG_INF(test, "other");
+
+  for (unsigned int i = 0; i < FRPP_LOG_LIMIT_BURST; i++) {
+    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  }
+
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("I [test] other", out_buf);
+  TEST_ASSERT_EQUAL(-EAGAIN,
+                    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+}
+
+/**
+ * @brief Test format strings flooding in turn from the same set are all
+ * suppressed rather than evicting each other
+ */
+void test_limit_shared_set(void) {
+  char last[64];
+  unsigned int rendered = 0;
+
+  for (int round = 0; round < (int)FRPP_LOG_LIMIT_BURST + 2; round++) {
+    for (size_t i = 0; i < FRPP_LOG_LIMIT_WAYS; i++) {
+      TEST_ASSERT_EQUAL(0, frpp_log_printf(prv_flood[i], round));
+    }
+
+    rendered += prv_drain(NULL, 0);
+  }
+
+  TEST_ASSERT_EQUAL(FRPP_LOG_LIMIT_WAYS * FRPP_LOG_LIMIT_BURST, rendered);
+
+  // Reported in slot order
+  TEST_ASSERT_EQUAL(FRPP_LOG_LIMIT_WAYS, frpp_log_limit_flush());
+  TEST_ASSERT_EQUAL(FRPP_LOG_LIMIT_WAYS, prv_drain(last, sizeof(last)));
+  TEST_ASSERT_NOT_NULL(strstr(last, " %d (repeated 2 times)"));
+}
+
+/**
+ * @brief Test a format string new to a full set evicts the least recently
+ * logged one, reporting what it suppressed
+ */
+void test_limit_lru(void) {
+  char out_buf[64] = {0};
+
+  // Fill the set, every format string suppressing one record
+  for (size_t i = 0; i < FRPP_LOG_LIMIT_WAYS; i++) {
+    for (int n = 0; n < (int)FRPP_LOG_LIMIT_BURST + 1; n++) {
+      frpp_log_printf(prv_flood[i], n);
+    }
+  }
+
+  TEST_ASSERT_EQUAL(FRPP_LOG_LIMIT_WAYS * FRPP_LOG_LIMIT_BURST,
+                    prv_drain(NULL, 0));
+
+  // Leave the first one least recently used
+  for (size_t i = 1; i < FRPP_LOG_LIMIT_WAYS; i++) {
+    frpp_log_printf(prv_flood[i], 0);
+  }
+
+  frpp_log_printf(prv_flood[FRPP_LOG_LIMIT_WAYS], 0);
+
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("flood a %d (repeated 1 times)", out_buf);
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("flood e 0", out_buf);
+
+  // The rest are still tracked and suppressed
+  frpp_log_printf(prv_flood[1], 0);
+  TEST_ASSERT_EQUAL(0, prv_drain(NULL, 0));
+  TEST_ASSERT_EQUAL(FRPP_LOG_LIMIT_WAYS - 1, frpp_log_limit_flush());
+}
+
+/**
+ * @brief Test setting invalid levels
+ */
+void test_set_level_invalid(void) {
+  TEST_ASSERT_EQUAL(-EINVAL,
+                    frpp_log_module_set_level(NULL, FRPP_LOG_LEVEL_INFO));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_module_set_level(
+                                 FRPP_LOG_MODULE(test), FRPP_LOG_LEVEL_DEBUG + 1));
+  TEST_ASSERT_EQUAL(FRPP_LOG_LEVEL_INFO,
+                    frpp_log_module_get_level(FRPP_LOG_MODULE(test)));
+}
+
+/**
+ * @brief Test modules can be listed and looked up by name
+ */
+void test_module_find(void) {
+  size_t count;
+  struct frpp_log_module *mods = frpp_log_modules(&count);
+
+  TEST_ASSERT_EQUAL(2, count);
+  TEST_ASSERT_NOT_NULL(mods);
+
+  TEST_ASSERT_EQUAL_PTR(FRPP_LOG_MODULE(test), frpp_log_module_find("test"));
+  TEST_ASSERT_EQUAL_PTR(FRPP_LOG_MODULE(other), frpp_log_module_find("other"));
+  TEST_ASSERT_NULL(frpp_log_module_find("missing"));
+  TEST_ASSERT_NULL(frpp_log_module_find(NULL));
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Must run before frpp_log_init
+  RUN_TEST(test_not_initialized);
+
+  frpp_log_init(&prv_queue);
+
+  // Filtering tests
+  RUN_TEST(test_enabled);
+  RUN_TEST(test_compile_elided);
+  RUN_TEST(test_runtime_filtered);
+
+  // Rate limiting tests
+  RUN_TEST(test_limit_burst);
+  RUN_TEST(test_limit_window);
+  RUN_TEST(test_limit_no_tick);
+  RUN_TEST(test_limit_independent);
+  RUN_TEST(test_limit_shared_set);
+  RUN_TEST(test_limit_lru);
+
+  // Module tests
+  RUN_TEST(test_set_level_invalid);
+  RUN_TEST(test_module_find);
+
+  return UNITY_END();
+}
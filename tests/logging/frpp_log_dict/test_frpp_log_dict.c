@@ -0,0 +1,546 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_log_dict.c
+ * @author Evan Stoddard
+ * @brief Tests for frpp_log_dict and the host decoder
+ */
+
+#include "unity.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "frpp/logging/frpp_log_dict.h"
+#include "frpp/logging/frpp_log_fmt.h"
+#include "frpp/utils/utils.h"
+#include "frpp_elf.h"
+#include "frpp_log_decode.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TEST_STREAM_SIZE (1024U)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief In-memory sink
+ */
+struct test_sink {
+  uint8_t buf[TEST_STREAM_SIZE];
+  size_t len;
+};
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static struct test_sink prv_sink;
+static struct frpp_log_dict prv_dict;
+static struct frpp_elf prv_elf;
+static struct frpp_log_decoder prv_dec;
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief Sink appending frames to prv_sink
+ */
+static int prv_sink_write(void *ctx, const void *data, size_t len) {
+  struct test_sink *sink = ctx;
+
+  if (sink->len + len > sizeof(sink->buf)) {
+    return -ENOSPC;
+  }
+
+  memcpy(&sink->buf[sink->len], data, len);
+  sink->len += len;
+
+  return 0;
+}
+
+/**
+ * @brief Reset sink and stream
+ */
+static void prv_reset(void) {
+  memset(&prv_sink, 0, sizeof(prv_sink));
+  frpp_log_dict_init(&prv_dict, prv_sink_write, &prv_sink);
+  frpp_log_decoder_init(&prv_dec, &prv_elf);
+}
+
+/**
+ * @brief Decode next frame of stream and assert it renders to expected
+ */
+static void prv_assert_next(size_t *pos, const char *expected) {
+  char out[256];
+  size_t consumed = 0;
+
+  int ret = frpp_log_decode_frame(&prv_dec, &prv_sink.buf[*pos],
+                                  prv_sink.len - *pos, &consumed, out,
+                                  sizeof(out));
+  TEST_ASSERT_EQUAL((int)strlen(expected), ret);
+  TEST_ASSERT_EQUAL_STRING(expected, out);
+
+  *pos += consumed;
+}
+
+/**
+ * @brief Append little endian integer to stream
+ */
+static void prv_put_le(uint64_t val, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    prv_sink.buf[prv_sink.len++] = (uint8_t)(val >> (8 * i));
+  }
+}
+
+/**
+ * @brief Append big endian integer to stream
+ */
+static void prv_put_be(uint64_t val, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    prv_sink.buf[prv_sink.len++] = (uint8_t)(val >> (8 * (len - 1 - i)));
+  }
+}
+
+/**
+ * @brief Append varint to stream
+ */
+static void prv_put_varint(uint64_t val) {
+  do {
+    uint8_t byte = (uint8_t)(val & 0x7FU);
+    val >>= 7;
+    prv_sink.buf[prv_sink.len++] = byte | ((val != 0) ? 0x80U : 0);
+  } while (val != 0);
+}
+
+/**
+ * @brief Append sync frame of a 32-bit target whose long double is a double
+ */
+static void prv_put_sync32(uint8_t flags, uint32_t anchor) {
+  prv_put_le(FRPP_LOG_DICT_FRAME_SYNC, 1);
+  prv_put_le(14 + 4, 2);
+  memcpy(&prv_sink.buf[prv_sink.len], "FRPD", 4);
+  prv_sink.len += 4;
+  prv_put_le(FRPP_LOG_DICT_VERSION, 1);
+  prv_put_le(flags, 1);
+  prv_put_le(4, 1);
+  prv_put_le(4, 1);
+  prv_put_le(4, 1);
+  prv_put_le(FRPP_LOG_FMT_ALIGN, 1);
+  prv_put_le(8, 1);
+  prv_put_le(53, 1);
+  prv_put_le(4, 1);
+  prv_put_le(4, 1);
+
+  if (flags & FRPP_LOG_DICT_SYNC_BIG_ENDIAN) {
+    prv_put_be(anchor, 4);
+  } else {
+    prv_put_le(anchor, 4);
+  }
+}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test invalid arguments
+ */
+void test_invalid_args(void) {
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_dict_init(NULL, prv_sink_write, NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_dict_init(&prv_dict, NULL, NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_dict_sync(NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_dict_printf(NULL, "x"));
+
+  prv_reset();
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_dict_printf(&prv_dict, NULL));
+}
+
+/**
+ * @brief Test records stream compactly and decode to the same text the
+ * target would have rendered
+ */
+void test_round_trip(void) {
+  prv_reset();
+
+  TEST_ASSERT_EQUAL(0, frpp_log_dict_sync(&prv_dict));
+  size_t sync_len = prv_sink.len;
+
+  TEST_ASSERT_EQUAL(0, frpp_log_dict_printf(&prv_dict, "boot complete"));
+  TEST_ASSERT_EQUAL(FRPP_LOG_DICT_HDR_SIZE + sizeof(void *),
+                    prv_sink.len - sync_len);
+
+  TEST_ASSERT_EQUAL(0, frpp_log_dict_printf(&prv_dict,
+                                            "%s: %d/%u 0x%08x", "sensor",
+                                            -17, 3000000000U, 0xbeef));
+  TEST_ASSERT_EQUAL(0, frpp_log_dict_printf(&prv_dict, "t=%lld n=%zu %c %%",
+                                            123456789012LL, (size_t)77, 'z'));
+  TEST_ASSERT_EQUAL(0, frpp_log_dict_printf(&prv_dict, "v=%.3f [%-6ld]",
+                                            2.71828, -5L));
+
+  size_t pos = 0;
+  prv_assert_next(&pos, "");
+  prv_assert_next(&pos, "boot complete");
+  prv_assert_next(&pos, "sensor: -17/3000000000 0x0000beef");
+  prv_assert_next(&pos, "t=123456789012 n=77 z %");
+  prv_assert_next(&pos, "v=2.718 [-5    ]");
+  TEST_ASSERT_EQUAL(prv_sink.len, pos);
+}
+
+/**
+ * @brief Test records are packaged densely, so small integers take less room
+ * in the stream than they do rendered
+ */
+void test_dense_frame_size(void) {
+  static const char fmt[] = "adc ch=%u raw=%u mv=%d state=%c flags=%hx";
+  static const char expected[] = "adc ch=3 raw=812 mv=-5 state=A flags=beef";
+
+  prv_reset();
+  frpp_log_dict_sync(&prv_dict);
+  size_t sync_len = prv_sink.len;
+
+  TEST_ASSERT_EQUAL(0, frpp_log_dict_printf(&prv_dict, fmt, 3U, 812U, -5, 'A',
+                                            (unsigned short)0xbeef));
+
+  // Varints of 3, 812 and zigzagged -5, then a char and a short
+  size_t frame_len = prv_sink.len - sync_len;
+  TEST_ASSERT_EQUAL(FRPP_LOG_DICT_HDR_SIZE + sizeof(void *) + 1 + 2 + 1 + 1 +
+                        sizeof(short),
+                    frame_len);
+  TEST_ASSERT_LESS_THAN(strlen(expected), frame_len);
+
+  size_t pos = 0;
+  prv_assert_next(&pos, "");
+  prv_assert_next(&pos, expected);
+  TEST_ASSERT_EQUAL(prv_sink.len, pos);
+}
+
+/**
+ * @brief Test interned format strings are streamed by ID and resolved from
+ * the ELF's format string section
+ */
+void test_interned_round_trip(void) {
+  prv_reset();
+  frpp_log_dict_sync(&prv_dict);
+  size_t sync_len = prv_sink.len;
+
+  const char *fmt = FRPP_LOG_FMT("interned %d");
+  TEST_ASSERT_NOT_EQUAL(FRPP_LOG_FMT_ID_NONE, frpp_log_fmt_id(fmt));
+
+  TEST_ASSERT_EQUAL(0, frpp_log_dict_printf(&prv_dict, fmt, 5));
+  TEST_ASSERT_EQUAL(FRPP_LOG_DICT_FRAME_RECORD_ID, prv_sink.buf[sync_len]);
+  TEST_ASSERT_EQUAL(FRPP_LOG_DICT_HDR_SIZE + sizeof(uint16_t) + 1,
+                    prv_sink.len - sync_len);
+
+  size_t pos = 0;
+  prv_assert_next(&pos, "");
+  prv_assert_next(&pos, "interned 5");
+}
+
+/**
+ * @brief Test strings that aren't in the ELF are shown by address
+ */
+void test_unresolved_string(void) {
+  char name[] = "stack";
+  char expected[64];
+
+  prv_reset();
+  frpp_log_dict_sync(&prv_dict);
+  frpp_log_dict_printf(&prv_dict, "name=%s", name);
+
+  snprintf(expected, sizeof(expected), "name=<0x%llx>",
+           (unsigned long long)(uintptr_t)name);
+
+  size_t pos = 0;
+  prv_assert_next(&pos, "");
+  prv_assert_next(&pos, expected);
+}
+
+/**
+ * @brief Test records can't be decoded before a sync frame
+ */
+void test_record_before_sync(void) {
+  char out[64];
+  size_t consumed = 0;
+
+  prv_reset();
+  frpp_log_dict_printf(&prv_dict, "lost %d", 1);
+
+  int ret = frpp_log_decode_frame(&prv_dec, prv_sink.buf, prv_sink.len,
+                                  &consumed, out, sizeof(out));
+  TEST_ASSERT_EQUAL(-ENOENT, ret);
+  TEST_ASSERT_EQUAL(prv_sink.len, consumed);
+}
+
+/**
+ * @brief Test partial frames are reported as incomplete
+ */
+void test_truncated_frame(void) {
+  char out[64];
+  size_t consumed = 0;
+
+  prv_reset();
+  frpp_log_dict_sync(&prv_dict);
+
+  for (size_t len = 0; len < prv_sink.len; len++) {
+    TEST_ASSERT_EQUAL(-EAGAIN,
+                      frpp_log_decode_frame(&prv_dec, prv_sink.buf, len,
+                                            &consumed, out, sizeof(out)));
+  }
+}
+
+/**
+ * @brief Test record too large for a frame is rejected without writing
+ */
+void test_oversized_record(void) {
+  prv_reset();
+
+  // Doubles keep their natural width in dense packages
+  int ret = frpp_log_dict_printf(
+      &prv_dict, "%f %f %f %f %f %f %f %f %f %f %f %f %f %f %f %f", 1.0, 2.0,
+      3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0, 11.0, 12.0, 13.0, 14.0, 15.0,
+      16.0);
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+  TEST_ASSERT_EQUAL(0, prv_sink.len);
+}
+
+/**
+ * @brief Test stream from a 32-bit little endian target is translated to the
+ * host ABI.  Target addresses are offset from the host's so relocation
+ * through the anchor is exercised.
+ */
+void test_32bit_target(void) {
+  static const char fmt[] = "%ld %s %d %lld %p [%*d] %.2Lf %lc %ls";
+  static const char str[] = "ro string";
+  static const wchar_t wstr[] = L"wide";
+  const uint32_t anchor = 0x20000000U;
+  const double val = 0.75;
+  uint64_t val_bits;
+
+  memcpy(&val_bits, &val, sizeof(val_bits));
+
+  prv_reset();
+
+  prv_put_sync32(0, anchor);
+
+  // Record frame.  The target's long double is a double.
+  prv_put_le(FRPP_LOG_DICT_FRAME_RECORD, 1);
+  prv_put_le(4 + 4 + 4 + 4 + 8 + 4 + 4 + 4 + 8 + 4 + 4, 2);
+  prv_put_le(anchor + (uint32_t)(fmt - frpp_log_dict_anchor), 4);
+  prv_put_le((uint32_t)-42, 4);
+  prv_put_le(anchor + (uint32_t)(str - frpp_log_dict_anchor), 4);
+  prv_put_le(7, 4);
+  prv_put_le(-9000000000LL, 8);
+  prv_put_le(0x2000abcdU, 4);
+  prv_put_le(4, 4);
+  prv_put_le(3, 4);
+  prv_put_le(val_bits, 8);
+  prv_put_le(L'w', 4);
+  prv_put_le(anchor + (uint32_t)((const char *)wstr - frpp_log_dict_anchor),
+             4);
+
+  char expected[96];
+  snprintf(expected, sizeof(expected),
+           "-42 ro string 7 -9000000000 %p [   3] 0.75 w wide",
+           (void *)(uintptr_t)0x2000abcdU);
+
+  size_t pos = 0;
+  prv_assert_next(&pos, "");
+  prv_assert_next(&pos, expected);
+  TEST_ASSERT_EQUAL(prv_sink.len, pos);
+}
+
+/**
+ * @brief Test dense stream from a 32-bit big endian target is translated to
+ * the host ABI
+ */
+void test_32bit_dense_target(void) {
+  static const char fmt[] = "%ld %s %hd %c %lld %.1f %p %lu";
+  static const char str[] = "ro string";
+  const uint32_t anchor = 0x20000000U;
+  const double val = 2.5;
+  uint64_t val_bits;
+
+  memcpy(&val_bits, &val, sizeof(val_bits));
+
+  prv_reset();
+
+  prv_put_sync32(FRPP_LOG_DICT_SYNC_BIG_ENDIAN | FRPP_LOG_DICT_SYNC_DENSE,
+                 anchor);
+
+  // Record frame.  Signed varints are zigzagged.
+  prv_put_le(FRPP_LOG_DICT_FRAME_RECORD, 1);
+  prv_put_le(4 + 1 + 4 + 2 + 1 + 5 + 8 + 4 + 5, 2);
+  prv_put_be(anchor + (uint32_t)(fmt - frpp_log_dict_anchor), 4);
+  prv_put_varint(83);
+  prv_put_be(anchor + (uint32_t)(str - frpp_log_dict_anchor), 4);
+  prv_put_be((uint16_t)-300, 2);
+  prv_put_le('x', 1);
+  prv_put_varint(17999999999ULL);
+  prv_put_be(val_bits, 8);
+  prv_put_be(0x2000abcdU, 4);
+  prv_put_varint(4000000000ULL);
+
+  char expected[96];
+  snprintf(expected, sizeof(expected),
+           "-42 ro string -300 x -9000000000 2.5 %p 4000000000",
+           (void *)(uintptr_t)0x2000abcdU);
+
+  size_t pos = 0;
+  prv_assert_next(&pos, "");
+  prv_assert_next(&pos, expected);
+  TEST_ASSERT_EQUAL(prv_sink.len, pos);
+}
+
+/**
+ * @brief Test * width and precision arguments decode in a dense stream
+ */
+void test_star_round_trip(void) {
+  prv_reset();
+  frpp_log_dict_sync(&prv_dict);
+
+  TEST_ASSERT_EQUAL(0, frpp_log_dict_printf(&prv_dict,
+                                            "star [%*d] after %s\n", 6, 42,
+                                            "ok"));
+  TEST_ASSERT_EQUAL(0, frpp_log_dict_printf(&prv_dict, "[%-*.*s]", 5, 2,
+                                            "abc"));
+
+  size_t pos = 0;
+  prv_assert_next(&pos, "");
+  prv_assert_next(&pos, "star [    42] after ok\n");
+  prv_assert_next(&pos, "[ab   ]");
+  TEST_ASSERT_EQUAL(prv_sink.len, pos);
+}
+
+/**
+ * @brief Test long double, wide character and wide string arguments decode
+ */
+void test_long_double_wide_round_trip(void) {
+  static const wchar_t wstr[] = L"wide";
+
+  prv_reset();
+  frpp_log_dict_sync(&prv_dict);
+
+  TEST_ASSERT_EQUAL(0, frpp_log_dict_printf(&prv_dict, "ld %Lf %d", 1.5L, 9));
+  TEST_ASSERT_EQUAL(0, frpp_log_dict_printf(&prv_dict, "%ls|%lc|%ls", wstr,
+                                            (wint_t)L'z', (wchar_t *)NULL));
+
+  size_t pos = 0;
+  prv_assert_next(&pos, "");
+  prv_assert_next(&pos, "ld 1.500000 9");
+  prv_assert_next(&pos, "wide|z|(null)");
+  TEST_ASSERT_EQUAL(prv_sink.len, pos);
+}
+
+/**
+ * @brief Test positional format strings, packaged with the regular layout,
+ * decode in a dense stream
+ */
+void test_positional_round_trip(void) {
+  int written = 0;
+
+  prv_reset();
+  frpp_log_dict_sync(&prv_dict);
+
+  TEST_ASSERT_EQUAL(0,
+                    frpp_log_dict_printf(&prv_dict, "pos %2$s %1$d", 7, "two"));
+  TEST_ASSERT_EQUAL(0, frpp_log_dict_printf(&prv_dict, "%2$*1$d|%3$s%4$n", 4,
+                                            5, "x", &written));
+
+  size_t pos = 0;
+  prv_assert_next(&pos, "");
+  prv_assert_next(&pos, "pos two 7");
+  prv_assert_next(&pos, "   5|x");
+  TEST_ASSERT_EQUAL(prv_sink.len, pos);
+}
+
+/**
+ * @brief Test long doubles in a format the host doesn't share aren't
+ * decoded
+ */
+void test_long_double_unsupported(void) {
+  static const char fmt[] = "%Lf";
+  const uint32_t anchor = 0x20000000U;
+  char out[64];
+  size_t consumed = 0;
+
+  prv_reset();
+  prv_put_sync32(0, anchor);
+
+  // Claim a 16 byte double-double long double
+  prv_sink.buf[FRPP_LOG_DICT_HDR_SIZE + 10] = 16;
+  prv_sink.buf[FRPP_LOG_DICT_HDR_SIZE + 11] = 106;
+  size_t sync_len = prv_sink.len;
+
+  prv_put_le(FRPP_LOG_DICT_FRAME_RECORD, 1);
+  prv_put_le(4 + 16, 2);
+  prv_put_le(anchor + (uint32_t)(fmt - frpp_log_dict_anchor), 4);
+  prv_put_le(0, 8);
+  prv_put_le(0, 8);
+
+  size_t pos = 0;
+  prv_assert_next(&pos, "");
+  TEST_ASSERT_EQUAL(sync_len, pos);
+
+  int ret = frpp_log_decode_frame(&prv_dec, &prv_sink.buf[pos],
+                                  prv_sink.len - pos, &consumed, out,
+                                  sizeof(out));
+  TEST_ASSERT_EQUAL(-ENOTSUP, ret);
+  TEST_ASSERT_EQUAL(prv_sink.len - pos, consumed);
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  if (frpp_elf_load(&prv_elf, "/proc/self/exe") != 0) {
+    return 1;
+  }
+
+  UNITY_BEGIN();
+
+  RUN_TEST(test_invalid_args);
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_dense_frame_size);
+  RUN_TEST(test_interned_round_trip);
+  RUN_TEST(test_unresolved_string);
+  RUN_TEST(test_record_before_sync);
+  RUN_TEST(test_truncated_frame);
+  RUN_TEST(test_oversized_record);
+  RUN_TEST(test_32bit_target);
+  RUN_TEST(test_32bit_dense_target);
+  RUN_TEST(test_star_round_trip);
+  RUN_TEST(test_long_double_wide_round_trip);
+  RUN_TEST(test_positional_round_trip);
+  RUN_TEST(test_long_double_unsupported);
+
+  int ret = UNITY_END();
+
+  frpp_elf_free(&prv_elf);
+
+  return ret;
+}
@@ -0,0 +1,598 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_log_lanes.c
+ * @author Evan Stoddard
+ * @brief Tests for frpp_log_lanes
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "unity.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "frpp/logging/frpp_log_lanes.h"
+#include "frpp/logging/frpp_log_queue.h"
+#include "frpp/sys/frpp_timestamp.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TEST_LANES (4U)
+#define TEST_RING_SIZE (1024U)
+
+#define TEST_MERGE_RECORDS (20000U)
+#define TEST_MERGE_RING_SIZE (16384U)
+
+#define TEST_SCALE_THREADS_MAX (8U)
+#define TEST_SCALE_RECORDS (50000U)
+#define TEST_SCALE_RING_SIZE (1U << 22)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Producer of the scaling benchmark
+ */
+struct test_producer {
+  pthread_t thread;
+  int id;
+  struct frpp_log_lane *lane;
+  struct frpp_log_queue *queue;
+  pthread_barrier_t *start;
+};
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static _Alignas(FRPP_LOG_LANES_ALIGN) uint8_t
+    prv_rings[TEST_LANES][TEST_MERGE_RING_SIZE];
+
+static struct frpp_log_lane prv_lane[TEST_LANES];
+
+static struct frpp_log_lanes prv_lanes;
+
+static uint64_t prv_ticks;
+
+static const char prv_fmt_producer[] = "producer %d seq %u";
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief Clock advanced by hand
+ */
+static uint64_t prv_tick(void) { return prv_ticks; }
+
+/**
+ * @brief Monotonic time in nanoseconds
+ */
+static uint64_t prv_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Wipe the format string pointer of a record in a ring, as if its
+ * format string were lost, so the record can't be rendered
+ *
+ * @param ring Ring storage
+ * @param size Size of ring storage
+ * @param fmt_str Format string of record
+ */
+static void prv_forget_fmt(uint8_t *ring, size_t size, const char *fmt_str) {
+  static const char *const none = NULL;
+
+  for (size_t i = 0; i + sizeof(fmt_str) <= size; i++) {
+    if (memcmp(&ring[i], &fmt_str, sizeof(fmt_str)) == 0) {
+      memcpy(&ring[i], &none, sizeof(none));
+      return;
+    }
+  }
+
+  TEST_FAIL_MESSAGE("Format string pointer not found in ring");
+}
+
+/**
+ * @brief Set up lanes with small rings
+ *
+ * @param count Number of lanes
+ * @param size Size of each ring
+ * @param clock Timestamp source
+ */
+static void prv_setup(size_t count, size_t size,
+                      frpp_timestamp_source_t clock) {
+  for (size_t i = 0; i < count; i++) {
+    TEST_ASSERT_EQUAL(0, frpp_log_lane_init(&prv_lane[i], prv_rings[i], size));
+  }
+
+  TEST_ASSERT_EQUAL(0, frpp_log_lanes_init(&prv_lanes, prv_lane, count,
+                                           clock));
+}
+
+/**
+ * @brief Log into own lane for the merge test
+ *
+ * @param arg Producer index
+ * @return NULL
+ */
+static void *prv_merge_producer(void *arg) {
+  int id = (int)(intptr_t)arg;
+  struct frpp_log_lane *lane = frpp_log_lanes_claim(&prv_lanes);
+
+  for (unsigned int seq = 0; seq < TEST_MERGE_RECORDS; seq++) {
+    while (frpp_log_lane_printf(lane, prv_fmt_producer, id, seq) ==
+           -ENOSPC) {
+      sched_yield();
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Log as fast as possible for the scaling benchmark, into a lane or
+ * the shared queue
+ *
+ * @param arg Producer
+ * @return NULL
+ */
+static void *prv_scale_producer(void *arg) {
+  struct test_producer *producer = (struct test_producer *)arg;
+
+  pthread_barrier_wait(producer->start);
+
+  for (unsigned int seq = 0; seq < TEST_SCALE_RECORDS; seq++) {
+    if (producer->lane != NULL) {
+      frpp_log_lane_printf(producer->lane, prv_fmt_producer, producer->id,
+                           seq);
+    } else {
+      frpp_log_queue_printf(producer->queue, prv_fmt_producer, producer->id,
+                            seq);
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Run scaling benchmark.  Rings hold every record, so only the
+ * producers are timed.
+ *
+ * @param threads Number of producers
+ * @param lanes Log into lanes if true, otherwise the shared queue
+ * @param rings Ring per producer
+ * @return Records per second across all producers
+ */
+static double prv_scale_run(size_t threads, bool lanes, uint8_t **rings) {
+  struct test_producer producers[TEST_SCALE_THREADS_MAX];
+  static struct frpp_log_lane lane[TEST_SCALE_THREADS_MAX];
+  static struct frpp_log_queue queue;
+  static uint8_t *shared;
+  pthread_barrier_t start;
+
+  if (shared == NULL) {
+    shared = aligned_alloc(FRPP_LOG_QUEUE_ALIGN,
+                           TEST_SCALE_RING_SIZE * TEST_SCALE_THREADS_MAX);
+    TEST_ASSERT_NOT_NULL(shared);
+  }
+
+  for (size_t i = 0; i < threads; i++) {
+    frpp_log_lane_init(&lane[i], rings[i], TEST_SCALE_RING_SIZE);
+  }
+
+  frpp_log_lanes_init(&prv_lanes, lane, threads, frpp_timestamp_cycles);
+  frpp_log_queue_init(&queue, shared, TEST_SCALE_RING_SIZE * 8);
+
+  pthread_barrier_init(&start, NULL, (unsigned int)threads + 1);
+
+  for (size_t i = 0; i < threads; i++) {
+    producers[i].id = (int)i;
+    producers[i].lane = lanes ? &lane[i] : NULL;
+    producers[i].queue = &queue;
+    producers[i].start = &start;
+    pthread_create(&producers[i].thread, NULL, prv_scale_producer,
+                   &producers[i]);
+  }
+
+  pthread_barrier_wait(&start);
+  uint64_t begin = prv_now_ns();
+
+  for (size_t i = 0; i < threads; i++) {
+    pthread_join(producers[i].thread, NULL);
+  }
+
+  uint64_t elapsed = prv_now_ns() - begin;
+
+  pthread_barrier_destroy(&start);
+
+  for (size_t i = 0; lanes && i < threads; i++) {
+    TEST_ASSERT_EQUAL(0, frpp_log_lane_dropped(&lane[i]));
+  }
+
+  return (double)(threads * TEST_SCALE_RECORDS) * 1e9 / (double)elapsed;
+}
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {
+  prv_ticks = 0;
+  prv_setup(TEST_LANES, TEST_RING_SIZE, prv_tick);
+}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test invalid arguments
+ */
+void test_invalid(void) {
+  struct frpp_log_lane lane;
+  char out_buf[16];
+  size_t len;
+
+  TEST_ASSERT_EQUAL(-EINVAL,
+                    frpp_log_lane_init(NULL, prv_rings[0], TEST_RING_SIZE));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_lane_init(&lane, NULL, TEST_RING_SIZE));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_lane_init(&lane, prv_rings[0], 1000));
+  TEST_ASSERT_EQUAL(-EINVAL,
+                    frpp_log_lane_init(&lane, prv_rings[0] + 1, 512));
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_lanes_init(NULL, prv_lane, 1, prv_tick));
+  TEST_ASSERT_EQUAL(-EINVAL,
+                    frpp_log_lanes_init(&prv_lanes, prv_lane, 0, prv_tick));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_lanes_init(&prv_lanes, prv_lane,
+                                                 FRPP_LOG_LANES_MAX + 1,
+                                                 prv_tick));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_lanes_init(&prv_lanes, prv_lane, 1,
+                                                 NULL));
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_lane_printf(NULL, "x"));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_lane_printf(&prv_lane[0], NULL));
+  TEST_ASSERT_EQUAL(-EINVAL,
+                    frpp_log_lanes_render(NULL, out_buf, sizeof(out_buf),
+                                          NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_lanes_render_batch(&prv_lanes, out_buf,
+                                                         0, &len));
+  TEST_ASSERT_EQUAL(-EAGAIN,
+                    frpp_log_lanes_render(&prv_lanes, out_buf,
+                                          sizeof(out_buf), NULL));
+}
+
+/**
+ * @brief Test lanes are claimed once each
+ */
+void test_claim(void) {
+  struct frpp_log_lane *claimed[TEST_LANES];
+
+  for (size_t i = 0; i < TEST_LANES; i++) {
+    claimed[i] = frpp_log_lanes_claim(&prv_lanes);
+    TEST_ASSERT_EQUAL_PTR(&prv_lane[i], claimed[i]);
+  }
+
+  TEST_ASSERT_NULL(frpp_log_lanes_claim(&prv_lanes));
+
+  frpp_log_lane_release(claimed[2]);
+  TEST_ASSERT_EQUAL_PTR(&prv_lane[2], frpp_log_lanes_claim(&prv_lanes));
+}
+
+/**
+ * @brief Test records of different lanes render in timestamp order
+ */
+void test_merge_order(void) {
+  char out_buf[32];
+  uint64_t ts = 0;
+
+  prv_ticks = 30;
+  frpp_log_lane_printf(&prv_lane[0], "a %d", 30);
+  prv_ticks = 10;
+  frpp_log_lane_printf(&prv_lane[1], "b %d", 10);
+  prv_ticks = 20;
+  frpp_log_lane_printf(&prv_lane[2], "c %d", 20);
+  prv_ticks = 40;
+  frpp_log_lane_printf(&prv_lane[1], "b %d", 40);
+  prv_ticks = 35;
+  frpp_log_lane_printf(&prv_lane[3], "d %d", 35);
+
+  const char *expected[] = {"b 10", "c 20", "a 30", "d 35", "b 40"};
+  const uint64_t expected_ts[] = {10, 20, 30, 35, 40};
+
+  for (size_t i = 0; i < 5; i++) {
+    TEST_ASSERT_GREATER_THAN(0, frpp_log_lanes_render(&prv_lanes, out_buf,
+                                                      sizeof(out_buf), &ts));
+    TEST_ASSERT_EQUAL_STRING(expected[i], out_buf);
+    TEST_ASSERT_EQUAL(expected_ts[i], ts);
+  }
+
+  TEST_ASSERT_EQUAL(-EAGAIN, frpp_log_lanes_render(&prv_lanes, out_buf,
+                                                   sizeof(out_buf), NULL));
+}
+
+/**
+ * @brief Test batches are merged in timestamp order, ties by lane
+ */
+void test_merge_batch(void) {
+  char out_buf[256];
+  size_t len = 0;
+
+  // Each lane logs every fourth tick
+  for (unsigned int t = 0; t < 16; t++) {
+    prv_ticks = t;
+    frpp_log_lane_printf(&prv_lane[(15 - t) % TEST_LANES], "%u,", t);
+  }
+
+  prv_ticks = 3;
+  frpp_log_lane_printf(&prv_lane[3], "3b,");
+  frpp_log_lane_printf(&prv_lane[3], "3c,");
+
+  TEST_ASSERT_EQUAL(18, frpp_log_lanes_render_batch(&prv_lanes, out_buf,
+                                                    sizeof(out_buf), &len));
+  TEST_ASSERT_EQUAL(strlen(out_buf), len);
+
+  // 3b and 3c were stamped 3 but logged after 12 into the same lane, so they
+  // are rendered once 12 is and before every later record
+  TEST_ASSERT_EQUAL_STRING("0,1,2,3,4,5,6,7,8,9,10,11,12,3b,3c,13,14,15,",
+                           out_buf);
+}
+
+/**
+ * @brief Test timestamps are rebuilt from deltas, including large and
+ * backwards steps
+ */
+void test_timestamp_deltas(void) {
+  const uint64_t stamps[] = {0,          1,          UINT64_MAX, 0x7fU,
+                             0x80U,      1ULL << 40, 5,          5,
+                             UINT64_MAX, 0};
+  const size_t count = sizeof(stamps) / sizeof(stamps[0]);
+  char out_buf[16];
+  uint64_t ts = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    prv_ticks = stamps[i];
+    TEST_ASSERT_EQUAL(0, frpp_log_lane_printf(&prv_lane[2], "%u",
+                                              (unsigned int)i));
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    TEST_ASSERT_GREATER_THAN(0, frpp_log_lanes_render(&prv_lanes, out_buf,
+                                                      sizeof(out_buf), &ts));
+    TEST_ASSERT_TRUE(ts == stamps[i]);
+  }
+}
+
+/**
+ * @brief Test batch stops at a full output buffer and resumes
+ */
+void test_merge_batch_partial(void) {
+  char out_buf[8];
+  size_t len = 0;
+
+  prv_ticks = 2;
+  frpp_log_lane_printf(&prv_lane[0], "ccc");
+  prv_ticks = 1;
+  frpp_log_lane_printf(&prv_lane[1], "bbb");
+  prv_ticks = 0;
+  frpp_log_lane_printf(&prv_lane[2], "aaa");
+
+  TEST_ASSERT_EQUAL(2, frpp_log_lanes_render_batch(&prv_lanes, out_buf,
+                                                   sizeof(out_buf), &len));
+  TEST_ASSERT_EQUAL_STRING("aaabbb", out_buf);
+  TEST_ASSERT_EQUAL(1, frpp_log_lanes_render_batch(&prv_lanes, out_buf,
+                                                   sizeof(out_buf), &len));
+  TEST_ASSERT_EQUAL_STRING("ccc", out_buf);
+  TEST_ASSERT_EQUAL(-EAGAIN, frpp_log_lanes_render_batch(
+                                 &prv_lanes, out_buf, sizeof(out_buf), &len));
+}
+
+/**
+ * @brief Test a record that can't be rendered is dropped and reported
+ * instead of stalling its lane
+ */
+void test_merge_batch_bad_record(void) {
+  static const char fmt_bad[] = "bad,";
+  char out_buf[32];
+  size_t len = 0;
+
+  prv_ticks = 0;
+  frpp_log_lane_printf(&prv_lane[1], "a,");
+  prv_ticks = 1;
+  frpp_log_lane_printf(&prv_lane[0], fmt_bad);
+  prv_ticks = 2;
+  frpp_log_lane_printf(&prv_lane[0], "c,");
+  prv_forget_fmt(prv_rings[0], sizeof(prv_rings[0]), fmt_bad);
+
+  TEST_ASSERT_EQUAL(1, frpp_log_lanes_render_batch(&prv_lanes, out_buf,
+                                                   sizeof(out_buf), &len));
+  TEST_ASSERT_EQUAL_STRING("a,", out_buf);
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_lanes_render_batch(
+                                 &prv_lanes, out_buf, sizeof(out_buf), &len));
+  TEST_ASSERT_EQUAL(0, len);
+
+  TEST_ASSERT_EQUAL(1, frpp_log_lanes_render_batch(&prv_lanes, out_buf,
+                                                   sizeof(out_buf), &len));
+  TEST_ASSERT_EQUAL_STRING("c,", out_buf);
+  TEST_ASSERT_EQUAL(-EAGAIN, frpp_log_lanes_render_batch(
+                                 &prv_lanes, out_buf, sizeof(out_buf), &len));
+}
+
+/**
+ * @brief Test a full lane drops records without affecting other lanes, and
+ * records wrap around the end of the ring
+ */
+void test_full_and_wrap(void) {
+  char out_buf[64];
+  char expected[64];
+  int ret = 0;
+  unsigned int logged = 0;
+
+  while ((ret = frpp_log_lane_printf(&prv_lane[0], "%u %s", logged,
+                                     "filler")) == 0) {
+    logged++;
+  }
+
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+  TEST_ASSERT_EQUAL(1, frpp_log_lane_dropped(&prv_lane[0]));
+  TEST_ASSERT_EQUAL(0, frpp_log_lane_printf(&prv_lane[1], "other"));
+
+  // Drain a little at a time so records straddle the end of the ring
+  unsigned int rendered = 0;
+
+  for (unsigned int i = 0; i < 500; i++) {
+    frpp_log_lanes_render(&prv_lanes, out_buf, sizeof(out_buf), NULL);
+
+    if (strcmp(out_buf, "other") == 0) {
+      continue;
+    }
+
+    snprintf(expected, sizeof(expected), "%u %s", rendered, "filler");
+    TEST_ASSERT_EQUAL_STRING(expected, out_buf);
+    rendered++;
+
+    TEST_ASSERT_EQUAL(0, frpp_log_lane_printf(&prv_lane[0], "%u %s",
+                                              logged, "filler"));
+    logged++;
+  }
+
+  TEST_ASSERT_EQUAL(1, frpp_log_lane_dropped(&prv_lane[0]));
+}
+
+/**
+ * @brief Test threads logging into their own lanes while the consumer
+ * merges them
+ */
+void test_threads_merge(void) {
+  pthread_t threads[TEST_LANES];
+  unsigned int next_seq[TEST_LANES] = {0};
+  const size_t total = TEST_LANES * TEST_MERGE_RECORDS;
+  size_t received = 0;
+  uint64_t last_ts = 0;
+  uint64_t ts = 0;
+  size_t inversions = 0;
+  char out_buf[64];
+
+  prv_setup(TEST_LANES, TEST_MERGE_RING_SIZE, frpp_timestamp_cycles);
+
+  for (size_t i = 0; i < TEST_LANES; i++) {
+    pthread_create(&threads[i], NULL, prv_merge_producer,
+                   (void *)(intptr_t)i);
+  }
+
+  while (received < total) {
+    if (frpp_log_lanes_render(&prv_lanes, out_buf, sizeof(out_buf), &ts) <
+        0) {
+      sched_yield();
+      continue;
+    }
+
+    int id = -1;
+    unsigned int seq = 0;
+    TEST_ASSERT_EQUAL(2, sscanf(out_buf, prv_fmt_producer, &id, &seq));
+    TEST_ASSERT_TRUE(id >= 0 && id < (int)TEST_LANES);
+
+    // Records from a single thread must arrive in order
+    TEST_ASSERT_EQUAL(next_seq[id], seq);
+    next_seq[id]++;
+    received++;
+
+    // Only records published late may go back in time
+    inversions += (ts < last_ts);
+    last_ts = ts;
+  }
+
+  for (size_t i = 0; i < TEST_LANES; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  printf("frpp_log_lanes: %zu records merged, %zu published late\n",
+         received, inversions);
+}
+
+/**
+ * @brief Compare aggregate logging throughput of per-thread lanes and the
+ * shared queue as producers are added
+ */
+void test_scaling(void) {
+  static uint8_t *rings[TEST_SCALE_THREADS_MAX];
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t max_threads = (cpus > (long)TEST_SCALE_THREADS_MAX)
+                           ? TEST_SCALE_THREADS_MAX
+                           : (size_t)((cpus > 0) ? cpus : 1);
+
+  // Always run at least two producers so the shared queue contends
+  if (max_threads < 2) {
+    max_threads = 2;
+  }
+
+  for (size_t i = 0; i < max_threads; i++) {
+    rings[i] = aligned_alloc(FRPP_LOG_LANES_CACHE_LINE, TEST_SCALE_RING_SIZE);
+    TEST_ASSERT_NOT_NULL(rings[i]);
+  }
+
+  printf("frpp_log_lanes: scaling on %ld cpus (Mrecords/s)\n", cpus);
+  printf("  threads     lanes    shared\n");
+
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    double lanes = prv_scale_run(threads, true, rings);
+    double shared = prv_scale_run(threads, false, rings);
+
+    printf("  %7zu  %8.2f  %8.2f\n", threads, lanes / 1e6, shared / 1e6);
+  }
+
+  for (size_t i = 0; i < max_threads; i++) {
+    free(rings[i]);
+  }
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Error condition tests
+  RUN_TEST(test_invalid);
+  RUN_TEST(test_claim);
+
+  // Merge tests
+  RUN_TEST(test_merge_order);
+  RUN_TEST(test_merge_batch);
+  RUN_TEST(test_merge_batch_partial);
+  RUN_TEST(test_merge_batch_bad_record);
+  RUN_TEST(test_timestamp_deltas);
+  RUN_TEST(test_full_and_wrap);
+
+  // Concurrency tests
+  RUN_TEST(test_threads_merge);
+  RUN_TEST(test_scaling);
+
+  return UNITY_END();
+}
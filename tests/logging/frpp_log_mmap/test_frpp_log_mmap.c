@@ -0,0 +1,447 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_log_mmap.c
+ * @author Evan Stoddard
+ * @brief Tests for frpp_log_mmap
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "unity.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "frpp/logging/frpp_log_mmap.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TEST_SEG_SIZE (4096U)
+
+#define TEST_BENCH_RECORDS (200000U)
+#define TEST_BENCH_SEG_SIZE (1U << 22)
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static char prv_dir[] = "/tmp/frpp_log_mmap_XXXXXX";
+
+static char prv_prefix[FRPP_LOG_MMAP_PATH_MAX];
+
+static struct frpp_log_mmap prv_sink;
+
+static uint64_t prv_ticks;
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief Clock advancing 1000 ticks per read
+ */
+static uint64_t prv_tick(void) {
+  prv_ticks += 1000;
+  return prv_ticks;
+}
+
+/**
+ * @brief Monotonic time in nanoseconds
+ */
+static uint64_t prv_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Log numbered record
+ *
+ * @param sink Sink instance
+ * @param idx Number of record
+ * @return Return value of frpp_log_mmap_printf
+ */
+static int prv_log(struct frpp_log_mmap *sink, unsigned int idx) {
+  char name[16];
+
+  snprintf(name, sizeof(name), "task%u", idx % 7);
+
+  return FRPP_LOG_MMAP_PRINTF(sink, "rec %u from %s", idx, name);
+}
+
+/**
+ * @brief Render next record and check its number
+ *
+ * @param reader Reader instance
+ * @param idx Expected number of record
+ * @param ts Timestamp of record output, may be NULL
+ */
+static void prv_expect(struct frpp_log_mmap_reader *reader, unsigned int idx,
+                       uint64_t *ts) {
+  char out_buf[64];
+  char expected[64];
+
+  snprintf(expected, sizeof(expected), "rec %u from task%u", idx, idx % 7);
+  TEST_ASSERT_GREATER_THAN(0, frpp_log_mmap_reader_render(
+                                  reader, out_buf, sizeof(out_buf), ts));
+  TEST_ASSERT_EQUAL_STRING(expected, out_buf);
+}
+
+/**
+ * @brief Open reader on a segment of the test sink
+ *
+ * @param reader Reader instance
+ * @param seg Number of segment
+ * @return Return value of frpp_log_mmap_reader_open
+ */
+static int prv_open_seg(struct frpp_log_mmap_reader *reader, uint32_t seg) {
+  char path[FRPP_LOG_MMAP_PATH_MAX];
+
+  frpp_log_mmap_path(&prv_sink, seg, path, sizeof(path));
+
+  return frpp_log_mmap_reader_open(reader, path);
+}
+
+/**
+ * @brief Read all segments of the test sink from first_seg on
+ *
+ * @param first_seg Number of first segment
+ * @param first Expected number of first record
+ * @return Number of records read
+ */
+static unsigned int prv_read_all(uint32_t first_seg, unsigned int first) {
+  struct frpp_log_mmap_reader reader;
+  char out_buf[64];
+  unsigned int idx = first;
+
+  for (uint32_t seg = first_seg; prv_open_seg(&reader, seg) == 0; seg++) {
+    int ret;
+
+    while ((ret = frpp_log_mmap_reader_render(&reader, out_buf,
+                                              sizeof(out_buf), NULL)) > 0) {
+      char expected[64];
+
+      snprintf(expected, sizeof(expected), "rec %u from task%u", idx,
+               idx % 7);
+      TEST_ASSERT_EQUAL_STRING(expected, out_buf);
+      idx++;
+    }
+
+    TEST_ASSERT_EQUAL(-EAGAIN, ret);
+    frpp_log_mmap_reader_close(&reader);
+  }
+
+  return idx - first;
+}
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {
+  static int run;
+
+  snprintf(prv_prefix, sizeof(prv_prefix), "%s/run%d", prv_dir, run++);
+  prv_ticks = 0;
+}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {
+  char path[FRPP_LOG_MMAP_PATH_MAX];
+
+  frpp_log_mmap_close(&prv_sink);
+
+  for (uint32_t seg = 0;; seg++) {
+    frpp_log_mmap_path(&prv_sink, seg, path, sizeof(path));
+
+    if (unlink(path) != 0 && seg > 16) {
+      break;
+    }
+  }
+}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test invalid arguments
+ */
+void test_invalid(void) {
+  struct frpp_log_mmap_reader reader;
+  char long_prefix[FRPP_LOG_MMAP_PATH_MAX + 1];
+
+  memset(long_prefix, 'a', sizeof(long_prefix) - 1);
+  long_prefix[sizeof(long_prefix) - 1] = '\0';
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_mmap_open(NULL, prv_prefix,
+                                                TEST_SEG_SIZE, 0, NULL));
+  TEST_ASSERT_EQUAL(-EINVAL,
+                    frpp_log_mmap_open(&prv_sink, NULL, TEST_SEG_SIZE, 0,
+                                       NULL));
+  TEST_ASSERT_EQUAL(-EINVAL,
+                    frpp_log_mmap_open(&prv_sink, prv_prefix, 1024, 0, NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_mmap_open(&prv_sink, prv_prefix,
+                                                TEST_SEG_SIZE + 1, 0, NULL));
+  TEST_ASSERT_EQUAL(-ENAMETOOLONG,
+                    frpp_log_mmap_open(&prv_sink, long_prefix, TEST_SEG_SIZE,
+                                       0, NULL));
+
+  TEST_ASSERT_EQUAL(0, frpp_log_mmap_open(&prv_sink, prv_prefix,
+                                          TEST_SEG_SIZE, 0, NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_mmap_printf(NULL, "x"));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_mmap_printf(&prv_sink, NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_mmap_printf(&prv_sink, "not interned"));
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_mmap_reader_open(NULL, prv_prefix));
+  TEST_ASSERT_EQUAL(-ENOENT, frpp_log_mmap_reader_open(&reader, prv_prefix));
+
+  // Not a segment
+  char path[FRPP_LOG_MMAP_PATH_MAX];
+  int path_len = snprintf(path, sizeof(path), "%s.bogus", prv_prefix);
+  TEST_ASSERT_TRUE(path_len > 0 && (size_t)path_len < sizeof(path));
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  TEST_ASSERT_TRUE(fd >= 0);
+  TEST_ASSERT_EQUAL(0, ftruncate(fd, TEST_SEG_SIZE));
+  close(fd);
+  TEST_ASSERT_EQUAL(-EBADMSG, frpp_log_mmap_reader_open(&reader, path));
+  unlink(path);
+}
+
+/**
+ * @brief Test records round trip with timestamps
+ */
+void test_round_trip(void) {
+  struct frpp_log_mmap_reader reader;
+  uint64_t ts = 0;
+
+  TEST_ASSERT_EQUAL(0, frpp_log_mmap_open(&prv_sink, prv_prefix,
+                                          TEST_SEG_SIZE, 0, prv_tick));
+
+  for (unsigned int i = 0; i < 10; i++) {
+    TEST_ASSERT_EQUAL(0, prv_log(&prv_sink, i));
+  }
+
+  // Readable while still being written
+  TEST_ASSERT_EQUAL(0, prv_open_seg(&reader, 0));
+
+  for (unsigned int i = 0; i < 10; i++) {
+    prv_expect(&reader, i, &ts);
+    TEST_ASSERT_TRUE(ts == 1000ULL * (i + 1));
+  }
+
+  frpp_log_mmap_reader_close(&reader);
+  frpp_log_mmap_close(&prv_sink);
+
+  TEST_ASSERT_EQUAL(10, prv_read_all(0, 0));
+}
+
+/**
+ * @brief Test segments roll over and records continue across them
+ */
+void test_rollover(void) {
+  const unsigned int total = 1000;
+
+  TEST_ASSERT_EQUAL(0, frpp_log_mmap_open(&prv_sink, prv_prefix,
+                                          TEST_SEG_SIZE, 0, prv_tick));
+
+  for (unsigned int i = 0; i < total; i++) {
+    TEST_ASSERT_EQUAL(0, prv_log(&prv_sink, i));
+  }
+
+  TEST_ASSERT_TRUE(prv_sink.seg > 4);
+  frpp_log_mmap_close(&prv_sink);
+
+  TEST_ASSERT_EQUAL(total, prv_read_all(0, 0));
+}
+
+/**
+ * @brief Test seeking through the index, with timestamps rebuilt from the
+ * entry sought to
+ */
+void test_seek(void) {
+  struct frpp_log_mmap_reader reader;
+  uint64_t ts = 0;
+
+  // Large segments so each holds several index strides
+  TEST_ASSERT_EQUAL(0, frpp_log_mmap_open(&prv_sink, prv_prefix,
+                                          4 * TEST_SEG_SIZE, 0, prv_tick));
+
+  for (unsigned int i = 0; i < 1000; i++) {
+    prv_log(&prv_sink, i);
+  }
+
+  frpp_log_mmap_close(&prv_sink);
+
+  const unsigned int targets[] = {0, 63, 64, 65, 200, 511, 999};
+
+  for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++) {
+    uint32_t seg = 0;
+
+    for (;; seg++) {
+      TEST_ASSERT_EQUAL(0, prv_open_seg(&reader, seg));
+
+      if (frpp_log_mmap_reader_seek(&reader, targets[t]) == 0) {
+        break;
+      }
+
+      frpp_log_mmap_reader_close(&reader);
+    }
+
+    prv_expect(&reader, targets[t], &ts);
+    TEST_ASSERT_TRUE(ts == 1000ULL * (targets[t] + 1));
+    frpp_log_mmap_reader_close(&reader);
+  }
+}
+
+/**
+ * @brief Test only the newest segments are kept
+ */
+void test_max_segs(void) {
+  struct frpp_log_mmap_reader reader;
+
+  TEST_ASSERT_EQUAL(0, frpp_log_mmap_open(&prv_sink, prv_prefix,
+                                          TEST_SEG_SIZE, 2, NULL));
+
+  unsigned int idx = 0;
+
+  while (prv_sink.seg < 5) {
+    prv_log(&prv_sink, idx++);
+  }
+
+  frpp_log_mmap_close(&prv_sink);
+
+  TEST_ASSERT_EQUAL(-ENOENT, prv_open_seg(&reader, 3));
+  TEST_ASSERT_EQUAL(0, prv_open_seg(&reader, 4));
+  frpp_log_mmap_reader_close(&reader);
+
+  // Segment 5 holds the last record alone
+  TEST_ASSERT_EQUAL(0, prv_open_seg(&reader, 5));
+  TEST_ASSERT_EQUAL(0, frpp_log_mmap_reader_seek(&reader, idx - 1));
+  prv_expect(&reader, idx - 1, NULL);
+  frpp_log_mmap_reader_close(&reader);
+}
+
+/**
+ * @brief Test records of a writer that crashed before finishing its segment
+ * are read by walking it
+ */
+void test_crash(void) {
+  TEST_ASSERT_EQUAL(0, frpp_log_mmap_open(&prv_sink, prv_prefix,
+                                          4 * TEST_SEG_SIZE, 0, prv_tick));
+
+  // The child inherits the shared mapping and crashes writing into it
+  pid_t pid = fork();
+  TEST_ASSERT_TRUE(pid >= 0);
+
+  if (pid == 0) {
+    for (unsigned int i = 0; i < 150; i++) {
+      prv_log(&prv_sink, i);
+    }
+
+    abort();
+  }
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  TEST_ASSERT_TRUE(WIFSIGNALED(status));
+
+  struct frpp_log_mmap_reader reader;
+
+  TEST_ASSERT_EQUAL(0, prv_open_seg(&reader, 0));
+  TEST_ASSERT_EQUAL(0, frpp_log_mmap_reader_seek(&reader, 149));
+  prv_expect(&reader, 149, NULL);
+  frpp_log_mmap_reader_close(&reader);
+
+  TEST_ASSERT_EQUAL(150, prv_read_all(0, 0));
+}
+
+/**
+ * @brief Compare logging into the sink with packaging and writing each
+ * record to a file
+ */
+void test_bench(void) {
+  char path[FRPP_LOG_MMAP_PATH_MAX];
+  _Alignas(8) uint8_t pkg[64];
+
+  TEST_ASSERT_EQUAL(0, frpp_log_mmap_open(&prv_sink, prv_prefix,
+                                          TEST_BENCH_SEG_SIZE, 0, NULL));
+
+  uint64_t start = prv_now_ns();
+
+  for (unsigned int i = 0; i < TEST_BENCH_RECORDS; i++) {
+    FRPP_LOG_MMAP_PRINTF(&prv_sink, "bench %u", i);
+  }
+
+  uint64_t mmap_ns = prv_now_ns() - start;
+
+  int path_len = snprintf(path, sizeof(path), "%s.write", prv_prefix);
+  TEST_ASSERT_TRUE(path_len > 0 && (size_t)path_len < sizeof(path));
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  TEST_ASSERT_TRUE(fd >= 0);
+
+  start = prv_now_ns();
+
+  for (unsigned int i = 0; i < TEST_BENCH_RECORDS; i++) {
+    int len = frpp_printf_package(pkg, sizeof(pkg),
+                                  FRPP_PRINTF_FLAG_CAPTURE_STR, "bench %u", i);
+    TEST_ASSERT_TRUE(write(fd, pkg, (size_t)len) == len);
+  }
+
+  uint64_t write_ns = prv_now_ns() - start;
+
+  close(fd);
+  unlink(path);
+
+  printf("frpp_log_mmap: mmap %.1f ns/record, write() %.1f ns/record\n",
+         (double)mmap_ns / TEST_BENCH_RECORDS,
+         (double)write_ns / TEST_BENCH_RECORDS);
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  if (mkdtemp(prv_dir) == NULL) {
+    return 1;
+  }
+
+  UNITY_BEGIN();
+
+  // Error condition tests
+  RUN_TEST(test_invalid);
+
+  // Sink tests
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_rollover);
+  RUN_TEST(test_seek);
+  RUN_TEST(test_max_segs);
+  RUN_TEST(test_crash);
+
+  // Benchmarks
+  RUN_TEST(test_bench);
+
+  int ret = UNITY_END();
+
+  rmdir(prv_dir);
+
+  return ret;
+}
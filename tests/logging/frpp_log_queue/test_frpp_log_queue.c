@@ -0,0 +1,603 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_log_queue.c
+ * @author Evan Stoddard
+ * @brief Tests for frpp_log_queue
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "unity.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "frpp/logging/frpp_log_queue.h"
+#include "frpp/sys/frpp_printf.h"
+#include "frpp/utils/utils.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TEST_RING_SIZE (1024U)
+
+#define TEST_THROUGHPUT_RING_SIZE (16384U)
+#define TEST_THROUGHPUT_PRODUCERS (4U)
+#define TEST_THROUGHPUT_RECORDS (50000U)
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static _Alignas(FRPP_LOG_QUEUE_ALIGN) uint8_t prv_ring[TEST_RING_SIZE];
+static _Alignas(FRPP_LOG_QUEUE_ALIGN) uint8_t
+    prv_throughput_ring[TEST_THROUGHPUT_RING_SIZE];
+
+static struct frpp_log_queue prv_queue;
+
+static const char prv_fmt_producer[] = "producer %d seq %u";
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {
+  frpp_log_queue_init(&prv_queue, prv_ring, sizeof(prv_ring));
+}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief Producer thread for throughput test
+ *
+ * @param arg Producer index
+ * @return NULL
+ */
+static void *prv_producer(void *arg) {
+  int id = (int)(intptr_t)arg;
+
+  for (unsigned int seq = 0; seq < TEST_THROUGHPUT_RECORDS; seq++) {
+    while (frpp_log_queue_printf(&prv_queue, prv_fmt_producer, id, seq) ==
+           -ENOSPC) {
+      sched_yield();
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Monotonic time in nanoseconds
+ */
+static uint64_t prv_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Wipe the format string pointer of a record in a ring, as if its
+ * format string were lost, so the record can't be rendered
+ *
+ * @param ring Ring storage
+ * @param size Size of ring storage
+ * @param fmt_str Format string of record
+ */
+static void prv_forget_fmt(uint8_t *ring, size_t size, const char *fmt_str) {
+  static const char *const none = NULL;
+
+  for (size_t i = 0; i + sizeof(fmt_str) <= size; i++) {
+    if (memcmp(&ring[i], &fmt_str, sizeof(fmt_str)) == 0) {
+      memcpy(&ring[i], &none, sizeof(none));
+      return;
+    }
+  }
+
+  TEST_FAIL_MESSAGE("Format string pointer not found in ring");
+}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test init with invalid arguments
+ */
+void test_init_invalid(void) {
+  struct frpp_log_queue queue;
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_queue_init(NULL, prv_ring, 1024));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_queue_init(&queue, NULL, 1024));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_queue_init(&queue, prv_ring, 1000));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_queue_init(&queue, prv_ring + 1, 512));
+}
+
+/**
+ * @brief Test empty queue
+ */
+void test_empty(void) {
+  char out_buf[64];
+  struct frpp_log_record record;
+
+  TEST_ASSERT_EQUAL(-EAGAIN, frpp_log_queue_peek(&prv_queue, &record));
+  TEST_ASSERT_EQUAL(-EAGAIN,
+                    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+}
+
+/**
+ * @brief Test single record round trip
+ */
+void test_single_record(void) {
+  char out_buf[64] = {0};
+
+  int ret = frpp_log_queue_printf(&prv_queue, "Value: %d, String: %s", 42,
+                                  "test");
+  TEST_ASSERT_EQUAL(0, ret);
+
+  ret = frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_GREATER_THAN(0, ret);
+  TEST_ASSERT_EQUAL_STRING("Value: 42, String: test", out_buf);
+
+  TEST_ASSERT_EQUAL(-EAGAIN,
+                    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+}
+
+/**
+ * @brief Test record without arguments
+ */
+void test_no_args_record(void) {
+  char out_buf[64] = {0};
+
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_printf(&prv_queue, "Hello"));
+
+  int ret = frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL(5, ret);
+  TEST_ASSERT_EQUAL_STRING("Hello", out_buf);
+}
+
+/**
+ * @brief Test interned format strings are stored by ID and take less ring
+ * space than ones stored by pointer
+ */
+void test_interned_record(void) {
+  struct frpp_log_record record;
+  char out_buf[64] = {0};
+
+  TEST_ASSERT_EQUAL(0, FRPP_LOG_QUEUE_PRINTF(&prv_queue, "id %d", 1));
+  size_t interned_span = atomic_load(&prv_queue.head);
+
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_printf(&prv_queue, "ptr %d", 2));
+  size_t ptr_span = atomic_load(&prv_queue.head) - interned_span;
+
+  TEST_ASSERT_EQUAL(ptr_span - sizeof(const char *), interned_span);
+
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_peek(&prv_queue, &record));
+  TEST_ASSERT_NOT_EQUAL(FRPP_LOG_FMT_ID_NONE, record.fmt_id);
+  TEST_ASSERT_EQUAL_PTR(frpp_log_fmt_str(record.fmt_id), record.fmt);
+  TEST_ASSERT_EQUAL_STRING("id %d", record.fmt);
+  frpp_log_queue_release(&prv_queue, &record);
+
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_peek(&prv_queue, &record));
+  TEST_ASSERT_EQUAL(FRPP_LOG_FMT_ID_NONE, record.fmt_id);
+  TEST_ASSERT_EQUAL_STRING("ptr %d", record.fmt);
+  frpp_log_queue_release(&prv_queue, &record);
+
+  TEST_ASSERT_EQUAL(0, FRPP_LOG_QUEUE_PRINTF(&prv_queue, "no args"));
+  TEST_ASSERT_EQUAL(7, frpp_log_queue_render(&prv_queue, out_buf,
+                                             sizeof(out_buf)));
+  TEST_ASSERT_EQUAL_STRING("no args", out_buf);
+}
+
+/**
+ * @brief Test records packaged with string capture render from their copy
+ */
+void test_capture_record(void) {
+  struct frpp_log_queue_slot slot;
+  struct frpp_log_record record;
+  char out_buf[64] = {0};
+  char name[16] = "temp";
+
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_reserve(&prv_queue, 64, &slot));
+  TEST_ASSERT_GREATER_THAN(
+      0, frpp_printf_reserve_package(&slot.pkg, FRPP_PRINTF_FLAG_CAPTURE_STR,
+                                     "%s record", name));
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_commit(&prv_queue, &slot, "%s record"));
+
+  strcpy(name, "gone");
+
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_peek(&prv_queue, &record));
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_FLAG_CAPTURE_STR, record.flags);
+
+  int ret = frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL(11, ret);
+  TEST_ASSERT_EQUAL_STRING("temp record", out_buf);
+}
+
+/**
+ * @brief Test records packaged densely are flagged and rendered as such
+ */
+void test_dense_record(void) {
+  struct frpp_log_queue_slot slot;
+  struct frpp_log_record record;
+  char out_buf[64] = {0};
+
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_reserve(&prv_queue, 64, &slot));
+  TEST_ASSERT_EQUAL(3, frpp_printf_reserve_package(&slot.pkg,
+                                                   FRPP_PRINTF_FLAG_DENSE,
+                                                   "%c%d %hhu", 'x', -3, 200));
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_commit(&prv_queue, &slot, "%c%d %hhu"));
+
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_peek(&prv_queue, &record));
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_FLAG_DENSE, record.flags);
+  TEST_ASSERT_EQUAL(3, record.pkg_len);
+
+  int ret = frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL(7, ret);
+  TEST_ASSERT_EQUAL_STRING("x-3 200", out_buf);
+}
+
+/**
+ * @brief Test peek exposes format string and package
+ */
+void test_peek(void) {
+  static const char fmt[] = "%lld";
+  struct frpp_log_record record;
+
+  frpp_log_queue_printf(&prv_queue, fmt, 1234LL);
+
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_peek(&prv_queue, &record));
+  TEST_ASSERT_EQUAL_PTR(fmt, record.fmt);
+  TEST_ASSERT_EQUAL(sizeof(long long), record.pkg_len);
+  TEST_ASSERT_EQUAL(1234LL, *(const long long *)record.pkg);
+
+  // Peek doesn't consume
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_peek(&prv_queue, &record));
+  frpp_log_queue_release(&prv_queue, &record);
+  TEST_ASSERT_EQUAL(-EAGAIN, frpp_log_queue_peek(&prv_queue, &record));
+}
+
+/**
+ * @brief Test records are rendered in FIFO order
+ */
+void test_fifo_order(void) {
+  char out_buf[32] = {0};
+  char expected[32] = {0};
+
+  for (int i = 0; i < 10; i++) {
+    TEST_ASSERT_EQUAL(0, frpp_log_queue_printf(&prv_queue, "rec %d", i));
+  }
+
+  for (int i = 0; i < 10; i++) {
+    snprintf(expected, sizeof(expected), "rec %d", i);
+    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+    TEST_ASSERT_EQUAL_STRING(expected, out_buf);
+  }
+}
+
+/**
+ * @brief Test records are drained back to back in FIFO order
+ */
+void test_render_batch(void) {
+  char out_buf[32] = {0};
+  size_t len = 0;
+
+  TEST_ASSERT_EQUAL(-EAGAIN, frpp_log_queue_render_batch(
+                                 &prv_queue, out_buf, sizeof(out_buf), &len));
+
+  for (int i = 0; i < 10; i++) {
+    TEST_ASSERT_EQUAL(0, frpp_log_queue_printf(&prv_queue, "rec %d;", i));
+  }
+
+  // Five 6 character records and a terminator fit, a sixth doesn't
+  int ret =
+      frpp_log_queue_render_batch(&prv_queue, out_buf, sizeof(out_buf), &len);
+  TEST_ASSERT_EQUAL(5, ret);
+  TEST_ASSERT_EQUAL(30, len);
+  TEST_ASSERT_EQUAL_STRING("rec 0;rec 1;rec 2;rec 3;rec 4;", out_buf);
+
+  ret = frpp_log_queue_render_batch(&prv_queue, out_buf, sizeof(out_buf), &len);
+  TEST_ASSERT_EQUAL(5, ret);
+  TEST_ASSERT_EQUAL_STRING("rec 5;rec 6;rec 7;rec 8;rec 9;", out_buf);
+
+  // Oversized records are truncated instead of blocking the queue
+  frpp_log_queue_printf(&prv_queue, "%s", "longer than the buffer");
+  ret = frpp_log_queue_render_batch(&prv_queue, out_buf, 8, &len);
+  TEST_ASSERT_EQUAL(1, ret);
+  TEST_ASSERT_EQUAL(7, len);
+  TEST_ASSERT_EQUAL_STRING("longer ", out_buf);
+  TEST_ASSERT_EQUAL(-EAGAIN, frpp_log_queue_render_batch(
+                                 &prv_queue, out_buf, sizeof(out_buf), &len));
+}
+
+/**
+ * @brief Test a record that can't be rendered is released and reported
+ * instead of stalling the queue
+ */
+void test_render_batch_bad_record(void) {
+  static const char fmt_bad[] = "bad %d;";
+  char out_buf[32] = {0};
+  size_t len = 0;
+
+  frpp_log_queue_printf(&prv_queue, "rec %d;", 0);
+  frpp_log_queue_printf(&prv_queue, fmt_bad, 1);
+  frpp_log_queue_printf(&prv_queue, "rec %d;", 2);
+  prv_forget_fmt(prv_ring, sizeof(prv_ring), fmt_bad);
+
+  // Records ahead of it are rendered first
+  TEST_ASSERT_EQUAL(1, frpp_log_queue_render_batch(&prv_queue, out_buf,
+                                                   sizeof(out_buf), &len));
+  TEST_ASSERT_EQUAL_STRING("rec 0;", out_buf);
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_queue_render_batch(
+                                 &prv_queue, out_buf, sizeof(out_buf), &len));
+  TEST_ASSERT_EQUAL(0, len);
+
+  TEST_ASSERT_EQUAL(1, frpp_log_queue_render_batch(&prv_queue, out_buf,
+                                                   sizeof(out_buf), &len));
+  TEST_ASSERT_EQUAL_STRING("rec 2;", out_buf);
+  TEST_ASSERT_EQUAL(-EAGAIN, frpp_log_queue_render_batch(
+                                 &prv_queue, out_buf, sizeof(out_buf), &len));
+}
+
+/**
+ * @brief Test full queue rejects records until space is released
+ */
+void test_full(void) {
+  char out_buf[32] = {0};
+  int count = 0;
+
+  while (frpp_log_queue_printf(&prv_queue, "%d", count) == 0) {
+    count++;
+  }
+
+  TEST_ASSERT_GREATER_THAN(0, count);
+  TEST_ASSERT_EQUAL(-ENOSPC, frpp_log_queue_printf(&prv_queue, "%d", count));
+
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("0", out_buf);
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_printf(&prv_queue, "%d", count));
+}
+
+/**
+ * @brief Test record larger than the ring
+ */
+void test_record_too_large(void) {
+  static _Alignas(FRPP_LOG_QUEUE_ALIGN) uint8_t small_ring[64];
+  struct frpp_log_queue queue;
+
+  frpp_log_queue_init(&queue, small_ring, sizeof(small_ring));
+
+  int ret = frpp_log_queue_printf(
+      &queue, "%lld %lld %lld %lld %lld %lld %lld %lld", 1LL, 2LL, 3LL, 4LL, 5LL,
+      6LL, 7LL, 8LL);
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+}
+
+/**
+ * @brief Test package larger than FRPP_LOG_QUEUE_RESERVE_HINT
+ */
+void test_record_larger_than_hint(void) {
+  char out_buf[256] = {0};
+  char expected[256] = {0};
+
+  int ret = frpp_log_queue_printf(
+      &prv_queue, "%lld %lld %lld %lld %lld %lld %lld %lld %lld %lld", 1LL, 2LL,
+      3LL, 4LL, 5LL, 6LL, 7LL, 8LL, 9LL, 10LL);
+  TEST_ASSERT_EQUAL(0, ret);
+
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  snprintf(expected, sizeof(expected), "%lld %lld %lld %lld %lld %lld %lld "
+           "%lld %lld %lld", 1LL, 2LL, 3LL, 4LL, 5LL, 6LL, 7LL, 8LL, 9LL, 10LL);
+  TEST_ASSERT_EQUAL_STRING(expected, out_buf);
+}
+
+/**
+ * @brief Test reserve/commit gives unused space back to the ring
+ */
+void test_reserve_commit_shrinks(void) {
+  struct frpp_log_queue_slot slot;
+  struct frpp_log_record record;
+
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_reserve(&prv_queue, 256, &slot));
+  TEST_ASSERT_GREATER_OR_EQUAL(256, slot.pkg.capacity);
+
+  frpp_printf_reserve_package(&slot.pkg, 0, "%d", 5);
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_commit(&prv_queue, &slot, "%d"));
+
+  TEST_ASSERT_EQUAL(0, frpp_log_queue_peek(&prv_queue, &record));
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(int), record.pkg_len);
+  TEST_ASSERT_LESS_THAN(256, record.span);
+  TEST_ASSERT_EQUAL(record.span, atomic_load(&prv_queue.head));
+}
+
+/**
+ * @brief Test commit keeps slack when a later slot was reserved
+ */
+void test_reserve_commit_out_of_order(void) {
+  struct frpp_log_queue_slot first;
+  struct frpp_log_queue_slot second;
+  char out_buf[32] = {0};
+
+  frpp_log_queue_reserve(&prv_queue, 64, &first);
+  frpp_log_queue_reserve(&prv_queue, 64, &second);
+
+  frpp_printf_reserve_package(&second.pkg, 0, "second %d", 2);
+  frpp_log_queue_commit(&prv_queue, &second, "second %d");
+
+  // First isn't committed yet, so nothing can be consumed
+  TEST_ASSERT_EQUAL(-EAGAIN,
+                    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)));
+
+  frpp_printf_reserve_package(&first.pkg, 0, "first %d", 1);
+  frpp_log_queue_commit(&prv_queue, &first, "first %d");
+
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("first 1", out_buf);
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("second 2", out_buf);
+}
+
+/**
+ * @brief Test aborted slots are never seen by the consumer
+ */
+void test_reserve_abort(void) {
+  struct frpp_log_queue_slot first;
+  struct frpp_log_queue_slot second;
+  struct frpp_log_record record;
+  char out_buf[32] = {0};
+
+  // Most recent slot is handed straight back
+  frpp_log_queue_reserve(&prv_queue, 64, &first);
+  frpp_log_queue_abort(&prv_queue, &first);
+  TEST_ASSERT_EQUAL(0, atomic_load(&prv_queue.head));
+
+  // Older slot is skipped
+  frpp_log_queue_reserve(&prv_queue, 64, &first);
+  frpp_log_queue_reserve(&prv_queue, 64, &second);
+  frpp_printf_reserve_package(&first.pkg, 0, "%d", 1);
+  frpp_log_queue_abort(&prv_queue, &first);
+  frpp_printf_reserve_package(&second.pkg, 0, "kept %d", 2);
+  frpp_log_queue_commit(&prv_queue, &second, "kept %d");
+
+  frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("kept 2", out_buf);
+  TEST_ASSERT_EQUAL(-EAGAIN, frpp_log_queue_peek(&prv_queue, &record));
+}
+
+/**
+ * @brief Test records wrap around the end of the ring
+ */
+void test_wraparound(void) {
+  char out_buf[64] = {0};
+  char expected[64] = {0};
+
+  // Odd-sized records so reservations eventually straddle the ring end
+  for (int i = 0; i < 200; i++) {
+    int ret = frpp_log_queue_printf(&prv_queue, "%d %s %lld", i, "wrap",
+                                    (long long)i * 3);
+    TEST_ASSERT_EQUAL(0, ret);
+
+    if (i % 3 == 0) {
+      ret = frpp_log_queue_printf(&prv_queue, "%d", i);
+      TEST_ASSERT_EQUAL(0, ret);
+    }
+
+    frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+    snprintf(expected, sizeof(expected), "%d %s %lld", i, "wrap",
+             (long long)i * 3);
+    TEST_ASSERT_EQUAL_STRING(expected, out_buf);
+
+    if (i % 3 == 0) {
+      frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf));
+      snprintf(expected, sizeof(expected), "%d", i);
+      TEST_ASSERT_EQUAL_STRING(expected, out_buf);
+    }
+  }
+}
+
+/**
+ * @brief Test throughput and ordering with concurrent producers
+ */
+void test_multi_producer_throughput(void) {
+  pthread_t threads[TEST_THROUGHPUT_PRODUCERS];
+  unsigned int next_seq[TEST_THROUGHPUT_PRODUCERS] = {0};
+  const size_t total = TEST_THROUGHPUT_PRODUCERS * TEST_THROUGHPUT_RECORDS;
+  size_t received = 0;
+  char out_buf[64];
+
+  frpp_log_queue_init(&prv_queue, prv_throughput_ring,
+                      sizeof(prv_throughput_ring));
+
+  uint64_t start = prv_now_ns();
+
+  for (size_t i = 0; i < TEST_THROUGHPUT_PRODUCERS; i++) {
+    pthread_create(&threads[i], NULL, prv_producer, (void *)(intptr_t)i);
+  }
+
+  while (received < total) {
+    if (frpp_log_queue_render(&prv_queue, out_buf, sizeof(out_buf)) < 0) {
+      sched_yield();
+      continue;
+    }
+
+    int id = -1;
+    unsigned int seq = 0;
+    TEST_ASSERT_EQUAL(2, sscanf(out_buf, prv_fmt_producer, &id, &seq));
+    TEST_ASSERT_TRUE(id >= 0 && id < (int)TEST_THROUGHPUT_PRODUCERS);
+
+    // Records from a single producer must arrive in order
+    TEST_ASSERT_EQUAL(next_seq[id], seq);
+    next_seq[id]++;
+    received++;
+  }
+
+  for (size_t i = 0; i < TEST_THROUGHPUT_PRODUCERS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  uint64_t elapsed = prv_now_ns() - start;
+
+  printf("frpp_log_queue: %u producers, %zu records, %.1f ns/record\n",
+         TEST_THROUGHPUT_PRODUCERS, received, (double)elapsed / received);
+
+  struct frpp_log_record record;
+  TEST_ASSERT_EQUAL(-EAGAIN, frpp_log_queue_peek(&prv_queue, &record));
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Error condition tests
+  RUN_TEST(test_init_invalid);
+  RUN_TEST(test_empty);
+
+  // Single producer tests
+  RUN_TEST(test_single_record);
+  RUN_TEST(test_no_args_record);
+  RUN_TEST(test_peek);
+  RUN_TEST(test_interned_record);
+  RUN_TEST(test_capture_record);
+  RUN_TEST(test_dense_record);
+  RUN_TEST(test_fifo_order);
+  RUN_TEST(test_render_batch);
+  RUN_TEST(test_render_batch_bad_record);
+
+  // Capacity tests
+  RUN_TEST(test_full);
+  RUN_TEST(test_record_too_large);
+  RUN_TEST(test_wraparound);
+  RUN_TEST(test_record_larger_than_hint);
+
+  // Reserve/commit tests
+  RUN_TEST(test_reserve_commit_shrinks);
+  RUN_TEST(test_reserve_commit_out_of_order);
+  RUN_TEST(test_reserve_abort);
+
+  // Concurrency tests
+  RUN_TEST(test_multi_producer_throughput);
+
+  return UNITY_END();
+}
@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_log_retain.c
+ * @author Evan Stoddard
+ * @brief Tests for frpp_log_retain
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "unity.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "frpp/logging/frpp_log_retain.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TEST_REGION_SIZE (4096U)
+#define TEST_BUILD_ID (0x1234U)
+
+#define TEST_SPEED_REGION_SIZE (1U << 20)
+
+/**
+ * @brief Offset of the first tail slot in the region header
+ */
+#define TEST_TAIL_SLOT_OFFSET (24U)
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static _Alignas(FRPP_LOG_RETAIN_ALIGN) uint8_t prv_region[TEST_REGION_SIZE];
+
+static struct frpp_log_retain prv_retain;
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {
+  memset(prv_region, 0xA5, sizeof(prv_region));
+  TEST_ASSERT_EQUAL(0, frpp_log_retain_init(&prv_retain, prv_region,
+                                            sizeof(prv_region),
+                                            TEST_BUILD_ID));
+}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief Monotonic time in nanoseconds
+ */
+static uint64_t prv_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Log numbered record
+ *
+ * @param retain Retained ring instance
+ * @param idx Number of record
+ * @return Return value of frpp_log_retain_printf
+ */
+static int prv_log(struct frpp_log_retain *retain, unsigned int idx) {
+  char name[16];
+
+  // Captured, so the stack copy may be gone by the time it's rendered
+  snprintf(name, sizeof(name), "task%u", idx % 7);
+
+  return FRPP_LOG_RETAIN_PRINTF(retain, "rec %u from %s", idx, name);
+}
+
+/**
+ * @brief Render records and check they're numbered consecutively
+ *
+ * @param retain Retained ring instance
+ * @param first Expected number of first record
+ * @param count Expected number of records
+ */
+static void prv_expect(struct frpp_log_retain *retain, unsigned int first,
+                       size_t count) {
+  char out_buf[64];
+  char expected[64];
+
+  for (size_t i = 0; i < count; i++) {
+    unsigned int idx = first + (unsigned int)i;
+
+    snprintf(expected, sizeof(expected), "rec %u from task%u", idx, idx % 7);
+    TEST_ASSERT_GREATER_THAN(0, frpp_log_retain_render(retain, out_buf,
+                                                       sizeof(out_buf)));
+    TEST_ASSERT_EQUAL_STRING(expected, out_buf);
+  }
+
+  TEST_ASSERT_EQUAL(-EAGAIN,
+                    frpp_log_retain_render(retain, out_buf, sizeof(out_buf)));
+}
+
+/**
+ * @brief Attach to the test region as if after a reset
+ *
+ * @return Number of records recovered
+ */
+static int prv_restart(void) {
+  memset(&prv_retain, 0xCC, sizeof(prv_retain));
+
+  return frpp_log_retain_init(&prv_retain, prv_region, sizeof(prv_region),
+                              TEST_BUILD_ID);
+}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test invalid arguments
+ */
+void test_invalid(void) {
+  struct frpp_log_retain retain;
+  char out_buf[16];
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_retain_init(NULL, prv_region,
+                                                  sizeof(prv_region), 0));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_retain_init(&retain, NULL,
+                                                  sizeof(prv_region), 0));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_retain_init(&retain, prv_region + 1,
+                                                  sizeof(prv_region) - 8, 0));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_retain_init(&retain, prv_region, 32, 0));
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_retain_printf(NULL, "x"));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_retain_printf(&prv_retain, NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_log_retain_render(NULL, out_buf, 16));
+
+  // Format string pointers don't survive a reset
+  TEST_ASSERT_EQUAL(-EINVAL,
+                    frpp_log_retain_printf(&prv_retain, "not interned"));
+  TEST_ASSERT_EQUAL(0, frpp_log_retain_count(&prv_retain));
+}
+
+/**
+ * @brief Test records round trip with captured strings
+ */
+void test_round_trip(void) {
+  for (unsigned int i = 0; i < 10; i++) {
+    TEST_ASSERT_EQUAL(0, prv_log(&prv_retain, i));
+  }
+
+  TEST_ASSERT_EQUAL(10, frpp_log_retain_count(&prv_retain));
+  prv_expect(&prv_retain, 0, 10);
+  TEST_ASSERT_EQUAL(0, frpp_log_retain_count(&prv_retain));
+  TEST_ASSERT_EQUAL(0, frpp_log_retain_lost(&prv_retain));
+}
+
+/**
+ * @brief Test records not yet rendered are recovered after restart
+ */
+void test_restart(void) {
+  char out_buf[64];
+
+  for (unsigned int i = 0; i < 5; i++) {
+    prv_log(&prv_retain, i);
+  }
+
+  frpp_log_retain_render(&prv_retain, out_buf, sizeof(out_buf));
+
+  TEST_ASSERT_EQUAL(4, prv_restart());
+
+  // Logging continues the recovered sequence
+  prv_log(&prv_retain, 5);
+  TEST_ASSERT_EQUAL(5, prv_restart());
+  prv_expect(&prv_retain, 1, 5);
+
+  // Rendered records stay rendered
+  TEST_ASSERT_EQUAL(0, prv_restart());
+}
+
+/**
+ * @brief Test region of another image is discarded
+ */
+void test_build_id(void) {
+  char out_buf[64];
+
+  prv_log(&prv_retain, 0);
+
+  TEST_ASSERT_EQUAL(0, frpp_log_retain_init(&prv_retain, prv_region,
+                                            sizeof(prv_region),
+                                            TEST_BUILD_ID + 1));
+  TEST_ASSERT_EQUAL(-EAGAIN, frpp_log_retain_render(&prv_retain, out_buf,
+                                                    sizeof(out_buf)));
+
+  // Stale records don't come back under the old ID either
+  TEST_ASSERT_EQUAL(0, prv_restart());
+}
+
+/**
+ * @brief Test the oldest records are overwritten when full, and the newest
+ * are recovered across many wraps of the ring
+ */
+void test_overwrite(void) {
+  const unsigned int total = 1000;
+
+  for (unsigned int i = 0; i < total; i++) {
+    TEST_ASSERT_EQUAL(0, prv_log(&prv_retain, i));
+  }
+
+  size_t count = frpp_log_retain_count(&prv_retain);
+
+  TEST_ASSERT_TRUE(count > 10 && count < total);
+  TEST_ASSERT_EQUAL(total - count, frpp_log_retain_lost(&prv_retain));
+
+  TEST_ASSERT_EQUAL(count, prv_restart());
+  prv_expect(&prv_retain, total - (unsigned int)count, count);
+}
+
+/**
+ * @brief Test a record torn by a reset is dropped, and logging resumes
+ * after the last intact record
+ */
+void test_torn_record(void) {
+  for (unsigned int i = 0; i < 10; i++) {
+    prv_log(&prv_retain, i);
+  }
+
+  size_t last = prv_retain.head;
+  prv_log(&prv_retain, 10);
+
+  // Reset hit while the package of record 10 was being copied
+  prv_retain.data[last + 20] ^= 0x5A;
+
+  TEST_ASSERT_EQUAL(10, prv_restart());
+  prv_log(&prv_retain, 10);
+  prv_log(&prv_retain, 11);
+
+  // Reset hit while the header of record 12 was being written
+  last = prv_retain.head;
+  prv_log(&prv_retain, 12);
+  memset(&prv_retain.data[last], 0, 8);
+
+  TEST_ASSERT_EQUAL(12, prv_restart());
+  prv_expect(&prv_retain, 0, 12);
+}
+
+/**
+ * @brief Test a tail torn by a reset falls back to the previous one
+ */
+void test_torn_tail(void) {
+  char out_buf[64];
+
+  for (unsigned int i = 0; i < 5; i++) {
+    prv_log(&prv_retain, i);
+  }
+
+  frpp_log_retain_render(&prv_retain, out_buf, sizeof(out_buf));
+  frpp_log_retain_render(&prv_retain, out_buf, sizeof(out_buf));
+
+  // Reset hit while the tail past record 1 was being written
+  size_t slot = TEST_TAIL_SLOT_OFFSET + 16U * (prv_retain.gen & 1U);
+  prv_region[slot + 8] ^= 0x01;
+
+  // Record 1 is rendered again rather than anything being lost
+  TEST_ASSERT_EQUAL(4, prv_restart());
+  prv_expect(&prv_retain, 1, 4);
+}
+
+/**
+ * @brief Test records survive a crash of the process when the region is a
+ * mapped file
+ */
+void test_mapped_crash(void) {
+  char path[] = "/tmp/frpp_log_retain_XXXXXX";
+  int fd = mkstemp(path);
+  TEST_ASSERT_TRUE(fd >= 0);
+  close(fd);
+
+  pid_t pid = fork();
+  TEST_ASSERT_TRUE(pid >= 0);
+
+  if (pid == 0) {
+    struct frpp_log_retain retain;
+    void *region = NULL;
+
+    if (frpp_log_retain_map(path, TEST_REGION_SIZE, &region) != 0 ||
+        frpp_log_retain_init(&retain, region, TEST_REGION_SIZE,
+                             TEST_BUILD_ID) != 0) {
+      _exit(1);
+    }
+
+    for (unsigned int i = 0; i < 20; i++) {
+      prv_log(&retain, i);
+    }
+
+    abort();
+  }
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  TEST_ASSERT_TRUE(WIFSIGNALED(status));
+
+  struct frpp_log_retain retain;
+  void *region = NULL;
+
+  TEST_ASSERT_EQUAL(0, frpp_log_retain_map(path, TEST_REGION_SIZE, &region));
+  TEST_ASSERT_EQUAL(20, frpp_log_retain_init(&retain, region,
+                                             TEST_REGION_SIZE,
+                                             TEST_BUILD_ID));
+  prv_expect(&retain, 0, 20);
+
+  frpp_log_retain_unmap(region, TEST_REGION_SIZE);
+  unlink(path);
+}
+
+/**
+ * @brief Measure recovery of a full region
+ */
+void test_recovery_speed(void) {
+  struct frpp_log_retain retain;
+  uint8_t *region = aligned_alloc(FRPP_LOG_RETAIN_ALIGN,
+                                  TEST_SPEED_REGION_SIZE);
+  TEST_ASSERT_NOT_NULL(region);
+
+  frpp_log_retain_init(&retain, region, TEST_SPEED_REGION_SIZE,
+                       TEST_BUILD_ID);
+
+  unsigned int total = 0;
+
+  while (frpp_log_retain_lost(&retain) < 1000) {
+    prv_log(&retain, total++);
+  }
+
+  size_t count = frpp_log_retain_count(&retain);
+  uint64_t start = prv_now_ns();
+
+  TEST_ASSERT_EQUAL(count, frpp_log_retain_init(&retain, region,
+                                                TEST_SPEED_REGION_SIZE,
+                                                TEST_BUILD_ID));
+
+  uint64_t elapsed = prv_now_ns() - start;
+
+  printf("frpp_log_retain: recovered %zu records (%u KiB) in %.2f ms\n",
+         count, TEST_SPEED_REGION_SIZE / 1024U, (double)elapsed / 1e6);
+
+  prv_expect(&retain, total - (unsigned int)count, count);
+  free(region);
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Error condition tests
+  RUN_TEST(test_invalid);
+
+  // Ring tests
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_overwrite);
+
+  // Recovery tests
+  RUN_TEST(test_restart);
+  RUN_TEST(test_build_id);
+  RUN_TEST(test_torn_record);
+  RUN_TEST(test_torn_tail);
+  RUN_TEST(test_mapped_crash);
+  RUN_TEST(test_recovery_speed);
+
+  return UNITY_END();
+}
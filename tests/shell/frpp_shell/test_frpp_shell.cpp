@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_shell.cpp
+ * @author Evan Stoddard
+ * @brief Tests for frpp_shell dispatch and compile-time command tables
+ */
+
+#include "unity.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frpp/shell/frpp_shell.h"
+#include "frpp/shell/frpp_shell_table.hpp"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TEST_GENERATED_COUNT (300U)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Arguments seen by the last handler called
+ */
+struct test_call {
+  int argc;
+  char *argv[FRPP_SHELL_ARGC_MAX];
+};
+
+/**
+ * @brief Names of generated commands ("g0".."g299")
+ */
+struct test_names {
+  char names[TEST_GENERATED_COUNT][8];
+};
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief Record arguments in the shell's context
+ */
+static int prv_cmd_record(struct frpp_shell *shell, int argc, char *argv[]) {
+  struct test_call *call = static_cast<struct test_call *>(shell->ctx);
+
+  call->argc = argc;
+  for (int i = 0; i < argc; i++) {
+    call->argv[i] = argv[i];
+  }
+
+  return 0;
+}
+
+static int prv_cmd_fail(struct frpp_shell *shell, int argc, char *argv[]) {
+  (void)shell;
+  (void)argc;
+  (void)argv;
+  return -EIO;
+}
+
+/**
+ * @brief Return index of generated command from its name
+ */
+static int prv_cmd_generated(struct frpp_shell *shell, int argc,
+                             char *argv[]) {
+  (void)shell;
+  (void)argc;
+  return atoi(argv[0] + 1);
+}
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static constexpr auto prv_cmds = frpp::shell::make_table({
+    {"record", prv_cmd_record, "Record arguments"},
+    {"fail", prv_cmd_fail, "Always fails"},
+    {"led", prv_cmd_record, "Set LED state"},
+    {"reset", prv_cmd_record, "Reset device"},
+    {"status", prv_cmd_record, "Print status"},
+    {"help", prv_cmd_record, "List commands"},
+});
+
+static constexpr frpp_shell_table prv_table = prv_cmds.view();
+
+static constexpr test_names prv_names = [] {
+  test_names ret{};
+  for (size_t i = 0; i < TEST_GENERATED_COUNT; i++) {
+    char digits[4] = {};
+    size_t len = 0;
+    size_t val = i;
+    do {
+      digits[len++] = static_cast<char>('0' + (val % 10));
+      val /= 10;
+    } while (val != 0);
+
+    ret.names[i][0] = 'g';
+    for (size_t d = 0; d < len; d++) {
+      ret.names[i][1 + d] = digits[len - 1 - d];
+    }
+  }
+  return ret;
+}();
+
+static constexpr auto prv_generated = []() consteval {
+  frpp_shell_cmd cmds[TEST_GENERATED_COUNT] = {};
+  for (size_t i = 0; i < TEST_GENERATED_COUNT; i++) {
+    cmds[i] = {prv_names.names[i], prv_cmd_generated, ""};
+  }
+  return frpp::shell::make_table(cmds);
+}();
+
+static constexpr frpp_shell_table prv_generated_table = prv_generated.view();
+
+static struct frpp_shell prv_shell;
+static struct test_call prv_call;
+
+/*****************************************************************************
+ * Compile-time Checks
+ *****************************************************************************/
+
+static_assert(prv_cmds.view().count == 6);
+static_assert(prv_cmds.view().buckets == 2);
+static_assert(prv_cmds.trie[0].matches == 6);
+static_assert(prv_generated.trie[0].matches == TEST_GENERATED_COUNT);
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {
+  memset(&prv_call, 0, sizeof(prv_call));
+  frpp_shell_init(&prv_shell, &prv_table, &prv_call);
+}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test init with invalid arguments
+ */
+void test_init_invalid(void) {
+  struct frpp_shell shell;
+  struct frpp_shell_table broken = {nullptr, nullptr, nullptr, nullptr, 1, 1};
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_init(nullptr, &prv_table, nullptr));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_init(&shell, nullptr, nullptr));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_init(&shell, &broken, nullptr));
+}
+
+/**
+ * @brief Test C hash matches the compile-time one
+ */
+void test_hash_parity(void) {
+  TEST_ASSERT_EQUAL_HEX32(frpp::shell::detail::hash("status", 6),
+                          frpp_shell_hash("status", 6));
+  TEST_ASSERT_EQUAL_HEX32(frpp::shell::detail::mix(0xDEADBEEFU, 1234),
+                          frpp_shell_mix(0xDEADBEEFU, 1234));
+}
+
+/**
+ * @brief Test every registered command is found, and nothing else is
+ */
+void test_find(void) {
+  const char *names[] = {"record", "fail", "led", "reset", "status", "help"};
+
+  for (const char *name : names) {
+    const struct frpp_shell_cmd *cmd =
+        frpp_shell_find(&prv_table, name, strlen(name));
+    TEST_ASSERT_NOT_NULL(cmd);
+    TEST_ASSERT_EQUAL_STRING(name, cmd->name);
+  }
+
+  TEST_ASSERT_NULL(frpp_shell_find(&prv_table, "le", 2));
+  TEST_ASSERT_NULL(frpp_shell_find(&prv_table, "leds", 4));
+  TEST_ASSERT_NULL(frpp_shell_find(&prv_table, "", 0));
+  TEST_ASSERT_NULL(frpp_shell_find(&prv_table, "missing", 7));
+
+  // Name need not be NULL terminated
+  TEST_ASSERT_EQUAL_STRING("led",
+                           frpp_shell_find(&prv_table, "leds", 3)->name);
+}
+
+/**
+ * @brief Test a line is split in place and passed to its handler
+ */
+void test_execute(void) {
+  char line[] = "  record one\ttwo   three \r\n";
+
+  TEST_ASSERT_EQUAL(0, frpp_shell_execute(&prv_shell, line));
+  TEST_ASSERT_EQUAL(4, prv_call.argc);
+  TEST_ASSERT_EQUAL_STRING("record", prv_call.argv[0]);
+  TEST_ASSERT_EQUAL_STRING("one", prv_call.argv[1]);
+  TEST_ASSERT_EQUAL_STRING("two", prv_call.argv[2]);
+  TEST_ASSERT_EQUAL_STRING("three", prv_call.argv[3]);
+
+  // Arguments point into the line, nothing was copied
+  TEST_ASSERT_EQUAL_PTR(&line[2], prv_call.argv[0]);
+  TEST_ASSERT_EQUAL_PTR(&line[9], prv_call.argv[1]);
+}
+
+/**
+ * @brief Test handler's return value is passed through
+ */
+void test_execute_handler_error(void) {
+  char line[] = "fail";
+
+  TEST_ASSERT_EQUAL(-EIO, frpp_shell_execute(&prv_shell, line));
+}
+
+/**
+ * @brief Test lines that can't be dispatched
+ */
+void test_execute_invalid(void) {
+  char blank[] = " \t ";
+  char unknown[] = "bogus arg";
+  char many[] = "record 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16";
+  char most[] = "record 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15";
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_execute(nullptr, blank));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_execute(&prv_shell, nullptr));
+  TEST_ASSERT_EQUAL(-ENODATA, frpp_shell_execute(&prv_shell, blank));
+  TEST_ASSERT_EQUAL(-ENOENT, frpp_shell_execute(&prv_shell, unknown));
+  TEST_ASSERT_EQUAL(-E2BIG, frpp_shell_execute(&prv_shell, many));
+  TEST_ASSERT_EQUAL(0, frpp_shell_execute(&prv_shell, most));
+  TEST_ASSERT_EQUAL(FRPP_SHELL_ARGC_MAX, prv_call.argc);
+}
+
+/**
+ * @brief Test a table of hundreds of commands dispatches every one
+ */
+void test_generated_table(void) {
+  struct frpp_shell shell;
+  char line[8];
+
+  TEST_ASSERT_EQUAL(0, frpp_shell_init(&shell, &prv_generated_table, nullptr));
+
+  for (unsigned int i = 0; i < TEST_GENERATED_COUNT; i++) {
+    snprintf(line, sizeof(line), "g%u", i);
+    TEST_ASSERT_EQUAL(static_cast<int>(i), frpp_shell_execute(&shell, line));
+  }
+
+  snprintf(line, sizeof(line), "g%u", TEST_GENERATED_COUNT);
+  TEST_ASSERT_EQUAL(-ENOENT, frpp_shell_execute(&shell, line));
+}
+
+/**
+ * @brief Test quotes and escapes are removed in place
+ */
+void test_tokenize_quotes(void) {
+  char line[] = "set 'a b' \"c \\\"d\\\"\" e\\ f x\"y z\"'w' '' plain";
+  char *argv[8];
+
+  TEST_ASSERT_EQUAL(7, frpp_shell_tokenize(line, argv, 8));
+  TEST_ASSERT_EQUAL_STRING("set", argv[0]);
+  TEST_ASSERT_EQUAL_STRING("a b", argv[1]);
+  TEST_ASSERT_EQUAL_STRING("c \"d\"", argv[2]);
+  TEST_ASSERT_EQUAL_STRING("e f", argv[3]);
+  TEST_ASSERT_EQUAL_STRING("xy zw", argv[4]);
+  TEST_ASSERT_EQUAL_STRING("", argv[5]);
+  TEST_ASSERT_EQUAL_STRING("plain", argv[6]);
+
+  // Arguments start where they were, however earlier ones were compacted
+  TEST_ASSERT_EQUAL_PTR(&line[0], argv[0]);
+  TEST_ASSERT_EQUAL_PTR(&line[4], argv[1]);
+  TEST_ASSERT_EQUAL_PTR(&line[sizeof(line) - 6], argv[6]);
+
+  // Backslash is literal in single quotes
+  char literal[] = "'a\\b'";
+  TEST_ASSERT_EQUAL(1, frpp_shell_tokenize(literal, argv, 8));
+  TEST_ASSERT_EQUAL_STRING("a\\b", argv[0]);
+}
+
+/**
+ * @brief Test malformed lines are rejected
+ */
+void test_tokenize_invalid(void) {
+  char open_double[] = "say \"hi";
+  char open_single[] = "say 'hi";
+  char trailing[] = "say hi\\";
+  char many[] = "a b c";
+  char *argv[2];
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_tokenize(nullptr, argv, 2));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_tokenize(many, nullptr, 2));
+  TEST_ASSERT_EQUAL(-EBADMSG, frpp_shell_tokenize(open_double, argv, 2));
+  TEST_ASSERT_EQUAL(-EBADMSG, frpp_shell_tokenize(open_single, argv, 2));
+  TEST_ASSERT_EQUAL(-EBADMSG, frpp_shell_tokenize(trailing, argv, 2));
+  TEST_ASSERT_EQUAL(-E2BIG, frpp_shell_tokenize(many, argv, 2));
+
+  char quoted[] = "record \"one two";
+  TEST_ASSERT_EQUAL(-EBADMSG, frpp_shell_execute(&prv_shell, quoted));
+}
+
+/**
+ * @brief Test quoted arguments reach handlers as one argument
+ */
+void test_execute_quoted(void) {
+  char line[] = "record \"hello world\" it\\'s";
+
+  TEST_ASSERT_EQUAL(0, frpp_shell_execute(&prv_shell, line));
+  TEST_ASSERT_EQUAL(3, prv_call.argc);
+  TEST_ASSERT_EQUAL_STRING("hello world", prv_call.argv[1]);
+  TEST_ASSERT_EQUAL_STRING("it's", prv_call.argv[2]);
+}
+
+/**
+ * @brief Test completing prefixes of a small table
+ */
+void test_complete(void) {
+  struct frpp_shell_match match;
+  struct frpp_shell_table no_trie = prv_table;
+
+  TEST_ASSERT_EQUAL(2, frpp_shell_complete(&prv_table, "re", 2, &match));
+  TEST_ASSERT_EQUAL(2, match.common);
+  TEST_ASSERT_EQUAL_STRING("record", frpp_shell_match_get(&match, 0)->name);
+  TEST_ASSERT_EQUAL_STRING("reset", frpp_shell_match_get(&match, 1)->name);
+  TEST_ASSERT_NULL(frpp_shell_match_get(&match, 2));
+
+  TEST_ASSERT_EQUAL(1, frpp_shell_complete(&prv_table, "s", 1, &match));
+  TEST_ASSERT_EQUAL(6, match.common);
+  TEST_ASSERT_EQUAL_STRING("status", frpp_shell_match_get(&match, 0)->name);
+
+  TEST_ASSERT_EQUAL(1, frpp_shell_complete(&prv_table, "led", 3, &match));
+  TEST_ASSERT_EQUAL(3, match.common);
+
+  // Everything matches the empty prefix, in name order
+  TEST_ASSERT_EQUAL(6, frpp_shell_complete(&prv_table, "", 0, &match));
+  TEST_ASSERT_EQUAL(0, match.common);
+  TEST_ASSERT_EQUAL_STRING("fail", frpp_shell_match_get(&match, 0)->name);
+  TEST_ASSERT_EQUAL_STRING("status", frpp_shell_match_get(&match, 5)->name);
+
+  TEST_ASSERT_EQUAL(0, frpp_shell_complete(&prv_table, "x", 1, &match));
+  TEST_ASSERT_EQUAL(0, frpp_shell_complete(&prv_table, "rex", 3, &match));
+  TEST_ASSERT_EQUAL(0, frpp_shell_complete(&prv_table, "leds", 4, &match));
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_complete(nullptr, "", 0, &match));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_complete(&prv_table, "", 0, nullptr));
+
+  no_trie.trie = nullptr;
+  TEST_ASSERT_EQUAL(-ENOTSUP, frpp_shell_complete(&no_trie, "", 0, &match));
+}
+
+/**
+ * @brief Test completing prefixes of a table of hundreds of commands
+ */
+void test_complete_generated(void) {
+  struct frpp_shell_match match;
+  const frpp_shell_table *table = &prv_generated_table;
+  char name[8];
+
+  // g1, g10-g19, g100-g199
+  TEST_ASSERT_EQUAL(111, frpp_shell_complete(table, "g1", 2, &match));
+  TEST_ASSERT_EQUAL(2, match.common);
+
+  // g29, g290-g299
+  TEST_ASSERT_EQUAL(11, frpp_shell_complete(table, "g29", 3, &match));
+  TEST_ASSERT_EQUAL_STRING("g29", frpp_shell_match_get(&match, 0)->name);
+  TEST_ASSERT_EQUAL_STRING("g299", frpp_shell_match_get(&match, 10)->name);
+
+  TEST_ASSERT_EQUAL(TEST_GENERATED_COUNT,
+                    frpp_shell_complete(table, "", 0, &match));
+  TEST_ASSERT_EQUAL(1, match.common);
+
+  // Matches come out in name order
+  for (unsigned int i = 1; i < TEST_GENERATED_COUNT; i++) {
+    TEST_ASSERT_LESS_THAN(0, strcmp(frpp_shell_match_get(&match, i - 1)->name,
+                                    frpp_shell_match_get(&match, i)->name));
+  }
+
+  // Names with 3 digits are unique, and complete to themselves
+  for (unsigned int i = 100; i < TEST_GENERATED_COUNT; i++) {
+    snprintf(name, sizeof(name), "g%u", i);
+    TEST_ASSERT_EQUAL(1, frpp_shell_complete(table, name, strlen(name),
+                                             &match));
+    TEST_ASSERT_EQUAL_STRING(name, frpp_shell_match_get(&match, 0)->name);
+  }
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Error condition tests
+  RUN_TEST(test_init_invalid);
+
+  // Lookup tests
+  RUN_TEST(test_hash_parity);
+  RUN_TEST(test_find);
+  RUN_TEST(test_generated_table);
+
+  // Dispatch tests
+  RUN_TEST(test_execute);
+  RUN_TEST(test_execute_handler_error);
+  RUN_TEST(test_execute_invalid);
+  RUN_TEST(test_execute_quoted);
+
+  // Tokenizer tests
+  RUN_TEST(test_tokenize_quotes);
+  RUN_TEST(test_tokenize_invalid);
+
+  // Completion tests
+  RUN_TEST(test_complete);
+  RUN_TEST(test_complete_generated);
+
+  return UNITY_END();
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_shell_arg.c
+ * @author Evan Stoddard
+ * @brief Tests for frpp_shell_arg
+ */
+
+#include "unity.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frpp/shell/frpp_shell_arg.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/* Unity is built without float support */
+#define TEST_ASSERT_FLOAT(expected_, actual_)                                 \
+  TEST_ASSERT_TRUE_MESSAGE(fabsf((expected_) - (actual_)) <=                 \
+                               fabsf(expected_) * 1e-6f,                     \
+                           "Float mismatch")
+
+/* Random floats round tripped through text and compared with strtof */
+#define TEST_FLOAT_ROUND_TRIPS (100000U)
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test invalid arguments
+ */
+void test_invalid(void) {
+  int32_t i;
+  uint32_t u;
+  float f;
+  bool b;
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_int(NULL, &i));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_int("1", NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_hex(NULL, &u));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_hex("1", NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_float(NULL, &f));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_float("1", NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_bool(NULL, &b));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_bool("1", NULL));
+}
+
+/**
+ * @brief Test decimal integers
+ */
+void test_int(void) {
+  int32_t value = 0;
+
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_int("0", &value));
+  TEST_ASSERT_EQUAL(0, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_int("-42", &value));
+  TEST_ASSERT_EQUAL(-42, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_int("+17", &value));
+  TEST_ASSERT_EQUAL(17, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_int("2147483647", &value));
+  TEST_ASSERT_EQUAL(INT32_MAX, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_int("-2147483648", &value));
+  TEST_ASSERT_EQUAL(INT32_MIN, value);
+
+  value = 5;
+  TEST_ASSERT_EQUAL(-ERANGE, frpp_shell_arg_int("2147483648", &value));
+  TEST_ASSERT_EQUAL(-ERANGE, frpp_shell_arg_int("-2147483649", &value));
+  TEST_ASSERT_EQUAL(-ERANGE, frpp_shell_arg_int("99999999999", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_int("", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_int("-", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_int("12a", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_int(" 1", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_int("0x10", &value));
+  TEST_ASSERT_EQUAL(5, value);
+}
+
+/**
+ * @brief Test hexadecimal integers
+ */
+void test_hex(void) {
+  uint32_t value = 0;
+
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_hex("0x1F", &value));
+  TEST_ASSERT_EQUAL_HEX32(0x1F, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_hex("deadBEEF", &value));
+  TEST_ASSERT_EQUAL_HEX32(0xDEADBEEF, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_hex("0X00000000ffffffff", &value));
+  TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_hex("0", &value));
+  TEST_ASSERT_EQUAL_HEX32(0, value);
+
+  value = 5;
+  TEST_ASSERT_EQUAL(-ERANGE, frpp_shell_arg_hex("100000000", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_hex("0x", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_hex("", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_hex("0xG", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_hex("-1", &value));
+  TEST_ASSERT_EQUAL(5, value);
+}
+
+/**
+ * @brief Assert arg converts to the same float as strtof, bit for bit
+ *
+ * @param arg Argument
+ */
+static void prv_assert_strtof(const char *arg) {
+  float value;
+  float expected = strtof(arg, NULL);
+  uint32_t value_bits;
+  uint32_t expected_bits;
+
+  TEST_ASSERT_EQUAL_MESSAGE(0, frpp_shell_arg_float(arg, &value), arg);
+
+  memcpy(&value_bits, &value, sizeof(value));
+  memcpy(&expected_bits, &expected, sizeof(expected));
+  TEST_ASSERT_TRUE_MESSAGE(value_bits == expected_bits, arg);
+}
+
+/**
+ * @brief Test floating point numbers
+ */
+void test_float(void) {
+  float value = 0.0f;
+
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_float("1.5", &value));
+  TEST_ASSERT_FLOAT(1.5f, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_float("-0.25", &value));
+  TEST_ASSERT_FLOAT(-0.25f, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_float("42", &value));
+  TEST_ASSERT_FLOAT(42.0f, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_float(".5", &value));
+  TEST_ASSERT_FLOAT(0.5f, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_float("3.", &value));
+  TEST_ASSERT_FLOAT(3.0f, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_float("1e3", &value));
+  TEST_ASSERT_FLOAT(1000.0f, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_float("+2.5E-3", &value));
+  TEST_ASSERT_FLOAT(0.0025f, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_float("3.14159265358979", &value));
+  TEST_ASSERT_FLOAT(3.14159265f, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_float("12345678901234", &value));
+  TEST_ASSERT_FLOAT(12345678901234.0f, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_float("0.000001", &value));
+  TEST_ASSERT_FLOAT(1e-6f, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_float("3.4e38", &value));
+  TEST_ASSERT_FLOAT(3.4e38f, value);
+  TEST_ASSERT_EQUAL(0, frpp_shell_arg_float("0e999", &value));
+  TEST_ASSERT_FLOAT(0.0f, value);
+
+  value = 5.0f;
+  TEST_ASSERT_EQUAL(-ERANGE, frpp_shell_arg_float("1e39", &value));
+  TEST_ASSERT_EQUAL(-ERANGE, frpp_shell_arg_float("1e-50", &value));
+  TEST_ASSERT_EQUAL(-ERANGE, frpp_shell_arg_float("1e99999", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_float("", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_float(".", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_float("-", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_float("1e", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_float("1.2.3", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_float("nan", &value));
+  TEST_ASSERT_FLOAT(5.0f, value);
+}
+
+/**
+ * @brief Test conversion rounds like strtof, at the limits of float and for
+ * random values printed with enough digits to round trip
+ */
+void test_float_strtof(void) {
+  char arg[32];
+  uint32_t state = 0x12345678U;
+
+  prv_assert_strtof("1.17549435e-38");
+  prv_assert_strtof("3.40282347e38");
+  prv_assert_strtof("1.40129846e-45");
+  prv_assert_strtof("0.1");
+  prv_assert_strtof("16777217");
+  prv_assert_strtof("9.99999998e-21");
+  prv_assert_strtof("123456789012345678901234567890");
+
+  for (uint32_t i = 0; i < TEST_FLOAT_ROUND_TRIPS; i++) {
+    float f;
+
+    // xorshift32, skipping patterns that aren't finite non-zero floats
+    do {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      memcpy(&f, &state, sizeof(f));
+    } while (!isfinite(f) || f == 0.0f);
+
+    snprintf(arg, sizeof(arg), (i & 1) ? "%.9g" : "%.7e", (double)f);
+    prv_assert_strtof(arg);
+  }
+}
+
+/**
+ * @brief Test booleans
+ */
+void test_bool(void) {
+  const char *trues[] = {"1", "true", "TRUE", "on", "On", "yes"};
+  const char *falses[] = {"0", "false", "False", "off", "OFF", "no"};
+  bool value;
+
+  for (size_t i = 0; i < sizeof(trues) / sizeof(trues[0]); i++) {
+    value = false;
+    TEST_ASSERT_EQUAL(0, frpp_shell_arg_bool(trues[i], &value));
+    TEST_ASSERT_TRUE(value);
+
+    value = true;
+    TEST_ASSERT_EQUAL(0, frpp_shell_arg_bool(falses[i], &value));
+    TEST_ASSERT_FALSE(value);
+  }
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_bool("", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_bool("tru", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_bool("truee", &value));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_arg_bool("2", &value));
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Error condition tests
+  RUN_TEST(test_invalid);
+
+  // Conversion tests
+  RUN_TEST(test_int);
+  RUN_TEST(test_hex);
+  RUN_TEST(test_float);
+  RUN_TEST(test_float_strtof);
+  RUN_TEST(test_bool);
+
+  return UNITY_END();
+}
@@ -0,0 +1,502 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_shell_line.c
+ * @author Evan Stoddard
+ * @brief Tests for frpp_shell_line
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "unity.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "frpp/shell/frpp_shell_line.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TEST_PROMPT "> "
+
+#define TEST_ESC "\x1b"
+#define TEST_UP TEST_ESC "[A"
+#define TEST_DOWN TEST_ESC "[B"
+#define TEST_RIGHT TEST_ESC "[C"
+#define TEST_LEFT TEST_ESC "[D"
+#define TEST_HOME TEST_ESC "[H"
+#define TEST_END TEST_ESC "[F"
+#define TEST_DEL TEST_ESC "[3~"
+
+#define TEST_SESSION_REPEAT (2000U)
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static struct frpp_shell_line prv_line;
+
+static char prv_echo[4096];
+
+/* Scripted session for pipe harness, and the lines it must produce */
+static const char prv_session[] =
+    "status\r\n"
+    "led on" TEST_LEFT TEST_LEFT "x" TEST_DEL "\r"
+    "reset now" "\x15" "help\n"
+    "abc" TEST_HOME "X" TEST_END "Y" "\x7f\x7f" "\r\n" TEST_UP "\r";
+
+static const char *const prv_session_lines[] = {
+    "status", "led xn", "help", "Xab", "Xab",
+};
+
+/* Completion only table, laid out by hand as frpp::shell::make_table would
+ * (cmds in name order, so sorted is the identity) */
+static const struct frpp_shell_cmd prv_cmds[] = {
+    {"led", NULL, NULL},
+    {"ledger", NULL, NULL},
+    {"reset", NULL, NULL},
+};
+
+static const uint16_t prv_sorted[] = {0, 1, 2};
+
+static const struct frpp_shell_trie_node prv_trie[] = {
+    {.child = 1, .first = 0, .matches = 3, .children = 2, .depth = 0},
+    {.child = 3, .first = 0, .matches = 2, .children = 1, .depth = 3},
+    {.child = 0, .first = 2, .matches = 1, .children = 0, .depth = 5},
+    {.child = 0, .first = 1, .matches = 1, .children = 0, .depth = 6},
+};
+
+static const struct frpp_shell_table prv_table = {
+    .cmds = prv_cmds,
+    .sorted = prv_sorted,
+    .trie = prv_trie,
+    .count = 3,
+};
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {
+  frpp_shell_line_init(&prv_line, TEST_PROMPT);
+  frpp_shell_line_echo(&prv_line, prv_echo, sizeof(prv_echo));
+}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief Feed a string
+ *
+ * @param str Bytes to feed
+ * @return Return value of last feed
+ */
+static int prv_feed(const char *str) {
+  int ret = 0;
+
+  while (*str) {
+    ret = frpp_shell_line_feed(&prv_line, (uint8_t)*str++);
+  }
+
+  return ret;
+}
+
+/**
+ * @brief Feed a string that must complete a line, and release it
+ *
+ * @param str Bytes to feed
+ * @param expected Expected line
+ */
+static void prv_feed_line(const char *str, const char *expected) {
+  TEST_ASSERT_EQUAL(FRPP_SHELL_LINE_READY, prv_feed(str));
+  TEST_ASSERT_EQUAL_STRING(expected, frpp_shell_line_get(&prv_line));
+  frpp_shell_line_next(&prv_line);
+}
+
+/**
+ * @brief Drain echo into prv_echo as a string
+ *
+ * @return prv_echo
+ */
+static const char *prv_drain(void) {
+  size_t len =
+      frpp_shell_line_echo(&prv_line, prv_echo, sizeof(prv_echo) - 1);
+  prv_echo[len] = '\0';
+  return prv_echo;
+}
+
+/**
+ * @brief Monotonic time in nanoseconds
+ */
+static uint64_t prv_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Write scripted session into pipe, standing in for a UART
+ *
+ * @param arg Pointer to write end of pipe
+ * @return NULL
+ */
+static void *prv_writer(void *arg) {
+  int fd = *(int *)arg;
+
+  for (unsigned int i = 0; i < TEST_SESSION_REPEAT; i++) {
+    size_t off = 0;
+    while (off < sizeof(prv_session) - 1) {
+      ssize_t ret =
+          write(fd, prv_session + off, sizeof(prv_session) - 1 - off);
+      if (ret > 0) {
+        off += (size_t)ret;
+      }
+    }
+  }
+
+  close(fd);
+
+  return NULL;
+}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test invalid arguments
+ */
+void test_invalid(void) {
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_line_init(NULL, TEST_PROMPT));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_line_feed(NULL, 'a'));
+  TEST_ASSERT_NULL(frpp_shell_line_get(NULL));
+  TEST_ASSERT_NULL(frpp_shell_line_get(&prv_line));
+}
+
+/**
+ * @brief Test prompt and echo of a typed line
+ */
+void test_simple_line(void) {
+  frpp_shell_line_init(&prv_line, TEST_PROMPT);
+
+  prv_feed_line("hello\r", "hello");
+  TEST_ASSERT_EQUAL_STRING(TEST_PROMPT "hello\r\n" TEST_PROMPT, prv_drain());
+}
+
+/**
+ * @brief Test line is held until released
+ */
+void test_busy_until_released(void) {
+  TEST_ASSERT_EQUAL(FRPP_SHELL_LINE_READY, prv_feed("one\r"));
+  TEST_ASSERT_EQUAL(-EBUSY, frpp_shell_line_feed(&prv_line, 'x'));
+  TEST_ASSERT_EQUAL_STRING("one", frpp_shell_line_get(&prv_line));
+
+  frpp_shell_line_next(&prv_line);
+  TEST_ASSERT_NULL(frpp_shell_line_get(&prv_line));
+  prv_feed_line("two\n", "two");
+}
+
+/**
+ * @brief Test CR, LF and CRLF each end exactly one line
+ */
+void test_line_endings(void) {
+  prv_feed_line("a\r", "a");
+  prv_feed_line("\nb\n", "b");
+  prv_feed_line("c\r", "c");
+  TEST_ASSERT_EQUAL(FRPP_SHELL_LINE_READY, prv_feed("\n\n"));
+  TEST_ASSERT_EQUAL_STRING("", frpp_shell_line_get(&prv_line));
+}
+
+/**
+ * @brief Test inserting in the middle of a line and its echo
+ */
+void test_insert_middle(void) {
+  prv_drain();
+
+  prv_feed("helo" TEST_LEFT);
+  TEST_ASSERT_EQUAL_STRING("helo" TEST_ESC "[1D", prv_drain());
+
+  prv_feed("l");
+  TEST_ASSERT_EQUAL_STRING("lo" TEST_ESC "[1D", prv_drain());
+
+  prv_feed_line("\r", "hello");
+}
+
+/**
+ * @brief Test cursor movement keys
+ */
+void test_cursor_keys(void) {
+  prv_feed_line("bc" TEST_HOME "a" TEST_END "d\r", "abcd");
+  prv_feed_line("bc\x01" "a\x05" "d\r", "abcd");
+  prv_feed_line("bc" TEST_ESC "[1~a" TEST_ESC "[4~d\r", "abcd");
+  prv_feed_line("bc" TEST_ESC "OHa" TEST_ESC "OFd\r", "abcd");
+  prv_feed_line("ac\x02" "b\x06" "d\r", "abcd");
+  prv_feed_line(TEST_LEFT "ab" TEST_RIGHT TEST_RIGHT "c\r", "abc");
+}
+
+/**
+ * @brief Test deletion keys
+ */
+void test_delete_keys(void) {
+  prv_feed_line("abcd\x7f\b\r", "ab");
+  prv_feed_line("abcd" TEST_HOME TEST_DEL "\x04\r", "cd");
+  prv_feed_line("abcd" TEST_LEFT TEST_LEFT "\x0b\r", "ab");
+  prv_feed_line("abcd" TEST_LEFT "\x15\r", "d");
+  prv_feed_line("\x7f" TEST_DEL "x\r", "x");
+
+  prv_drain();
+  prv_feed("abcd" TEST_LEFT TEST_LEFT "\x7f");
+  prv_drain();
+  TEST_ASSERT_EQUAL_STRING("abcd" TEST_ESC "[1D" TEST_ESC "[1D" TEST_ESC
+                           "[1D" "cd" TEST_ESC "[K" TEST_ESC "[2D",
+                           prv_echo);
+}
+
+/**
+ * @brief Test Ctrl-C discards the line
+ */
+void test_cancel(void) {
+  prv_drain();
+  TEST_ASSERT_EQUAL(0, prv_feed("junk\x03"));
+  TEST_ASSERT_EQUAL_STRING("junk^C\r\n" TEST_PROMPT, prv_drain());
+  prv_feed_line("ok\r", "ok");
+}
+
+/**
+ * @brief Test a full line rings the bell rather than overflowing
+ */
+void test_line_full(void) {
+  char expected[FRPP_SHELL_LINE_MAX];
+
+  memset(expected, 'x', sizeof(expected) - 1);
+  expected[sizeof(expected) - 1] = '\0';
+
+  for (unsigned int i = 0; i < FRPP_SHELL_LINE_MAX + 4; i++) {
+    TEST_ASSERT_EQUAL(0, frpp_shell_line_feed(&prv_line, 'x'));
+  }
+
+  prv_drain();
+  TEST_ASSERT_EQUAL(0, frpp_shell_line_feed(&prv_line, 'x'));
+  TEST_ASSERT_EQUAL_STRING("\a", prv_drain());
+
+  prv_feed_line("\r", expected);
+}
+
+/**
+ * @brief Test unknown and malformed escape sequences are swallowed
+ */
+void test_unknown_escapes(void) {
+  prv_feed_line("a" TEST_ESC "[200Z" TEST_ESC "x" TEST_ESC "[9~b\r", "ab");
+  prv_feed_line("a" TEST_ESC "[1;5Cb\r", "ab");
+  prv_feed_line("a" TEST_ESC "[\x01" "b\r", "ab");
+}
+
+/**
+ * @brief Test Tab completes command names
+ */
+void test_tab_complete(void) {
+  // Nothing to complete from until a table is set
+  prv_feed_line("r\t\r", "r");
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_line_set_table(NULL, &prv_table));
+  TEST_ASSERT_EQUAL(0, frpp_shell_line_set_table(&prv_line, &prv_table));
+
+  prv_feed_line("r\t\r", "reset ");
+  prv_feed_line("  r\t\r", "  reset ");
+  prv_feed_line("ledg\t\r", "ledger ");
+
+  // Ambiguous prefixes complete as far as the matches agree
+  prv_drain();
+  prv_feed("l\t");
+  TEST_ASSERT_EQUAL_STRING("led", prv_drain());
+  prv_feed("\t");
+  TEST_ASSERT_EQUAL_STRING("\a", prv_drain());
+  prv_feed_line("g\t\r", "ledger ");
+
+  // Arguments, unknown names and mid-line cursors aren't completed
+  prv_feed_line("led o\t\r", "led o");
+  prv_feed_line("x\t\r", "x");
+  prv_feed_line("r" TEST_LEFT "\t\r", "r");
+}
+
+/**
+ * @brief Test walking history
+ */
+void test_history(void) {
+  prv_feed_line("one\r", "one");
+  prv_feed_line("two\r", "two");
+  prv_feed_line("two\r", "two");
+  prv_feed_line("\r", "");
+
+  // Repeats and blank lines aren't recorded
+  prv_feed_line(TEST_UP TEST_UP "\r", "one");
+  prv_feed_line(TEST_UP TEST_UP TEST_UP TEST_UP "\r", "one");
+
+  // Walking back down restores the line being edited
+  prv_feed_line("new" TEST_UP TEST_UP TEST_DOWN TEST_DOWN TEST_DOWN "!\r",
+                "new!");
+  prv_feed_line("\x10\x10\x0e\r", "new!");
+
+  // Recalled entries can be edited
+  prv_feed_line(TEST_UP "\x7f?\r", "new?");
+}
+
+/**
+ * @brief Test history keeps only the most recent entries
+ */
+void test_history_wrap(void) {
+  char buf[16];
+  char cmd[16];
+  char ups[(FRPP_SHELL_LINE_HISTORY + 2) * 3 + 2] = {0};
+
+  for (unsigned int i = 0; i < FRPP_SHELL_LINE_HISTORY + 3; i++) {
+    snprintf(buf, sizeof(buf), "cmd%u\r", i);
+    snprintf(cmd, sizeof(cmd), "cmd%u", i);
+    prv_feed_line(buf, cmd);
+  }
+
+  for (unsigned int i = 0; i < FRPP_SHELL_LINE_HISTORY + 2; i++) {
+    strcat(ups, TEST_UP);
+  }
+  strcat(ups, "\r");
+
+  // Oldest entry left is the first not overwritten
+  prv_feed_line(ups, "cmd3");
+}
+
+/**
+ * @brief Test echo that doesn't fit is dropped whole and counted
+ */
+void test_echo_overflow(void) {
+  for (unsigned int i = 0; i < FRPP_SHELL_LINE_ECHO_SIZE; i++) {
+    prv_feed("x\x7f");
+  }
+
+  TEST_ASSERT_GREATER_THAN(0, atomic_load(&prv_line.echo_dropped));
+
+  size_t len = frpp_shell_line_echo(&prv_line, prv_echo, sizeof(prv_echo));
+  TEST_ASSERT_LESS_OR_EQUAL(FRPP_SHELL_LINE_ECHO_SIZE, len);
+
+  // Echo resumes once drained
+  prv_feed_line("ok\r", "ok");
+  TEST_ASSERT_EQUAL_STRING("ok\r\n" TEST_PROMPT, prv_drain());
+}
+
+/**
+ * @brief Drive the editor from a non-blocking pipe in a poll loop, as from a
+ * UART, and time every byte
+ */
+void test_pipe_harness(void) {
+  int fds[2];
+  pthread_t writer;
+  uint8_t chunk[64];
+  uint64_t worst = 0;
+  uint64_t total = 0;
+  size_t bytes = 0;
+  size_t lines = 0;
+  const size_t count =
+      sizeof(prv_session_lines) / sizeof(prv_session_lines[0]);
+
+  TEST_ASSERT_EQUAL(0, pipe(fds));
+  TEST_ASSERT_EQUAL(0, fcntl(fds[0], F_SETFL, O_NONBLOCK));
+  pthread_create(&writer, NULL, prv_writer, &fds[1]);
+
+  for (;;) {
+    ssize_t ret = read(fds[0], chunk, sizeof(chunk));
+
+    if (ret == 0) {
+      break;
+    }
+
+    if (ret < 0) {
+      TEST_ASSERT_EQUAL(EAGAIN, errno);
+      sched_yield();
+      continue;
+    }
+
+    for (ssize_t i = 0; i < ret; i++) {
+      uint64_t start = prv_now_ns();
+      int status = frpp_shell_line_feed(&prv_line, chunk[i]);
+      uint64_t elapsed = prv_now_ns() - start;
+
+      total += elapsed;
+      bytes++;
+      if (elapsed > worst) {
+        worst = elapsed;
+      }
+
+      if (status == FRPP_SHELL_LINE_READY) {
+        TEST_ASSERT_EQUAL_STRING(prv_session_lines[lines % count],
+                                 frpp_shell_line_get(&prv_line));
+        frpp_shell_line_next(&prv_line);
+        lines++;
+      }
+
+      frpp_shell_line_echo(&prv_line, prv_echo, sizeof(prv_echo));
+    }
+  }
+
+  pthread_join(writer, NULL);
+  close(fds[0]);
+
+  TEST_ASSERT_EQUAL(count * TEST_SESSION_REPEAT, lines);
+  TEST_ASSERT_EQUAL(0, atomic_load(&prv_line.echo_dropped));
+
+  printf("frpp_shell_line: %zu bytes, %.1f ns/byte avg, %llu ns worst\n",
+         bytes, (double)total / bytes, (unsigned long long)worst);
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Error condition tests
+  RUN_TEST(test_invalid);
+
+  // Editing tests
+  RUN_TEST(test_simple_line);
+  RUN_TEST(test_busy_until_released);
+  RUN_TEST(test_line_endings);
+  RUN_TEST(test_insert_middle);
+  RUN_TEST(test_cursor_keys);
+  RUN_TEST(test_delete_keys);
+  RUN_TEST(test_cancel);
+  RUN_TEST(test_line_full);
+  RUN_TEST(test_unknown_escapes);
+  RUN_TEST(test_tab_complete);
+
+  // History tests
+  RUN_TEST(test_history);
+  RUN_TEST(test_history_wrap);
+
+  // Echo tests
+  RUN_TEST(test_echo_overflow);
+
+  // Harness tests
+  RUN_TEST(test_pipe_harness);
+
+  return UNITY_END();
+}
@@ -0,0 +1,425 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_shell_out.cpp
+ * @author Evan Stoddard
+ * @brief Tests for frpp_shell_out deferred output.  Handlers are called
+ * directly, dispatch is covered by frpp_shell tests.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "unity.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "frpp/shell/frpp_shell.h"
+#include "frpp/shell/frpp_shell_out.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TEST_RING_SIZE (32768U)
+
+/* Lines printed by the dump command */
+#define TEST_DUMP_LINES (300U)
+
+/* Link speed of the pipe stand-in, as a 115200 baud UART */
+#define TEST_LINK_BYTES_PER_SEC (11520U)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Rate limited link: a non-blocking pipe fed through a token bucket
+ */
+struct test_link {
+  int fd;
+  uint64_t start_ns;
+  size_t sent;
+};
+
+/**
+ * @brief Output collected by the reader thread
+ */
+struct test_capture {
+  int fd;
+  char buf[TEST_DUMP_LINES * 48];
+  size_t len;
+};
+
+/**
+ * @brief Link accepting up to a fixed number of bytes per poll
+ */
+struct test_budget {
+  char buf[1024];
+  size_t len;
+  size_t budget;
+};
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief Monotonic time in nanoseconds
+ */
+static uint64_t prv_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Write as much as the token bucket allows into the pipe
+ */
+static size_t prv_link_write(void *ctx, const void *buf, size_t len) {
+  struct test_link *link = (struct test_link *)ctx;
+  uint64_t elapsed = prv_now_ns() - link->start_ns;
+  size_t allowed =
+      (size_t)(elapsed * TEST_LINK_BYTES_PER_SEC / 1000000000ULL);
+
+  if (allowed <= link->sent) {
+    return 0;
+  }
+
+  if (len > allowed - link->sent) {
+    len = allowed - link->sent;
+  }
+
+  ssize_t ret = write(link->fd, buf, len);
+  if (ret <= 0) {
+    return 0;
+  }
+
+  link->sent += (size_t)ret;
+
+  return (size_t)ret;
+}
+
+/**
+ * @brief Write up to the remaining budget into a buffer
+ */
+static size_t prv_budget_write(void *ctx, const void *buf, size_t len) {
+  struct test_budget *link = (struct test_budget *)ctx;
+
+  if (len > link->budget) {
+    len = link->budget;
+  }
+
+  if (len > sizeof(link->buf) - 1 - link->len) {
+    len = sizeof(link->buf) - 1 - link->len;
+  }
+
+  memcpy(&link->buf[link->len], buf, len);
+  link->len += len;
+  link->buf[link->len] = '\0';
+  link->budget -= len;
+
+  return len;
+}
+
+/**
+ * @brief Read pipe until closed, standing in for the far end of a UART
+ *
+ * @param arg Capture instance
+ * @return NULL
+ */
+static void *prv_reader(void *arg) {
+  struct test_capture *cap = (struct test_capture *)arg;
+
+  for (;;) {
+    ssize_t ret =
+        read(cap->fd, &cap->buf[cap->len], sizeof(cap->buf) - 1 - cap->len);
+    if (ret <= 0) {
+      break;
+    }
+
+    cap->len += (size_t)ret;
+  }
+
+  cap->buf[cap->len] = '\0';
+
+  return NULL;
+}
+
+/**
+ * @brief Print argument from a buffer the handler owns
+ */
+static int prv_cmd_echo(struct frpp_shell *shell, int argc, char *argv[]) {
+  char local[32];
+
+  snprintf(local, sizeof(local), "<%s>", (argc > 1) ? argv[1] : "");
+
+  return frpp_shell_printf(shell, "%s %d\n", local, argc);
+}
+
+/**
+ * @brief Print TEST_DUMP_LINES lines
+ */
+static int prv_cmd_dump(struct frpp_shell *shell, int argc, char *argv[]) {
+  (void)argc;
+  (void)argv;
+
+  for (unsigned int i = 0; i < TEST_DUMP_LINES; i++) {
+    char name[16];
+    snprintf(name, sizeof(name), "reg%u", i);
+
+    int ret = frpp_shell_printf(shell, "%-8s = 0x%08x\n", name, i * 0x1111U);
+    if (ret < 0) {
+      return ret;
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static uint8_t prv_ring[TEST_RING_SIZE];
+
+static struct frpp_shell_out prv_out;
+
+static struct frpp_shell prv_shell;
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {
+  frpp_shell_set_out(&prv_shell, &prv_out);
+}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test invalid arguments
+ */
+void test_invalid(void) {
+  struct frpp_shell shell = {0};
+  struct test_budget link = {0};
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_out_init(NULL, prv_ring,
+                                                 sizeof(prv_ring),
+                                                 prv_budget_write, &link));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_out_init(&prv_out, prv_ring,
+                                                 sizeof(prv_ring), NULL,
+                                                 &link));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_out_init(&prv_out, prv_ring, 1000,
+                                                 prv_budget_write, &link));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_out_printf(NULL, "x"));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_out_poll(NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_set_out(NULL, &prv_out));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_shell_printf(NULL, "x"));
+  TEST_ASSERT_EQUAL(-ENODEV, frpp_shell_printf(&shell, "x"));
+}
+
+/**
+ * @brief Strings printed from the handler's stack and line outlive it
+ */
+void test_captured_strings(void) {
+  struct test_budget link = {0};
+  char arg[] = "hello";
+  char *argv[] = {"echo", arg};
+
+  link.budget = sizeof(link.buf);
+  frpp_shell_out_init(&prv_out, prv_ring, sizeof(prv_ring), prv_budget_write,
+                      &link);
+
+  TEST_ASSERT_EQUAL(0, prv_cmd_echo(&prv_shell, 2, argv));
+  memset(arg, 'X', sizeof(arg) - 1);
+
+  TEST_ASSERT_FALSE(frpp_shell_out_idle(&prv_out));
+  TEST_ASSERT_EQUAL(strlen("<hello> 2\n"), frpp_shell_out_poll(&prv_out));
+  TEST_ASSERT_EQUAL_STRING("<hello> 2\n", link.buf);
+  TEST_ASSERT_TRUE(frpp_shell_out_idle(&prv_out));
+}
+
+/**
+ * @brief Strings longer than the default capture cap print in full
+ */
+void test_long_strings(void) {
+  struct test_budget link = {0};
+  char path[] = "/mnt/sdcard/logs/2026-10-16/session-000123.bin";
+  char max[FRPP_SHELL_OUT_STR_CAP + 2];
+
+  link.budget = sizeof(link.buf);
+  frpp_shell_out_init(&prv_out, prv_ring, sizeof(prv_ring), prv_budget_write,
+                      &link);
+
+  TEST_ASSERT_GREATER_THAN(FRPP_PRINTF_CAPTURE_CAP_DEFAULT, strlen(path));
+  TEST_ASSERT_EQUAL(0, frpp_shell_out_printf(&prv_out, "opened %s\n", path));
+  memset(path, 'X', sizeof(path) - 1);
+
+  frpp_shell_out_poll(&prv_out);
+  TEST_ASSERT_EQUAL_STRING(
+      "opened /mnt/sdcard/logs/2026-10-16/session-000123.bin\n", link.buf);
+
+  // Past the cap, strings are cut and marked
+  memset(max, 'a', sizeof(max) - 1);
+  max[sizeof(max) - 1] = '\0';
+  link.len = 0;
+  TEST_ASSERT_EQUAL(0, frpp_shell_out_printf(&prv_out, "%s", max));
+
+  TEST_ASSERT_EQUAL(FRPP_SHELL_OUT_STR_CAP, frpp_shell_out_poll(&prv_out));
+  TEST_ASSERT_EQUAL_STRING(FRPP_PRINTF_CAPTURE_TRUNC_MARKER,
+                           link.buf + FRPP_SHELL_OUT_STR_CAP -
+                               strlen(FRPP_PRINTF_CAPTURE_TRUNC_MARKER));
+}
+
+/**
+ * @brief Output resumes where it stopped when the link is busy
+ */
+void test_busy_link(void) {
+  struct test_budget link = {0};
+
+  frpp_shell_out_init(&prv_out, prv_ring, sizeof(prv_ring), prv_budget_write,
+                      &link);
+
+  frpp_shell_out_printf(&prv_out, "first %d\n", 1);
+  frpp_shell_out_printf(&prv_out, "second %d\n", 2);
+
+  TEST_ASSERT_EQUAL(0, frpp_shell_out_poll(&prv_out));
+
+  link.budget = 5;
+  TEST_ASSERT_EQUAL(5, frpp_shell_out_poll(&prv_out));
+  TEST_ASSERT_FALSE(frpp_shell_out_idle(&prv_out));
+
+  frpp_shell_out_printf(&prv_out, "third\n");
+
+  link.budget = sizeof(link.buf);
+  TEST_ASSERT_EQUAL(strlen("first 1\nsecond 2\nthird\n") - 5,
+                    frpp_shell_out_poll(&prv_out));
+  TEST_ASSERT_EQUAL_STRING("first 1\nsecond 2\nthird\n", link.buf);
+  TEST_ASSERT_TRUE(frpp_shell_out_idle(&prv_out));
+}
+
+/**
+ * @brief Handler sees -ENOSPC once queued output fills the ring
+ */
+void test_full(void) {
+  static uint8_t ring[256];
+  struct test_budget link = {0};
+  int ret = 0;
+
+  frpp_shell_out_init(&prv_out, ring, sizeof(ring), prv_budget_write, &link);
+
+  for (unsigned int i = 0; i < sizeof(ring) && ret == 0; i++) {
+    ret = frpp_shell_printf(&prv_shell, "line %u\n", i);
+  }
+
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+
+  link.budget = sizeof(link.buf);
+  frpp_shell_out_poll(&prv_out);
+  TEST_ASSERT_TRUE(frpp_shell_out_idle(&prv_out));
+  TEST_ASSERT_EQUAL(0, frpp_shell_printf(&prv_shell, "again\n"));
+}
+
+/**
+ * @brief Run a command printing far more than the link can carry while it
+ * runs, and drain it through a rate limited pipe
+ */
+void test_rate_limited_pipe(void) {
+  int fds[2];
+  pthread_t reader;
+  static struct test_capture cap;
+  static char expected[sizeof(cap.buf)];
+  struct test_link link = {0};
+  char *argv[] = {"dump"};
+  size_t expected_len = 0;
+
+  TEST_ASSERT_EQUAL(0, pipe(fds));
+  TEST_ASSERT_EQUAL(0, fcntl(fds[1], F_SETFL, O_NONBLOCK));
+
+  cap.fd = fds[0];
+  cap.len = 0;
+  pthread_create(&reader, NULL, prv_reader, &cap);
+
+  link.fd = fds[1];
+  link.start_ns = prv_now_ns();
+  frpp_shell_out_init(&prv_out, prv_ring, sizeof(prv_ring), prv_link_write,
+                      &link);
+
+  uint64_t start = prv_now_ns();
+  TEST_ASSERT_EQUAL(0, prv_cmd_dump(&prv_shell, 1, argv));
+  uint64_t handled = prv_now_ns();
+
+  while (!frpp_shell_out_idle(&prv_out)) {
+    TEST_ASSERT_GREATER_OR_EQUAL(0, frpp_shell_out_poll(&prv_out));
+    sched_yield();
+  }
+
+  uint64_t drained = prv_now_ns();
+
+  close(fds[1]);
+  pthread_join(reader, NULL);
+  close(fds[0]);
+
+  for (unsigned int i = 0; i < TEST_DUMP_LINES; i++) {
+    char name[16];
+    snprintf(name, sizeof(name), "reg%u", i);
+    expected_len += (size_t)snprintf(&expected[expected_len],
+                                     sizeof(expected) - expected_len,
+                                     "%-8s = 0x%08x\n", name, i * 0x1111U);
+  }
+
+  TEST_ASSERT_EQUAL(expected_len, cap.len);
+  TEST_ASSERT_EQUAL_STRING(expected, cap.buf);
+
+  // Handler must return long before the link could have carried its output
+  uint64_t link_ns = expected_len * 1000000000ULL / TEST_LINK_BYTES_PER_SEC;
+  TEST_ASSERT_TRUE(handled - start < link_ns / 10);
+
+  printf("frpp_shell_out: %zu bytes, handler %llu us, drain %llu us "
+         "(%.0f bytes/s)\n",
+         expected_len, (unsigned long long)((handled - start) / 1000),
+         (unsigned long long)((drained - start) / 1000),
+         (double)expected_len * 1e9 / (double)(drained - start));
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Error condition tests
+  RUN_TEST(test_invalid);
+
+  // Output tests
+  RUN_TEST(test_captured_strings);
+  RUN_TEST(test_long_strings);
+  RUN_TEST(test_busy_link);
+  RUN_TEST(test_full);
+
+  // Throughput tests
+  RUN_TEST(test_rate_limited_pipe);
+
+  return UNITY_END();
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_formatter.cpp
+ * @author Evan Stoddard
+ * @brief Tests for the C++ formatter registry and %@ packaging
+ */
+
+#include "unity.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "frpp/sys/frpp_formatter.hpp"
+#include "frpp/sys/frpp_package.hpp"
+#include "frpp/sys/frpp_printf.h"
+#include "frpp/utils/utils.h"
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief IPv4 address
+ */
+struct ip_addr {
+  uint8_t octets[4];
+};
+
+/**
+ * @brief Sensor sample with a name that's only valid while logging
+ */
+struct sample {
+  const char *name;
+  int32_t milli;
+};
+
+/**
+ * @brief Type without a formatter
+ */
+struct unregistered {
+  int val;
+};
+
+template <> struct frpp::formatter<ip_addr> {
+  static constexpr size_t max_size = 4;
+
+  static size_t serialize(const ip_addr &addr, void *dst, size_t len) {
+    if (dst != nullptr && len >= sizeof(addr.octets)) {
+      memcpy(dst, addr.octets, sizeof(addr.octets));
+    }
+    return sizeof(addr.octets);
+  }
+
+  static int render(const void *data, size_t len, char *out, size_t out_size) {
+    const uint8_t *b = static_cast<const uint8_t *>(data);
+    (void)len;
+    return snprintf(out, out_size, "%u.%u.%u.%u", b[0], b[1], b[2], b[3]);
+  }
+};
+
+template <> struct frpp::formatter<sample> {
+  static constexpr size_t max_size = sizeof(int32_t) + 16;
+
+  static size_t serialize(const sample &s, void *dst, size_t len) {
+    size_t name_len = strnlen(s.name, 16);
+    size_t size = sizeof(s.milli) + name_len;
+
+    if (dst != nullptr && len >= size) {
+      uint8_t *bytes = static_cast<uint8_t *>(dst);
+      memcpy(bytes, &s.milli, sizeof(s.milli));
+      memcpy(bytes + sizeof(s.milli), s.name, name_len);
+    }
+    return size;
+  }
+
+  static int render(const void *data, size_t len, char *out, size_t out_size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    int32_t milli;
+    memcpy(&milli, bytes, sizeof(milli));
+    return snprintf(out, out_size, "%.*s=%d.%03d",
+                    (int)(len - sizeof(milli)),
+                    (const char *)bytes + sizeof(milli), (int)(milli / 1000),
+                    (int)(milli % 1000));
+  }
+};
+
+/*****************************************************************************
+ * Compile-time Checks
+ *****************************************************************************/
+
+static_assert(frpp::has_formatter_v<ip_addr>);
+static_assert(frpp::has_formatter_v<const sample &>);
+static_assert(!frpp::has_formatter_v<unregistered>);
+static_assert(frpp::package_size<"%@"> ==
+              FRPP_VA_STACK_ALIGN(void *) + 1 + FRPP_PRINTF_UDT_SIZE_MAX);
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test each type gets one set of hooks
+ */
+void test_ops_per_type(void) {
+  ip_addr a = {{1, 2, 3, 4}};
+  ip_addr b = {{5, 6, 7, 8}};
+  sample s = {"t", 0};
+
+  TEST_ASSERT_EQUAL_PTR(frpp::udt(a).ops, frpp::udt(b).ops);
+  TEST_ASSERT_NOT_EQUAL(frpp::udt(a).ops, frpp::udt(s).ops);
+  TEST_ASSERT_EQUAL_PTR(&a, frpp::udt(a).obj);
+}
+
+/**
+ * @brief Test objects are captured at log time and rendered by the consumer
+ */
+void test_runtime_package(void) {
+  uint8_t buf[64] = {0};
+  char out_buf[64] = {0};
+  char name[8] = "temp";
+  sample s = {name, 21500};
+  ip_addr peer = {{192, 168, 1, 20}};
+
+  auto s_arg = frpp::udt(s);
+  auto peer_arg = frpp::udt(peer);
+  int ret = frpp_printf_package(buf, sizeof(buf), 0, "%@ from %@", &s_arg,
+                                &peer_arg);
+  TEST_ASSERT_GREATER_THAN(0, ret);
+
+  strcpy(name, "xxxx");
+  peer.octets[0] = 0;
+
+  ret = frpp_snprintf("%@ from %@", buf, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("temp=21.500 from 192.168.1.20", out_buf);
+  TEST_ASSERT_EQUAL(29, ret);
+}
+
+/**
+ * @brief Test compile-time packer produces the same bytes as the runtime one
+ */
+void test_compile_time_package(void) {
+  uint8_t cpp_buf[64] = {0};
+  uint8_t c_buf[64] = {0};
+  char out_buf[64] = {0};
+  ip_addr peer = {{10, 0, 0, 1}};
+
+  auto peer_arg = frpp::udt(peer);
+  int c_ret = frpp_printf_package(c_buf, sizeof(c_buf), 0, "%d %@ %s", 7,
+                                  &peer_arg, "up");
+  int cpp_ret = frpp::package<"%d %@ %s">(cpp_buf, sizeof(cpp_buf), 7, peer,
+                                          "up");
+  TEST_ASSERT_EQUAL(c_ret, cpp_ret);
+  TEST_ASSERT_EQUAL_MEMORY(c_buf, cpp_buf, cpp_ret);
+
+  // Wrapped arguments are accepted as is
+  cpp_ret = frpp::package<"%d %@ %s">(cpp_buf, sizeof(cpp_buf), 7, &peer_arg,
+                                      "up");
+  TEST_ASSERT_EQUAL(c_ret, cpp_ret);
+  TEST_ASSERT_EQUAL_MEMORY(c_buf, cpp_buf, cpp_ret);
+
+  frpp_snprintf(frpp::format_str<"%d %@ %s">(), cpp_buf, out_buf,
+                sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("7 10.0.0.1 up", out_buf);
+}
+
+/**
+ * @brief Test compile-time packer reports captured objects that don't fit
+ */
+void test_compile_time_no_space(void) {
+  // Slot and length byte fit, object doesn't
+  uint8_t buf[FRPP_VA_STACK_ALIGN(void *) + 5] = {0};
+  ip_addr peer = {{10, 0, 0, 1}};
+
+  int ret = frpp::package<"%@">(buf, sizeof(buf) - 1, peer);
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+
+  ret = frpp::package<"%@">(buf, sizeof(buf), peer);
+  TEST_ASSERT_EQUAL(sizeof(buf), ret);
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_ops_per_type);
+  RUN_TEST(test_runtime_package);
+  RUN_TEST(test_compile_time_package);
+  RUN_TEST(test_compile_time_no_space);
+
+  return UNITY_END();
+}
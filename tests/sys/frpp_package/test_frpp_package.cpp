@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_package.cpp
+ * @author Evan Stoddard
+ * @brief Tests for compile-time frpp::package
+ */
+
+#include "unity.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "frpp/sys/frpp_package.hpp"
+#include "frpp/sys/frpp_printf.h"
+#include "frpp/utils/utils.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Package fmt_ with both packers and assert the bytes are identical
+ */
+#define ASSERT_MATCHES_C_PACKAGE(fmt_, ...)                                    \
+  do {                                                                         \
+    uint8_t cpp_buf_[128] = {0};                                               \
+    uint8_t c_buf_[128] = {0};                                                 \
+    int cpp_ret_ =                                                             \
+        frpp::package<fmt_>(cpp_buf_, sizeof(cpp_buf_), __VA_ARGS__);          \
+    int c_ret_ = frpp_printf_package(c_buf_, sizeof(c_buf_), 0,                \
+                                     frpp::format_str<fmt_>(), __VA_ARGS__);   \
+    TEST_ASSERT_EQUAL(c_ret_, cpp_ret_);                                       \
+    TEST_ASSERT_EQUAL(frpp::package_size<fmt_>, cpp_ret_);                     \
+    TEST_ASSERT_EQUAL_MEMORY(c_buf_, cpp_buf_, cpp_ret_);                      \
+  } while (0);
+
+/*****************************************************************************
+ * Compile-time Checks
+ *****************************************************************************/
+
+static_assert(frpp::package_size<"no args"> == 0);
+static_assert(frpp::package_size<"%%"> == 0);
+static_assert(frpp::package_size<"%d"> == FRPP_VA_STACK_ALIGN(int));
+static_assert(frpp::package_size<"%hhd %hd"> == 2 * FRPP_VA_STACK_ALIGN(int));
+static_assert(frpp::package_size<"%-08.3f"> == FRPP_VA_STACK_ALIGN(double));
+static_assert(frpp::package_size<"%lld %s"> ==
+              FRPP_VA_STACK_ALIGN(long long) + FRPP_VA_STACK_ALIGN(char *));
+static_assert(frpp::package_size<"%lc %ls"> ==
+              FRPP_VA_STACK_ALIGN(wint_t) + FRPP_VA_STACK_ALIGN(wchar_t *));
+
+// Wide arguments only match the l length modifier
+static_assert(frpp::detail::layout<"%lc %ls">::kinds[0] ==
+              frpp::arg_kind::wint);
+static_assert(frpp::detail::layout<"%lc %ls">::kinds[1] ==
+              frpp::arg_kind::wstring);
+static_assert(
+    frpp::detail::accepts<frpp::arg_kind::wstring, const wchar_t *>());
+static_assert(!frpp::detail::accepts<frpp::arg_kind::wstring, const char *>());
+static_assert(
+    !frpp::detail::accepts<frpp::arg_kind::string, const wchar_t *>());
+static_assert(frpp::detail::accepts<frpp::arg_kind::wint, wchar_t>());
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test NULL destination
+ */
+void test_null_dst(void) {
+  int ret = frpp::package<"%d">(nullptr, 0, 1);
+  TEST_ASSERT_EQUAL(-EINVAL, ret);
+}
+
+/**
+ * @brief Test destination smaller than package
+ */
+void test_buffer_overrun(void) {
+  uint8_t buf[sizeof(long long) - 1] = {0};
+  int ret = frpp::package<"%lld">(buf, sizeof(buf), 1LL);
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+}
+
+/**
+ * @brief Test format string pointer is stable across uses
+ */
+void test_format_str_stable(void) {
+  TEST_ASSERT_EQUAL_PTR(frpp::format_str<"abc %d">(),
+                        frpp::format_str<"abc %d">());
+  TEST_ASSERT_EQUAL_STRING("abc %d", frpp::format_str<"abc %d">());
+}
+
+/**
+ * @brief Test integer specifiers match C packer
+ */
+void test_integers_match_c(void) {
+  ASSERT_MATCHES_C_PACKAGE("%d %i %u %x %X %o %c", 1, -2, 3u, 4, 5, 6, 'A');
+  ASSERT_MATCHES_C_PACKAGE("%hd %hhu", (short)-7, (unsigned char)200);
+  ASSERT_MATCHES_C_PACKAGE("%ld %lu", -123456789L, 123456789UL);
+  ASSERT_MATCHES_C_PACKAGE("%lld %llx", -9876543210LL, 0xDEADBEEFCAFEULL);
+  ASSERT_MATCHES_C_PACKAGE("%zu %td %jd", (size_t)42, (ptrdiff_t)-42,
+                           (intmax_t)99);
+}
+
+/**
+ * @brief Test pointer, string and float specifiers match C packer
+ */
+void test_mixed_match_c(void) {
+  int written = 0;
+  const char *str = "test";
+
+  ASSERT_MATCHES_C_PACKAGE("%s %p %n", str, (void *)0x1234, &written);
+  ASSERT_MATCHES_C_PACKAGE("%f %.2e %10g", 3.14159, 2.71828, 1.5);
+  ASSERT_MATCHES_C_PACKAGE(
+      "Int: %d, Long: %ld, LongLong: %lld, Size: %zu, Ptr: %p, Str: %s, "
+      "Float: %f",
+      42, 123L, 456LL, (size_t)789, (void *)0x1234, "test", 3.14);
+}
+
+/**
+ * @brief Test wide character and string specifiers match C packer
+ */
+void test_wide_match_c(void) {
+  const wchar_t *wstr = L"wide";
+
+  ASSERT_MATCHES_C_PACKAGE("%lc %ls %c %s", (wint_t)L'w', wstr, 'n', "narrow");
+  ASSERT_MATCHES_C_PACKAGE("[%-3lc] [%.2ls]", L'x', L"abc");
+}
+
+/**
+ * @brief Test float arguments are promoted to double like va_arg
+ */
+void test_float_promotion(void) {
+  uint8_t buf[FRPP_VA_STACK_ALIGN(double)] = {0};
+  float val = 1.25f;
+  double expected = 1.25;
+
+  int ret = frpp::package<"%f">(buf, sizeof(buf), val);
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(double), ret);
+  TEST_ASSERT_EQUAL_MEMORY(&expected, buf, sizeof(expected));
+}
+
+/**
+ * @brief Test package renders with frpp_snprintf
+ */
+void test_render_with_snprintf(void) {
+  char out_buf[128] = {0};
+
+  auto pkg = frpp::make_package<"Status: %d, Message: %s, Value: 0x%X">(
+      200, "OK", 0xBEEF);
+
+  int ret = frpp_snprintf(pkg.fmt(), pkg.data(), out_buf, sizeof(out_buf));
+  TEST_ASSERT_GREATER_THAN(0, ret);
+  TEST_ASSERT_EQUAL_STRING("Status: 200, Message: OK, Value: 0xBEEF", out_buf);
+
+  auto wide = frpp::make_package<"%ls/%lc">(L"abc", L'd');
+
+  ret = frpp_snprintf(wide.fmt(), wide.data(), out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL(5, ret);
+  TEST_ASSERT_EQUAL_STRING("abc/d", out_buf);
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Error condition tests
+  RUN_TEST(test_null_dst);
+  RUN_TEST(test_buffer_overrun);
+
+  // Layout tests
+  RUN_TEST(test_format_str_stable);
+  RUN_TEST(test_integers_match_c);
+  RUN_TEST(test_mixed_match_c);
+  RUN_TEST(test_wide_match_c);
+  RUN_TEST(test_float_promotion);
+
+  // Integration tests
+  RUN_TEST(test_render_with_snprintf);
+
+  return UNITY_END();
+}
@@ -11,7 +11,12 @@
 #include "unity.h"
 
 #include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <string.h>
+#include <wchar.h>
 
 #include "frpp/sys/frpp_printf.h"
 #include "frpp/utils/utils.h"
@@ -20,6 +25,49 @@
  * Definitions
  *****************************************************************************/
 
+/**
+ * @brief Package arguments, render them with frpp_snprintf and compare output
+ * and return value against libc snprintf
+ */
+#define ASSERT_RENDER_PARITY(fmt_, ...)                                        \
+  do {                                                                         \
+    uint8_t arg_buf_[128] = {0};                                               \
+    char out_[128];                                                            \
+    char expected_[128];                                                       \
+    TEST_ASSERT_GREATER_OR_EQUAL(                                              \
+        0, frpp_printf_package(arg_buf_, sizeof(arg_buf_), 0, fmt_,            \
+                               __VA_ARGS__));                                  \
+    int expected_ret_ =                                                        \
+        snprintf(expected_, sizeof(expected_), fmt_, __VA_ARGS__);             \
+    int ret_ = frpp_snprintf(fmt_, arg_buf_, out_, sizeof(out_));              \
+    TEST_ASSERT_EQUAL_MESSAGE(expected_ret_, ret_, fmt_);                      \
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(expected_, out_, fmt_);                   \
+  } while (0)
+
+/**
+ * @brief Package arguments densely, render them, and assert output matches
+ * libc snprintf
+ */
+#define ASSERT_DENSE_PARITY(fmt_, ...)                                         \
+  do {                                                                         \
+    uint8_t arg_buf_[128] = {0};                                               \
+    char out_[128];                                                            \
+    char expected_[128];                                                       \
+    int size_ = frpp_printf_package(NULL, 0, FRPP_PRINTF_FLAG_DENSE, fmt_,    \
+                                    __VA_ARGS__);                              \
+    TEST_ASSERT_EQUAL_MESSAGE(                                                 \
+        size_,                                                                 \
+        frpp_printf_package(arg_buf_, sizeof(arg_buf_),                        \
+                            FRPP_PRINTF_FLAG_DENSE, fmt_, __VA_ARGS__),        \
+        fmt_);                                                                 \
+    int expected_ret_ =                                                        \
+        snprintf(expected_, sizeof(expected_), fmt_, __VA_ARGS__);             \
+    int ret_ = frpp_snprintf_ex(fmt_, FRPP_PRINTF_FLAG_DENSE, arg_buf_, out_,  \
+                                sizeof(out_));                                 \
+    TEST_ASSERT_EQUAL_MESSAGE(expected_ret_, ret_, fmt_);                      \
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(expected_, out_, fmt_);                   \
+  } while (0)
+
 /*****************************************************************************
  * Variables
  *****************************************************************************/
@@ -42,6 +90,66 @@ void tearDown(void) {}
  * Setup/Teardown
  *****************************************************************************/
 
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief User-defined type logged with %@
+ */
+struct test_point {
+  int16_t x;
+  int16_t y;
+};
+
+/**
+ * @brief Serialize test_point
+ */
+static size_t prv_point_serialize(const void *obj, void *dst, size_t len) {
+  if (dst != NULL && len >= sizeof(struct test_point)) {
+    memcpy(dst, obj, sizeof(struct test_point));
+  }
+
+  return sizeof(struct test_point);
+}
+
+/**
+ * @brief Render serialized test_point
+ */
+static int prv_point_render(const void *data, size_t len, char *out,
+                            size_t out_size) {
+  struct test_point point;
+
+  if (len != sizeof(point)) {
+    return snprintf(out, out_size, "<bad point>");
+  }
+
+  memcpy(&point, data, sizeof(point));
+
+  return snprintf(out, out_size, "(%d, %d)", point.x, point.y);
+}
+
+static const struct frpp_printf_udt_ops prv_point_ops = {
+    .serialize = prv_point_serialize,
+    .render = prv_point_render,
+};
+
+/**
+ * @brief Serialize hook reporting a size too large for a package
+ */
+static size_t prv_huge_serialize(const void *obj, void *dst, size_t len) {
+  (void)obj;
+  (void)dst;
+  (void)len;
+
+  return FRPP_PRINTF_UDT_SIZE_MAX + 1;
+}
+
+static const struct frpp_printf_udt_ops prv_huge_ops = {
+    .serialize = prv_huge_serialize,
+    .render = prv_point_render,
+};
+
 /*****************************************************************************
  * Tests
  *****************************************************************************/
@@ -207,6 +315,17 @@ void test_float_formats(void) {
   TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(double), ret);
 }
 
+/**
+ * @brief Test %lf is packaged as a double, not a long
+ */
+void test_lf_format(void) {
+  uint8_t buf[FRPP_VA_STACK_ALIGN(double)] = {0};
+  double val = 1.5;
+  int ret = frpp_printf_package(buf, sizeof(buf), 0, "%lf", val);
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(double), ret);
+  TEST_ASSERT_EQUAL_MEMORY(&val, buf, sizeof(double));
+}
+
 /**
  * @brief Test %n format specifier
  */
@@ -284,6 +403,15 @@ void test_buffer_overrun(void) {
   TEST_ASSERT_EQUAL(-ENOSPC, ret);
 }
 
+/**
+ * @brief Test buffer that fits some but not all arguments
+ */
+void test_buffer_partial_fit(void) {
+  uint8_t buf[FRPP_VA_STACK_ALIGN(int) * 2] = {0};
+  int ret = frpp_printf_package(buf, sizeof(buf), 0, "%d %d %d", 1, 2, 3);
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+}
+
 /**
  * @brief Test exact buffer size
  */
@@ -353,6 +481,119 @@ void test_data_integrity_multiple_values(void) {
   TEST_ASSERT_EQUAL(val3, *(int *)(buf + FRPP_VA_STACK_ALIGN(int) * 2 + FRPP_VA_STACK_ALIGN(char *)));
 }
 
+/*****************************************************************************
+ * Reservation Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test reservation with invalid arguments
+ */
+void test_reserve_invalid(void) {
+  struct frpp_printf_reservation res;
+  uint8_t buf[16] = {0};
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_reserve(NULL, buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_reserve(&res, NULL, sizeof(buf)));
+
+  TEST_ASSERT_EQUAL(0, frpp_printf_reserve(&res, buf, sizeof(buf)));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_reserve_package(&res, 0, NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_reserve_package(NULL, 0, "%d", 1));
+}
+
+/**
+ * @brief Test single-pass packaging into a reservation
+ */
+void test_reserve_package(void) {
+  struct frpp_printf_reservation res;
+  uint8_t buf[64] = {0};
+  uint8_t expected[64] = {0};
+
+  frpp_printf_reserve(&res, buf, sizeof(buf));
+
+  int ret = frpp_printf_reserve_package(&res, 0, "%d %s", 42, "test");
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(int) + FRPP_VA_STACK_ALIGN(char *),
+                    ret);
+  TEST_ASSERT_EQUAL(ret, frpp_printf_commit(&res));
+
+  frpp_printf_package(expected, sizeof(expected), 0, "%d %s", 42, "test");
+  TEST_ASSERT_EQUAL_MEMORY(expected, buf, ret);
+}
+
+/**
+ * @brief Test packages append within a reservation
+ */
+void test_reserve_append(void) {
+  struct frpp_printf_reservation res;
+  uint8_t buf[64] = {0};
+
+  frpp_printf_reserve(&res, buf, sizeof(buf));
+
+  frpp_printf_reserve_package(&res, 0, "%d", 1);
+  frpp_printf_reserve_package(&res, 0, "%lld", 2LL);
+
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(int) + FRPP_VA_STACK_ALIGN(long long),
+                    frpp_printf_commit(&res));
+  TEST_ASSERT_EQUAL(1, *(int *)buf);
+  TEST_ASSERT_EQUAL(2LL, *(long long *)(buf + FRPP_VA_STACK_ALIGN(int)));
+}
+
+/**
+ * @brief Test short write leaves committed bytes intact and wipes the rest
+ */
+void test_reserve_short_write(void) {
+  struct frpp_printf_reservation res;
+  uint8_t buf[FRPP_VA_STACK_ALIGN(int) * 3] = {0};
+  uint8_t zero[sizeof(buf)] = {0};
+
+  frpp_printf_reserve(&res, buf, sizeof(buf));
+  frpp_printf_reserve_package(&res, 0, "%d", 7);
+
+  int ret = frpp_printf_reserve_package(&res, 0, "%d %d %d", 1, 2, 3);
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(int), frpp_printf_commit(&res));
+  TEST_ASSERT_EQUAL(7, *(int *)buf);
+  TEST_ASSERT_EQUAL_MEMORY(zero, buf + FRPP_VA_STACK_ALIGN(int),
+                           sizeof(buf) - FRPP_VA_STACK_ALIGN(int));
+
+  // Same for errors other than running out of space
+  ret = frpp_printf_reserve_package(&res, 0, "%d %1$d", 1);
+  TEST_ASSERT_EQUAL(-EINVAL, ret);
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(int), frpp_printf_commit(&res));
+  TEST_ASSERT_EQUAL(7, *(int *)buf);
+  TEST_ASSERT_EQUAL_MEMORY(zero, buf + FRPP_VA_STACK_ALIGN(int),
+                           sizeof(buf) - FRPP_VA_STACK_ALIGN(int));
+}
+
+/**
+ * @brief Test exhausted reservation
+ */
+void test_reserve_exhausted(void) {
+  struct frpp_printf_reservation res;
+  uint8_t buf[FRPP_VA_STACK_ALIGN(int)] = {0};
+
+  frpp_printf_reserve(&res, buf, sizeof(buf));
+  frpp_printf_reserve_package(&res, 0, "%d", 7);
+
+  TEST_ASSERT_EQUAL(0, frpp_printf_reserve_package(&res, 0, "no args"));
+  TEST_ASSERT_EQUAL(-ENOSPC, frpp_printf_reserve_package(&res, 0, "%d", 1));
+}
+
+/**
+ * @brief Test abort discards packages
+ */
+void test_reserve_abort(void) {
+  struct frpp_printf_reservation res;
+  uint8_t buf[16] = {0};
+  uint8_t zero[sizeof(buf)] = {0};
+
+  frpp_printf_reserve(&res, buf, sizeof(buf));
+  frpp_printf_reserve_package(&res, 0, "%d", 7);
+  frpp_printf_abort(&res);
+
+  TEST_ASSERT_EQUAL(0, frpp_printf_commit(&res));
+  TEST_ASSERT_EQUAL_MEMORY(zero, buf, sizeof(buf));
+}
+
 /*****************************************************************************
  * frpp_snprintf Tests
  *****************************************************************************/
@@ -622,6 +863,572 @@ void test_snprintf_end_to_end(void) {
   TEST_ASSERT_EQUAL_STRING("Status: 200, Message: OK, Value: 0xBEEF", out_buf);
 }
 
+/**
+ * @brief Test integer rendering matches libc across flags, width, precision
+ * and length modifiers
+ */
+void test_snprintf_parity_integers(void) {
+  ASSERT_RENDER_PARITY("%d %i %u", -12345, 0, 4000000000U);
+  ASSERT_RENDER_PARITY("%+d % d %+d", 5, 5, -5);
+  ASSERT_RENDER_PARITY("[%8d] [%-8d] [%08d]", -42, -42, -42);
+  ASSERT_RENDER_PARITY("[%.5d] [%8.3d] [%-8.3d]", 42, -7, 7);
+  ASSERT_RENDER_PARITY("[%.0d] [%5.0d] [%.0x]", 0, 0, 0);
+  ASSERT_RENDER_PARITY("[%#x] [%#X] [%#o] [%#o] [%#x]", 255, 255, 8, 0, 0);
+  ASSERT_RENDER_PARITY("[%#010x] [%#.3o]", 0xab, 8);
+  ASSERT_RENDER_PARITY("%hhd %hhu %hd %hu", 300, 300, 70000, 70000);
+  ASSERT_RENDER_PARITY("%ld %lu %lx", -1L, (unsigned long)-1, 0xdeadbeefUL);
+  ASSERT_RENDER_PARITY("%lld %llu", (-9223372036854775807LL - 1),
+                       18446744073709551615ULL);
+  ASSERT_RENDER_PARITY("%zu %zd %td %jd", (size_t)123, (size_t)-1,
+                       (ptrdiff_t)-5, (intmax_t)-99);
+}
+
+/**
+ * @brief Test character, string and pointer rendering matches libc
+ */
+void test_snprintf_parity_text(void) {
+  ASSERT_RENDER_PARITY("[%c] [%3c] [%-3c]", 'a', 'b', 'c');
+  ASSERT_RENDER_PARITY("[%s] [%10s] [%-10s] [%.3s]", "abc", "abc", "abc",
+                       "abcdef");
+  ASSERT_RENDER_PARITY("[%p] [%20p] [%-20p]", (void *)0x1234, (void *)0x1234,
+                       (void *)0x1234);
+  ASSERT_RENDER_PARITY("[%p]", (void *)NULL);
+  ASSERT_RENDER_PARITY("100%% %s", "done");
+}
+
+/**
+ * @brief Test floating point rendering matches libc
+ */
+void test_snprintf_parity_floats(void) {
+  ASSERT_RENDER_PARITY("%f %e %g", 3.14159, 31415.9, 0.0001);
+  ASSERT_RENDER_PARITY("[%10.3f] [%-10.2e] [%+G] [%08.2f]", 2.5, 1e10, 1e-10,
+                       -3.5);
+}
+
+/**
+ * @brief Test width and precision read from arguments match libc, including
+ * negative ones
+ */
+void test_snprintf_parity_star(void) {
+  ASSERT_RENDER_PARITY("[%*d] [%-*d] [%*d]", 8, 42, 8, 42, -8, 42);
+  ASSERT_RENDER_PARITY("[%.*d] [%.*d] [%0*d]", 5, 42, -1, 42, 6, -3);
+  ASSERT_RENDER_PARITY("[%.*s] [%*s] [%*.*s]", 3, "abcdef", -6, "ab", 5, 2,
+                       "xyz");
+  ASSERT_RENDER_PARITY("[%.*f] [%*.*e] [%-*g]", 2, 3.14159, 12, 3, 1e5, 9,
+                       0.5);
+  ASSERT_RENDER_PARITY("[%*c] [%*x] %s", 3, 'z', 4, 0xab, "end");
+  ASSERT_DENSE_PARITY("[%*d] [%.*s] [%-*.*f]", -5, 42, 2, "abc", 8, 1, 2.25);
+}
+
+/**
+ * @brief Test long double conversions match libc
+ */
+void test_snprintf_parity_long_double(void) {
+  ASSERT_RENDER_PARITY("%Lf %Le %Lg", 3.14159L, 123456.789L, 1e-5L);
+  ASSERT_RENDER_PARITY("[%12.3Lf] [%-12.2Le] [%+LG] %d", 2.5L, -1e10L, 1e-10L,
+                       7);
+  ASSERT_RENDER_PARITY("%d %La %d", 1, 0.75L, 2);
+  ASSERT_DENSE_PARITY("%d %Lf %d", -1, 0.125L, 9);
+}
+
+/**
+ * @brief Test hexadecimal floating point conversions match libc
+ */
+void test_snprintf_parity_hex_float(void) {
+  ASSERT_RENDER_PARITY("%a %A %a", 1.0, 255.5, -0.1);
+  ASSERT_RENDER_PARITY("[%.3a] [%#a] [%20a] [%-20A]", 3.14159, 0.0, 1e-3,
+                       1e3);
+  ASSERT_DENSE_PARITY("%a %d", 2.5, 4);
+}
+
+/**
+ * @brief Test wide character and wide string conversions match libc
+ */
+void test_snprintf_parity_wide(void) {
+  ASSERT_RENDER_PARITY("[%lc] [%3lc] [%-3lc]", (wint_t)L'x', (wint_t)L'y',
+                       (wint_t)L'z');
+  ASSERT_RENDER_PARITY("[%ls] [%.2ls] [%-6ls] [%6ls]", L"wide", L"wide",
+                       L"ab", L"cd");
+  ASSERT_RENDER_PARITY("%ls %s %lc", L"mixed", "narrow", (wint_t)L'w');
+  ASSERT_DENSE_PARITY("[%lc] [%ls] %c", (wint_t)L'q', L"wide", 'n');
+}
+
+/**
+ * @brief Test positional arguments match libc, in and out of order and
+ * reused
+ */
+void test_snprintf_parity_positional(void) {
+  ASSERT_RENDER_PARITY("%2$s %1$d", 7, "seven");
+  ASSERT_RENDER_PARITY("%1$d %1$x %1$#o", 255);
+  ASSERT_RENDER_PARITY("[%3$*1$.*2$f] [%3$-*1$.1f]", 10, 3, 3.14159);
+  ASSERT_RENDER_PARITY("%2$c%1$c %3$Lf %4$lld", 'a', 'b', 0.5L, -1LL);
+  ASSERT_RENDER_PARITY("%1$d%% %2$ls", 50, L"done");
+  ASSERT_DENSE_PARITY("%2$d %1$s", "x", 5);
+
+  // More arguments than a cached signature holds
+  ASSERT_RENDER_PARITY("%14$d %13$d %12$d %11$d %10$d %9$d %8$d %7$d %6$d "
+                       "%5$d %4$d %3$d %2$d %1$d",
+                       1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14);
+}
+
+/**
+ * @brief Test positional arguments whose types can't be known are rejected
+ */
+void test_positional_invalid(void) {
+  uint8_t arg_buf[64];
+
+  // Mixed with arguments taken in order
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_package(arg_buf, sizeof(arg_buf), 0,
+                                                 "%1$d %d", 1, 2));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_package(arg_buf, sizeof(arg_buf), 0,
+                                                 "%d %1$d", 7));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_package(NULL, 0, 0, "%d %*2$d", 1, 2));
+
+  // Skipped position
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_package(arg_buf, sizeof(arg_buf), 0,
+                                                 "%1$d %3$d", 1, 2, 3));
+
+  // Conflicting types
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_package(NULL, 0, 0, "%1$d %1$lld",
+                                                 1LL));
+  TEST_ASSERT_EQUAL(-EINVAL,
+                    frpp_printf_package(NULL, 0, FRPP_PRINTF_FLAG_DENSE,
+                                        "%1$d %1$s", "x"));
+
+  // Beyond FRPP_PRINTF_POS_ARGS_MAX
+  TEST_ASSERT_EQUAL(-E2BIG, frpp_printf_package(NULL, 0, 0, "%17$d", 1, 2, 3,
+                                                4, 5, 6, 7, 8, 9, 10, 11, 12,
+                                                13, 14, 15, 16, 17));
+}
+
+/**
+ * @brief Test captured strings are found by position, and with precision
+ * read from an argument
+ */
+void test_capture_str_positional(void) {
+  uint8_t arg_buf[64] = {0};
+  char name[8] = "pump";
+  char out_buf[64];
+  uint32_t flags = FRPP_PRINTF_FLAG_CAPTURE_STR;
+
+  TEST_ASSERT_GREATER_THAN(
+      0, frpp_printf_package(arg_buf, sizeof(arg_buf), flags,
+                             "%2$s=%1$d %2$.*3$s", 5, name, 2));
+  memset(name, 0, sizeof(name));
+  frpp_snprintf_ex("%2$s=%1$d %2$.*3$s", flags, arg_buf, out_buf,
+                   sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("pump=5 pu", out_buf);
+
+  strcpy(name, "valve");
+  TEST_ASSERT_GREATER_THAN(0, frpp_printf_package(arg_buf, sizeof(arg_buf),
+                                                  flags, "[%*s] [%.*s]", 7,
+                                                  name, 3, name));
+  memset(name, 0, sizeof(name));
+  frpp_snprintf_ex("[%*s] [%.*s]", flags, arg_buf, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("[  valve] [val]", out_buf);
+}
+
+/**
+ * @brief Test frpp_snprintf truncates like snprintf and reports the full
+ * length
+ */
+void test_snprintf_truncation(void) {
+  uint8_t arg_buf[32] = {0};
+  char out_buf[8];
+
+  int ret =
+      frpp_printf_package(arg_buf, sizeof(arg_buf), 0, "%s=%d", "value", 1234);
+  TEST_ASSERT_GREATER_THAN(0, ret);
+
+  memset(out_buf, 'x', sizeof(out_buf));
+  ret = frpp_snprintf("%s=%d", arg_buf, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL(10, ret);
+  TEST_ASSERT_EQUAL_STRING("value=1", out_buf);
+
+  memset(out_buf, 'x', sizeof(out_buf));
+  ret = frpp_snprintf("%s=%d", arg_buf, out_buf, 0);
+  TEST_ASSERT_EQUAL(10, ret);
+  TEST_ASSERT_EQUAL('x', out_buf[0]);
+}
+
+/**
+ * @brief Test %n writes number of characters rendered so far
+ */
+void test_snprintf_n_format(void) {
+  uint8_t arg_buf[32] = {0};
+  char out_buf[32];
+  int count = -1;
+
+  int ret = frpp_printf_package(arg_buf, sizeof(arg_buf), 0, "abc%n%d", &count,
+                                42);
+  TEST_ASSERT_GREATER_THAN(0, ret);
+
+  ret = frpp_snprintf("abc%n%d", arg_buf, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL(5, ret);
+  TEST_ASSERT_EQUAL(3, count);
+  TEST_ASSERT_EQUAL_STRING("abc42", out_buf);
+}
+
+/**
+ * @brief Test captured strings survive their source being overwritten
+ */
+void test_capture_str(void) {
+  uint8_t arg_buf[64] = {0};
+  char out_buf[64] = {0};
+  char name[16] = "stack";
+
+  int size = frpp_printf_package(NULL, 0, FRPP_PRINTF_FLAG_CAPTURE_STR,
+                                 "%s=%d", name, 7);
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(char *) + FRPP_VA_STACK_ALIGN(int) +
+                        1 + 5,
+                    size);
+
+  int ret = frpp_printf_package(arg_buf, sizeof(arg_buf),
+                                FRPP_PRINTF_FLAG_CAPTURE_STR, "%s=%d", name, 7);
+  TEST_ASSERT_EQUAL(size, ret);
+
+  strcpy(name, "gone");
+
+  ret = frpp_snprintf_ex("%s=%d", FRPP_PRINTF_FLAG_CAPTURE_STR, arg_buf,
+                         out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL(7, ret);
+  TEST_ASSERT_EQUAL_STRING("stack=7", out_buf);
+
+  ret = frpp_printf_package(arg_buf, sizeof(arg_buf),
+                            FRPP_PRINTF_FLAG_CAPTURE_STR, "[%-8.3s|%s]", name,
+                            (const char *)NULL);
+  TEST_ASSERT_GREATER_THAN(0, ret);
+
+  ret = frpp_snprintf_ex("[%-8.3s|%s]", FRPP_PRINTF_FLAG_CAPTURE_STR, arg_buf,
+                         out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("[gon     |(null)]", out_buf);
+}
+
+/**
+ * @brief Test strings longer than the cap are truncated with a marker
+ */
+void test_capture_str_cap(void) {
+  uint8_t arg_buf[64] = {0};
+  char out_buf[64] = {0};
+  char text[] = "0123456789abcdef";
+  const uint32_t flags =
+      FRPP_PRINTF_FLAG_CAPTURE_STR | FRPP_PRINTF_FLAG_STR_CAP(8);
+
+  int ret = frpp_printf_package(arg_buf, sizeof(arg_buf), flags, "%s", text);
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(char *) + 1 + 8, ret);
+
+  ret = frpp_snprintf_ex("%s", flags, arg_buf, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("01234...", out_buf);
+
+  // Exactly at the cap isn't truncated
+  text[8] = '\0';
+  frpp_printf_package(arg_buf, sizeof(arg_buf), flags, "%s", text);
+  frpp_snprintf_ex("%s", flags, arg_buf, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("01234567", out_buf);
+}
+
+/**
+ * @brief Test strings in registered read-only ranges are stored by pointer
+ */
+void test_capture_str_ro_range(void) {
+  static const char ro[] = "read only";
+  uint8_t arg_buf[64] = {0};
+  char out_buf[64] = {0};
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_ro_range_add(NULL, 1));
+  TEST_ASSERT_EQUAL(0, frpp_printf_ro_range_add(ro, sizeof(ro)));
+  TEST_ASSERT_TRUE(frpp_printf_is_ro(&ro[4]));
+  TEST_ASSERT_FALSE(frpp_printf_is_ro(out_buf));
+
+  int ret = frpp_printf_package(arg_buf, sizeof(arg_buf),
+                                FRPP_PRINTF_FLAG_CAPTURE_STR, "%s!", ro);
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(char *) + 1, ret);
+
+  ret = frpp_snprintf_ex("%s!", FRPP_PRINTF_FLAG_CAPTURE_STR, arg_buf, out_buf,
+                         sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("read only!", out_buf);
+}
+
+/**
+ * @brief Test captured strings that don't fit are reported as -ENOSPC
+ */
+void test_capture_str_no_space(void) {
+  uint8_t arg_buf[16] = {0};
+  char text[] = "does not fit here";
+
+  int ret = frpp_printf_package(arg_buf, FRPP_VA_STACK_ALIGN(char *) + 4,
+                                FRPP_PRINTF_FLAG_CAPTURE_STR, "%s", text);
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+}
+
+/**
+ * @brief Test dense packages render the same as libc snprintf
+ */
+void test_dense_parity(void) {
+  ASSERT_DENSE_PARITY("%d %i %u", -12345, 0, 4000000000U);
+  ASSERT_DENSE_PARITY("%d %d %d", INT_MIN, INT_MAX, -1);
+  ASSERT_DENSE_PARITY("%hhd %hhu %hd %hu %c", -5, 250, -3000, 60000, 'q');
+  ASSERT_DENSE_PARITY("%ld %lu %lld %llu", LONG_MIN, ULONG_MAX, LLONG_MIN,
+                      ULLONG_MAX);
+  ASSERT_DENSE_PARITY("%zu %td %jd %jx", (size_t)12, (ptrdiff_t)-12,
+                      (intmax_t)-1, (uintmax_t)0xdeadbeef);
+  ASSERT_DENSE_PARITY("[%08.3f] [%-10s] [%p] %%", 3.14159, "str",
+                      (void *)0x1234);
+  ASSERT_DENSE_PARITY("[%#010x] [%+5d] [%-6o]", 0xab, 9, 8);
+}
+
+/**
+ * @brief Test dense packages are smaller than slotted ones for small values
+ */
+void test_dense_size(void) {
+  int dense = frpp_printf_package(NULL, 0, FRPP_PRINTF_FLAG_DENSE,
+                                  "%c %hhd %hd %d %u %ld", 'a', 1, -2, 3, 4U,
+                                  -5L);
+  TEST_ASSERT_EQUAL(1 + 1 + 2 + 1 + 1 + 1, dense);
+
+  int slotted = frpp_printf_package(NULL, 0, 0, "%c %hhd %hd %d %u %ld", 'a',
+                                    1, -2, 3, 4U, -5L);
+  TEST_ASSERT_GREATER_THAN(dense, slotted);
+
+  // Varints grow with magnitude, zigzag keeps small negatives short
+  TEST_ASSERT_EQUAL(1, frpp_printf_package(NULL, 0, FRPP_PRINTF_FLAG_DENSE,
+                                           "%d", -64));
+  TEST_ASSERT_EQUAL(2, frpp_printf_package(NULL, 0, FRPP_PRINTF_FLAG_DENSE,
+                                           "%d", 64));
+  TEST_ASSERT_EQUAL(5, frpp_printf_package(NULL, 0, FRPP_PRINTF_FLAG_DENSE,
+                                           "%u", UINT_MAX));
+}
+
+/**
+ * @brief Test dense packages can capture strings
+ */
+void test_dense_capture(void) {
+  const uint32_t flags = FRPP_PRINTF_FLAG_DENSE | FRPP_PRINTF_FLAG_CAPTURE_STR;
+  uint8_t arg_buf[64] = {0};
+  char out_buf[64] = {0};
+  char name[16] = "stack";
+
+  int size = frpp_printf_package(NULL, 0, flags, "%s=%d %s", name, 7,
+                                 (const char *)NULL);
+  TEST_ASSERT_EQUAL(1 + 5 + 1 + 1 + sizeof(char *), size);
+
+  int ret = frpp_printf_package(arg_buf, sizeof(arg_buf), flags, "%s=%d %s",
+                                name, 7, (const char *)NULL);
+  TEST_ASSERT_EQUAL(size, ret);
+
+  strcpy(name, "gone");
+
+  ret = frpp_snprintf_ex("%s=%d %s", flags, arg_buf, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("stack=7 (null)", out_buf);
+  TEST_ASSERT_EQUAL(14, ret);
+}
+
+/**
+ * @brief Test dense packages that don't fit are reported as -ENOSPC
+ */
+void test_dense_no_space(void) {
+  uint8_t arg_buf[8] = {0};
+
+  int ret = frpp_printf_package(arg_buf, 4, FRPP_PRINTF_FLAG_DENSE, "%d %d",
+                                1, INT_MAX);
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+
+  ret = frpp_printf_package(arg_buf, 4, FRPP_PRINTF_FLAG_DENSE, "%f", 1.0);
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+}
+
+/**
+ * @brief Test user-defined types are serialized when packaged and rendered
+ * with their hooks
+ */
+void test_udt(void) {
+  uint8_t arg_buf[64] = {0};
+  char out_buf[64] = {0};
+  struct test_point point = {.x = 3, .y = -4};
+
+  int size = frpp_printf_package(NULL, 0, 0, "p=%@ n=%d",
+                                 FRPP_PRINTF_UDT(&prv_point_ops, &point), 5);
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(void *) + FRPP_VA_STACK_ALIGN(int) +
+                        1 + sizeof(point),
+                    size);
+
+  int ret = frpp_printf_package(arg_buf, sizeof(arg_buf), 0, "p=%@ n=%d",
+                                FRPP_PRINTF_UDT(&prv_point_ops, &point), 5);
+  TEST_ASSERT_EQUAL(size, ret);
+
+  // Object is captured, not referenced
+  point.x = 100;
+
+  ret = frpp_snprintf("p=%@ n=%d", arg_buf, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("p=(3, -4) n=5", out_buf);
+  TEST_ASSERT_EQUAL(13, ret);
+
+  // Truncated output still reports the full length
+  ret = frpp_snprintf("p=%@ n=%d", arg_buf, out_buf, 6);
+  TEST_ASSERT_EQUAL_STRING("p=(3,", out_buf);
+  TEST_ASSERT_EQUAL(13, ret);
+}
+
+/**
+ * @brief Test NULL user-defined type arguments
+ */
+void test_udt_null(void) {
+  uint8_t arg_buf[64] = {0};
+  char out_buf[64] = {0};
+
+  int ret = frpp_printf_package(arg_buf, sizeof(arg_buf), 0, "[%@|%@]",
+                                (const struct frpp_printf_udt *)NULL,
+                                FRPP_PRINTF_UDT(NULL, NULL));
+  TEST_ASSERT_EQUAL(2 * (FRPP_VA_STACK_ALIGN(void *) + 1), ret);
+
+  frpp_snprintf("[%@|%@]", arg_buf, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("[(null)|(null)]", out_buf);
+}
+
+/**
+ * @brief Test user-defined types share the captured area with strings and
+ * work in dense packages
+ */
+void test_udt_capture_dense(void) {
+  const uint32_t modes[] = {
+      FRPP_PRINTF_FLAG_CAPTURE_STR,
+      FRPP_PRINTF_FLAG_DENSE,
+      FRPP_PRINTF_FLAG_CAPTURE_STR | FRPP_PRINTF_FLAG_DENSE,
+  };
+  struct test_point a = {.x = 1, .y = 2};
+  struct test_point b = {.x = -7, .y = 0};
+
+  for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+    uint8_t arg_buf[96] = {0};
+    char out_buf[64] = {0};
+    char name[8] = "pts";
+
+    int size = frpp_printf_package(NULL, 0, modes[i], "%s %@->%@ %hd", name,
+                                   FRPP_PRINTF_UDT(&prv_point_ops, &a),
+                                   FRPP_PRINTF_UDT(&prv_point_ops, &b), -1);
+    int ret = frpp_printf_package(arg_buf, sizeof(arg_buf), modes[i],
+                                  "%s %@->%@ %hd", name,
+                                  FRPP_PRINTF_UDT(&prv_point_ops, &a),
+                                  FRPP_PRINTF_UDT(&prv_point_ops, &b), -1);
+    TEST_ASSERT_EQUAL(size, ret);
+
+    if (modes[i] & FRPP_PRINTF_FLAG_CAPTURE_STR) {
+      strcpy(name, "xxx");
+    }
+
+    frpp_snprintf_ex("%s %@->%@ %hd", modes[i], arg_buf, out_buf,
+                     sizeof(out_buf));
+    TEST_ASSERT_EQUAL_STRING("pts (1, 2)->(-7, 0) -1", out_buf);
+  }
+}
+
+/**
+ * @brief Test user-defined types that don't fit are reported as -ENOSPC
+ */
+void test_udt_no_space(void) {
+  uint8_t arg_buf[64] = {0};
+  struct test_point point = {0};
+
+  int ret = frpp_printf_package(arg_buf, FRPP_VA_STACK_ALIGN(void *) + 2, 0,
+                                "%@", FRPP_PRINTF_UDT(&prv_point_ops, &point));
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+
+  ret = frpp_printf_package(NULL, 0, 0, "%@",
+                            FRPP_PRINTF_UDT(&prv_huge_ops, &point));
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+}
+
+/**
+ * @brief Test records are rendered back to back with their offsets
+ */
+void test_batch(void) {
+  uint8_t pkg_a[32] = {0};
+  uint8_t pkg_b[32] = {0};
+  uint8_t pkg_c[32] = {0};
+  char out_buf[64];
+  size_t offsets[4];
+
+  frpp_printf_package(pkg_a, sizeof(pkg_a), 0, "a=%d\n", 1);
+  frpp_printf_package(pkg_b, sizeof(pkg_b), FRPP_PRINTF_FLAG_DENSE,
+                      "b=%u %s\n", 22U, "x");
+  frpp_printf_package(pkg_c, sizeof(pkg_c), 0, "no args\n");
+
+  const struct frpp_printf_record records[] = {
+      {.fmt = "a=%d\n", .arg_buf = pkg_a, .flags = 0},
+      {.fmt = "b=%u %s\n", .arg_buf = pkg_b, .flags = FRPP_PRINTF_FLAG_DENSE},
+      {.fmt = "no args\n", .arg_buf = pkg_c, .flags = 0},
+  };
+
+  int ret = frpp_snprintf_batch(records, 3, out_buf, sizeof(out_buf), offsets);
+  TEST_ASSERT_EQUAL(3, ret);
+  TEST_ASSERT_EQUAL_STRING("a=1\nb=22 x\nno args\n", out_buf);
+  TEST_ASSERT_EQUAL(0, offsets[0]);
+  TEST_ASSERT_EQUAL(4, offsets[1]);
+  TEST_ASSERT_EQUAL(11, offsets[2]);
+  TEST_ASSERT_EQUAL(19, offsets[3]);
+}
+
+/**
+ * @brief Test batch stops at the first record that doesn't fit without
+ * splitting it
+ */
+void test_batch_full(void) {
+  uint8_t pkg[32] = {0};
+  char out_buf[16];
+  size_t offsets[5];
+
+  frpp_printf_package(pkg, sizeof(pkg), 0, "[%05d]", 42);
+
+  const struct frpp_printf_record records[] = {
+      {.fmt = "[%05d]", .arg_buf = pkg, .flags = 0},
+      {.fmt = "[%05d]", .arg_buf = pkg, .flags = 0},
+      {.fmt = "[%05d]", .arg_buf = pkg, .flags = 0},
+      {.fmt = "[%05d]", .arg_buf = pkg, .flags = 0},
+  };
+
+  // Two 7 character records and a terminator fit, a third doesn't
+  int ret = frpp_snprintf_batch(records, 4, out_buf, sizeof(out_buf), offsets);
+  TEST_ASSERT_EQUAL(2, ret);
+  TEST_ASSERT_EQUAL_STRING("[00042][00042]", out_buf);
+  TEST_ASSERT_EQUAL(14, offsets[2]);
+
+  // Exactly enough room
+  ret = frpp_snprintf_batch(records, 2, out_buf, 15, offsets);
+  TEST_ASSERT_EQUAL(2, ret);
+
+  ret = frpp_snprintf_batch(records, 1, out_buf, 7, offsets);
+  TEST_ASSERT_EQUAL(0, ret);
+  TEST_ASSERT_EQUAL_STRING("", out_buf);
+}
+
+/**
+ * @brief Test batch rejects invalid arguments
+ */
+void test_batch_invalid(void) {
+  uint8_t pkg[8] = {0};
+  char out_buf[16];
+  size_t offsets[3];
+  const struct frpp_printf_record records[] = {
+      {.fmt = "ok", .arg_buf = pkg, .flags = 0},
+      {.fmt = NULL, .arg_buf = pkg, .flags = 0},
+  };
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_snprintf_batch(NULL, 1, out_buf,
+                                                 sizeof(out_buf), offsets));
+  TEST_ASSERT_EQUAL(-EINVAL,
+                    frpp_snprintf_batch(records, 1, NULL, 16, offsets));
+  TEST_ASSERT_EQUAL(-EINVAL,
+                    frpp_snprintf_batch(records, 1, out_buf, 0, offsets));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_snprintf_batch(records, 1, out_buf,
+                                                 sizeof(out_buf), NULL));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_snprintf_batch(records, 2, out_buf,
+                                                 sizeof(out_buf), offsets));
+
+  TEST_ASSERT_EQUAL(0, frpp_snprintf_batch(records, 0, out_buf,
+                                           sizeof(out_buf), offsets));
+  TEST_ASSERT_EQUAL_STRING("", out_buf);
+}
+
 /**
  * @brief Runner
  *
@@ -658,6 +1465,7 @@ int main(void) {
   // Floating point tests
   RUN_TEST(test_double_format);
   RUN_TEST(test_float_formats);
+  RUN_TEST(test_lf_format);
 
   // Format modifier tests
   RUN_TEST(test_escaped_percent);
@@ -671,6 +1479,7 @@ int main(void) {
 
   // Buffer handling tests
   RUN_TEST(test_buffer_overrun);
+  RUN_TEST(test_buffer_partial_fit);
   RUN_TEST(test_exact_buffer_size);
 
   // Edge case tests
@@ -680,6 +1489,14 @@ int main(void) {
   // Data integrity tests
   RUN_TEST(test_data_integrity_multiple_values);
 
+  // Reservation tests
+  RUN_TEST(test_reserve_invalid);
+  RUN_TEST(test_reserve_package);
+  RUN_TEST(test_reserve_append);
+  RUN_TEST(test_reserve_short_write);
+  RUN_TEST(test_reserve_exhausted);
+  RUN_TEST(test_reserve_abort);
+
   // frpp_snprintf error condition tests
   RUN_TEST(test_snprintf_null_format_str);
   RUN_TEST(test_snprintf_null_arg_buf);
@@ -709,6 +1526,41 @@ int main(void) {
 
   // frpp_snprintf integration test
   RUN_TEST(test_snprintf_end_to_end);
+  RUN_TEST(test_snprintf_parity_integers);
+  RUN_TEST(test_snprintf_parity_text);
+  RUN_TEST(test_snprintf_parity_floats);
+  RUN_TEST(test_snprintf_parity_star);
+  RUN_TEST(test_snprintf_parity_long_double);
+  RUN_TEST(test_snprintf_parity_hex_float);
+  RUN_TEST(test_snprintf_parity_wide);
+  RUN_TEST(test_snprintf_parity_positional);
+  RUN_TEST(test_positional_invalid);
+  RUN_TEST(test_snprintf_truncation);
+  RUN_TEST(test_snprintf_n_format);
+
+  // String capture tests
+  RUN_TEST(test_capture_str);
+  RUN_TEST(test_capture_str_cap);
+  RUN_TEST(test_capture_str_ro_range);
+  RUN_TEST(test_capture_str_no_space);
+  RUN_TEST(test_capture_str_positional);
+
+  // Dense packing tests
+  RUN_TEST(test_dense_parity);
+  RUN_TEST(test_dense_size);
+  RUN_TEST(test_dense_capture);
+  RUN_TEST(test_dense_no_space);
+
+  // User-defined type tests
+  RUN_TEST(test_udt);
+  RUN_TEST(test_udt_null);
+  RUN_TEST(test_udt_capture_dense);
+  RUN_TEST(test_udt_no_space);
+
+  // Batch rendering tests
+  RUN_TEST(test_batch);
+  RUN_TEST(test_batch_full);
+  RUN_TEST(test_batch_invalid);
 
   return UNITY_END();
 }
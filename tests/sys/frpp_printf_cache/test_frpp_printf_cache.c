@@ -0,0 +1,329 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_printf_cache.c
+ * @author Evan Stoddard
+ * @brief Tests for frpp_printf signature cache
+ */
+
+#include "unity.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "frpp/sys/frpp_printf.h"
+#include "frpp/sys/frpp_printf_cache.h"
+#include "frpp/utils/utils.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static const char prv_fmt_simple[] = "Value: %d, String: %s, Float: %f";
+
+/* Distinct format strings, twice as many as the cache holds */
+static char prv_fmt_many[FRPP_PRINTF_CACHE_SIZE * 2][4];
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) { frpp_printf_cache_reset(); }
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test signature contents
+ */
+void test_signature_build(void) {
+  struct frpp_printf_signature sig;
+  int ret = frpp_printf_signature_build("%hhd %lld %% %s %zu %5.2f", &sig);
+  TEST_ASSERT_EQUAL(0, ret);
+  TEST_ASSERT_EQUAL(5, sig.count);
+
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_ARG_INT, sig.types[0]);
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_ARG_LONG_LONG, sig.types[1]);
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_ARG_STR, sig.types[2]);
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_ARG_SIZE, sig.types[3]);
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_ARG_DOUBLE, sig.types[4]);
+
+  size_t offset = 0;
+  TEST_ASSERT_EQUAL(offset, sig.offsets[0]);
+  offset += FRPP_VA_STACK_ALIGN(int);
+  TEST_ASSERT_EQUAL(offset, sig.offsets[1]);
+  offset += FRPP_VA_STACK_ALIGN(long long);
+  TEST_ASSERT_EQUAL(offset, sig.offsets[2]);
+  offset += FRPP_VA_STACK_ALIGN(char *);
+  TEST_ASSERT_EQUAL(offset, sig.offsets[3]);
+  offset += FRPP_VA_STACK_ALIGN(size_t);
+  TEST_ASSERT_EQUAL(offset, sig.offsets[4]);
+  offset += FRPP_VA_STACK_ALIGN(double);
+  TEST_ASSERT_EQUAL(offset, sig.size);
+}
+
+/**
+ * @brief Test signature build with invalid arguments
+ */
+void test_signature_build_invalid(void) {
+  struct frpp_printf_signature sig;
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_signature_build(NULL, &sig));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_signature_build("%d", NULL));
+}
+
+/**
+ * @brief Test format string with too many arguments to cache
+ */
+void test_signature_build_too_many_args(void) {
+  struct frpp_printf_signature sig;
+  int ret = frpp_printf_signature_build(
+      "%d %d %d %d %d %d %d %d %d %d %d %d %d", &sig);
+  TEST_ASSERT_EQUAL(-E2BIG, ret);
+}
+
+/**
+ * @brief Test star width/precision and positional arguments in signature
+ */
+void test_signature_build_star_positional(void) {
+  struct frpp_printf_signature sig;
+  int ret = frpp_printf_signature_build("%-*.*Lf", &sig);
+  TEST_ASSERT_EQUAL(0, ret);
+  TEST_ASSERT_EQUAL(3, sig.count);
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_ARG_INT, sig.types[0]);
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_ARG_INT, sig.types[1]);
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_ARG_LONG_DOUBLE, sig.types[2]);
+
+  // Types follow positions, not specifier order
+  ret = frpp_printf_signature_build("%2$s %1$d %2$s", &sig);
+  TEST_ASSERT_EQUAL(0, ret);
+  TEST_ASSERT_EQUAL(2, sig.count);
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_ARG_INT, sig.types[0]);
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_ARG_STR, sig.types[1]);
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(int), sig.offsets[1]);
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_signature_build("%2$d", &sig));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_signature_build("%1$d %d", &sig));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_signature_build("%d %1$d", &sig));
+}
+
+/**
+ * @brief Test first lookup misses and subsequent lookups hit
+ */
+void test_lookup_hit_after_miss(void) {
+  struct frpp_printf_cache_stats stats;
+  struct frpp_printf_signature first;
+  struct frpp_printf_signature second;
+
+  TEST_ASSERT_EQUAL(0, frpp_printf_cache_lookup(prv_fmt_simple, &first));
+  TEST_ASSERT_EQUAL(0, frpp_printf_cache_lookup(prv_fmt_simple, &second));
+  TEST_ASSERT_EQUAL_MEMORY(&first, &second, sizeof(first));
+  TEST_ASSERT_EQUAL(3, second.count);
+
+  frpp_printf_cache_get_stats(&stats);
+  TEST_ASSERT_EQUAL(1, stats.misses);
+  TEST_ASSERT_EQUAL(1, stats.hits);
+  TEST_ASSERT_EQUAL(0, stats.uncacheable);
+}
+
+/**
+ * @brief Test cache is keyed by pointer, not contents
+ */
+void test_lookup_keyed_by_pointer(void) {
+  static const char fmt_a[] = "%d";
+  static const char fmt_b[] = "%d";
+  struct frpp_printf_cache_stats stats;
+  struct frpp_printf_signature sig;
+
+  TEST_ASSERT_EQUAL(0, frpp_printf_cache_lookup(fmt_a, &sig));
+  TEST_ASSERT_EQUAL(0, frpp_printf_cache_lookup(fmt_b, &sig));
+
+  frpp_printf_cache_get_stats(&stats);
+  TEST_ASSERT_EQUAL(2, stats.misses);
+  TEST_ASSERT_EQUAL(0, stats.hits);
+}
+
+/**
+ * @brief Test uncacheable format strings are remembered as such
+ */
+void test_lookup_uncacheable(void) {
+  static const char fmt[] = "%d %d %d %d %d %d %d %d %d %d %d %d %d";
+  struct frpp_printf_cache_stats stats;
+  struct frpp_printf_signature sig;
+
+  TEST_ASSERT_EQUAL(-ENOENT, frpp_printf_cache_lookup(fmt, &sig));
+  TEST_ASSERT_EQUAL(-ENOENT, frpp_printf_cache_lookup(fmt, &sig));
+
+  frpp_printf_cache_get_stats(&stats);
+  TEST_ASSERT_EQUAL(1, stats.misses);
+  TEST_ASSERT_EQUAL(2, stats.uncacheable);
+}
+
+/**
+ * @brief Test format strings past the cache's capacity replace entries that
+ * weren't hit recently, while a hot format string stays cached
+ */
+void test_lookup_overflow(void) {
+  struct frpp_printf_cache_stats stats;
+  struct frpp_printf_signature sig;
+  const size_t count = sizeof(prv_fmt_many) / sizeof(prv_fmt_many[0]);
+
+  TEST_ASSERT_EQUAL(0, frpp_printf_cache_lookup(prv_fmt_simple, &sig));
+
+  for (size_t i = 0; i < count; i++) {
+    memcpy(prv_fmt_many[i], (i & 1) ? "%s" : "%d", 3);
+
+    TEST_ASSERT_EQUAL(0, frpp_printf_cache_lookup(prv_fmt_many[i], &sig));
+    TEST_ASSERT_EQUAL(1, sig.count);
+    TEST_ASSERT_EQUAL((i & 1) ? FRPP_PRINTF_ARG_STR : FRPP_PRINTF_ARG_INT,
+                      sig.types[0]);
+
+    TEST_ASSERT_EQUAL(0, frpp_printf_cache_lookup(prv_fmt_simple, &sig));
+    TEST_ASSERT_EQUAL(3, sig.count);
+  }
+
+  frpp_printf_cache_get_stats(&stats);
+  TEST_ASSERT_EQUAL(1 + count, stats.misses);
+  TEST_ASSERT_EQUAL(count, stats.hits);
+  TEST_ASSERT_EQUAL(0, stats.uncacheable);
+  TEST_ASSERT_GREATER_OR_EQUAL(count - FRPP_PRINTF_CACHE_SIZE,
+                               stats.evictions);
+
+  // The most recent format string is cached, and evicted ones still package
+  TEST_ASSERT_EQUAL(0, frpp_printf_cache_lookup(prv_fmt_many[count - 1], &sig));
+
+  uint8_t buf[16];
+  for (size_t i = 0; i < count; i += 2) {
+    TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(int),
+                      frpp_printf_package(buf, sizeof(buf), 0,
+                                          prv_fmt_many[i], (int)i));
+  }
+}
+
+/**
+ * @brief Test size query and write both use cached signature
+ */
+void test_package_uses_cache(void) {
+  uint8_t buf[64] = {0};
+  struct frpp_printf_cache_stats stats;
+
+  int size = frpp_printf_package(NULL, 0, 0, prv_fmt_simple, 42, "test", 1.5);
+  int ret =
+      frpp_printf_package(buf, sizeof(buf), 0, prv_fmt_simple, 42, "test", 1.5);
+  TEST_ASSERT_EQUAL(size, ret);
+
+  frpp_printf_cache_get_stats(&stats);
+  TEST_ASSERT_EQUAL(1, stats.misses);
+  TEST_ASSERT_EQUAL(1, stats.hits);
+
+  char out_buf[64] = {0};
+  frpp_snprintf(prv_fmt_simple, buf, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL_STRING("Value: 42, String: test, Float: 1.500000", out_buf);
+}
+
+/**
+ * @brief Test cached and uncached packaging produce identical packages
+ */
+void test_cached_matches_uncached(void) {
+  static const char fmt[] =
+      "%d %d %d %d %d %d %d %d %d %d %d %d %s %lld";
+  static const char fmt_short[] = "%d %s %lld";
+  uint8_t uncached[128] = {0};
+  uint8_t cached[128] = {0};
+
+  // Uncacheable format string packages through the parser
+  int ret = frpp_printf_package(uncached, sizeof(uncached), 0, fmt, 1, 2, 3, 4,
+                                5, 6, 7, 8, 9, 10, 11, 12, "str", 99LL);
+  TEST_ASSERT_GREATER_THAN(0, ret);
+
+  // Last three arguments through the cache.  Second call is a cache hit.
+  int ret_short = frpp_printf_package(cached, sizeof(cached), 0, fmt_short, 12,
+                                      "str", 99LL);
+  ret_short = frpp_printf_package(cached, sizeof(cached), 0, fmt_short, 12,
+                                  "str", 99LL);
+
+  size_t offset = 11 * FRPP_VA_STACK_ALIGN(int);
+  TEST_ASSERT_EQUAL(ret - offset, ret_short);
+  TEST_ASSERT_EQUAL_MEMORY(uncached + offset, cached, ret_short);
+}
+
+/**
+ * @brief Test cached package that doesn't fit
+ */
+void test_cached_buffer_overrun(void) {
+  uint8_t buf[FRPP_VA_STACK_ALIGN(int)] = {0};
+
+  int ret = frpp_printf_package(buf, sizeof(buf), 0, prv_fmt_simple, 42,
+                                "test", 1.5);
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+
+  ret = frpp_printf_package(buf, sizeof(buf), 0, prv_fmt_simple, 42, "test",
+                            1.5);
+  TEST_ASSERT_EQUAL(-ENOSPC, ret);
+}
+
+/**
+ * @brief Test reset clears entries and counters
+ */
+void test_reset(void) {
+  struct frpp_printf_cache_stats stats;
+  struct frpp_printf_signature sig;
+
+  frpp_printf_cache_lookup(prv_fmt_simple, &sig);
+  frpp_printf_cache_lookup(prv_fmt_simple, &sig);
+  frpp_printf_cache_reset();
+
+  frpp_printf_cache_get_stats(&stats);
+  TEST_ASSERT_EQUAL(0, stats.hits);
+  TEST_ASSERT_EQUAL(0, stats.misses);
+  TEST_ASSERT_EQUAL(0, stats.evictions);
+
+  frpp_printf_cache_lookup(prv_fmt_simple, &sig);
+  frpp_printf_cache_get_stats(&stats);
+  TEST_ASSERT_EQUAL(1, stats.misses);
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Signature tests
+  RUN_TEST(test_signature_build);
+  RUN_TEST(test_signature_build_invalid);
+  RUN_TEST(test_signature_build_too_many_args);
+  RUN_TEST(test_signature_build_star_positional);
+
+  // Lookup tests
+  RUN_TEST(test_lookup_hit_after_miss);
+  RUN_TEST(test_lookup_keyed_by_pointer);
+  RUN_TEST(test_lookup_uncacheable);
+  RUN_TEST(test_lookup_overflow);
+
+  // Packaging tests
+  RUN_TEST(test_package_uses_cache);
+  RUN_TEST(test_cached_matches_uncached);
+  RUN_TEST(test_cached_buffer_overrun);
+
+  // Reset tests
+  RUN_TEST(test_reset);
+
+  return UNITY_END();
+}
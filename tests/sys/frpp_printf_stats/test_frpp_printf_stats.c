@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_printf_stats.c
+ * @author Evan Stoddard
+ * @brief Tests for frpp_printf_stats
+ */
+
+#include "unity.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "frpp/sys/frpp_printf.h"
+#include "frpp/sys/frpp_printf_stats.h"
+#include "frpp/utils/utils.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TEST_THREAD_PACKAGES (1000U)
+
+/**
+ * @brief Threads packaging concurrently into the shared table
+ */
+#define TEST_SHARED_THREADS (4U)
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static const char prv_thread_fmt[] = "thread %d";
+
+/* Lines up threads so they package at the same time */
+static pthread_barrier_t prv_barrier;
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) { frpp_printf_stats_reset(); }
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief Find counters of a call site
+ */
+static const struct frpp_printf_stats_site *
+prv_find(const struct frpp_printf_stats_site *sites, int count,
+         const char *fmt) {
+  for (int i = 0; i < count; i++) {
+    if (sites[i].fmt == fmt) {
+      return &sites[i];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Thread packaging prv_thread_fmt repeatedly
+ */
+static void *prv_packager(void *arg) {
+  uint8_t buf[16];
+
+  (void)arg;
+
+  for (unsigned int i = 0; i < TEST_THREAD_PACKAGES; i++) {
+    frpp_printf_package(buf, sizeof(buf), 0, prv_thread_fmt, (int)i);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Thread packaging prv_thread_fmt repeatedly once all threads started
+ */
+static void *prv_concurrent_packager(void *arg) {
+  pthread_barrier_wait(&prv_barrier);
+
+  for (unsigned int i = 0; i < 100; i++) {
+    prv_packager(arg);
+  }
+
+  return NULL;
+}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test invalid arguments
+ */
+void test_invalid_args(void) {
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_printf_stats_read(NULL, 1));
+  TEST_ASSERT_EQUAL(0, frpp_printf_stats_read(NULL, 0));
+}
+
+/**
+ * @brief Test packages are counted per format string
+ */
+void test_package_counted(void) {
+  static const char fmt_a[] = "a=%d";
+  static const char fmt_b[] = "b=%lld %s";
+  struct frpp_printf_stats_site sites[4];
+  uint8_t buf[64];
+
+  frpp_printf_package(buf, sizeof(buf), 0, fmt_a, 1);
+  frpp_printf_package(buf, sizeof(buf), 0, fmt_a, 2);
+  frpp_printf_package(buf, sizeof(buf), 0, fmt_b, 3LL, "x");
+
+  // Calculate mode isn't counted
+  frpp_printf_package(NULL, 0, 0, fmt_a, 3);
+
+  int count = frpp_printf_stats_read(sites, 4);
+  TEST_ASSERT_EQUAL(2, count);
+
+  const struct frpp_printf_stats_site *a = prv_find(sites, count, fmt_a);
+  TEST_ASSERT_NOT_NULL(a);
+  TEST_ASSERT_EQUAL(2, a->packages);
+  TEST_ASSERT_EQUAL(0, a->enospc);
+  TEST_ASSERT_EQUAL(2 * FRPP_VA_STACK_ALIGN(int), a->package_bytes);
+  TEST_ASSERT_EQUAL(0, a->renders);
+
+  const struct frpp_printf_stats_site *b = prv_find(sites, count, fmt_b);
+  TEST_ASSERT_NOT_NULL(b);
+  TEST_ASSERT_EQUAL(1, b->packages);
+  TEST_ASSERT_EQUAL(FRPP_VA_STACK_ALIGN(long long) +
+                        FRPP_VA_STACK_ALIGN(char *),
+                    b->package_bytes);
+}
+
+/**
+ * @brief Test -ENOSPC failures are counted without adding bytes
+ */
+void test_enospc_counted(void) {
+  static const char fmt[] = "%lld %lld";
+  struct frpp_printf_stats_site site;
+  uint8_t buf[4];
+
+  TEST_ASSERT_EQUAL(-ENOSPC,
+                    frpp_printf_package(buf, sizeof(buf), 0, fmt, 1LL, 2LL));
+
+  TEST_ASSERT_EQUAL(1, frpp_printf_stats_read(&site, 1));
+  TEST_ASSERT_EQUAL_PTR(fmt, site.fmt);
+  TEST_ASSERT_EQUAL(1, site.packages);
+  TEST_ASSERT_EQUAL(1, site.enospc);
+  TEST_ASSERT_EQUAL(0, site.package_bytes);
+}
+
+/**
+ * @brief Test rendering is counted against the same call site
+ */
+void test_render_counted(void) {
+  static const char fmt[] = "render %d %s";
+  struct frpp_printf_stats_site site;
+  uint8_t buf[32];
+  char out[32];
+
+  frpp_printf_package(buf, sizeof(buf), 0, fmt, 5, "x");
+  frpp_snprintf(fmt, buf, out, sizeof(out));
+  frpp_snprintf(fmt, buf, out, sizeof(out));
+
+  TEST_ASSERT_EQUAL(1, frpp_printf_stats_read(&site, 1));
+  TEST_ASSERT_EQUAL(1, site.packages);
+  TEST_ASSERT_EQUAL(2, site.renders);
+
+#if defined(__x86_64__) || defined(__i386__)
+  TEST_ASSERT_GREATER_THAN(0, site.package_cycles);
+  TEST_ASSERT_GREATER_THAN(0, site.render_cycles);
+#endif
+}
+
+/**
+ * @brief Test read stops at the size of the output array
+ */
+void test_read_max(void) {
+  static const char fmt_a[] = "a";
+  static const char fmt_b[] = "b";
+  struct frpp_printf_stats_site sites[2];
+  uint8_t buf[8];
+
+  frpp_printf_package(buf, sizeof(buf), 0, fmt_a);
+  frpp_printf_package(buf, sizeof(buf), 0, fmt_b);
+
+  TEST_ASSERT_EQUAL(1, frpp_printf_stats_read(sites, 1));
+  TEST_ASSERT_EQUAL(2, frpp_printf_stats_read(sites, 2));
+}
+
+/**
+ * @brief Test counters of each thread are summed, and threads beyond
+ * FRPP_PRINTF_STATS_THREADS count into the shared table
+ */
+void test_threads(void) {
+  pthread_t threads[FRPP_PRINTF_STATS_THREADS];
+  struct frpp_printf_stats_site site;
+
+  // Main thread already has a table, so the last thread won't get one
+  for (size_t i = 0; i < FRPP_PRINTF_STATS_THREADS; i++) {
+    pthread_create(&threads[i], NULL, prv_packager, NULL);
+    pthread_join(threads[i], NULL);
+  }
+
+  TEST_ASSERT_EQUAL(1, frpp_printf_stats_read(&site, 1));
+  TEST_ASSERT_EQUAL_PTR(prv_thread_fmt, site.fmt);
+  TEST_ASSERT_EQUAL(FRPP_PRINTF_STATS_THREADS * TEST_THREAD_PACKAGES,
+                    site.packages);
+  TEST_ASSERT_EQUAL(0, frpp_printf_stats_dropped());
+}
+
+/**
+ * @brief Test threads sharing a table don't lose each other's updates
+ */
+void test_shared_table(void) {
+  const uint32_t packages = TEST_SHARED_THREADS * 100 * TEST_THREAD_PACKAGES;
+  pthread_t threads[TEST_SHARED_THREADS];
+  struct frpp_printf_stats_site site;
+
+  pthread_barrier_init(&prv_barrier, NULL, TEST_SHARED_THREADS);
+
+  // Tables were all handed out by test_threads
+  for (size_t i = 0; i < TEST_SHARED_THREADS; i++) {
+    pthread_create(&threads[i], NULL, prv_concurrent_packager, NULL);
+  }
+
+  for (size_t i = 0; i < TEST_SHARED_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  pthread_barrier_destroy(&prv_barrier);
+
+  TEST_ASSERT_EQUAL(1, frpp_printf_stats_read(&site, 1));
+  TEST_ASSERT_EQUAL(packages, site.packages);
+  TEST_ASSERT_EQUAL(packages * FRPP_VA_STACK_ALIGN(int), site.package_bytes);
+  TEST_ASSERT_EQUAL(0, frpp_printf_stats_dropped());
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_invalid_args);
+  RUN_TEST(test_package_counted);
+  RUN_TEST(test_enospc_counted);
+  RUN_TEST(test_render_counted);
+  RUN_TEST(test_read_max);
+
+  // Use up all tables, so must run last
+  RUN_TEST(test_threads);
+  RUN_TEST(test_shared_table);
+
+  return UNITY_END();
+}
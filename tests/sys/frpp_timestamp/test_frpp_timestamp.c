@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_timestamp.c
+ * @author Evan Stoddard
+ * @brief Tests for frpp_timestamp
+ */
+
+#include "unity.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "frpp/sys/frpp_timestamp.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TEST_BENCH_READS (1000000U)
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief Encode and decode a timestamp
+ *
+ * @param ts Timestamp
+ * @param prev Previous timestamp
+ * @return Encoded length
+ */
+static size_t prv_round_trip(uint64_t ts, uint64_t prev) {
+  uint8_t buf[FRPP_TIMESTAMP_DELTA_MAX];
+  uint64_t decoded = 0;
+
+  size_t len = frpp_timestamp_delta_encode(ts, prev, buf);
+  TEST_ASSERT_TRUE(len >= 1 && len <= FRPP_TIMESTAMP_DELTA_MAX);
+
+  TEST_ASSERT_EQUAL((int)len,
+                    frpp_timestamp_delta_decode(buf, len, prev, &decoded));
+  TEST_ASSERT_TRUE(decoded == ts);
+
+  return len;
+}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test invalid arguments
+ */
+void test_invalid(void) {
+  uint8_t buf[FRPP_TIMESTAMP_DELTA_MAX] = {0};
+  uint64_t ts = 0;
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_timestamp_delta_decode(NULL, 1, 0, &ts));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_timestamp_delta_decode(buf, 1, 0, NULL));
+}
+
+/**
+ * @brief Test encoded length grows with the size of the step
+ */
+void test_delta_len(void) {
+  TEST_ASSERT_EQUAL(1, prv_round_trip(1000, 1000));
+  TEST_ASSERT_EQUAL(1, prv_round_trip(1063, 1000));
+  TEST_ASSERT_EQUAL(2, prv_round_trip(1064, 1000));
+  TEST_ASSERT_EQUAL(2, prv_round_trip(1000 + 8191, 1000));
+  TEST_ASSERT_EQUAL(3, prv_round_trip(1000 + 8192, 1000));
+
+  // Backwards steps cost the same as forwards ones
+  TEST_ASSERT_EQUAL(1, prv_round_trip(999, 1000));
+  TEST_ASSERT_EQUAL(1, prv_round_trip(1000 - 64, 1000));
+  TEST_ASSERT_EQUAL(2, prv_round_trip(1000 - 65, 1000));
+}
+
+/**
+ * @brief Test extreme steps round trip
+ */
+void test_delta_extremes(void) {
+  TEST_ASSERT_EQUAL(1, prv_round_trip(UINT64_MAX, 0));
+  TEST_ASSERT_EQUAL(1, prv_round_trip(0, UINT64_MAX));
+  TEST_ASSERT_EQUAL(FRPP_TIMESTAMP_DELTA_MAX,
+                    prv_round_trip(1ULL << 63, 0));
+  TEST_ASSERT_EQUAL(FRPP_TIMESTAMP_DELTA_MAX,
+                    prv_round_trip(0, 1ULL << 63));
+  prv_round_trip(UINT64_MAX / 3, UINT64_MAX / 2);
+}
+
+/**
+ * @brief Test malformed deltas are rejected
+ */
+void test_delta_malformed(void) {
+  uint8_t buf[FRPP_TIMESTAMP_DELTA_MAX + 1];
+  uint64_t ts = 0;
+
+  // Truncated
+  size_t len = frpp_timestamp_delta_encode(1 << 20, 0, buf);
+  TEST_ASSERT_EQUAL(-EBADMSG,
+                    frpp_timestamp_delta_decode(buf, len - 1, 0, &ts));
+  TEST_ASSERT_EQUAL(-EBADMSG, frpp_timestamp_delta_decode(buf, 0, 0, &ts));
+
+  // Too long
+  memset(buf, 0x80, sizeof(buf));
+  buf[FRPP_TIMESTAMP_DELTA_MAX] = 0;
+  TEST_ASSERT_EQUAL(-EBADMSG,
+                    frpp_timestamp_delta_decode(buf, sizeof(buf), 0, &ts));
+}
+
+/**
+ * @brief Test sources don't go backwards, and compare their cost
+ */
+void test_sources(void) {
+  uint64_t prev_cycles = frpp_timestamp_cycles();
+  uint64_t prev_mono = frpp_timestamp_monotonic();
+
+  TEST_ASSERT_TRUE(prev_mono != 0);
+
+  uint64_t start = frpp_timestamp_monotonic();
+
+  for (unsigned int i = 0; i < TEST_BENCH_READS; i++) {
+    uint64_t now = frpp_timestamp_cycles();
+    TEST_ASSERT_TRUE(now >= prev_cycles);
+    prev_cycles = now;
+  }
+
+  uint64_t cycles_ns = frpp_timestamp_monotonic() - start;
+
+  start = frpp_timestamp_monotonic();
+
+  for (unsigned int i = 0; i < TEST_BENCH_READS; i++) {
+    uint64_t now = frpp_timestamp_monotonic();
+    TEST_ASSERT_TRUE(now >= prev_mono);
+    prev_mono = now;
+  }
+
+  uint64_t mono_ns = frpp_timestamp_monotonic() - start;
+
+  printf("frpp_timestamp: cycles %.1f ns/read, monotonic %.1f ns/read\n",
+         (double)cycles_ns / TEST_BENCH_READS,
+         (double)mono_ns / TEST_BENCH_READS);
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Error condition tests
+  RUN_TEST(test_invalid);
+  RUN_TEST(test_delta_malformed);
+
+  // Encoding tests
+  RUN_TEST(test_delta_len);
+  RUN_TEST(test_delta_extremes);
+
+  // Source tests
+  RUN_TEST(test_sources);
+
+  return UNITY_END();
+}
@@ -0,0 +1,500 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_tlsf.c
+ * @author Evan Stoddard
+ * @brief Tests for frpp_tlsf
+ */
+
+#include "unity.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frpp/sys/frpp_printf.h"
+#include "frpp/sys/frpp_timestamp.h"
+#include "frpp/sys/frpp_tlsf.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define TEST_POOL_SIZE (64U * 1024U)
+
+#define TEST_SLOTS (256U)
+
+#define TEST_STRESS_OPS (200000U)
+
+#define TEST_BENCH_OPS (200000U)
+
+/**
+ * @brief Largest package size in the random workload
+ */
+#define TEST_PKG_MAX (400U)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Live allocation in the random workload
+ */
+struct test_slot {
+  uint8_t *ptr;
+  size_t size;
+  uint8_t fill;
+};
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static uint64_t prv_pool[TEST_POOL_SIZE / sizeof(uint64_t)];
+
+static struct frpp_tlsf prv_tlsf;
+
+static struct test_slot prv_slots[TEST_SLOTS];
+
+static uint32_t prv_rand_state;
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {
+  memset(prv_slots, 0, sizeof(prv_slots));
+  prv_rand_state = 0x2545F491U;
+}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+
+/**
+ * @brief Deterministic pseudo-random number
+ *
+ * @return Next number
+ */
+static uint32_t prv_rand(void) {
+  prv_rand_state = prv_rand_state * 1664525U + 1013904223U;
+  return prv_rand_state >> 8;
+}
+
+/**
+ * @brief Random package size, mostly small with a long tail
+ *
+ * @return Size in bytes
+ */
+static size_t prv_rand_size(void) {
+  uint32_t r = prv_rand();
+
+  return (r & 3U) != 0 ? (r >> 2) % 64U : (r >> 2) % (TEST_PKG_MAX + 1U);
+}
+
+/**
+ * @brief Bytes a block costs, as counted by the allocator
+ *
+ * @param ptr Block
+ * @return Cost in bytes
+ */
+static size_t prv_cost(const void *ptr) {
+  return frpp_tlsf_block_size(ptr) + sizeof(uint64_t);
+}
+
+/**
+ * @brief Verify a slot still holds its fill pattern
+ *
+ * @param slot Slot
+ */
+static void prv_check_slot(const struct test_slot *slot) {
+  for (size_t i = 0; i < slot->size; i++) {
+    TEST_ASSERT_EQUAL_HEX8(slot->fill, slot->ptr[i]);
+  }
+}
+
+/**
+ * @brief Run one step of the random workload against a slot
+ *
+ * @param slot Slot
+ */
+static void prv_step(struct test_slot *slot) {
+  if (slot->ptr != NULL) {
+    prv_check_slot(slot);
+    frpp_tlsf_free(&prv_tlsf, slot->ptr);
+    slot->ptr = NULL;
+    return;
+  }
+
+  size_t size = prv_rand_size();
+  uint8_t *ptr = frpp_tlsf_alloc(&prv_tlsf, size);
+
+  if (ptr == NULL) {
+    return;
+  }
+
+  TEST_ASSERT_EQUAL(0, (uintptr_t)ptr % FRPP_TLSF_ALIGN);
+  TEST_ASSERT_TRUE(frpp_tlsf_block_size(ptr) >= size);
+  TEST_ASSERT_TRUE((uint8_t *)ptr >= (uint8_t *)prv_pool);
+  TEST_ASSERT_TRUE((uint8_t *)ptr + size <=
+                   (uint8_t *)prv_pool + sizeof(prv_pool));
+
+  slot->ptr = ptr;
+  slot->size = size;
+  slot->fill = (uint8_t)prv_rand();
+  memset(ptr, slot->fill, size);
+}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test invalid arguments
+ */
+void test_invalid(void) {
+  struct frpp_tlsf_stats stats;
+  void *pkg = NULL;
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_tlsf_init(NULL, prv_pool, 1024));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_tlsf_init(&prv_tlsf, NULL, 1024));
+  TEST_ASSERT_EQUAL(-EINVAL,
+                    frpp_tlsf_init(&prv_tlsf, (uint8_t *)prv_pool + 4, 1024));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_tlsf_init(&prv_tlsf, prv_pool, 16));
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_init(&prv_tlsf, prv_pool, 1024));
+
+  TEST_ASSERT_NULL(frpp_tlsf_alloc(NULL, 8));
+  TEST_ASSERT_NULL(frpp_tlsf_alloc(&prv_tlsf, 1024));
+  TEST_ASSERT_NULL(frpp_tlsf_alloc(&prv_tlsf, SIZE_MAX));
+  frpp_tlsf_free(&prv_tlsf, NULL);
+  frpp_tlsf_free(NULL, prv_pool);
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_tlsf_stats(NULL, &stats));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_tlsf_stats(&prv_tlsf, NULL));
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_stats(&prv_tlsf, &stats));
+  TEST_ASSERT_EQUAL(2, stats.failures);
+  TEST_ASSERT_EQUAL(0, stats.allocs);
+
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_tlsf_package(NULL, &pkg, 0, "%d", 1));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_tlsf_package(&prv_tlsf, NULL, 0, "%d", 1));
+  TEST_ASSERT_EQUAL(-EINVAL, frpp_tlsf_package(&prv_tlsf, &pkg, 0, NULL));
+}
+
+/**
+ * @brief Test blocks are aligned, fit their size and don't overlap
+ */
+void test_alloc_free(void) {
+  uint8_t *blocks[8];
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_init(&prv_tlsf, prv_pool, 4096));
+
+  for (size_t i = 0; i < 8; i++) {
+    blocks[i] = frpp_tlsf_alloc(&prv_tlsf, i * 37U);
+    TEST_ASSERT_NOT_NULL(blocks[i]);
+    TEST_ASSERT_EQUAL(0, (uintptr_t)blocks[i] % FRPP_TLSF_ALIGN);
+    TEST_ASSERT_TRUE(frpp_tlsf_block_size(blocks[i]) >= i * 37U);
+    memset(blocks[i], (int)i, i * 37U);
+  }
+
+  // Neighbours are packed one size field apart
+  for (size_t i = 1; i < 8; i++) {
+    TEST_ASSERT_EQUAL_PTR(blocks[i - 1] + prv_cost(blocks[i - 1]),
+                          blocks[i]);
+  }
+
+  for (size_t i = 0; i < 8; i++) {
+    for (size_t j = 0; j < i * 37U; j++) {
+      TEST_ASSERT_EQUAL_HEX8(i, blocks[i][j]);
+    }
+
+    frpp_tlsf_free(&prv_tlsf, blocks[i]);
+  }
+
+  // A freed block is reused
+  uint8_t *again = frpp_tlsf_alloc(&prv_tlsf, 0);
+  TEST_ASSERT_EQUAL_PTR(blocks[0], again);
+  frpp_tlsf_free(&prv_tlsf, again);
+}
+
+/**
+ * @brief Test freed neighbours merge, so the whole pool is usable again
+ */
+void test_coalesce(void) {
+  struct frpp_tlsf_stats stats;
+  void *blocks[128];
+  size_t count = 0;
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_init(&prv_tlsf, prv_pool, 4096));
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_stats(&prv_tlsf, &stats));
+
+  size_t whole = stats.largest_free;
+  TEST_ASSERT_EQUAL(1, stats.free_blocks);
+  TEST_ASSERT_EQUAL(0, stats.fragmentation);
+  TEST_ASSERT_EQUAL(whole + sizeof(uint64_t), stats.total);
+
+  // The whole pool can be allocated as one block
+  void *big = frpp_tlsf_alloc(&prv_tlsf, whole);
+  TEST_ASSERT_NOT_NULL(big);
+  TEST_ASSERT_NULL(frpp_tlsf_alloc(&prv_tlsf, 0));
+  frpp_tlsf_free(&prv_tlsf, big);
+
+  while (count < 128 &&
+         (blocks[count] = frpp_tlsf_alloc(&prv_tlsf, 56)) != NULL) {
+    count++;
+  }
+
+  TEST_ASSERT_TRUE(count > 32 && count < 128);
+
+  // Free every other block: memory is free but scattered
+  for (size_t i = 0; i < count; i += 2) {
+    frpp_tlsf_free(&prv_tlsf, blocks[i]);
+  }
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_stats(&prv_tlsf, &stats));
+  TEST_ASSERT_TRUE(stats.free_blocks >= count / 2);
+  TEST_ASSERT_TRUE(stats.fragmentation > 90);
+  TEST_ASSERT_TRUE(stats.largest_free < 128);
+  TEST_ASSERT_NULL(frpp_tlsf_alloc(&prv_tlsf, 128));
+
+  // Freeing the rest merges everything back into one block
+  for (size_t i = 1; i < count; i += 2) {
+    frpp_tlsf_free(&prv_tlsf, blocks[i]);
+  }
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_stats(&prv_tlsf, &stats));
+  TEST_ASSERT_EQUAL(1, stats.free_blocks);
+  TEST_ASSERT_EQUAL(whole, stats.largest_free);
+  TEST_ASSERT_EQUAL(0, stats.used);
+
+  big = frpp_tlsf_alloc(&prv_tlsf, whole);
+  TEST_ASSERT_NOT_NULL(big);
+  frpp_tlsf_free(&prv_tlsf, big);
+}
+
+/**
+ * @brief Test usage and high-water mark track allocations
+ */
+void test_stats(void) {
+  struct frpp_tlsf_stats stats;
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_init(&prv_tlsf, prv_pool, 4096));
+
+  void *a = frpp_tlsf_alloc(&prv_tlsf, 100);
+  void *b = frpp_tlsf_alloc(&prv_tlsf, 300);
+  size_t peak = prv_cost(a) + prv_cost(b);
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_stats(&prv_tlsf, &stats));
+  TEST_ASSERT_EQUAL(peak, stats.used);
+  TEST_ASSERT_EQUAL(peak, stats.high_water);
+  TEST_ASSERT_EQUAL(stats.total - peak, stats.free);
+  TEST_ASSERT_EQUAL(2, stats.allocs);
+
+  frpp_tlsf_free(&prv_tlsf, b);
+  void *c = frpp_tlsf_alloc(&prv_tlsf, 8);
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_stats(&prv_tlsf, &stats));
+  TEST_ASSERT_EQUAL(prv_cost(a) + prv_cost(c), stats.used);
+  TEST_ASSERT_EQUAL(peak, stats.high_water);
+  TEST_ASSERT_EQUAL(3, stats.allocs);
+  TEST_ASSERT_EQUAL(1, stats.frees);
+
+  frpp_tlsf_free(&prv_tlsf, a);
+  frpp_tlsf_free(&prv_tlsf, c);
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_stats(&prv_tlsf, &stats));
+  TEST_ASSERT_EQUAL(0, stats.used);
+  TEST_ASSERT_EQUAL(stats.total, stats.free);
+  TEST_ASSERT_EQUAL(peak, stats.high_water);
+  TEST_ASSERT_EQUAL(0, stats.failures);
+}
+
+/**
+ * @brief Test a long random workload keeps every block intact and the
+ * counters consistent with the blocks handed out
+ */
+void test_stress(void) {
+  struct frpp_tlsf_stats stats;
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_init(&prv_tlsf, prv_pool, sizeof(prv_pool)));
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_stats(&prv_tlsf, &stats));
+
+  size_t whole = stats.largest_free;
+
+  for (uint32_t op = 0; op < TEST_STRESS_OPS; op++) {
+    prv_step(&prv_slots[prv_rand() % TEST_SLOTS]);
+
+    if (op % 10000U != 0) {
+      continue;
+    }
+
+    size_t used = 0;
+
+    for (size_t i = 0; i < TEST_SLOTS; i++) {
+      if (prv_slots[i].ptr != NULL) {
+        prv_check_slot(&prv_slots[i]);
+        used += prv_cost(prv_slots[i].ptr);
+      }
+    }
+
+    TEST_ASSERT_EQUAL(0, frpp_tlsf_stats(&prv_tlsf, &stats));
+    TEST_ASSERT_EQUAL(used, stats.used);
+    TEST_ASSERT_TRUE(stats.high_water >= used);
+  }
+
+  for (size_t i = 0; i < TEST_SLOTS; i++) {
+    if (prv_slots[i].ptr != NULL) {
+      prv_step(&prv_slots[i]);
+    }
+  }
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_stats(&prv_tlsf, &stats));
+  TEST_ASSERT_EQUAL(0, stats.used);
+  TEST_ASSERT_EQUAL(1, stats.free_blocks);
+  TEST_ASSERT_EQUAL(whole, stats.largest_free);
+  TEST_ASSERT_EQUAL(stats.allocs, stats.frees);
+
+  printf("frpp_tlsf: %zu allocs, high water %zu of %zu bytes\n",
+         stats.allocs, stats.high_water, stats.total);
+}
+
+/**
+ * @brief Test packages are sized exactly, render after their arguments are
+ * gone, and report exhaustion
+ */
+void test_package(void) {
+  struct frpp_tlsf_stats stats;
+  char name[8] = "pump";
+  char out[64];
+  void *pkg = NULL;
+  uint32_t flags = FRPP_PRINTF_FLAG_CAPTURE_STR;
+  const char *fmt = "%s at %d rpm, %u%%";
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_init(&prv_tlsf, prv_pool, 512));
+
+  int len = frpp_tlsf_package(&prv_tlsf, &pkg, flags, fmt, name, 1200, 85U);
+  TEST_ASSERT_TRUE(len > 0);
+  TEST_ASSERT_EQUAL(frpp_printf_package(NULL, 0, flags, fmt, name, 1200, 85U),
+                    len);
+  TEST_ASSERT_TRUE(frpp_tlsf_block_size(pkg) >= (size_t)len);
+  TEST_ASSERT_TRUE(frpp_tlsf_block_size(pkg) < (size_t)len + 32U);
+
+  memset(name, 0, sizeof(name));
+  frpp_snprintf_ex(fmt, flags, pkg, out, sizeof(out));
+  TEST_ASSERT_EQUAL_STRING("pump at 1200 rpm, 85%", out);
+  frpp_tlsf_free(&prv_tlsf, pkg);
+
+  // Packages without arguments still get a block to free
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_package(&prv_tlsf, &pkg, 0, "idle"));
+  TEST_ASSERT_NOT_NULL(pkg);
+  frpp_tlsf_free(&prv_tlsf, pkg);
+
+  int count = 0;
+  int ret;
+
+  while ((ret = frpp_tlsf_package(&prv_tlsf, &pkg, 0, "%d %d", 1, 2)) >= 0) {
+    count++;
+  }
+
+  TEST_ASSERT_EQUAL(-ENOMEM, ret);
+  TEST_ASSERT_TRUE(count > 4);
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_stats(&prv_tlsf, &stats));
+  TEST_ASSERT_EQUAL(1, stats.failures);
+}
+
+/**
+ * @brief Compare worst-case cost of the random workload against malloc
+ */
+void test_bench(void) {
+  uint64_t tlsf_max = 0;
+  uint64_t tlsf_sum = 0;
+  uint64_t libc_max = 0;
+  uint64_t libc_sum = 0;
+
+  TEST_ASSERT_EQUAL(0, frpp_tlsf_init(&prv_tlsf, prv_pool, sizeof(prv_pool)));
+
+  for (uint32_t op = 0; op < TEST_BENCH_OPS; op++) {
+    struct test_slot *slot = &prv_slots[prv_rand() % TEST_SLOTS];
+    size_t size = prv_rand_size();
+    uint64_t start = frpp_timestamp_cycles();
+
+    if (slot->ptr != NULL) {
+      frpp_tlsf_free(&prv_tlsf, slot->ptr);
+      slot->ptr = NULL;
+    } else {
+      slot->ptr = frpp_tlsf_alloc(&prv_tlsf, size);
+    }
+
+    uint64_t cycles = frpp_timestamp_cycles() - start;
+
+    tlsf_sum += cycles;
+    tlsf_max = cycles > tlsf_max ? cycles : tlsf_max;
+  }
+
+  memset(prv_slots, 0, sizeof(prv_slots));
+  prv_rand_state = 0x2545F491U;
+
+  for (uint32_t op = 0; op < TEST_BENCH_OPS; op++) {
+    struct test_slot *slot = &prv_slots[prv_rand() % TEST_SLOTS];
+    size_t size = prv_rand_size();
+    uint64_t start = frpp_timestamp_cycles();
+
+    if (slot->ptr != NULL) {
+      free(slot->ptr);
+      slot->ptr = NULL;
+    } else {
+      slot->ptr = malloc(size);
+    }
+
+    uint64_t cycles = frpp_timestamp_cycles() - start;
+
+    libc_sum += cycles;
+    libc_max = cycles > libc_max ? cycles : libc_max;
+  }
+
+  for (size_t i = 0; i < TEST_SLOTS; i++) {
+    free(prv_slots[i].ptr);
+  }
+
+  // Maxima include preemption on a host; on target they bound the call
+  printf("frpp_tlsf: avg %.1f max %llu cycles/op, malloc avg %.1f max %llu\n",
+         (double)tlsf_sum / TEST_BENCH_OPS, (unsigned long long)tlsf_max,
+         (double)libc_sum / TEST_BENCH_OPS, (unsigned long long)libc_max);
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Error condition tests
+  RUN_TEST(test_invalid);
+
+  // Allocation tests
+  RUN_TEST(test_alloc_free);
+  RUN_TEST(test_coalesce);
+  RUN_TEST(test_stats);
+  RUN_TEST(test_stress);
+
+  // Package tests
+  RUN_TEST(test_package);
+
+  // Benchmarks
+  RUN_TEST(test_bench);
+
+  return UNITY_END();
+}
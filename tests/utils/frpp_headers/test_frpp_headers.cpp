@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file test_frpp_headers.cpp
+ * @author Evan Stoddard
+ * @brief Tests every public header builds as C++, and that structs with
+ * atomic members work when set up from C++
+ */
+
+#include "unity.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "frpp/logging/frpp_log.h"
+#include "frpp/logging/frpp_log_dict.h"
+#include "frpp/logging/frpp_log_fmt.h"
+#include "frpp/logging/frpp_log_lanes.h"
+#include "frpp/logging/frpp_log_mmap.h"
+#include "frpp/logging/frpp_log_queue.h"
+#include "frpp/logging/frpp_log_retain.h"
+#include "frpp/shell/frpp_shell.h"
+#include "frpp/shell/frpp_shell_arg.h"
+#include "frpp/shell/frpp_shell_line.h"
+#include "frpp/shell/frpp_shell_out.h"
+#include "frpp/shell/frpp_shell_table.hpp"
+#include "frpp/sys/frpp_formatter.hpp"
+#include "frpp/sys/frpp_package.hpp"
+#include "frpp/sys/frpp_printf.h"
+#include "frpp/sys/frpp_printf_cache.h"
+#include "frpp/sys/frpp_printf_parse.h"
+#include "frpp/sys/frpp_printf_stats.h"
+#include "frpp/sys/frpp_timestamp.h"
+#include "frpp/sys/frpp_tlsf.h"
+#include "frpp/utils/atomic.h"
+#include "frpp/utils/utils.h"
+
+/*****************************************************************************
+ * Compile-time Checks
+ *****************************************************************************/
+
+// Structs with atomic members are shared between C and C++ translation units
+static_assert(sizeof(FRPP_ATOMIC(size_t)) == sizeof(size_t));
+static_assert(alignof(FRPP_ATOMIC(size_t)) == alignof(size_t));
+static_assert(sizeof(FRPP_ATOMIC(bool)) == sizeof(bool));
+static_assert(sizeof(FRPP_ATOMIC(uint8_t)) == sizeof(uint8_t));
+static_assert(FRPP_ATOMIC(size_t)::is_always_lock_free);
+static_assert(alignof(struct frpp_log_lane) == FRPP_LOG_LANES_CACHE_LINE);
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Queue storage
+ */
+alignas(FRPP_LOG_QUEUE_ALIGN) static uint8_t prv_queue_buf[256];
+
+/**
+ * @brief Log module defined in C++
+ */
+FRPP_LOG_MODULE_DEFINE(cpp, FRPP_LOG_LEVEL_INFO);
+
+/*****************************************************************************
+ * Setup/Teardown
+ *****************************************************************************/
+
+/**
+ * @brief Setup Code called before every test
+ */
+void setUp(void) {}
+
+/**
+ * @brief Tear down code run after each test
+ */
+void tearDown(void) {}
+
+/*****************************************************************************
+ * Tests
+ *****************************************************************************/
+
+/**
+ * @brief Test queue set up and filled from C++ is drained by the C consumer
+ */
+void test_queue(void) {
+  struct frpp_log_queue queue;
+  char out_buf[64];
+
+  TEST_ASSERT_EQUAL(
+      0, frpp_log_queue_init(&queue, prv_queue_buf, sizeof(prv_queue_buf)));
+  TEST_ASSERT_EQUAL(0, FRPP_LOG_QUEUE_PRINTF(&queue, "cpp %d %s", 7, "ok"));
+
+  int ret = frpp_log_queue_render(&queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL(8, ret);
+  TEST_ASSERT_EQUAL_STRING("cpp 7 ok", out_buf);
+
+  ret = frpp_log_queue_render(&queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL(-EAGAIN, ret);
+}
+
+/**
+ * @brief Test module defined in C++ logs through the level filter
+ */
+void test_log_module(void) {
+  struct frpp_log_queue queue;
+  char out_buf[64];
+
+  TEST_ASSERT_EQUAL(
+      0, frpp_log_queue_init(&queue, prv_queue_buf, sizeof(prv_queue_buf)));
+  TEST_ASSERT_EQUAL(0, frpp_log_init(&queue));
+
+  TEST_ASSERT_EQUAL_PTR(FRPP_LOG_MODULE(cpp), frpp_log_module_find("cpp"));
+  TEST_ASSERT_EQUAL(FRPP_LOG_LEVEL_INFO,
+                    frpp_log_module_get_level(FRPP_LOG_MODULE(cpp)));
+
+  FRPP_LOG_INF(cpp, "up %d", 3);
+  TEST_ASSERT_EQUAL(0, frpp_log_module_set_level(FRPP_LOG_MODULE(cpp),
+                                                 FRPP_LOG_LEVEL_ERROR));
+  FRPP_LOG_WRN(cpp, "filtered");
+
+  int ret = frpp_log_queue_render(&queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_GREATER_THAN(0, ret);
+  TEST_ASSERT_EQUAL_STRING("I [cpp] up 3", out_buf);
+
+  ret = frpp_log_queue_render(&queue, out_buf, sizeof(out_buf));
+  TEST_ASSERT_EQUAL(-EAGAIN, ret);
+}
+
+/**
+ * @brief Test lanes set up and filled from C++ are merged by the C consumer
+ */
+void test_lanes(void) {
+  alignas(FRPP_LOG_LANES_ALIGN) static uint8_t buf[2][128];
+  static struct frpp_log_lane lane[2];
+  static struct frpp_log_lanes lanes;
+  char out_buf[64];
+
+  for (size_t i = 0; i < 2; i++) {
+    TEST_ASSERT_EQUAL(0, frpp_log_lane_init(&lane[i], buf[i], sizeof(buf[i])));
+  }
+
+  TEST_ASSERT_EQUAL(0, frpp_log_lanes_init(&lanes, lane, 2,
+                                           frpp_timestamp_cycles));
+  TEST_ASSERT_EQUAL(0, FRPP_LOG_LANE_PRINTF(&lane[1], "first %d", 1));
+  TEST_ASSERT_EQUAL(0, FRPP_LOG_LANE_PRINTF(&lane[0], "second %d", 2));
+
+  int ret = frpp_log_lanes_render(&lanes, out_buf, sizeof(out_buf), NULL);
+  TEST_ASSERT_GREATER_THAN(0, ret);
+  TEST_ASSERT_EQUAL_STRING("first 1", out_buf);
+
+  ret = frpp_log_lanes_render(&lanes, out_buf, sizeof(out_buf), NULL);
+  TEST_ASSERT_GREATER_THAN(0, ret);
+  TEST_ASSERT_EQUAL_STRING("second 2", out_buf);
+}
+
+/**
+ * @brief Test line editor set up and fed from C++ hands over its line
+ */
+void test_shell_line(void) {
+  static struct frpp_shell_line line;
+  char echo[32];
+
+  TEST_ASSERT_EQUAL(0, frpp_shell_line_init(&line, "> "));
+
+  for (const char *c = "hi"; *c; c++) {
+    TEST_ASSERT_EQUAL(0, frpp_shell_line_feed(&line, (uint8_t)*c));
+  }
+
+  TEST_ASSERT_EQUAL(FRPP_SHELL_LINE_READY, frpp_shell_line_feed(&line, '\r'));
+  TEST_ASSERT_EQUAL_STRING("hi", frpp_shell_line_get(&line));
+
+  size_t len = frpp_shell_line_echo(&line, echo, sizeof(echo) - 1);
+  echo[len] = '\0';
+  TEST_ASSERT_EQUAL_STRING("> hi\r\n", echo);
+}
+
+/**
+ * @brief Runner
+ *
+ * @return Return status (non-zero if any test failed)
+ */
+int main(void) {
+  UNITY_BEGIN();
+
+  // Logging tests
+  RUN_TEST(test_queue);
+  RUN_TEST(test_log_module);
+  RUN_TEST(test_lanes);
+
+  // Shell tests
+  RUN_TEST(test_shell_line);
+
+  return UNITY_END();
+}
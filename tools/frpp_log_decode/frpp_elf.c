@@ -0,0 +1,302 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_elf.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp_elf.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define FRPP_ELF_EI_CLASS (4U)
+#define FRPP_ELF_EI_DATA (5U)
+#define FRPP_ELF_CLASS64 (2U)
+#define FRPP_ELF_DATA2MSB (2U)
+
+#define FRPP_ELF_SHT_PROGBITS (1U)
+#define FRPP_ELF_SHT_SYMTAB (2U)
+
+#define FRPP_ELF_SHF_WRITE (1U << 0)
+#define FRPP_ELF_SHF_ALLOC (1U << 1)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Section header fields used by the reader, independent of class
+ */
+struct prv_shdr {
+  uint32_t name;
+  uint32_t type;
+  uint64_t flags;
+  uint64_t addr;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t link;
+  uint64_t entsize;
+};
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Read unsigned integer of ELF's byte order
+ *
+ * @param elf ELF instance
+ * @param off Offset into file
+ * @param len Width of integer in bytes
+ * @return Value, or 0 if out of range
+ */
+static uint64_t prv_read(const struct frpp_elf *elf, uint64_t off,
+                         size_t len) {
+  uint64_t val = 0;
+
+  if (off > elf->size || len > elf->size - off) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    size_t idx = elf->big_endian ? i : (len - 1 - i);
+    val = (val << 8) | elf->data[off + idx];
+  }
+
+  return val;
+}
+
+/**
+ * @brief Number of section headers
+ *
+ * @param elf ELF instance
+ * @return Section count
+ */
+static size_t prv_shnum(const struct frpp_elf *elf) {
+  return (size_t)prv_read(elf, elf->is64 ? 0x3C : 0x30, 2);
+}
+
+/**
+ * @brief Read section header
+ *
+ * @param elf ELF instance
+ * @param idx Section index
+ * @param shdr Section header output
+ * @return true if section header is within file
+ */
+static bool prv_shdr(const struct frpp_elf *elf, size_t idx,
+                     struct prv_shdr *shdr) {
+  uint64_t shoff = prv_read(elf, elf->is64 ? 0x28 : 0x20, elf->is64 ? 8 : 4);
+  uint64_t shentsize = prv_read(elf, elf->is64 ? 0x3A : 0x2E, 2);
+  uint64_t base = shoff + (idx * shentsize);
+
+  if (shoff == 0 || base + shentsize > elf->size) {
+    return false;
+  }
+
+  if (elf->is64) {
+    shdr->name = (uint32_t)prv_read(elf, base + 0x00, 4);
+    shdr->type = (uint32_t)prv_read(elf, base + 0x04, 4);
+    shdr->flags = prv_read(elf, base + 0x08, 8);
+    shdr->addr = prv_read(elf, base + 0x10, 8);
+    shdr->offset = prv_read(elf, base + 0x18, 8);
+    shdr->size = prv_read(elf, base + 0x20, 8);
+    shdr->link = (uint32_t)prv_read(elf, base + 0x28, 4);
+    shdr->entsize = prv_read(elf, base + 0x38, 8);
+  } else {
+    shdr->name = (uint32_t)prv_read(elf, base + 0x00, 4);
+    shdr->type = (uint32_t)prv_read(elf, base + 0x04, 4);
+    shdr->flags = prv_read(elf, base + 0x08, 4);
+    shdr->addr = prv_read(elf, base + 0x0C, 4);
+    shdr->offset = prv_read(elf, base + 0x10, 4);
+    shdr->size = prv_read(elf, base + 0x14, 4);
+    shdr->link = (uint32_t)prv_read(elf, base + 0x18, 4);
+    shdr->entsize = prv_read(elf, base + 0x24, 4);
+  }
+
+  return shdr->offset <= elf->size && shdr->size <= elf->size - shdr->offset;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_elf_load(struct frpp_elf *elf, const char *path) {
+  if (elf == NULL || path == NULL) {
+    return -EINVAL;
+  }
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return -errno;
+  }
+
+  int ret = 0;
+  long size = -1;
+  if (fseek(file, 0, SEEK_END) == 0) {
+    size = ftell(file);
+  }
+
+  if (size <= 0 || fseek(file, 0, SEEK_SET) != 0) {
+    fclose(file);
+    return -EIO;
+  }
+
+  elf->data = malloc((size_t)size);
+  elf->size = (size_t)size;
+  if (elf->data == NULL) {
+    fclose(file);
+    return -ENOMEM;
+  }
+
+  if (fread(elf->data, 1, elf->size, file) != elf->size) {
+    ret = -EIO;
+  }
+
+  fclose(file);
+
+  if (ret == 0 &&
+      (elf->size < 0x34 || memcmp(elf->data, "\177ELF", 4) != 0)) {
+    ret = -EINVAL;
+  }
+
+  if (ret != 0) {
+    frpp_elf_free(elf);
+    return ret;
+  }
+
+  elf->is64 = elf->data[FRPP_ELF_EI_CLASS] == FRPP_ELF_CLASS64;
+  elf->big_endian = elf->data[FRPP_ELF_EI_DATA] == FRPP_ELF_DATA2MSB;
+
+  return 0;
+}
+
+void frpp_elf_free(struct frpp_elf *elf) {
+  if (elf == NULL) {
+    return;
+  }
+
+  free(elf->data);
+  elf->data = NULL;
+  elf->size = 0;
+}
+
+int frpp_elf_symbol(const struct frpp_elf *elf, const char *name,
+                    uint64_t *addr) {
+  if (elf == NULL || name == NULL || addr == NULL) {
+    return -EINVAL;
+  }
+
+  size_t name_len = strlen(name);
+  size_t shnum = prv_shnum(elf);
+
+  for (size_t i = 0; i < shnum; i++) {
+    struct prv_shdr symtab;
+    struct prv_shdr strtab;
+
+    if (!prv_shdr(elf, i, &symtab) || symtab.type != FRPP_ELF_SHT_SYMTAB ||
+        symtab.entsize == 0 || !prv_shdr(elf, symtab.link, &strtab)) {
+      continue;
+    }
+
+    for (uint64_t off = 0; off + symtab.entsize <= symtab.size;
+         off += symtab.entsize) {
+      uint64_t sym = symtab.offset + off;
+      uint64_t str = strtab.offset + prv_read(elf, sym, 4);
+
+      if (str + name_len + 1 > strtab.offset + strtab.size ||
+          memcmp(&elf->data[str], name, name_len + 1) != 0) {
+        continue;
+      }
+
+      *addr = elf->is64 ? prv_read(elf, sym + 0x08, 8)
+                        : prv_read(elf, sym + 0x04, 4);
+      return 0;
+    }
+  }
+
+  return -ENOENT;
+}
+
+int frpp_elf_section(const struct frpp_elf *elf, const char *name,
+                     uint64_t *addr, uint64_t *size) {
+  if (elf == NULL || name == NULL || addr == NULL || size == NULL) {
+    return -EINVAL;
+  }
+
+  size_t name_len = strlen(name);
+  size_t shnum = prv_shnum(elf);
+  struct prv_shdr strtab;
+
+  if (!prv_shdr(elf, (size_t)prv_read(elf, elf->is64 ? 0x3E : 0x32, 2),
+                &strtab)) {
+    return -ENOENT;
+  }
+
+  for (size_t i = 0; i < shnum; i++) {
+    struct prv_shdr shdr;
+
+    if (!prv_shdr(elf, i, &shdr)) {
+      continue;
+    }
+
+    uint64_t str = strtab.offset + shdr.name;
+    if (str + name_len + 1 > strtab.offset + strtab.size ||
+        memcmp(&elf->data[str], name, name_len + 1) != 0) {
+      continue;
+    }
+
+    *addr = shdr.addr;
+    *size = shdr.size;
+    return 0;
+  }
+
+  return -ENOENT;
+}
+
+const uint8_t *frpp_elf_ro_data(const struct frpp_elf *elf, uint64_t addr,
+                                size_t *room) {
+  if (elf == NULL || room == NULL) {
+    return NULL;
+  }
+
+  size_t shnum = prv_shnum(elf);
+
+  for (size_t i = 0; i < shnum; i++) {
+    struct prv_shdr shdr;
+
+    if (!prv_shdr(elf, i, &shdr) || shdr.type != FRPP_ELF_SHT_PROGBITS ||
+        (shdr.flags & FRPP_ELF_SHF_ALLOC) == 0 ||
+        (shdr.flags & FRPP_ELF_SHF_WRITE) != 0) {
+      continue;
+    }
+
+    if (addr < shdr.addr || addr - shdr.addr >= shdr.size) {
+      continue;
+    }
+
+    uint64_t off = addr - shdr.addr;
+    *room = (size_t)(shdr.size - off);
+
+    return &elf->data[shdr.offset + off];
+  }
+
+  return NULL;
+}
+
+const char *frpp_elf_ro_string(const struct frpp_elf *elf, uint64_t addr) {
+  size_t room = 0;
+  const char *str = (const char *)frpp_elf_ro_data(elf, addr, &room);
+
+  return (str != NULL && memchr(str, '\0', room) != NULL) ? str : NULL;
+}
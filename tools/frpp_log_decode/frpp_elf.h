@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_elf.h
+ * @author Evan Stoddard
+ * @brief Minimal ELF reader for the dictionary log decoder.  Only what's
+ * needed to look up symbols and read strings out of read-only sections.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef frpp_elf_h
+#define frpp_elf_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Loaded ELF image.  Treat members as private.
+ */
+struct frpp_elf {
+  /* Contents of file */
+  uint8_t *data;
+
+  /* Size of file */
+  size_t size;
+
+  /* ELFCLASS64 */
+  bool is64;
+
+  /* ELFDATA2MSB */
+  bool big_endian;
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Load ELF file
+ *
+ * @param elf ELF instance
+ * @param path Path to file
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments or not an ELF file
+ * @retval -ENOMEM Out of memory
+ * @retval Negative errno from opening or reading file
+ */
+int frpp_elf_load(struct frpp_elf *elf, const char *path);
+
+/**
+ * @brief Free ELF loaded with frpp_elf_load
+ *
+ * @param elf ELF instance
+ */
+void frpp_elf_free(struct frpp_elf *elf);
+
+/**
+ * @brief Look up address of a symbol in the symbol table
+ *
+ * @param elf ELF instance
+ * @param name Symbol name
+ * @param addr Address output
+ * @retval 0 Success
+ * @retval -ENOENT Symbol not found or ELF has no symbol table
+ */
+int frpp_elf_symbol(const struct frpp_elf *elf, const char *name,
+                    uint64_t *addr);
+
+/**
+ * @brief Look up address and size of a section by name
+ *
+ * @param elf ELF instance
+ * @param name Section name
+ * @param addr Address output
+ * @param size Size output
+ * @retval 0 Success
+ * @retval -ENOENT Section not found
+ */
+int frpp_elf_section(const struct frpp_elf *elf, const char *name,
+                     uint64_t *addr, uint64_t *size);
+
+/**
+ * @brief Get data at address in an allocated, read-only section
+ *
+ * @param elf ELF instance
+ * @param addr Link time address of data
+ * @param room Output of bytes from addr to the end of its section
+ * @return Pointer to data within ELF image, or NULL if address isn't in a
+ * read-only section
+ */
+const uint8_t *frpp_elf_ro_data(const struct frpp_elf *elf, uint64_t addr,
+                                size_t *room);
+
+/**
+ * @brief Get NULL terminated string at address in an allocated, read-only
+ * section
+ *
+ * @param elf ELF instance
+ * @param addr Link time address of string
+ * @return Pointer to string within ELF image, or NULL if address isn't in a
+ * read-only section or the string isn't terminated within it
+ */
+const char *frpp_elf_ro_string(const struct frpp_elf *elf, uint64_t addr);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_elf_h */
@@ -0,0 +1,817 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_decode.c
+ * @author Evan Stoddard
+ * @brief
+ */
+
+#include "frpp_log_decode.h"
+
+#include <errno.h>
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "frpp/logging/frpp_log_dict.h"
+#include "frpp/logging/frpp_log_fmt.h"
+#include "frpp/sys/frpp_printf.h"
+#include "frpp/sys/frpp_printf_parse.h"
+#include "frpp/utils/utils.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Size of sync frame payload before the anchor address
+ */
+#define FRPP_LOG_DECODE_SYNC_FIXED (14U)
+
+/**
+ * @brief Largest host package a record can be translated to
+ */
+#define FRPP_LOG_DECODE_PKG_MAX (512U)
+
+/**
+ * @brief Largest host encoding of a single value
+ */
+#define FRPP_LOG_DECODE_VALUE_MAX                                              \
+  FRPP_MAX(sizeof(long double), sizeof(uint64_t))
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Record being translated
+ */
+struct prv_record {
+  /* Target package */
+  const uint8_t *pkg;
+  size_t pkg_len;
+
+  /* Host package */
+  uint8_t *out;
+  size_t out_len;
+
+  /* Offsets into pkg and out */
+  size_t src;
+  size_t dst;
+
+  /* Entries of the decoder's unresolved used */
+  size_t unresolved;
+
+  /* Characters of the decoder's wide used */
+  size_t wide;
+};
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Read unsigned integer in target byte order
+ *
+ * @param target Target description
+ * @param src Source bytes
+ * @param len Width of integer in bytes
+ * @return Value
+ */
+static uint64_t prv_read(const struct frpp_log_decode_target *target,
+                         const uint8_t *src, size_t len) {
+  uint64_t val = 0;
+
+  for (size_t i = 0; i < len; i++) {
+    size_t idx = target->big_endian ? i : (len - 1 - i);
+    val = (val << 8) | src[idx];
+  }
+
+  return val;
+}
+
+/**
+ * @brief Sign extend integer of given width
+ *
+ * @param val Value
+ * @param len Width of value in bytes
+ * @return Sign extended value
+ */
+static int64_t prv_sign_extend(uint64_t val, size_t len) {
+  if (len >= sizeof(val)) {
+    return (int64_t)val;
+  }
+
+  uint64_t sign = (uint64_t)1 << ((len * 8) - 1);
+
+  return (int64_t)((val ^ sign) - sign);
+}
+
+/**
+ * @brief Determine if host is big endian
+ *
+ * @return true if big endian
+ */
+static bool prv_host_big_endian(void) {
+  const uint16_t probe = 1;
+  uint8_t first;
+
+  memcpy(&first, &probe, sizeof(first));
+
+  return first == 0;
+}
+
+/**
+ * @brief Size of an argument on target, before slot alignment
+ *
+ * @param target Target description
+ * @param arg Argument type
+ * @return Size in bytes
+ */
+static size_t prv_target_size(const struct frpp_log_decode_target *target,
+                              frpp_printf_arg_t arg) {
+  switch (arg) {
+  case FRPP_PRINTF_ARG_INT:
+    return 4;
+  case FRPP_PRINTF_ARG_LONG:
+    return target->long_size;
+  case FRPP_PRINTF_ARG_LONG_LONG:
+  case FRPP_PRINTF_ARG_INTMAX:
+  case FRPP_PRINTF_ARG_DOUBLE:
+    return 8;
+  case FRPP_PRINTF_ARG_SIZE:
+  case FRPP_PRINTF_ARG_PTRDIFF:
+  case FRPP_PRINTF_ARG_STR:
+  case FRPP_PRINTF_ARG_PTR:
+  case FRPP_PRINTF_ARG_WSTR:
+    return target->ptr_size;
+  case FRPP_PRINTF_ARG_WINT:
+    return target->wint_size;
+  case FRPP_PRINTF_ARG_LONG_DOUBLE:
+    return target->long_double_size;
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief Translate a target address to its link time address in the ELF
+ *
+ * @param dec Decoder instance
+ * @param addr Target address
+ * @return Link time address
+ */
+static uint64_t prv_relocate(const struct frpp_log_decoder *dec,
+                             uint64_t addr) {
+  int64_t delta = prv_sign_extend(addr - dec->target.anchor,
+                                  dec->target.ptr_size);
+
+  return dec->anchor + (uint64_t)delta;
+}
+
+/**
+ * @brief Host string for a %s argument.  Strings that aren't in the ELF are
+ * shown by address.
+ *
+ * @param dec Decoder instance
+ * @param rec Record being translated
+ * @param raw Target address
+ * @return Host string, NULL if target string was NULL
+ */
+static const char *prv_string(struct frpp_log_decoder *dec,
+                              struct prv_record *rec, uint64_t raw) {
+  if (raw == 0) {
+    return NULL;
+  }
+
+  const char *host = frpp_elf_ro_string(dec->elf, prv_relocate(dec, raw));
+  if (host != NULL) {
+    return host;
+  }
+
+  if (rec->unresolved >= FRPP_LOG_DECODE_MAX_UNRESOLVED) {
+    return "<?>";
+  }
+
+  char *text = dec->unresolved[rec->unresolved++];
+  snprintf(text, sizeof(dec->unresolved[0]), "<0x%llx>",
+           (unsigned long long)raw);
+
+  return text;
+}
+
+/**
+ * @brief Host string for a %ls argument, converted from the target's wchar_t
+ * into the decoder.  Strings that aren't in the ELF are shown by address.
+ *
+ * @param dec Decoder instance
+ * @param rec Record being translated
+ * @param raw Target address
+ * @return Host string, NULL if target string was NULL
+ */
+static const wchar_t *prv_wstring(struct frpp_log_decoder *dec,
+                                  struct prv_record *rec, uint64_t raw) {
+  const struct frpp_log_decode_target *target = &dec->target;
+  size_t avail = FRPP_LOG_DECODE_WIDE_MAX - rec->wide;
+  wchar_t *str = &dec->wide[rec->wide];
+  size_t room = 0;
+  size_t len = 0;
+
+  if (raw == 0) {
+    return NULL;
+  }
+
+  if (avail == 0) {
+    return L"<?>";
+  }
+
+  const uint8_t *src =
+      frpp_elf_ro_data(dec->elf, prv_relocate(dec, raw), &room);
+
+  // Only shown if terminated within its section
+  for (size_t i = 0; src != NULL; i++) {
+    if ((i + 1) * target->wchar_size > room) {
+      src = NULL;
+      break;
+    }
+
+    uint64_t c = prv_read(target, &src[i * target->wchar_size],
+                          target->wchar_size);
+    if (c == 0) {
+      break;
+    }
+
+    if (len + 1 < avail) {
+      str[len++] = (wchar_t)c;
+    }
+  }
+
+  if (src == NULL) {
+    char text[sizeof(dec->unresolved[0])];
+    snprintf(text, sizeof(text), "<0x%llx>", (unsigned long long)raw);
+
+    for (len = 0; text[len] != '\0' && len + 1 < avail; len++) {
+      str[len] = (wchar_t)text[len];
+    }
+  }
+
+  str[len] = L'\0';
+  rec->wide += len + 1;
+
+  return str;
+}
+
+/**
+ * @brief Convert a single value from its target encoding to its host one
+ *
+ * @param dec Decoder instance
+ * @param rec Record being translated
+ * @param arg Argument type
+ * @param conversion Conversion character of specifier, 0 if unknown
+ * @param src Target value, prv_target_size bytes
+ * @param host Host value output, FRPP_LOG_DECODE_VALUE_MAX bytes
+ * @retval Positive Size of host value
+ * @retval -ENOTSUP Value can't be converted to the host
+ */
+static int prv_value(struct frpp_log_decoder *dec, struct prv_record *rec,
+                     frpp_printf_arg_t arg, char conversion,
+                     const uint8_t *src, uint8_t *host) {
+  const struct frpp_log_decode_target *target = &dec->target;
+  size_t size = prv_target_size(target, arg);
+  uint64_t raw = (size <= sizeof(uint64_t)) ? prv_read(target, src, size) : 0;
+  int64_t val = prv_sign_extend(raw, size);
+
+  switch (arg) {
+  case FRPP_PRINTF_ARG_INT: {
+    int v = (int)val;
+    memcpy(host, &v, sizeof(v));
+    return (int)sizeof(v);
+  }
+  case FRPP_PRINTF_ARG_LONG: {
+    long v = (long)val;
+    memcpy(host, &v, sizeof(v));
+    return (int)sizeof(v);
+  }
+  case FRPP_PRINTF_ARG_LONG_LONG: {
+    long long v = (long long)val;
+    memcpy(host, &v, sizeof(v));
+    return (int)sizeof(v);
+  }
+  case FRPP_PRINTF_ARG_SIZE: {
+    size_t v = (size_t)raw;
+    memcpy(host, &v, sizeof(v));
+    return (int)sizeof(v);
+  }
+  case FRPP_PRINTF_ARG_PTRDIFF: {
+    ptrdiff_t v = (ptrdiff_t)val;
+    memcpy(host, &v, sizeof(v));
+    return (int)sizeof(v);
+  }
+  case FRPP_PRINTF_ARG_INTMAX: {
+    intmax_t v = (intmax_t)val;
+    memcpy(host, &v, sizeof(v));
+    return (int)sizeof(v);
+  }
+  case FRPP_PRINTF_ARG_WINT: {
+    wint_t v = (wint_t)raw;
+    memcpy(host, &v, sizeof(v));
+    return (int)sizeof(v);
+  }
+  case FRPP_PRINTF_ARG_DOUBLE: {
+    double v;
+    memcpy(&v, &raw, sizeof(v));
+    memcpy(host, &v, sizeof(v));
+    return (int)sizeof(v);
+  }
+  case FRPP_PRINTF_ARG_LONG_DOUBLE: {
+    long double v;
+
+    // Targets whose long double is a double, or that share the host's format
+    if (target->long_double_mant_dig == DBL_MANT_DIG &&
+        size == sizeof(double)) {
+      double d;
+      memcpy(&d, &raw, sizeof(d));
+      v = d;
+    } else if (target->long_double_mant_dig == LDBL_MANT_DIG &&
+               size == sizeof(long double) &&
+               target->big_endian == prv_host_big_endian()) {
+      memcpy(&v, src, sizeof(v));
+    } else {
+      return -ENOTSUP;
+    }
+
+    memcpy(host, &v, sizeof(v));
+    return (int)sizeof(v);
+  }
+  case FRPP_PRINTF_ARG_STR: {
+    const char *v = prv_string(dec, rec, raw);
+    memcpy(host, &v, sizeof(v));
+    return (int)sizeof(v);
+  }
+  case FRPP_PRINTF_ARG_WSTR: {
+    const wchar_t *v = prv_wstring(dec, rec, raw);
+    memcpy(host, &v, sizeof(v));
+    return (int)sizeof(v);
+  }
+  case FRPP_PRINTF_ARG_PTR: {
+    // %p shows the target's address, %n has nothing to write to
+    void *v = (conversion == 'n') ? NULL : (void *)(uintptr_t)raw;
+    memcpy(host, &v, sizeof(v));
+    return (int)sizeof(v);
+  }
+  default:
+    // %@ hooks only exist on target
+    return -ENOTSUP;
+  }
+}
+
+/**
+ * @brief Translate an argument's slot of a regular target package to its
+ * host slot
+ *
+ * @param dec Decoder instance
+ * @param rec Record being translated
+ * @param arg Argument type
+ * @param conversion Conversion character of specifier, 0 if unknown
+ * @return 0 or negative error, see prv_translate
+ */
+static int prv_slot(struct frpp_log_decoder *dec, struct prv_record *rec,
+                    frpp_printf_arg_t arg, char conversion) {
+  const struct frpp_log_decode_target *target = &dec->target;
+  size_t size = prv_target_size(target, arg);
+  size_t slot = (size > target->min_align) ? size : target->min_align;
+  size_t host_slot = frpp_printf_arg_size(arg);
+  uint8_t host[FRPP_LOG_DECODE_VALUE_MAX];
+
+  if (rec->src + slot > rec->pkg_len) {
+    return -EINVAL;
+  }
+
+  if (rec->dst + host_slot > rec->out_len) {
+    return -ENOSPC;
+  }
+
+  int ret = prv_value(dec, rec, arg, conversion, &rec->pkg[rec->src], host);
+  if (ret < 0) {
+    return ret;
+  }
+
+  memcpy(&rec->out[rec->dst], host, (size_t)ret);
+  rec->src += slot;
+  rec->dst += host_slot;
+
+  return 0;
+}
+
+/**
+ * @brief Width of an integer argument stored at its natural width in a dense
+ * package rather than as a varint.  Must match the packager.
+ *
+ * @param spec Specifier
+ * @return Width in bytes, 0 if stored as a varint
+ */
+static size_t prv_dense_width(const struct frpp_printf_spec *spec) {
+  if ((spec->conversion == 'c' && spec->arg == FRPP_PRINTF_ARG_INT) ||
+      spec->length == FRPP_PRINTF_LEN_HH) {
+    return 1;
+  }
+
+  if (spec->length == FRPP_PRINTF_LEN_H) {
+    return 2;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Length of a varint
+ *
+ * @param src Varint
+ * @param len Bytes available
+ * @return Length in bytes, 0 if it runs past len
+ */
+static size_t prv_varint_len(const uint8_t *src, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if ((src[i] & 0x80U) == 0) {
+      return i + 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Copy a varint of a dense target package to the host package.
+ * Varints don't depend on the ABI.
+ *
+ * @param rec Record being translated
+ * @return 0 or negative error, see prv_translate
+ */
+static int prv_dense_varint(struct prv_record *rec) {
+  size_t size = prv_varint_len(&rec->pkg[rec->src], rec->pkg_len - rec->src);
+
+  if (size == 0) {
+    return -EINVAL;
+  }
+
+  if (rec->dst + size > rec->out_len) {
+    return -ENOSPC;
+  }
+
+  memcpy(&rec->out[rec->dst], &rec->pkg[rec->src], size);
+  rec->src += size;
+  rec->dst += size;
+
+  return 0;
+}
+
+/**
+ * @brief Translate an argument of a dense target package to the host package
+ *
+ * @param dec Decoder instance
+ * @param rec Record being translated
+ * @param spec Specifier
+ * @return 0 or negative error, see prv_translate
+ */
+static int prv_dense_value(struct frpp_log_decoder *dec,
+                           struct prv_record *rec,
+                           const struct frpp_printf_spec *spec) {
+  uint8_t host[FRPP_LOG_DECODE_VALUE_MAX];
+  size_t size;
+  int ret;
+
+  switch (spec->arg) {
+  case FRPP_PRINTF_ARG_STR:
+  case FRPP_PRINTF_ARG_PTR:
+  case FRPP_PRINTF_ARG_WSTR:
+  case FRPP_PRINTF_ARG_DOUBLE:
+  case FRPP_PRINTF_ARG_LONG_DOUBLE:
+    // Natural width, unaligned
+    size = prv_target_size(&dec->target, spec->arg);
+    if (rec->src + size > rec->pkg_len) {
+      return -EINVAL;
+    }
+
+    ret = prv_value(dec, rec, spec->arg, spec->conversion,
+                    &rec->pkg[rec->src], host);
+    break;
+
+  case FRPP_PRINTF_ARG_UDT:
+    return -ENOTSUP;
+
+  default:
+    size = prv_dense_width(spec);
+    if (size == 0) {
+      return prv_dense_varint(rec);
+    }
+
+    if (rec->src + size > rec->pkg_len) {
+      return -EINVAL;
+    }
+
+    if (size == sizeof(short)) {
+      unsigned short half =
+          (unsigned short)prv_read(&dec->target, &rec->pkg[rec->src], size);
+      memcpy(host, &half, sizeof(half));
+      ret = (int)sizeof(half);
+    } else {
+      host[0] = rec->pkg[rec->src];
+      ret = 1;
+    }
+    break;
+  }
+
+  if (ret < 0) {
+    return ret;
+  }
+
+  if (rec->dst + (size_t)ret > rec->out_len) {
+    return -ENOSPC;
+  }
+
+  memcpy(&rec->out[rec->dst], host, (size_t)ret);
+  rec->src += size;
+  rec->dst += (size_t)ret;
+
+  return 0;
+}
+
+/**
+ * @brief Handle sync frame
+ *
+ * @param dec Decoder instance
+ * @param payload Frame payload
+ * @param len Length of payload
+ * @retval 0 Success
+ * @retval -EINVAL Malformed frame
+ * @retval -ENOTSUP Target ABI can't be represented on this host
+ */
+static int prv_sync(struct frpp_log_decoder *dec, const uint8_t *payload,
+                    size_t len) {
+  struct frpp_log_decode_target target;
+
+  if (len < FRPP_LOG_DECODE_SYNC_FIXED || memcmp(payload, "FRPD", 4) != 0 ||
+      payload[4] != FRPP_LOG_DICT_VERSION) {
+    return -EINVAL;
+  }
+
+  target.big_endian = (payload[5] & FRPP_LOG_DICT_SYNC_BIG_ENDIAN) != 0;
+  target.dense = (payload[5] & FRPP_LOG_DICT_SYNC_DENSE) != 0;
+  target.ptr_size = payload[6];
+  target.long_size = payload[7];
+  target.min_align = payload[8];
+  target.fmt_align = payload[9];
+  target.long_double_size = payload[10];
+  target.long_double_mant_dig = payload[11];
+  target.wchar_size = payload[12];
+  target.wint_size = payload[13];
+
+  if (target.ptr_size == 0 || target.ptr_size > sizeof(uint64_t) ||
+      target.wchar_size == 0 || target.wchar_size > sizeof(uint64_t) ||
+      target.wint_size == 0 || target.wint_size > sizeof(uint64_t) ||
+      len < FRPP_LOG_DECODE_SYNC_FIXED + target.ptr_size) {
+    return -EINVAL;
+  }
+
+  if (target.ptr_size > sizeof(void *) || target.long_size > sizeof(long) ||
+      target.wchar_size > sizeof(wchar_t) ||
+      target.wint_size > sizeof(wint_t)) {
+    return -ENOTSUP;
+  }
+
+  target.anchor = prv_read(&target, &payload[FRPP_LOG_DECODE_SYNC_FIXED],
+                           target.ptr_size);
+
+  dec->target = target;
+  dec->synced = true;
+
+  return 0;
+}
+
+/**
+ * @brief Translate a regular target package to a host package.  Arguments
+ * are taken in va_list order, which for positional format strings differs
+ * from specifier order.
+ *
+ * @param dec Decoder instance
+ * @param fmt Format string
+ * @param rec Record being translated
+ * @retval 0 Success
+ * @retval -EINVAL Target package is shorter than format string requires, or
+ * format string's positions are invalid
+ * @retval -ENOSPC Host package doesn't fit in output
+ * @retval -ENOTSUP Format string has a %@ specifier, whose hooks only exist
+ * on target, or a long double the host can't represent
+ */
+static int prv_translate(struct frpp_log_decoder *dec, const char *fmt,
+                         struct prv_record *rec) {
+  struct frpp_printf_pos_args pos;
+  struct frpp_printf_spec spec;
+  const char *ptr = fmt;
+  int ret = frpp_printf_parse_positions(fmt, &pos);
+
+  if (ret < 0) {
+    return -EINVAL;
+  }
+
+  if (ret > 0) {
+    char conversion[FRPP_PRINTF_POS_ARGS_MAX] = {0};
+
+    // Positions of %n, which have nothing to write to
+    while ((ptr = frpp_printf_parse_next(ptr, &spec)) != NULL) {
+      if (spec.pos > 0 && spec.pos <= FRPP_PRINTF_POS_ARGS_MAX) {
+        conversion[spec.pos - 1] = spec.conversion;
+      }
+    }
+
+    for (size_t i = 0; i < pos.count; i++) {
+      ret = prv_slot(dec, rec, (frpp_printf_arg_t)pos.types[i],
+                     conversion[i]);
+      if (ret < 0) {
+        return ret;
+      }
+    }
+
+    return 0;
+  }
+
+  while ((ptr = frpp_printf_parse_next(ptr, &spec)) != NULL) {
+    frpp_printf_arg_t types[FRPP_PRINTF_SPEC_ARGS_MAX];
+    size_t count = frpp_printf_spec_args(&spec, types);
+
+    // Width and precision arguments are ints, the value comes last
+    for (size_t i = 0; i < count; i++) {
+      ret = prv_slot(dec, rec, types[i],
+                     (i + 1 == count) ? spec.conversion : 0);
+      if (ret < 0) {
+        return ret;
+      }
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Translate a dense target package to a host dense package
+ *
+ * @param dec Decoder instance
+ * @param fmt Format string, taking its arguments in order
+ * @param rec Record being translated
+ * @return 0 on success, negative error otherwise, see prv_translate
+ */
+static int prv_translate_dense(struct frpp_log_decoder *dec, const char *fmt,
+                               struct prv_record *rec) {
+  struct frpp_printf_spec spec;
+  const char *ptr = fmt;
+  int ret = 0;
+
+  while (ret == 0 && (ptr = frpp_printf_parse_next(ptr, &spec)) != NULL) {
+    // Width and precision arguments precede the value, as int varints
+    if (spec.flags & FRPP_PRINTF_SPEC_WIDTH_ARG) {
+      ret = prv_dense_varint(rec);
+    }
+
+    if (ret == 0 && (spec.flags & FRPP_PRINTF_SPEC_PREC_ARG)) {
+      ret = prv_dense_varint(rec);
+    }
+
+    if (ret == 0 && spec.arg != FRPP_PRINTF_ARG_NONE) {
+      ret = prv_dense_value(dec, rec, &spec);
+    }
+  }
+
+  return ret;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int frpp_log_decoder_init(struct frpp_log_decoder *dec,
+                          const struct frpp_elf *elf) {
+  if (dec == NULL || elf == NULL) {
+    return -EINVAL;
+  }
+
+  memset(dec, 0, sizeof(*dec));
+  dec->elf = elf;
+
+  // Images without the anchor are assumed to run at their link address
+  if (frpp_elf_symbol(elf, "frpp_log_dict_anchor", &dec->anchor) != 0) {
+    dec->anchor = 0;
+  }
+
+  if (frpp_elf_section(elf, FRPP_LOG_FMT_SECTION, &dec->fmt_addr,
+                       &dec->fmt_size) != 0) {
+    dec->fmt_addr = 0;
+    dec->fmt_size = 0;
+  }
+
+  return 0;
+}
+
+int frpp_log_decode_frame(struct frpp_log_decoder *dec, const uint8_t *buf,
+                          size_t len, size_t *consumed, char *out,
+                          size_t out_size) {
+  if (dec == NULL || buf == NULL || consumed == NULL || out == NULL) {
+    return -EINVAL;
+  }
+
+  if (len < FRPP_LOG_DICT_HDR_SIZE) {
+    return -EAGAIN;
+  }
+
+  size_t payload_len = (size_t)buf[1] | ((size_t)buf[2] << 8);
+  if (len < FRPP_LOG_DICT_HDR_SIZE + payload_len) {
+    return -EAGAIN;
+  }
+
+  const uint8_t *payload = &buf[FRPP_LOG_DICT_HDR_SIZE];
+  *consumed = FRPP_LOG_DICT_HDR_SIZE + payload_len;
+
+  if (out_size > 0) {
+    out[0] = '\0';
+  }
+
+  switch (buf[0]) {
+  case FRPP_LOG_DICT_FRAME_SYNC:
+    return prv_sync(dec, payload, payload_len);
+
+  case FRPP_LOG_DICT_FRAME_RECORD:
+  case FRPP_LOG_DICT_FRAME_RECORD_ID:
+    break;
+
+  default:
+    // Skip frame types added by later versions
+    return 0;
+  }
+
+  if (!dec->synced) {
+    return -ENOENT;
+  }
+
+  const char *fmt;
+  size_t id_len;
+
+  if (buf[0] == FRPP_LOG_DICT_FRAME_RECORD_ID) {
+    id_len = sizeof(uint16_t);
+    if (payload_len < id_len) {
+      return -EINVAL;
+    }
+
+    uint64_t off = prv_read(&dec->target, payload, id_len) *
+                   dec->target.fmt_align;
+    if (off >= dec->fmt_size) {
+      return -ENOENT;
+    }
+
+    fmt = frpp_elf_ro_string(dec->elf, dec->fmt_addr + off);
+  } else {
+    id_len = dec->target.ptr_size;
+    if (payload_len < id_len) {
+      return -EINVAL;
+    }
+
+    uint64_t addr = prv_read(&dec->target, payload, id_len);
+    fmt = frpp_elf_ro_string(dec->elf, prv_relocate(dec, addr));
+  }
+
+  if (fmt == NULL) {
+    return -ENOENT;
+  }
+
+  // Positional format strings are packaged with the regular layout even in
+  // dense streams
+  struct frpp_printf_pos_args pos;
+  int positional = frpp_printf_parse_positions(fmt, &pos);
+  if (positional < 0) {
+    return -EINVAL;
+  }
+
+  // max_align_t backing keeps the host package aligned for frpp_snprintf
+  max_align_t pkg[FRPP_LOG_DECODE_PKG_MAX / sizeof(max_align_t)];
+  struct prv_record rec = {
+      .pkg = &payload[id_len],
+      .pkg_len = payload_len - id_len,
+      .out = (uint8_t *)pkg,
+      .out_len = sizeof(pkg),
+  };
+  uint32_t flags = 0;
+  int ret;
+
+  if (dec->target.dense && positional == 0) {
+    flags = FRPP_PRINTF_FLAG_DENSE;
+    ret = prv_translate_dense(dec, fmt, &rec);
+  } else {
+    ret = prv_translate(dec, fmt, &rec);
+  }
+
+  if (ret < 0) {
+    return ret;
+  }
+
+  return frpp_snprintf_ex(fmt, flags, pkg, out, out_size);
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file frpp_log_decode.h
+ * @author Evan Stoddard
+ * @brief Host side decoder for dictionary log streams (see frpp_log_dict.h).
+ * Packages are translated from the target's ABI to the host's and rendered
+ * with frpp_snprintf, so decoded output matches what the target would have
+ * rendered itself.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <wchar.h>
+
+#include "frpp_elf.h"
+
+#ifndef frpp_log_decode_h
+#define frpp_log_decode_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Most %s arguments of a single record that can be shown by address
+ * because they aren't in the ELF
+ */
+#define FRPP_LOG_DECODE_MAX_UNRESOLVED (8U)
+
+/**
+ * @brief Most wide characters of all %ls arguments of a single record,
+ * including terminators.  Longer strings are cut short.
+ */
+#define FRPP_LOG_DECODE_WIDE_MAX (256U)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Target description from the most recent sync frame
+ */
+struct frpp_log_decode_target {
+  bool big_endian;
+
+  /* Packages use the dense encoding */
+  bool dense;
+
+  uint8_t ptr_size;
+  uint8_t long_size;
+  uint8_t min_align;
+  uint8_t fmt_align;
+  uint8_t long_double_size;
+  uint8_t long_double_mant_dig;
+  uint8_t wchar_size;
+  uint8_t wint_size;
+
+  /* Runtime address of frpp_log_dict_anchor */
+  uint64_t anchor;
+};
+
+/**
+ * @brief Decoder instance.  Treat members as private.
+ */
+struct frpp_log_decoder {
+  /* Firmware image */
+  const struct frpp_elf *elf;
+
+  /* Link time address of frpp_log_dict_anchor */
+  uint64_t anchor;
+
+  /* Link time address and size of interned format string section */
+  uint64_t fmt_addr;
+  uint64_t fmt_size;
+
+  /* Whether a sync frame has been seen */
+  bool synced;
+
+  /* Target description */
+  struct frpp_log_decode_target target;
+
+  /* Text substituted for %s arguments that aren't in the ELF */
+  char unresolved[FRPP_LOG_DECODE_MAX_UNRESOLVED][2 + 16 + 3];
+
+  /* %ls arguments converted to the host's wchar_t */
+  wchar_t wide[FRPP_LOG_DECODE_WIDE_MAX];
+};
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize decoder
+ *
+ * @param dec Decoder instance
+ * @param elf Firmware image stream was produced by.  Must outlive decoder
+ * @retval 0 Success
+ * @retval -EINVAL Invalid input arguments
+ */
+int frpp_log_decoder_init(struct frpp_log_decoder *dec,
+                          const struct frpp_elf *elf);
+
+/**
+ * @brief Decode a single frame from the front of a stream
+ *
+ * @param dec Decoder instance
+ * @param buf Stream data
+ * @param len Length of stream data
+ * @param consumed Length of frame.  Set whenever a complete frame is present,
+ * including when decoding it fails, so the caller can skip past it
+ * @param out Output buffer for rendered record
+ * @param out_size Size of output buffer
+ * @retval Non-negative Rendered length as returned by frpp_snprintf (0 for
+ * sync frames and unknown frame types)
+ * @retval -EINVAL Invalid input arguments or malformed frame
+ * @retval -EAGAIN Stream doesn't hold a complete frame yet
+ * @retval -ENOENT Record seen before a sync frame, or its format string or
+ * format string ID isn't in the ELF
+ * @retval -ENOTSUP Target ABI can't be represented on this host, or record
+ * has a %@ argument or a long double in a format the host doesn't share
+ */
+int frpp_log_decode_frame(struct frpp_log_decoder *dec, const uint8_t *buf,
+                          size_t len, size_t *consumed, char *out,
+                          size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* frpp_log_decode_h */
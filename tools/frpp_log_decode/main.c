@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file main.c
+ * @author Evan Stoddard
+ * @brief Decode a dictionary log stream captured from a target
+ *
+ * Usage: frpp_log_decode <firmware.elf> [stream file]
+ *
+ * Reads the stream from stdin if no file is given and prints one rendered
+ * record per line.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frpp/logging/frpp_log_dict.h"
+#include "frpp_elf.h"
+#include "frpp_log_decode.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define FRPP_LOG_DECODE_LINE_MAX (1024U)
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Read entire stream into memory
+ *
+ * @param file Stream
+ * @param len Length output
+ * @return Stream contents (caller frees), or NULL on error
+ */
+static uint8_t *prv_read_all(FILE *file, size_t *len) {
+  size_t cap = 4096;
+  uint8_t *buf = malloc(cap);
+
+  *len = 0;
+
+  while (buf != NULL) {
+    *len += fread(&buf[*len], 1, cap - *len, file);
+
+    if (*len < cap) {
+      break;
+    }
+
+    uint8_t *grown = realloc(buf, cap * 2);
+    if (grown == NULL) {
+      free(buf);
+      return NULL;
+    }
+
+    buf = grown;
+    cap *= 2;
+  }
+
+  return buf;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s <firmware.elf> [stream file]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  struct frpp_elf elf = {0};
+  int ret = frpp_elf_load(&elf, argv[1]);
+  if (ret < 0) {
+    fprintf(stderr, "%s: %s\n", argv[1], strerror(-ret));
+    return EXIT_FAILURE;
+  }
+
+  FILE *file = (argc == 3) ? fopen(argv[2], "rb") : stdin;
+  if (file == NULL) {
+    fprintf(stderr, "%s: %s\n", argv[2], strerror(errno));
+    frpp_elf_free(&elf);
+    return EXIT_FAILURE;
+  }
+
+  size_t len;
+  uint8_t *stream = prv_read_all(file, &len);
+  if (file != stdin) {
+    fclose(file);
+  }
+
+  if (stream == NULL) {
+    fprintf(stderr, "out of memory\n");
+    frpp_elf_free(&elf);
+    return EXIT_FAILURE;
+  }
+
+  struct frpp_log_decoder dec;
+  frpp_log_decoder_init(&dec, &elf);
+
+  char line[FRPP_LOG_DECODE_LINE_MAX];
+  size_t pos = 0;
+  int status = EXIT_SUCCESS;
+
+  while (pos < len) {
+    size_t consumed = 0;
+    ret = frpp_log_decode_frame(&dec, &stream[pos], len - pos, &consumed, line,
+                                sizeof(line));
+
+    if (ret == -EAGAIN) {
+      fprintf(stderr, "offset %zu: truncated frame\n", pos);
+      status = EXIT_FAILURE;
+      break;
+    }
+
+    if (ret < 0) {
+      fprintf(stderr, "offset %zu: %s\n", pos, strerror(-ret));
+      status = EXIT_FAILURE;
+    } else if (stream[pos] == FRPP_LOG_DICT_FRAME_RECORD ||
+               stream[pos] == FRPP_LOG_DICT_FRAME_RECORD_ID) {
+      puts(line);
+    }
+
+    pos += consumed;
+  }
+
+  free(stream);
+  frpp_elf_free(&elf);
+
+  return status;
+}